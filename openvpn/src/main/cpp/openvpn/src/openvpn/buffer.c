@@ -189,7 +189,12 @@ free_buf(struct buffer *buf)
 static void
 free_buf_gc(struct buffer *buf, struct gc_arena *gc)
 {
+    /* small buffers live in a shared chunk and are freed with the arena */
+#ifdef DMALLOC
     if (gc)
+#else
+    if (gc && buf->capacity > GC_CHUNK_MAX_ALLOC)
+#endif
     {
         struct gc_entry **e = &gc->list;
 
@@ -347,6 +352,34 @@ cleanup:
  * Garbage collection
  */
 
+#ifndef DMALLOC
+/*
+ * Take a small allocation from the current chunk of the arena,
+ * starting a new chunk if it does not fit.
+ */
+static void *
+gc_malloc_chunk(size_t size, struct gc_arena *a)
+{
+    uint8_t *ret = (uint8_t *)(((uintptr_t)a->chunk_next + (GC_CHUNK_ALIGN - 1))
+                               & ~(uintptr_t)(GC_CHUNK_ALIGN - 1));
+
+    if (!a->chunk_next || ret + size > a->chunk_end)
+    {
+        struct gc_entry *e = (struct gc_entry *) malloc(sizeof(struct gc_entry) + GC_CHUNK_ALIGN + GC_CHUNK_SIZE);
+        check_malloc_return(e);
+        e->next = a->list;
+        a->list = e;
+
+        ret = (uint8_t *)(((uintptr_t)(e + 1) + (GC_CHUNK_ALIGN - 1))
+                          & ~(uintptr_t)(GC_CHUNK_ALIGN - 1));
+        a->chunk_end = ret + GC_CHUNK_SIZE;
+    }
+
+    a->chunk_next = ret + size;
+    return ret;
+}
+#endif
+
 void *
 #ifdef DMALLOC
 gc_malloc_debug(size_t size, bool clear, struct gc_arena *a, const char *file, int line)
@@ -355,6 +388,13 @@ gc_malloc(size_t size, bool clear, struct gc_arena *a)
 #endif
 {
     void *ret;
+#ifndef DMALLOC
+    if (a && size <= GC_CHUNK_MAX_ALLOC)
+    {
+        ret = gc_malloc_chunk(size, a);
+    }
+    else
+#endif
     if (a)
     {
         struct gc_entry *e;
@@ -423,6 +463,8 @@ x_gc_free(struct gc_arena *a)
     struct gc_entry *e;
     e = a->list;
     a->list = NULL;
+    a->chunk_next = NULL;
+    a->chunk_end = NULL;
 
     while (e != NULL)
     {
@@ -489,6 +531,10 @@ gc_transfer(struct gc_arena *dest, struct gc_arena *src)
             e->next = dest->list;
             dest->list = src->list;
             src->list = NULL;
+
+            /* the current chunk of src now belongs to dest */
+            src->chunk_next = NULL;
+            src->chunk_end = NULL;
         }
     }
 }
@@ -103,6 +103,18 @@ struct gc_entry_special
 };
 
 
+/**
+ * Size of the chunks that small \c gc_malloc() allocations are carved
+ * from.  Allocations larger than \c GC_CHUNK_MAX_ALLOC get their own
+ * \c gc_entry.
+ */
+#define GC_CHUNK_SIZE       1024
+#define GC_CHUNK_MAX_ALLOC  (GC_CHUNK_SIZE / 4)
+
+/** Alignment of memory returned by gc_malloc() from a chunk, the same
+ *  that malloc() guarantees */
+#define GC_CHUNK_ALIGN      _Alignof(max_align_t)
+
 /**
  * Garbage collection arena used to keep track of dynamically allocated
  * memory.
@@ -112,12 +124,20 @@ struct gc_entry_special
  * allocation is registered in the function's \c gc_arena argument.  All
  * the dynamically allocated memory registered in a \c gc_arena can be
  * freed using the \c gc_free() function.
+ *
+ * Small allocations do not get an entry of their own, they are taken
+ * from the most recent chunk, which is a \c gc_entry of
+ * \c GC_CHUNK_SIZE bytes, by advancing \c chunk_next.  This turns the
+ * many short strings that are typically allocated in one arena into a
+ * few calls to malloc() and free().
  */
 struct gc_arena
 {
     struct gc_entry *list;      /**< First element of the linked list of
                                  *   \c gc_entry structures. */
     struct gc_entry_special *list_special;
+    uint8_t *chunk_next;        /**< Next free byte in the current chunk */
+    uint8_t *chunk_end;         /**< End of the current chunk */
 };
 
 
@@ -1018,6 +1038,8 @@ gc_init(struct gc_arena *a)
 {
     a->list = NULL;
     a->list_special = NULL;
+    a->chunk_next = NULL;
+    a->chunk_end = NULL;
 }
 
 static inline void
@@ -234,7 +234,8 @@ dco_update_keys(dco_context_t *dco, struct tls_multi *multi)
 }
 
 static bool
-dco_check_option_ce(const struct connection_entry *ce, int msglevel)
+dco_check_option_ce(const struct options *o, const struct connection_entry *ce,
+                    int msglevel)
 {
     if (ce->fragment)
     {
@@ -262,6 +263,14 @@ dco_check_option_ce(const struct connection_entry *ce, int msglevel)
     }
 #endif
 
+#if defined(TARGET_LINUX)
+    if (o->tuntap_options.dco_userspace && !proto_is_udp(ce->proto))
+    {
+        msg(msglevel, "NOTE: TCP transport disables --dco-userspace.");
+        return false;
+    }
+#endif
+
 #if defined(_WIN32)
     if (!ce->remote)
     {
@@ -303,7 +312,7 @@ dco_check_startup_option(int msglevel, const struct options *o)
         const struct connection_list *l = o->connection_list;
         for (int i = 0; i < l->len; ++i)
         {
-            if (!dco_check_option_ce(l->array[i], msglevel))
+            if (!dco_check_option_ce(o, l->array[i], msglevel))
             {
                 return false;
             }
@@ -311,7 +320,7 @@ dco_check_startup_option(int msglevel, const struct options *o)
     }
     else
     {
-        if (!dco_check_option_ce(&o->ce, msglevel))
+        if (!dco_check_option_ce(o, &o->ce, msglevel))
         {
             return false;
         }
@@ -345,7 +354,13 @@ dco_check_startup_option(int msglevel, const struct options *o)
          * don't need to have the net_ctx percolate all the way here
          */
         int ret = net_iface_type(NULL, o->dev, iftype);
-        if ((ret == 0) && (strcmp(iftype, "ovpn-dco") != 0))
+        if ((ret == 0) && o->tuntap_options.dco_userspace)
+        {
+            msg(msglevel, "Interface %s exists, but --dco-userspace needs to "
+                "create it. Disabling data channel offload", o->dev);
+            return false;
+        }
+        else if ((ret == 0) && (strcmp(iftype, "ovpn-dco") != 0))
         {
             msg(msglevel, "Interface %s exists and is non-DCO. Disabling data channel offload",
                 o->dev);
@@ -393,6 +408,14 @@ dco_check_startup_option(int msglevel, const struct options *o)
         return false;
     }
 
+#if defined(TARGET_LINUX)
+    if (o->tuntap_options.dco_userspace)
+    {
+        /* the data channel runs in our own worker threads */
+        return true;
+    }
+#endif
+
     /* now that all options have been confirmed to be supported, check
      * if DCO is truly available on the system
      */
@@ -428,6 +451,12 @@ dco_check_option(int msglevel, const struct options *o)
     }
 #endif
 
+    if (o->shaper_total || o->shaper_client)
+    {
+        msg(msglevel, "Note: --shaper-total and --shaper-client disable data channel offload.");
+        return false;
+    }
+
     struct gc_arena gc = gc_new();
     char *tmp_ciphers = string_alloc(o->ncp_ciphers, &gc);
     const char *token;
@@ -458,6 +487,36 @@ dco_check_pull_options(int msglevel, const struct options *o)
     return true;
 }
 
+/*
+ * The --dco-userspace engine reads the UDP socket once it has a peer and
+ * hands back everything that is not data channel traffic.
+ */
+static void
+dco_attach_link_socket(dco_context_t *dco, struct link_socket *sock)
+{
+#if defined(TARGET_LINUX)
+    if (dco->user)
+    {
+        sock->dco_ctrl_sd = dco_user_ctrl_sd(dco->user);
+    }
+#endif
+}
+
+void
+dco_release_link_socket(struct context *c)
+{
+#if defined(TARGET_LINUX)
+    struct link_socket *sock = c->c2.link_socket;
+
+    if (c->c1.tuntap && c->c1.tuntap->dco.user && sock
+        && socket_defined(sock->dco_ctrl_sd))
+    {
+        dco_user_release_socket(c->c1.tuntap->dco.user, sock->sd);
+        sock->dco_ctrl_sd = SOCKET_UNDEFINED;
+    }
+#endif
+}
+
 int
 dco_p2p_add_new_peer(struct context *c)
 {
@@ -489,6 +548,7 @@ dco_p2p_add_new_peer(struct context *c)
     }
 
     c->c2.tls_multi->dco_peer_id = multi->peer_id;
+    dco_attach_link_socket(&c->c1.tuntap->dco, c->c2.link_socket);
 
     return 0;
 }
@@ -607,6 +667,10 @@ dco_multi_add_new_peer(struct multi_context *m, struct multi_instance *mi)
     }
 
     c->c2.tls_multi->dco_peer_id = peer_id;
+    if (remoteaddr)
+    {
+        dco_attach_link_socket(&c->c1.tuntap->dco, c->c2.link_socket);
+    }
 
     return 0;
 }
@@ -638,6 +702,14 @@ dco_install_iroute(struct multi_context *m, struct multi_instance *mi,
         net_route_v6_add(&m->top.net_ctx, &addr->v6.addr, addr->netbits,
                          &mi->context.c2.push_ifconfig_ipv6_local, dev, 0,
                          DCO_IROUTE_METRIC);
+#if defined(TARGET_LINUX)
+        if (c->c1.tuntap->dco.user)
+        {
+            dco_user_add_route(c->c1.tuntap->dco.user, AF_INET6,
+                               &addr->v6.addr, addr->netbits,
+                               &mi->context.c2.push_ifconfig_ipv6_local);
+        }
+#endif
     }
     else if (addrtype == MR_ADDR_IPV4)
     {
@@ -645,6 +717,17 @@ dco_install_iroute(struct multi_context *m, struct multi_instance *mi,
         net_route_v4_add(&m->top.net_ctx, &dest, addr->netbits,
                          &mi->context.c2.push_ifconfig_local, dev, 0,
                          DCO_IROUTE_METRIC);
+#if defined(TARGET_LINUX)
+        if (c->c1.tuntap->dco.user)
+        {
+            const struct in_addr net = { .s_addr = addr->v4.addr };
+            const struct in_addr gw = {
+                .s_addr = htonl(mi->context.c2.push_ifconfig_local)
+            };
+            dco_user_add_route(c->c1.tuntap->dco.user, AF_INET, &net,
+                               addr->netbits, &gw);
+        }
+#endif
     }
 #endif /* if defined(TARGET_LINUX) || defined(TARGET_FREEBSD) */
 }
@@ -671,6 +754,14 @@ dco_delete_iroutes(struct multi_context *m, struct multi_instance *mi)
             net_route_v4_del(&m->top.net_ctx, &ir->network, ir->netbits,
                              &mi->context.c2.push_ifconfig_local, dev,
                              0, DCO_IROUTE_METRIC);
+#if defined(TARGET_LINUX)
+            if (c->c1.tuntap->dco.user)
+            {
+                const struct in_addr net = { .s_addr = htonl(ir->network) };
+                dco_user_del_route(c->c1.tuntap->dco.user, AF_INET, &net,
+                                   ir->netbits);
+            }
+#endif
         }
     }
 
@@ -683,6 +774,13 @@ dco_delete_iroutes(struct multi_context *m, struct multi_instance *mi)
             net_route_v6_del(&m->top.net_ctx, &ir6->network, ir6->netbits,
                              &mi->context.c2.push_ifconfig_ipv6_local, dev,
                              0, DCO_IROUTE_METRIC);
+#if defined(TARGET_LINUX)
+            if (c->c1.tuntap->dco.user)
+            {
+                dco_user_del_route(c->c1.tuntap->dco.user, AF_INET6,
+                                   &ir6->network, ir6->netbits);
+            }
+#endif
         }
     }
 #endif /* if defined(TARGET_LINUX) || defined(TARGET_FREEBSD) */
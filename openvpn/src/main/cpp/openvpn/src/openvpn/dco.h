@@ -199,6 +199,14 @@ int dco_set_peer(dco_context_t *dco, unsigned int peerid,
  */
 void dco_remove_peer(struct context *c);
 
+/**
+ * Take the link socket back from the --dco-userspace engine before it is
+ * closed.  Does nothing when the engine is not reading the socket.
+ *
+ * @param c         the instance context that owns the link socket
+ */
+void dco_release_link_socket(struct context *c);
+
 /**
  * Install a new peer in DCO - to be called by a SERVER instance
  *
@@ -345,6 +353,11 @@ dco_remove_peer(struct context *c)
 {
 }
 
+static inline void
+dco_release_link_socket(struct context *c)
+{
+}
+
 static inline int
 dco_multi_add_new_peer(struct multi_context *m, struct multi_instance *mi)
 {
@@ -231,6 +231,22 @@ dco_new_peer(dco_context_t *dco, unsigned int peerid, int sd,
     msg(D_DCO_DEBUG, "%s: peer-id %d, fd %d, remote addr: %s", __func__,
         peerid, sd, remotestr);
 
+    if (dco->user)
+    {
+        if (remoteaddr)
+        {
+            remoteaddr = mapped_v4_to_v6(remoteaddr, &gc);
+        }
+        if (localaddr)
+        {
+            localaddr = mapped_v4_to_v6(localaddr, &gc);
+        }
+        int ret = dco_user_new_peer(dco->user, peerid, sd, localaddr,
+                                    remoteaddr, remote_in4, remote_in6);
+        gc_free(&gc);
+        return ret;
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_NEW_PEER);
     struct nlattr *attr = nla_nest_start(nl_msg, OVPN_ATTR_NEW_PEER);
     int ret = -EMSGSIZE;
@@ -407,7 +423,8 @@ ovpn_dco_init(int mode, dco_context_t *dco)
             ASSERT(false);
     }
 
-    ovpn_dco_init_netlink(dco);
+    /* netlink is set up in open_tun_dco(), --dco-userspace does not
+     * need the kernel module */
     return true;
 }
 
@@ -450,6 +467,26 @@ open_tun_dco(struct tuntap *tt, openvpn_net_ctx_t *ctx, const char *dev)
     msg(D_DCO_DEBUG, "%s: %s", __func__, dev);
     ASSERT(tt->type == DEV_TYPE_TUN);
 
+    if (tt->options.dco_userspace)
+    {
+        int ret = dco_user_open(tt->dco.ifmode, dev,
+                                tt->options.dco_user_threads, &tt->dco.user);
+        if (ret < 0)
+        {
+            msg(D_DCO_DEBUG, "Cannot create userspace DCO device %s: %d",
+                dev, ret);
+            return ret;
+        }
+
+        tt->dco.dco_message_peer_id = -1;
+        return 0;
+    }
+
+    if (!tt->dco.nl_sock)
+    {
+        ovpn_dco_init_netlink(&tt->dco);
+    }
+
     int ret = net_iface_new(ctx, dev, "ovpn-dco", &tt->dco);
     if (ret < 0)
     {
@@ -475,6 +512,14 @@ close_tun_dco(struct tuntap *tt, openvpn_net_ctx_t *ctx)
 {
     msg(D_DCO_DEBUG, __func__);
 
+    if (tt->dco.user)
+    {
+        /* closing the last queue removes the tun device */
+        dco_user_close(tt->dco.user);
+        tt->dco.user = NULL;
+        return;
+    }
+
     net_iface_del(ctx, tt->actual_name);
     ovpn_dco_uninit_netlink(&tt->dco);
 }
@@ -484,6 +529,11 @@ dco_swap_keys(dco_context_t *dco, unsigned int peerid)
 {
     msg(D_DCO_DEBUG, "%s: peer-id %d", __func__, peerid);
 
+    if (dco->user)
+    {
+        return dco_user_swap_keys(dco->user, peerid);
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_SWAP_KEYS);
     if (!nl_msg)
     {
@@ -508,6 +558,11 @@ dco_del_peer(dco_context_t *dco, unsigned int peerid)
 {
     msg(D_DCO_DEBUG, "%s: peer-id %d", __func__, peerid);
 
+    if (dco->user)
+    {
+        return dco_user_del_peer(dco->user, peerid);
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_DEL_PEER);
     if (!nl_msg)
     {
@@ -533,6 +588,11 @@ dco_del_key(dco_context_t *dco, unsigned int peerid,
 {
     msg(D_DCO_DEBUG, "%s: peer-id %d, slot %d", __func__, peerid, slot);
 
+    if (dco->user)
+    {
+        return dco_user_del_key(dco->user, peerid, slot);
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_DEL_KEY);
     if (!nl_msg)
     {
@@ -562,6 +622,13 @@ dco_new_key(dco_context_t *dco, unsigned int peerid, int keyid,
     msg(D_DCO_DEBUG, "%s: slot %d, key-id %d, peer-id %d, cipher %s",
         __func__, slot, keyid, peerid, ciphername);
 
+    if (dco->user)
+    {
+        return dco_user_new_key(dco->user, peerid, keyid, slot, encrypt_key,
+                                encrypt_iv, decrypt_key, decrypt_iv,
+                                ciphername);
+    }
+
     const size_t key_len = cipher_kt_key_size(ciphername);
     const int nonce_tail_len = 8;
 
@@ -616,6 +683,13 @@ dco_set_peer(dco_context_t *dco, unsigned int peerid,
     msg(D_DCO_DEBUG, "%s: peer-id %d, keepalive %d/%d, mss %d", __func__,
         peerid, keepalive_interval, keepalive_timeout, mss);
 
+    if (dco->user)
+    {
+        /* like ovpn-dco, the engine does not clamp the MSS */
+        return dco_user_set_peer(dco->user, peerid, keepalive_interval,
+                                 keepalive_timeout);
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_SET_PEER);
     if (!nl_msg)
     {
@@ -816,10 +890,35 @@ ovpn_handle_msg(struct nl_msg *msg, void *arg)
     return NL_OK;
 }
 
+static int
+dco_user_do_read(dco_context_t *dco)
+{
+    struct dco_user_event ev;
+
+    if (!dco_user_read_event(dco->user, &ev))
+    {
+        return 0;
+    }
+
+    msg(D_DCO_DEBUG, "dco-userspace: received cmd %d, peer-id %d, reason %d",
+        ev.type, ev.peer_id, ev.reason);
+    dco->dco_message_type = ev.type;
+    dco->dco_message_peer_id = ev.peer_id;
+    dco->dco_del_peer_reason = ev.reason;
+    dco->dco_read_bytes = ev.stats.link_rx_bytes;
+    dco->dco_write_bytes = ev.stats.link_tx_bytes;
+    return 0;
+}
+
 int
 dco_do_read(dco_context_t *dco)
 {
     msg(D_DCO_DEBUG, __func__);
+
+    if (dco->user)
+    {
+        return dco_user_do_read(dco);
+    }
     nl_cb_set(dco->nl_cb, NL_CB_VALID, NL_CB_CUSTOM, ovpn_handle_msg, dco);
 
     return ovpn_nl_recvmsgs(dco, __func__);
@@ -920,11 +1019,43 @@ dco_parse_peer_multi(struct nl_msg *msg, void *arg)
     return NL_OK;
 }
 
+static void
+dco_user_update_peer_stat(struct context_2 *c2,
+                          const struct dco_user_stats *stats)
+{
+    c2->dco_read_bytes = stats->link_rx_bytes;
+    c2->dco_write_bytes = stats->link_tx_bytes;
+    c2->tun_read_bytes = stats->vpn_rx_bytes;
+    c2->tun_write_bytes = stats->vpn_tx_bytes;
+}
+
+static void
+dco_user_peer_stat_multi(void *arg, unsigned int peer_id,
+                         const struct dco_user_stats *stats)
+{
+    struct multi_context *m = arg;
+
+    if (peer_id >= m->max_clients || !m->instances[peer_id])
+    {
+        msg(M_WARN, "%s: cannot store DCO stats for peer %u", __func__,
+            peer_id);
+        return;
+    }
+
+    dco_user_update_peer_stat(&m->instances[peer_id]->context.c2, stats);
+}
+
 int
 dco_get_peer_stats_multi(dco_context_t *dco, struct multi_context *m)
 {
     msg(D_DCO_DEBUG, "%s", __func__);
 
+    if (dco->user)
+    {
+        dco_user_foreach_peer(dco->user, dco_user_peer_stat_multi, m);
+        return 0;
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_GET_PEER);
 
     nlmsg_hdr(nl_msg)->nlmsg_flags |= NLM_F_DUMP;
@@ -988,6 +1119,17 @@ dco_get_peer_stats(struct context *c)
     }
 
     dco_context_t *dco = &c->c1.tuntap->dco;
+    if (dco->user)
+    {
+        struct dco_user_stats stats;
+        int ret = dco_user_get_stats(dco->user, peer_id, &stats);
+        if (ret == 0)
+        {
+            dco_user_update_peer_stat(&c->c2, &stats);
+        }
+        return ret;
+    }
+
     struct nl_msg *nl_msg = ovpn_dco_nlmsg_create(dco, OVPN_CMD_GET_PEER);
     struct nlattr *attr = nla_nest_start(nl_msg, OVPN_ATTR_GET_PEER);
     int ret = -EMSGSIZE;
@@ -1046,7 +1188,11 @@ dco_version_string(struct gc_arena *gc)
 void
 dco_event_set(dco_context_t *dco, struct event_set *es, void *arg)
 {
-    if (dco && dco->nl_sock)
+    if (dco && dco->user)
+    {
+        event_ctl(es, dco_user_event_sd(dco->user), EVENT_READ, arg);
+    }
+    else if (dco && dco->nl_sock)
     {
         event_ctl(es, nl_socket_get_fd(dco->nl_sock), EVENT_READ, arg);
     }
@@ -27,6 +27,7 @@
 #include "event.h"
 
 #include "ovpn_dco_linux.h"
+#include "dco_user.h"
 
 #include <netlink/socket.h>
 #include <netlink/netlink.h>
@@ -53,6 +54,9 @@ typedef struct
     int dco_del_peer_reason;
     uint64_t dco_read_bytes;
     uint64_t dco_write_bytes;
+
+    /** --dco-userspace engine, replaces the kernel module when set */
+    struct dco_user *user;
 } dco_context_t;
 
 #endif /* defined(ENABLE_DCO) && defined(TARGET_LINUX) */
@@ -0,0 +1,1706 @@
+/*
+ *  Userspace data channel offload engine for Linux
+ *
+ *  Copyright (C) 2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program (see the file COPYING included with this
+ *  distribution); if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+
+#include "syshead.h"
+
+#include "dco_user.h"
+#include "buffer.h"
+#include "crypto_backend.h"
+#include "packet_id.h"
+#include "ping.h"
+#include "socket.h"
+#include "ssl_pkt.h"
+
+#include <linux/if_tun.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "memdbg.h"
+
+/*
+ * Threading model
+ *
+ * Every worker thread owns one queue of the multi-queue tun device and
+ * its own epoll set, in which the shared link socket is registered with
+ * EPOLLEXCLUSIVE, so a datagram wakes up a single worker.  Workers hold
+ * du->lock for reading while they process a batch; everything that
+ * changes the peer, key or route tables or the link socket runs in the
+ * main thread and takes the lock for writing.  The lock prefers writers,
+ * so these changes never wait for more than one batch per worker.
+ *
+ * Within a batch, the mutable per peer state (packet id counters, replay
+ * windows, the remote address) is only touched with atomics or under
+ * peer->lock.  Each worker has its own cipher contexts for every key, so
+ * several workers can encrypt and decrypt for the same peer in parallel.
+ *
+ * Workers never call msg(): logging is not thread safe.
+ */
+
+/** Datagrams per recvmmsg()/sendmmsg() call and tun reads per wakeup */
+#define DCO_USER_BATCH          32
+
+/** Largest packet read from or written to the tun device */
+#define DCO_USER_TUN_MAX        9216
+
+/** DATA_V2 overhead: opcode/key-id/peer-id, packet id and AEAD tag */
+#define DCO_USER_HDR_SIZE       (4 + 4 + OPENVPN_AEAD_TAG_LENGTH)
+
+#define DCO_USER_PKT_SIZE       (DCO_USER_TUN_MAX + DCO_USER_HDR_SIZE)
+
+/** Size of the peer, VPN address and route hash tables */
+#define DCO_USER_HASH_SIZE      1024
+
+/** Replay window in packets, must be a multiple of 64 */
+#define DCO_USER_REPLAY_WINDOW  1024
+
+/** Peers expired by one housekeeping run, the rest waits a second */
+#define DCO_USER_EXPIRE_MAX     64
+
+#define DCO_USER_NONCE_TAIL     8
+
+/* epoll user data of the descriptors a worker waits for */
+#define DCO_USER_EV_LINK        1
+#define DCO_USER_EV_TUN         2
+#define DCO_USER_EV_WAKE        3
+
+/** Control message buffer large enough for IP_PKTINFO or IPV6_PKTINFO */
+union dco_user_cmsg
+{
+    struct cmsghdr align;
+    uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+};
+
+struct dco_user_key
+{
+    bool valid;
+    uint8_t key_id;
+    cipher_ctx_t **encrypt;     /**< one context per worker */
+    cipher_ctx_t **decrypt;     /**< one context per worker */
+    uint8_t encrypt_tail[DCO_USER_NONCE_TAIL];
+    uint8_t decrypt_tail[DCO_USER_NONCE_TAIL];
+    uint32_t tx_pid;            /**< last packet id sent, atomic */
+    uint32_t rx_pid_max;        /**< under peer->lock */
+    uint64_t rx_window[DCO_USER_REPLAY_WINDOW / 64];
+};
+
+struct dco_user_peer
+{
+    unsigned int id;
+    struct dco_user_peer *next;         /**< peer-id hash chain */
+    struct dco_user_peer *next_vpn4;    /**< VPN IPv4 address hash chain */
+    struct dco_user_peer *next_vpn6;    /**< VPN IPv6 address hash chain */
+
+    bool has_vpn4;
+    bool has_vpn6;
+    struct in_addr vpn4;
+    struct in6_addr vpn6;
+
+    struct dco_user_key keys[__OVPN_KEY_SLOT_AFTER_LAST];
+
+    /** Protects remote and the replay windows */
+    pthread_mutex_t lock;
+    struct openvpn_sockaddr remote;
+    socklen_t remote_len;
+
+    /** Local address to send from, AF_UNSPEC if the kernel picks it */
+    int local_af;
+    union {
+        struct in_pktinfo in4;
+        struct in6_pktinfo in6;
+    } local;
+
+    /* atomics */
+    int keepalive_interval;
+    int keepalive_timeout;
+    time_t last_rx;
+    time_t last_tx;
+    struct dco_user_stats stats;
+};
+
+struct dco_user_route
+{
+    struct dco_user_route *next;
+    int af;
+    int netbits;
+    uint8_t addr[16];
+    uint8_t gw[16];
+};
+
+struct dco_user_worker
+{
+    struct dco_user *du;
+    int index;
+    pthread_t thread;
+    bool started;
+    int epfd;
+    int tun_fd;
+
+    /* link socket receive batch */
+    struct mmsghdr rx_msgs[DCO_USER_BATCH];
+    struct iovec rx_iov[DCO_USER_BATCH];
+    struct openvpn_sockaddr rx_from[DCO_USER_BATCH];
+    union dco_user_cmsg rx_cmsg[DCO_USER_BATCH];
+    uint8_t rx_buf[DCO_USER_BATCH][DCO_USER_PKT_SIZE];
+
+    /* link socket send batch */
+    int n_tx;
+    struct mmsghdr tx_msgs[DCO_USER_BATCH];
+    struct iovec tx_iov[DCO_USER_BATCH];
+    struct openvpn_sockaddr tx_to[DCO_USER_BATCH];
+    union dco_user_cmsg tx_cmsg[DCO_USER_BATCH];
+    uint8_t tx_buf[DCO_USER_BATCH][DCO_USER_PKT_SIZE];
+
+    /** plaintext of the packet being processed */
+    uint8_t plain[DCO_USER_PKT_SIZE];
+};
+
+struct dco_user
+{
+    enum ovpn_mode mode;
+
+    /** Protects the tables below and the link socket, see above */
+    pthread_rwlock_t lock;
+    struct dco_user_peer *peers[DCO_USER_HASH_SIZE];
+    struct dco_user_peer *vpn4[DCO_USER_HASH_SIZE];
+    struct dco_user_peer *vpn6[DCO_USER_HASH_SIZE];
+    struct dco_user_route *routes[DCO_USER_HASH_SIZE];
+    int route_count[2][129];   /**< routes per prefix length, IPv4 and IPv6 */
+    struct dco_user_peer *p2p_peer;
+
+    int link_sd;               /**< our duplicate of the link socket */
+    int link_sd_orig;          /**< the link socket in the main loop */
+    int link_af;
+
+    int ctrl_sd[2];            /**< [0] read by the main loop, [1] workers */
+    int event_sd[2];           /**< [0] read by the main loop, [1] workers */
+    int wake_fd;
+    bool stop;
+
+    int n_workers;
+    struct dco_user_worker *workers;
+};
+
+static inline uint32_t
+dco_user_hash(const void *data, size_t len, uint32_t seed)
+{
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h % DCO_USER_HASH_SIZE;
+}
+
+static inline int
+dco_user_addr_len(int af)
+{
+    return af == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+}
+
+static void
+dco_user_mask(uint8_t *addr, int len, int netbits)
+{
+    for (int i = 0; i < len; ++i)
+    {
+        const int bits = netbits - i * 8;
+        if (bits <= 0)
+        {
+            addr[i] = 0;
+        }
+        else if (bits < 8)
+        {
+            addr[i] &= (uint8_t)(0xff << (8 - bits));
+        }
+    }
+}
+
+/*
+ * Table lookups, called with du->lock held.
+ */
+
+static struct dco_user_peer *
+dco_user_find_peer(struct dco_user *du, unsigned int peerid)
+{
+    struct dco_user_peer *peer = du->peers[peerid % DCO_USER_HASH_SIZE];
+
+    while (peer && peer->id != peerid)
+    {
+        peer = peer->next;
+    }
+    return peer;
+}
+
+static struct dco_user_peer *
+dco_user_find_vpn_peer(struct dco_user *du, int af, const void *addr)
+{
+    const int len = dco_user_addr_len(af);
+    const uint32_t h = dco_user_hash(addr, len, 0);
+
+    if (af == AF_INET)
+    {
+        for (struct dco_user_peer *peer = du->vpn4[h]; peer; peer = peer->next_vpn4)
+        {
+            if (!memcmp(&peer->vpn4, addr, len))
+            {
+                return peer;
+            }
+        }
+    }
+    else
+    {
+        for (struct dco_user_peer *peer = du->vpn6[h]; peer; peer = peer->next_vpn6)
+        {
+            if (!memcmp(&peer->vpn6, addr, len))
+            {
+                return peer;
+            }
+        }
+    }
+    return NULL;
+}
+
+static struct dco_user_route **
+dco_user_find_route(struct dco_user *du, int af, const uint8_t *addr,
+                    int netbits)
+{
+    const int len = dco_user_addr_len(af);
+    struct dco_user_route **rp =
+        &du->routes[dco_user_hash(addr, len, (uint32_t)(af << 8 | netbits))];
+
+    while (*rp && ((*rp)->af != af || (*rp)->netbits != netbits
+                   || memcmp((*rp)->addr, addr, len)))
+    {
+        rp = &(*rp)->next;
+    }
+    return rp;
+}
+
+/**
+ * Find the peer a packet to \c dst has to be sent to: the peer with that
+ * VPN address, otherwise the peer behind the longest matching iroute.
+ */
+static struct dco_user_peer *
+dco_user_route_lookup(struct dco_user *du, int af, const uint8_t *dst)
+{
+    struct dco_user_peer *peer = dco_user_find_vpn_peer(du, af, dst);
+    if (peer)
+    {
+        return peer;
+    }
+
+    const int len = dco_user_addr_len(af);
+    const int *count = du->route_count[af == AF_INET ? 0 : 1];
+    for (int netbits = len * 8; netbits >= 0; --netbits)
+    {
+        if (!count[netbits])
+        {
+            continue;
+        }
+
+        uint8_t net[16];
+        memcpy(net, dst, len);
+        dco_user_mask(net, len, netbits);
+
+        const struct dco_user_route *route =
+            *dco_user_find_route(du, af, net, netbits);
+        if (route)
+        {
+            return dco_user_find_vpn_peer(du, af, route->gw);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Peer that owns a packet read from the tun device, looked up by its
+ * destination address in MP mode.
+ */
+static struct dco_user_peer *
+dco_user_tun_peer(struct dco_user *du, const uint8_t *pkt, int len)
+{
+    if (du->mode == OVPN_MODE_P2P)
+    {
+        return du->p2p_peer;
+    }
+
+    if (len >= 20 && (pkt[0] >> 4) == 4)
+    {
+        return dco_user_route_lookup(du, AF_INET, pkt + 16);
+    }
+    if (len >= 40 && (pkt[0] >> 4) == 6)
+    {
+        return dco_user_route_lookup(du, AF_INET6, pkt + 24);
+    }
+    return NULL;
+}
+
+/**
+ * Check that a decrypted packet may be sent to the tun device: it must
+ * be IP and, in MP mode, its source address must route back to the peer
+ * it came from.
+ */
+static bool
+dco_user_source_ok(struct dco_user *du, const struct dco_user_peer *peer,
+                   const uint8_t *pkt, int len)
+{
+    if (len >= 20 && (pkt[0] >> 4) == 4)
+    {
+        return du->mode == OVPN_MODE_P2P
+               || dco_user_route_lookup(du, AF_INET, pkt + 12) == peer;
+    }
+    if (len >= 40 && (pkt[0] >> 4) == 6)
+    {
+        return du->mode == OVPN_MODE_P2P
+               || dco_user_route_lookup(du, AF_INET6, pkt + 8) == peer;
+    }
+    return false;
+}
+
+/*
+ * Notifications for the main loop
+ */
+
+static void
+dco_user_post_event(struct dco_user *du, int type, unsigned int peerid,
+                    int reason, const struct dco_user_stats *stats)
+{
+    struct dco_user_event ev;
+
+    CLEAR(ev);
+    ev.type = type;
+    ev.peer_id = (int)peerid;
+    ev.reason = reason;
+    if (stats)
+    {
+        ev.stats = *stats;
+    }
+
+    /* the socket buffer holds thousands of these, when it is full the main
+     * loop is hopelessly behind and will find out about the peer anyway */
+    (void)send(du->event_sd[1], &ev, sizeof(ev), MSG_DONTWAIT);
+}
+
+static void
+dco_user_copy_stats(const struct dco_user_peer *peer,
+                    struct dco_user_stats *stats)
+{
+    stats->link_rx_bytes = __atomic_load_n(&peer->stats.link_rx_bytes, __ATOMIC_RELAXED);
+    stats->link_tx_bytes = __atomic_load_n(&peer->stats.link_tx_bytes, __ATOMIC_RELAXED);
+    stats->vpn_rx_bytes = __atomic_load_n(&peer->stats.vpn_rx_bytes, __ATOMIC_RELAXED);
+    stats->vpn_tx_bytes = __atomic_load_n(&peer->stats.vpn_tx_bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Keys
+ */
+
+static void
+dco_user_key_free(struct dco_user *du, struct dco_user_key *key)
+{
+    for (int i = 0; key->encrypt && i < du->n_workers; ++i)
+    {
+        cipher_ctx_free(key->encrypt[i]);
+    }
+    for (int i = 0; key->decrypt && i < du->n_workers; ++i)
+    {
+        cipher_ctx_free(key->decrypt[i]);
+    }
+    free(key->encrypt);
+    free(key->decrypt);
+    secure_memzero(key, sizeof(*key));
+}
+
+static void
+dco_user_key_init(struct dco_user *du, struct dco_user_key *key, int keyid,
+                  const uint8_t *encrypt_key, const uint8_t *encrypt_iv,
+                  const uint8_t *decrypt_key, const uint8_t *decrypt_iv,
+                  const char *ciphername)
+{
+    CLEAR(*key);
+    key->valid = true;
+    key->key_id = (uint8_t)keyid;
+    memcpy(key->encrypt_tail, encrypt_iv, DCO_USER_NONCE_TAIL);
+    memcpy(key->decrypt_tail, decrypt_iv, DCO_USER_NONCE_TAIL);
+
+    ALLOC_ARRAY_CLEAR(key->encrypt, cipher_ctx_t *, du->n_workers);
+    ALLOC_ARRAY_CLEAR(key->decrypt, cipher_ctx_t *, du->n_workers);
+    for (int i = 0; i < du->n_workers; ++i)
+    {
+        key->encrypt[i] = cipher_ctx_new();
+        cipher_ctx_init(key->encrypt[i], encrypt_key, ciphername,
+                        OPENVPN_OP_ENCRYPT);
+        key->decrypt[i] = cipher_ctx_new();
+        cipher_ctx_init(key->decrypt[i], decrypt_key, ciphername,
+                        OPENVPN_OP_DECRYPT);
+    }
+}
+
+static struct dco_user_key *
+dco_user_rx_key(struct dco_user_peer *peer, uint8_t key_id)
+{
+    for (int slot = 0; slot < __OVPN_KEY_SLOT_AFTER_LAST; ++slot)
+    {
+        if (peer->keys[slot].valid && peer->keys[slot].key_id == key_id)
+        {
+            return &peer->keys[slot];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Sliding window replay protection.  With \c update false only check
+ * whether \c pid would be accepted, so that unauthenticated packets do
+ * not move the window.  Called with peer->lock held.
+ */
+static bool
+dco_user_replay_check(struct dco_user_key *key, uint32_t pid, bool update)
+{
+    const uint32_t bit = pid % DCO_USER_REPLAY_WINDOW;
+    uint64_t *word = &key->rx_window[bit / 64];
+    const uint64_t mask = (uint64_t)1 << (bit % 64);
+
+    if (pid == 0)
+    {
+        return false;
+    }
+
+    if (pid > key->rx_pid_max)
+    {
+        if (!update)
+        {
+            return true;
+        }
+
+        if (pid - key->rx_pid_max >= DCO_USER_REPLAY_WINDOW)
+        {
+            CLEAR(key->rx_window);
+        }
+        else
+        {
+            for (uint32_t p = key->rx_pid_max + 1; p != pid; ++p)
+            {
+                const uint32_t b = p % DCO_USER_REPLAY_WINDOW;
+                key->rx_window[b / 64] &= ~((uint64_t)1 << (b % 64));
+            }
+        }
+        key->rx_pid_max = pid;
+    }
+    else if (key->rx_pid_max - pid >= DCO_USER_REPLAY_WINDOW || (*word & mask))
+    {
+        return false;
+    }
+
+    if (update)
+    {
+        *word |= mask;
+    }
+    return true;
+}
+
+/*
+ * Data channel, runs in the workers with du->lock held for reading
+ */
+
+static void
+dco_user_flush_tx(struct dco_user_worker *w)
+{
+    struct dco_user *du = w->du;
+    int sent = 0;
+
+    while (sent < w->n_tx)
+    {
+        const int ret = sendmmsg(du->link_sd, &w->tx_msgs[sent],
+                                 w->n_tx - sent, MSG_DONTWAIT);
+        if (ret <= 0)
+        {
+            /* socket buffer full or transport error: drop the rest, like
+             * the kernel does */
+            break;
+        }
+        sent += ret;
+    }
+    w->n_tx = 0;
+}
+
+/**
+ * Encrypt \c len bytes of \c in with the primary key of \c peer and
+ * queue the result for sending.
+ */
+static void
+dco_user_encrypt(struct dco_user_worker *w, struct dco_user_peer *peer,
+                 const uint8_t *in, int len, time_t now)
+{
+    struct dco_user *du = w->du;
+    struct dco_user_key *key = &peer->keys[OVPN_KEY_SLOT_PRIMARY];
+
+    if (!key->valid || du->link_sd < 0)
+    {
+        return;
+    }
+
+    /* packet ids must never wrap for the same key */
+    uint32_t pid = __atomic_load_n(&key->tx_pid, __ATOMIC_RELAXED);
+    do
+    {
+        if (pid == UINT32_MAX)
+        {
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&key->tx_pid, &pid, pid + 1, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    ++pid;
+
+    if (pid == PACKET_ID_WRAP_TRIGGER)
+    {
+        /* ask the main loop to renegotiate long before we run out */
+        dco_user_post_event(du, OVPN_CMD_SWAP_KEYS, peer->id, 0, NULL);
+    }
+
+    const int i = w->n_tx;
+    uint8_t *out = w->tx_buf[i];
+    const uint32_t op = htonl(((uint32_t)((P_DATA_V2 << P_OPCODE_SHIFT) | key->key_id) << 24)
+                              | (peer->id & 0xFFFFFF));
+    const uint32_t npid = htonl(pid);
+    uint8_t iv[4 + DCO_USER_NONCE_TAIL];
+    int outlen = 0, finallen = 0;
+
+    memcpy(out, &op, sizeof(op));
+    memcpy(out + 4, &npid, sizeof(npid));
+    memcpy(iv, &npid, sizeof(npid));
+    memcpy(iv + 4, key->encrypt_tail, DCO_USER_NONCE_TAIL);
+
+    cipher_ctx_t *ctx = key->encrypt[w->index];
+    if (!cipher_ctx_reset(ctx, iv)
+        || !cipher_ctx_update_ad(ctx, out, 8)
+        || !cipher_ctx_update(ctx, out + DCO_USER_HDR_SIZE, &outlen,
+                              (uint8_t *)in, len)
+        || !cipher_ctx_final(ctx, out + DCO_USER_HDR_SIZE + outlen, &finallen)
+        || !cipher_ctx_get_tag(ctx, out + 8, OPENVPN_AEAD_TAG_LENGTH))
+    {
+        crypto_clear_error();
+        return;
+    }
+
+    const int pktlen = DCO_USER_HDR_SIZE + outlen + finallen;
+    struct msghdr *mh = &w->tx_msgs[i].msg_hdr;
+
+    CLEAR(*mh);
+    w->tx_iov[i].iov_base = out;
+    w->tx_iov[i].iov_len = pktlen;
+    mh->msg_iov = &w->tx_iov[i];
+    mh->msg_iovlen = 1;
+
+    pthread_mutex_lock(&peer->lock);
+    w->tx_to[i] = peer->remote;
+    mh->msg_namelen = peer->remote_len;
+    pthread_mutex_unlock(&peer->lock);
+    mh->msg_name = &w->tx_to[i].addr;
+
+    if (peer->local_af != AF_UNSPEC && peer->local_af == du->link_af)
+    {
+        struct cmsghdr *cmsg = &w->tx_cmsg[i].align;
+        mh->msg_control = w->tx_cmsg[i].buf;
+        if (peer->local_af == AF_INET)
+        {
+            mh->msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+            cmsg->cmsg_level = SOL_IP;
+            cmsg->cmsg_type = IP_PKTINFO;
+            memcpy(CMSG_DATA(cmsg), &peer->local.in4, sizeof(struct in_pktinfo));
+        }
+        else
+        {
+            mh->msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+            cmsg->cmsg_level = IPPROTO_IPV6;
+            cmsg->cmsg_type = IPV6_PKTINFO;
+            memcpy(CMSG_DATA(cmsg), &peer->local.in6, sizeof(struct in6_pktinfo));
+        }
+    }
+
+    __atomic_add_fetch(&peer->stats.vpn_tx_bytes, len, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&peer->stats.link_tx_bytes, pktlen, __ATOMIC_RELAXED);
+    __atomic_store_n(&peer->last_tx, now, __ATOMIC_RELAXED);
+
+    if (++w->n_tx == DCO_USER_BATCH)
+    {
+        dco_user_flush_tx(w);
+    }
+}
+
+static bool
+dco_user_same_addr(const struct openvpn_sockaddr *a,
+                   const struct openvpn_sockaddr *b)
+{
+    if (a->addr.sa.sa_family != b->addr.sa.sa_family)
+    {
+        return false;
+    }
+    if (a->addr.sa.sa_family == AF_INET)
+    {
+        return a->addr.in4.sin_port == b->addr.in4.sin_port
+               && a->addr.in4.sin_addr.s_addr == b->addr.in4.sin_addr.s_addr;
+    }
+    return a->addr.in6.sin6_port == b->addr.in6.sin6_port
+           && IN6_ARE_ADDR_EQUAL(&a->addr.in6.sin6_addr, &b->addr.in6.sin6_addr);
+}
+
+/**
+ * Decrypt a DATA_V2 packet of \c peer and write it to the tun device.
+ * Packets that fail authentication or the replay check are dropped.
+ */
+static void
+dco_user_decrypt(struct dco_user_worker *w, struct dco_user_peer *peer,
+                 uint8_t *pkt, int len, const struct openvpn_sockaddr *from,
+                 socklen_t fromlen, time_t now)
+{
+    struct dco_user *du = w->du;
+    struct dco_user_key *key = dco_user_rx_key(peer, pkt[0] & P_KEY_ID_MASK);
+    uint32_t pid;
+
+    if (!key)
+    {
+        return;
+    }
+
+    memcpy(&pid, pkt + 4, sizeof(pid));
+    pid = ntohl(pid);
+
+    pthread_mutex_lock(&peer->lock);
+    bool fresh = dco_user_replay_check(key, pid, false);
+    pthread_mutex_unlock(&peer->lock);
+    if (!fresh)
+    {
+        return;
+    }
+
+    uint8_t iv[4 + DCO_USER_NONCE_TAIL];
+    int outlen = 0, finallen = 0;
+
+    memcpy(iv, pkt + 4, 4);
+    memcpy(iv + 4, key->decrypt_tail, DCO_USER_NONCE_TAIL);
+
+    cipher_ctx_t *ctx = key->decrypt[w->index];
+    if (!cipher_ctx_reset(ctx, iv)
+        || !cipher_ctx_update_ad(ctx, pkt, 8)
+        || !cipher_ctx_update(ctx, w->plain, &outlen, pkt + DCO_USER_HDR_SIZE,
+                              len - DCO_USER_HDR_SIZE)
+        || !cipher_ctx_final_check_tag(ctx, w->plain + outlen, &finallen,
+                                       pkt + 8, OPENVPN_AEAD_TAG_LENGTH))
+    {
+        crypto_clear_error();
+        return;
+    }
+    const int plainlen = outlen + finallen;
+
+    /* the packet is authentic: move the window and follow the peer if it
+     * moved to another address */
+    pthread_mutex_lock(&peer->lock);
+    fresh = dco_user_replay_check(key, pid, true);
+    if (fresh && !dco_user_same_addr(&peer->remote, from))
+    {
+        peer->remote = *from;
+        peer->remote_len = fromlen;
+    }
+    pthread_mutex_unlock(&peer->lock);
+    if (!fresh)
+    {
+        return;
+    }
+
+    __atomic_add_fetch(&peer->stats.link_rx_bytes, len, __ATOMIC_RELAXED);
+    __atomic_store_n(&peer->last_rx, now, __ATOMIC_RELAXED);
+
+    if (plainlen == PING_STRING_SIZE
+        && !memcmp(w->plain, ping_string, PING_STRING_SIZE))
+    {
+        return;
+    }
+
+    if (!dco_user_source_ok(du, peer, w->plain, plainlen))
+    {
+        return;
+    }
+
+    if (write(w->tun_fd, w->plain, plainlen) == plainlen)
+    {
+        __atomic_add_fetch(&peer->stats.vpn_rx_bytes, plainlen, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Hand a packet the engine does not handle itself to the main loop,
+ * prefixed with the sender as struct link_socket_actual.
+ */
+static void
+dco_user_pass_up(struct dco_user_worker *w, int i)
+{
+    struct dco_user *du = w->du;
+    struct msghdr *mh = &w->rx_msgs[i].msg_hdr;
+    struct link_socket_actual from;
+
+    CLEAR(from);
+    memcpy(&from.dest.addr, mh->msg_name,
+           min_int(mh->msg_namelen, sizeof(from.dest.addr)));
+
+#if ENABLE_IP_PKTINFO
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(mh); cmsg;
+         cmsg = CMSG_NXTHDR(mh, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_PKTINFO
+            && cmsg->cmsg_len >= CMSG_LEN(sizeof(struct in_pktinfo)))
+        {
+            const struct in_pktinfo *pkti = (struct in_pktinfo *)CMSG_DATA(cmsg);
+            from.pi.in4.ipi_ifindex = pkti->ipi_ifindex;
+            from.pi.in4.ipi_spec_dst = pkti->ipi_spec_dst;
+        }
+        else if (cmsg->cmsg_level == IPPROTO_IPV6
+                 && cmsg->cmsg_type == IPV6_PKTINFO
+                 && cmsg->cmsg_len >= CMSG_LEN(sizeof(struct in6_pktinfo)))
+        {
+            const struct in6_pktinfo *pkti6 = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+            from.pi.in6.ipi6_ifindex = pkti6->ipi6_ifindex;
+            from.pi.in6.ipi6_addr = pkti6->ipi6_addr;
+        }
+    }
+#endif
+
+    struct iovec iov[2] = {
+        { .iov_base = &from, .iov_len = sizeof(from) },
+        { .iov_base = w->rx_buf[i], .iov_len = w->rx_msgs[i].msg_len },
+    };
+    struct msghdr up = { .msg_iov = iov, .msg_iovlen = 2 };
+
+    (void)sendmsg(du->ctrl_sd[1], &up, MSG_DONTWAIT);
+}
+
+static void
+dco_user_link_read(struct dco_user_worker *w)
+{
+    struct dco_user *du = w->du;
+
+    pthread_rwlock_rdlock(&du->lock);
+    if (du->link_sd < 0)
+    {
+        pthread_rwlock_unlock(&du->lock);
+        return;
+    }
+
+    for (int i = 0; i < DCO_USER_BATCH; ++i)
+    {
+        struct msghdr *mh = &w->rx_msgs[i].msg_hdr;
+        w->rx_iov[i].iov_base = w->rx_buf[i];
+        w->rx_iov[i].iov_len = DCO_USER_PKT_SIZE;
+        mh->msg_iov = &w->rx_iov[i];
+        mh->msg_iovlen = 1;
+        mh->msg_name = &w->rx_from[i].addr;
+        mh->msg_namelen = sizeof(w->rx_from[i].addr);
+        mh->msg_control = w->rx_cmsg[i].buf;
+        mh->msg_controllen = sizeof(w->rx_cmsg[i].buf);
+        mh->msg_flags = 0;
+    }
+
+    const int n = recvmmsg(du->link_sd, w->rx_msgs, DCO_USER_BATCH,
+                           MSG_DONTWAIT, NULL);
+    const time_t now = time(NULL);
+
+    for (int i = 0; i < n; ++i)
+    {
+        uint8_t *pkt = w->rx_buf[i];
+        const int len = (int)w->rx_msgs[i].msg_len;
+
+        if (w->rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            continue;
+        }
+
+        if (len > DCO_USER_HDR_SIZE
+            && (pkt[0] >> P_OPCODE_SHIFT) == P_DATA_V2)
+        {
+            /* like the kernel module, a P2P instance does not look at the
+             * peer-id */
+            const unsigned int peerid = pkt[1] << 16 | pkt[2] << 8 | pkt[3];
+            struct dco_user_peer *peer = du->mode == OVPN_MODE_P2P
+                                         ? du->p2p_peer
+                                         : dco_user_find_peer(du, peerid);
+            if (peer)
+            {
+                dco_user_decrypt(w, peer, pkt, len, &w->rx_from[i],
+                                 w->rx_msgs[i].msg_hdr.msg_namelen, now);
+                continue;
+            }
+        }
+
+        dco_user_pass_up(w, i);
+    }
+
+    pthread_rwlock_unlock(&du->lock);
+}
+
+static void
+dco_user_tun_read(struct dco_user_worker *w)
+{
+    struct dco_user *du = w->du;
+
+    pthread_rwlock_rdlock(&du->lock);
+    const time_t now = time(NULL);
+
+    for (int i = 0; i < DCO_USER_BATCH; ++i)
+    {
+        /* read one byte more than we handle to notice oversized packets */
+        const ssize_t len = read(w->tun_fd, w->plain, DCO_USER_TUN_MAX + 1);
+        if (len <= 0)
+        {
+            break;
+        }
+        if (len > DCO_USER_TUN_MAX)
+        {
+            continue;
+        }
+
+        struct dco_user_peer *peer = dco_user_tun_peer(du, w->plain, (int)len);
+        if (peer)
+        {
+            dco_user_encrypt(w, peer, w->plain, (int)len, now);
+        }
+    }
+    if (w->n_tx)
+    {
+        dco_user_flush_tx(w);
+    }
+
+    pthread_rwlock_unlock(&du->lock);
+}
+
+static void
+dco_user_peer_free(struct dco_user *du, struct dco_user_peer *peer)
+{
+    for (int slot = 0; slot < __OVPN_KEY_SLOT_AFTER_LAST; ++slot)
+    {
+        dco_user_key_free(du, &peer->keys[slot]);
+    }
+    pthread_mutex_destroy(&peer->lock);
+    free(peer);
+}
+
+/**
+ * Remove a peer from all tables, called with du->lock held for writing.
+ */
+static void
+dco_user_unlink_peer(struct dco_user *du, struct dco_user_peer *peer)
+{
+    struct dco_user_peer **pp = &du->peers[peer->id % DCO_USER_HASH_SIZE];
+    while (*pp != peer)
+    {
+        pp = &(*pp)->next;
+    }
+    *pp = peer->next;
+
+    if (peer->has_vpn4)
+    {
+        pp = &du->vpn4[dco_user_hash(&peer->vpn4, sizeof(peer->vpn4), 0)];
+        while (*pp != peer)
+        {
+            pp = &(*pp)->next_vpn4;
+        }
+        *pp = peer->next_vpn4;
+    }
+
+    if (peer->has_vpn6)
+    {
+        pp = &du->vpn6[dco_user_hash(&peer->vpn6, sizeof(peer->vpn6), 0)];
+        while (*pp != peer)
+        {
+            pp = &(*pp)->next_vpn6;
+        }
+        *pp = peer->next_vpn6;
+    }
+
+    if (du->p2p_peer == peer)
+    {
+        du->p2p_peer = NULL;
+    }
+}
+
+static void
+dco_user_expire(struct dco_user *du, unsigned int peerid)
+{
+    struct dco_user_stats stats;
+
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        dco_user_unlink_peer(du, peer);
+        dco_user_copy_stats(peer, &stats);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    if (peer)
+    {
+        dco_user_post_event(du, OVPN_CMD_DEL_PEER, peerid,
+                            OVPN_DEL_PEER_REASON_EXPIRED, &stats);
+        dco_user_peer_free(du, peer);
+    }
+}
+
+/**
+ * Send keepalive pings and expire silent peers, once per second in the
+ * first worker.
+ */
+static void
+dco_user_housekeeping(struct dco_user_worker *w, time_t now)
+{
+    struct dco_user *du = w->du;
+    unsigned int expired[DCO_USER_EXPIRE_MAX];
+    int n_expired = 0;
+
+    pthread_rwlock_rdlock(&du->lock);
+    for (int h = 0; h < DCO_USER_HASH_SIZE; ++h)
+    {
+        for (struct dco_user_peer *peer = du->peers[h]; peer; peer = peer->next)
+        {
+            const int interval = __atomic_load_n(&peer->keepalive_interval, __ATOMIC_RELAXED);
+            const int timeout = __atomic_load_n(&peer->keepalive_timeout, __ATOMIC_RELAXED);
+            const time_t last_rx = __atomic_load_n(&peer->last_rx, __ATOMIC_RELAXED);
+            const time_t last_tx = __atomic_load_n(&peer->last_tx, __ATOMIC_RELAXED);
+
+            if (timeout > 0 && now - last_rx >= timeout)
+            {
+                if (n_expired < DCO_USER_EXPIRE_MAX)
+                {
+                    expired[n_expired++] = peer->id;
+                }
+            }
+            else if (interval > 0 && now - last_tx >= interval)
+            {
+                dco_user_encrypt(w, peer, ping_string, PING_STRING_SIZE, now);
+            }
+        }
+    }
+    if (w->n_tx)
+    {
+        dco_user_flush_tx(w);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    for (int i = 0; i < n_expired; ++i)
+    {
+        dco_user_expire(du, expired[i]);
+    }
+}
+
+static void *
+dco_user_worker_main(void *arg)
+{
+    struct dco_user_worker *w = arg;
+    struct dco_user *du = w->du;
+    time_t next_housekeeping = 0;
+
+    while (!__atomic_load_n(&du->stop, __ATOMIC_ACQUIRE))
+    {
+        struct epoll_event events[3];
+        const int n = epoll_wait(w->epfd, events, SIZE(events), 1000);
+
+        for (int i = 0; i < n; ++i)
+        {
+            switch (events[i].data.u32)
+            {
+                case DCO_USER_EV_LINK:
+                    dco_user_link_read(w);
+                    break;
+
+                case DCO_USER_EV_TUN:
+                    dco_user_tun_read(w);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        if (w->index == 0)
+        {
+            const time_t now = time(NULL);
+            if (now >= next_housekeeping)
+            {
+                dco_user_housekeeping(w, now);
+                next_housekeeping = now + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Link socket ownership, called with du->lock held for writing
+ */
+
+static void
+dco_user_detach_socket(struct dco_user *du)
+{
+    if (du->link_sd < 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < du->n_workers; ++i)
+    {
+        epoll_ctl(du->workers[i].epfd, EPOLL_CTL_DEL, du->link_sd, NULL);
+    }
+    close(du->link_sd);
+    du->link_sd = -1;
+    du->link_sd_orig = -1;
+
+    /* control packets from the old socket are of no use to anyone */
+    uint8_t drain[1];
+    while (recv(du->ctrl_sd[0], drain, sizeof(drain), MSG_DONTWAIT) >= 0)
+    {
+    }
+}
+
+static int
+dco_user_attach_socket(struct dco_user *du, int sd)
+{
+    if (du->link_sd >= 0 && du->link_sd_orig == sd)
+    {
+        return 0;
+    }
+    dco_user_detach_socket(du);
+
+    struct openvpn_sockaddr local;
+    socklen_t len = sizeof(local.addr);
+    if (getsockname(sd, &local.addr.sa, &len) < 0)
+    {
+        return -errno;
+    }
+
+    const int fd = fcntl(sd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -errno;
+    }
+
+    for (int i = 0; i < du->n_workers; ++i)
+    {
+        struct epoll_event ev;
+        CLEAR(ev);
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.u32 = DCO_USER_EV_LINK;
+        if (epoll_ctl(du->workers[i].epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            const int err = -errno;
+            while (--i >= 0)
+            {
+                epoll_ctl(du->workers[i].epfd, EPOLL_CTL_DEL, fd, NULL);
+            }
+            close(fd);
+            return err;
+        }
+    }
+
+    du->link_sd = fd;
+    du->link_sd_orig = sd;
+    du->link_af = local.addr.sa.sa_family;
+    return 0;
+}
+
+/**
+ * Store \c sa as the peer's remote in the form the link socket expects,
+ * i.e. IPv4 addresses as v4-mapped IPv6 on a dual stack socket.
+ */
+static void
+dco_user_set_remote(struct dco_user *du, struct dco_user_peer *peer,
+                    const struct sockaddr *sa)
+{
+    CLEAR(peer->remote);
+    if (sa->sa_family == AF_INET && du->link_af == AF_INET6)
+    {
+        const struct sockaddr_in *in4 = (const struct sockaddr_in *)sa;
+        struct sockaddr_in6 *in6 = &peer->remote.addr.in6;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = in4->sin_port;
+        in6->sin6_addr.s6_addr[10] = 0xff;
+        in6->sin6_addr.s6_addr[11] = 0xff;
+        memcpy(&in6->sin6_addr.s6_addr[12], &in4->sin_addr, sizeof(in4->sin_addr));
+        peer->remote_len = sizeof(*in6);
+    }
+    else if (sa->sa_family == AF_INET)
+    {
+        peer->remote.addr.in4 = *(const struct sockaddr_in *)sa;
+        peer->remote_len = sizeof(struct sockaddr_in);
+    }
+    else
+    {
+        peer->remote.addr.in6 = *(const struct sockaddr_in6 *)sa;
+        peer->remote_len = sizeof(struct sockaddr_in6);
+    }
+}
+
+/*
+ * Main loop interface
+ */
+
+static int
+dco_user_open_queue(const char *dev, bool first)
+{
+    struct ifreq ifr;
+    const int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return -errno;
+    }
+
+    CLEAR(ifr);
+    ifr.ifr_flags = IFF_TUN | IFF_NO_PI | IFF_MULTI_QUEUE;
+    if (first)
+    {
+        /* never attach to a device somebody else is using */
+        ifr.ifr_flags |= IFF_TUN_EXCL;
+    }
+    strncpynt(ifr.ifr_name, dev, IFNAMSIZ);
+
+    if (ioctl(fd, TUNSETIFF, (void *)&ifr) < 0)
+    {
+        const int err = -errno;
+        close(fd);
+        return err;
+    }
+    return fd;
+}
+
+int
+dco_user_open(enum ovpn_mode mode, const char *dev, int threads,
+              struct dco_user **dup)
+{
+    struct dco_user *du;
+    int ret = 0;
+
+    if (threads <= 0)
+    {
+        threads = max_int((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    }
+    threads = min_int(threads, DCO_USER_THREADS_MAX);
+
+    ALLOC_OBJ_CLEAR(du, struct dco_user);
+    du->mode = mode;
+    du->link_sd = du->link_sd_orig = -1;
+    du->ctrl_sd[0] = du->ctrl_sd[1] = -1;
+    du->event_sd[0] = du->event_sd[1] = -1;
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr,
+                                  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&du->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    du->n_workers = threads;
+    ALLOC_ARRAY_CLEAR(du->workers, struct dco_user_worker, threads);
+    for (int i = 0; i < threads; ++i)
+    {
+        du->workers[i].du = du;
+        du->workers[i].index = i;
+        du->workers[i].epfd = du->workers[i].tun_fd = -1;
+    }
+
+    du->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (du->wake_fd < 0
+        || socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                      du->ctrl_sd) < 0
+        || socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+                      du->event_sd) < 0)
+    {
+        ret = -errno;
+        goto err;
+    }
+
+    /* room for a burst of handshakes while the main loop is busy */
+    const int sndbuf = 1024 * 1024;
+    setsockopt(du->ctrl_sd[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    for (int i = 0; i < threads; ++i)
+    {
+        struct dco_user_worker *w = &du->workers[i];
+        struct epoll_event ev;
+
+        w->tun_fd = dco_user_open_queue(dev, i == 0);
+        if (w->tun_fd < 0)
+        {
+            ret = w->tun_fd;
+            goto err;
+        }
+
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (w->epfd < 0)
+        {
+            ret = -errno;
+            goto err;
+        }
+
+        CLEAR(ev);
+        ev.events = EPOLLIN;
+        ev.data.u32 = DCO_USER_EV_TUN;
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->tun_fd, &ev) < 0)
+        {
+            ret = -errno;
+            goto err;
+        }
+        ev.data.u32 = DCO_USER_EV_WAKE;
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, du->wake_fd, &ev) < 0)
+        {
+            ret = -errno;
+            goto err;
+        }
+    }
+
+    /* signals are for the main thread only */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (int i = 0; i < threads && !ret; ++i)
+    {
+        ret = -pthread_create(&du->workers[i].thread, NULL,
+                              dco_user_worker_main, &du->workers[i]);
+        du->workers[i].started = !ret;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (ret)
+    {
+        goto err;
+    }
+
+    *dup = du;
+    return 0;
+
+err:
+    dco_user_close(du);
+    return ret;
+}
+
+void
+dco_user_close(struct dco_user *du)
+{
+    if (!du)
+    {
+        return;
+    }
+
+    __atomic_store_n(&du->stop, true, __ATOMIC_RELEASE);
+    if (du->wake_fd >= 0)
+    {
+        const uint64_t one = 1;
+        (void)write(du->wake_fd, &one, sizeof(one));
+    }
+
+    for (int i = 0; i < du->n_workers; ++i)
+    {
+        struct dco_user_worker *w = &du->workers[i];
+        if (w->started)
+        {
+            pthread_join(w->thread, NULL);
+        }
+    }
+
+    dco_user_detach_socket(du);
+
+    for (int i = 0; i < du->n_workers; ++i)
+    {
+        struct dco_user_worker *w = &du->workers[i];
+        if (w->epfd >= 0)
+        {
+            close(w->epfd);
+        }
+        if (w->tun_fd >= 0)
+        {
+            close(w->tun_fd);
+        }
+    }
+
+    for (int h = 0; h < DCO_USER_HASH_SIZE; ++h)
+    {
+        while (du->peers[h])
+        {
+            struct dco_user_peer *peer = du->peers[h];
+            du->peers[h] = peer->next;
+            dco_user_peer_free(du, peer);
+        }
+        while (du->routes[h])
+        {
+            struct dco_user_route *route = du->routes[h];
+            du->routes[h] = route->next;
+            free(route);
+        }
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (du->ctrl_sd[i] >= 0)
+        {
+            close(du->ctrl_sd[i]);
+        }
+        if (du->event_sd[i] >= 0)
+        {
+            close(du->event_sd[i]);
+        }
+    }
+    if (du->wake_fd >= 0)
+    {
+        close(du->wake_fd);
+    }
+
+    pthread_rwlock_destroy(&du->lock);
+    free(du->workers);
+    free(du);
+}
+
+int
+dco_user_new_peer(struct dco_user *du, unsigned int peerid, int sd,
+                  struct sockaddr *localaddr, struct sockaddr *remoteaddr,
+                  struct in_addr *remote_in4, struct in6_addr *remote_in6)
+{
+    if (!remoteaddr
+        || (remoteaddr->sa_family != AF_INET && remoteaddr->sa_family != AF_INET6))
+    {
+        /* only UDP peers, see dco_check_option_ce() */
+        return -EINVAL;
+    }
+
+    struct dco_user_peer *peer;
+    ALLOC_OBJ_CLEAR(peer, struct dco_user_peer);
+    peer->id = peerid;
+    pthread_mutex_init(&peer->lock, NULL);
+    peer->last_rx = peer->last_tx = time(NULL);
+
+    pthread_rwlock_wrlock(&du->lock);
+
+    struct dco_user_peer *old = NULL;
+    int ret = dco_user_find_peer(du, peerid) ? -EEXIST : 0;
+    if (!ret)
+    {
+        ret = dco_user_attach_socket(du, sd);
+    }
+    if (ret)
+    {
+        pthread_rwlock_unlock(&du->lock);
+        dco_user_peer_free(du, peer);
+        return ret;
+    }
+
+    if (du->mode == OVPN_MODE_P2P && du->p2p_peer)
+    {
+        /* a P2P instance talks to exactly one peer */
+        old = du->p2p_peer;
+        dco_user_unlink_peer(du, old);
+    }
+
+    dco_user_set_remote(du, peer, remoteaddr);
+
+    peer->local_af = AF_UNSPEC;
+    if (localaddr && localaddr->sa_family == AF_INET)
+    {
+        peer->local_af = AF_INET;
+        peer->local.in4.ipi_spec_dst = ((struct sockaddr_in *)localaddr)->sin_addr;
+    }
+    else if (localaddr && localaddr->sa_family == AF_INET6)
+    {
+        peer->local_af = AF_INET6;
+        peer->local.in6.ipi6_addr = ((struct sockaddr_in6 *)localaddr)->sin6_addr;
+    }
+
+    const uint32_t h = peerid % DCO_USER_HASH_SIZE;
+    peer->next = du->peers[h];
+    du->peers[h] = peer;
+
+    if (remote_in4)
+    {
+        const uint32_t h4 = dco_user_hash(remote_in4, sizeof(*remote_in4), 0);
+        peer->has_vpn4 = true;
+        peer->vpn4 = *remote_in4;
+        peer->next_vpn4 = du->vpn4[h4];
+        du->vpn4[h4] = peer;
+    }
+    if (remote_in6)
+    {
+        const uint32_t h6 = dco_user_hash(remote_in6, sizeof(*remote_in6), 0);
+        peer->has_vpn6 = true;
+        peer->vpn6 = *remote_in6;
+        peer->next_vpn6 = du->vpn6[h6];
+        du->vpn6[h6] = peer;
+    }
+
+    if (du->mode == OVPN_MODE_P2P)
+    {
+        du->p2p_peer = peer;
+    }
+
+    pthread_rwlock_unlock(&du->lock);
+
+    if (old)
+    {
+        dco_user_peer_free(du, old);
+    }
+    return 0;
+}
+
+int
+dco_user_set_peer(struct dco_user *du, unsigned int peerid,
+                  int keepalive_interval, int keepalive_timeout)
+{
+    pthread_rwlock_rdlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        __atomic_store_n(&peer->keepalive_interval, keepalive_interval, __ATOMIC_RELAXED);
+        __atomic_store_n(&peer->keepalive_timeout, keepalive_timeout, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    return peer ? 0 : -ENOENT;
+}
+
+int
+dco_user_del_peer(struct dco_user *du, unsigned int peerid)
+{
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        dco_user_unlink_peer(du, peer);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    if (!peer)
+    {
+        return -ENOENT;
+    }
+    dco_user_peer_free(du, peer);
+    return 0;
+}
+
+int
+dco_user_new_key(struct dco_user *du, unsigned int peerid, int keyid,
+                 enum ovpn_key_slot slot,
+                 const uint8_t *encrypt_key, const uint8_t *encrypt_iv,
+                 const uint8_t *decrypt_key, const uint8_t *decrypt_iv,
+                 const char *ciphername)
+{
+    if (slot < __OVPN_KEY_SLOT_FIRST || slot >= __OVPN_KEY_SLOT_AFTER_LAST
+        || !cipher_kt_mode_aead(ciphername))
+    {
+        return -EINVAL;
+    }
+
+    /* set up the contexts before blocking the workers */
+    struct dco_user_key key;
+    dco_user_key_init(du, &key, keyid, encrypt_key, encrypt_iv, decrypt_key,
+                      decrypt_iv, ciphername);
+
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        struct dco_user_key tmp = peer->keys[slot];
+        peer->keys[slot] = key;
+        key = tmp;
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    /* either the replaced key or the new one if the peer is gone */
+    dco_user_key_free(du, &key);
+    return peer ? 0 : -ENOENT;
+}
+
+int
+dco_user_del_key(struct dco_user *du, unsigned int peerid,
+                 enum ovpn_key_slot slot)
+{
+    struct dco_user_key key;
+
+    if (slot < __OVPN_KEY_SLOT_FIRST || slot >= __OVPN_KEY_SLOT_AFTER_LAST)
+    {
+        return -EINVAL;
+    }
+
+    CLEAR(key);
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        key = peer->keys[slot];
+        CLEAR(peer->keys[slot]);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    dco_user_key_free(du, &key);
+    return peer ? 0 : -ENOENT;
+}
+
+int
+dco_user_swap_keys(struct dco_user *du, unsigned int peerid)
+{
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        struct dco_user_key tmp = peer->keys[OVPN_KEY_SLOT_PRIMARY];
+        peer->keys[OVPN_KEY_SLOT_PRIMARY] = peer->keys[OVPN_KEY_SLOT_SECONDARY];
+        peer->keys[OVPN_KEY_SLOT_SECONDARY] = tmp;
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    return peer ? 0 : -ENOENT;
+}
+
+int
+dco_user_add_route(struct dco_user *du, int af, const void *addr,
+                   int netbits, const void *gw)
+{
+    const int len = dco_user_addr_len(af);
+    uint8_t net[16];
+
+    if ((af != AF_INET && af != AF_INET6) || netbits < 0 || netbits > len * 8)
+    {
+        return -EINVAL;
+    }
+    memcpy(net, addr, len);
+    dco_user_mask(net, len, netbits);
+
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_route **rp = dco_user_find_route(du, af, net, netbits);
+    if (!*rp)
+    {
+        ALLOC_OBJ_CLEAR(*rp, struct dco_user_route);
+        (*rp)->af = af;
+        (*rp)->netbits = netbits;
+        memcpy((*rp)->addr, net, len);
+        du->route_count[af == AF_INET ? 0 : 1][netbits]++;
+    }
+    memcpy((*rp)->gw, gw, len);
+    pthread_rwlock_unlock(&du->lock);
+
+    return 0;
+}
+
+int
+dco_user_del_route(struct dco_user *du, int af, const void *addr,
+                   int netbits)
+{
+    const int len = dco_user_addr_len(af);
+    struct dco_user_route *route = NULL;
+    uint8_t net[16];
+
+    if ((af != AF_INET && af != AF_INET6) || netbits < 0 || netbits > len * 8)
+    {
+        return -EINVAL;
+    }
+    memcpy(net, addr, len);
+    dco_user_mask(net, len, netbits);
+
+    pthread_rwlock_wrlock(&du->lock);
+    struct dco_user_route **rp = dco_user_find_route(du, af, net, netbits);
+    if (*rp)
+    {
+        route = *rp;
+        *rp = route->next;
+        du->route_count[af == AF_INET ? 0 : 1][netbits]--;
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    free(route);
+    return route ? 0 : -ENOENT;
+}
+
+int
+dco_user_get_stats(struct dco_user *du, unsigned int peerid,
+                   struct dco_user_stats *stats)
+{
+    pthread_rwlock_rdlock(&du->lock);
+    struct dco_user_peer *peer = dco_user_find_peer(du, peerid);
+    if (peer)
+    {
+        dco_user_copy_stats(peer, stats);
+    }
+    pthread_rwlock_unlock(&du->lock);
+
+    return peer ? 0 : -ENOENT;
+}
+
+void
+dco_user_foreach_peer(struct dco_user *du,
+                      void (*cb)(void *arg, unsigned int peerid,
+                                 const struct dco_user_stats *stats),
+                      void *arg)
+{
+    pthread_rwlock_rdlock(&du->lock);
+    for (int h = 0; h < DCO_USER_HASH_SIZE; ++h)
+    {
+        for (struct dco_user_peer *peer = du->peers[h]; peer; peer = peer->next)
+        {
+            struct dco_user_stats stats;
+            dco_user_copy_stats(peer, &stats);
+            cb(arg, peer->id, &stats);
+        }
+    }
+    pthread_rwlock_unlock(&du->lock);
+}
+
+int
+dco_user_read_event(struct dco_user *du, struct dco_user_event *ev)
+{
+    return recv(du->event_sd[0], ev, sizeof(*ev), MSG_DONTWAIT) == sizeof(*ev);
+}
+
+int
+dco_user_event_sd(const struct dco_user *du)
+{
+    return du->event_sd[0];
+}
+
+int
+dco_user_ctrl_sd(const struct dco_user *du)
+{
+    return du->link_sd >= 0 ? du->ctrl_sd[0] : -1;
+}
+
+void
+dco_user_release_socket(struct dco_user *du, int sd)
+{
+    pthread_rwlock_wrlock(&du->lock);
+    if (du->link_sd >= 0 && du->link_sd_orig == sd)
+    {
+        dco_user_detach_socket(du);
+    }
+    pthread_rwlock_unlock(&du->lock);
+}
+
+#endif /* defined(ENABLE_DCO) && defined(TARGET_LINUX) */
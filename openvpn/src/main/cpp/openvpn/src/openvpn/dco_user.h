@@ -0,0 +1,166 @@
+/*
+ *  Userspace data channel offload engine for Linux
+ *
+ *  Copyright (C) 2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program (see the file COPYING included with this
+ *  distribution); if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef DCO_USER_H
+#define DCO_USER_H
+
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+
+#include "ovpn_dco_linux.h"
+
+/**
+ * @file
+ * A data channel engine that implements the ovpn-dco peer, key and
+ * statistics operations in a pool of worker threads instead of the
+ * kernel.  It is used on Linux when --dco-userspace is given, and is
+ * driven by dco_linux.c, so the rest of OpenVPN sees the same DCO
+ * interface as with the kernel module.
+ *
+ * The workers own a multi-queue tun device (one queue per worker) and,
+ * once the first peer is added, the UDP link socket.  They encrypt,
+ * decrypt, check replays and route packets between the two.  Packets
+ * that are not data channel packets of a known peer are handed back to
+ * the main loop through the descriptor returned by dco_user_ctrl_sd(),
+ * which the link socket reads instead of the UDP socket (see
+ * link_socket_read_udp_posix()).  Peer removals and key rotation
+ * requests are reported through dco_user_event_sd(), like the netlink
+ * notifications of the kernel module.
+ */
+
+/** Upper limit for --dco-userspace worker threads */
+#define DCO_USER_THREADS_MAX 64
+
+struct dco_user;
+struct link_socket_actual;
+
+/** Per peer counters, as reported by the kernel module */
+struct dco_user_stats
+{
+    uint64_t link_rx_bytes;
+    uint64_t link_tx_bytes;
+    uint64_t vpn_rx_bytes;     /**< decrypted and written to tun */
+    uint64_t vpn_tx_bytes;     /**< read from tun and encrypted */
+};
+
+/** A notification for the main loop, see dco_user_read_event() */
+struct dco_user_event
+{
+    int type;                  /**< OVPN_CMD_DEL_PEER or OVPN_CMD_SWAP_KEYS */
+    int peer_id;
+    int reason;                /**< enum ovpn_del_peer_reason for DEL_PEER */
+    struct dco_user_stats stats;
+};
+
+/**
+ * Open a multi-queue tun device and start the worker threads.
+ *
+ * @param mode      OVPN_MODE_P2P or OVPN_MODE_MP
+ * @param dev       name of the tun device to create or attach to
+ * @param threads   number of worker threads, 0 for one per online CPU
+ * @param du        returns the engine on success
+ *
+ * @return          0 on success or a negative error code otherwise
+ */
+int dco_user_open(enum ovpn_mode mode, const char *dev, int threads,
+                  struct dco_user **du);
+
+/**
+ * Stop the worker threads, close the tun queues and free the engine.
+ */
+void dco_user_close(struct dco_user *du);
+
+int dco_user_new_peer(struct dco_user *du, unsigned int peerid, int sd,
+                      struct sockaddr *localaddr, struct sockaddr *remoteaddr,
+                      struct in_addr *remote_in4, struct in6_addr *remote_in6);
+
+int dco_user_set_peer(struct dco_user *du, unsigned int peerid,
+                      int keepalive_interval, int keepalive_timeout);
+
+int dco_user_del_peer(struct dco_user *du, unsigned int peerid);
+
+int dco_user_new_key(struct dco_user *du, unsigned int peerid, int keyid,
+                     enum ovpn_key_slot slot,
+                     const uint8_t *encrypt_key, const uint8_t *encrypt_iv,
+                     const uint8_t *decrypt_key, const uint8_t *decrypt_iv,
+                     const char *ciphername);
+
+int dco_user_del_key(struct dco_user *du, unsigned int peerid,
+                     enum ovpn_key_slot slot);
+
+int dco_user_swap_keys(struct dco_user *du, unsigned int peerid);
+
+/**
+ * Route packets for \c addr/netbits to the peer whose VPN address is
+ * \c gw.  This mirrors the iroute routes that are installed via the
+ * client's VPN address for the kernel module.
+ *
+ * @param af        AF_INET or AF_INET6
+ * @param addr      network address (struct in_addr or struct in6_addr)
+ * @param netbits   prefix length
+ * @param gw        VPN address of the peer, same type as addr
+ */
+int dco_user_add_route(struct dco_user *du, int af, const void *addr,
+                       int netbits, const void *gw);
+
+int dco_user_del_route(struct dco_user *du, int af, const void *addr,
+                       int netbits);
+
+/**
+ * Copy the counters of a peer.
+ *
+ * @return          0 on success, -ENOENT if the peer does not exist
+ */
+int dco_user_get_stats(struct dco_user *du, unsigned int peerid,
+                       struct dco_user_stats *stats);
+
+/**
+ * Call \c cb for every peer with its current counters.
+ */
+void dco_user_foreach_peer(struct dco_user *du,
+                           void (*cb)(void *arg, unsigned int peerid,
+                                      const struct dco_user_stats *stats),
+                           void *arg);
+
+/**
+ * Read the next pending notification.
+ *
+ * @return          1 if \c ev was filled, 0 if nothing was pending
+ */
+int dco_user_read_event(struct dco_user *du, struct dco_user_event *ev);
+
+/** Descriptor that becomes readable when notifications are pending */
+int dco_user_event_sd(const struct dco_user *du);
+
+/**
+ * Descriptor the main loop reads control packets from while the engine
+ * owns the link socket, or -1 if it does not own one.  Every datagram
+ * starts with a struct link_socket_actual holding the sender, followed
+ * by the packet.
+ */
+int dco_user_ctrl_sd(const struct dco_user *du);
+
+/**
+ * Stop reading the link socket \c sd and drop the engine's reference to
+ * it.  Peers using the socket are kept but cannot send until a new
+ * socket is attached by dco_user_new_peer().
+ */
+void dco_user_release_socket(struct dco_user *du, int sd);
+
+#endif /* defined(ENABLE_DCO) && defined(TARGET_LINUX) */
+#endif /* ifndef DCO_USER_H */
@@ -75,6 +75,8 @@
 #define DCO_SHIFT           10
 #define DCO_READ            (1 << (DCO_SHIFT + READ_SHIFT))
 #define DCO_WRITE           (1 << (DCO_SHIFT + WRITE_SHIFT))
+#define SIGN_SHIFT          12
+#define SIGN_DONE           (1 << (SIGN_SHIFT + READ_SHIFT))
 
 /*
  * Initialization flags passed to event_set_init
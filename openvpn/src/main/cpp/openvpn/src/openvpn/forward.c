@@ -41,6 +41,7 @@
 #include "ssl_verify.h"
 #include "dco.h"
 #include "auth_token.h"
+#include "xkey_async.h"
 
 #include "memdbg.h"
 
@@ -1821,6 +1822,15 @@ process_outgoing_link(struct context *c)
         error_code = openvpn_errno();
         check_status(size, "write", c->c2.link_socket, NULL);
 
+        c->c2.link_socket->write_blocked = size < 0
+                                           ? error_code ==
+#ifdef _WIN32
+                                           WSAEWOULDBLOCK
+#else
+                                           EAGAIN
+#endif
+                                           : size < BLEN(&c->c2.to_link);
+
         if (size > 0)
         {
             /* Did we write a different size packet than we intended? */
@@ -2032,6 +2042,137 @@ pre_select(struct context *c)
     check_timeout_random_component(c);
 }
 
+#if ENABLE_IO_URING
+
+/* io_wait() calls in a row that may skip event_wait() because
+ * io_uring already has what was asked for */
+#define URING_SKIP_MAX 32
+
+/*
+ * Move the link socket and the TUN/TAP device to io_uring the first
+ * time we wait on them.  This is after --daemon has forked, a ring
+ * may only be used by the task that created it.  If it fails, stay
+ * with epoll for the rest of this run.
+ */
+static void
+io_wait_uring_open(struct context *c)
+{
+    const int buf_size = BUF_SIZE(&c->c2.frame);
+
+    if (c->options.disable_io_uring || dco_enabled(&c->options))
+    {
+        return;
+    }
+
+    if ((c->c2.link_socket && !link_socket_uring_open(c->c2.link_socket, buf_size))
+        || (c->c1.tuntap && !tun_uring_open(c->c1.tuntap, buf_size)))
+    {
+        c->options.disable_io_uring = true;
+    }
+}
+
+/*
+ * Return the SOCKET_x and TUN_x status bits that the rings can
+ * satisfy without waiting.
+ */
+static unsigned int
+io_wait_uring_ready(const struct context *c, unsigned int socket, unsigned int tuntap)
+{
+    const struct link_socket *sock = c->c2.link_socket;
+    const struct tuntap *tt = c->c1.tuntap;
+    unsigned int ret = 0;
+
+    if (sock && sock->uring)
+    {
+        ret |= uring_ready(sock->uring, socket) << SOCKET_SHIFT;
+    }
+    if (tt && tt->uring)
+    {
+        ret |= uring_ready(tt->uring, tuntap) << TUN_SHIFT;
+    }
+    return ret;
+}
+
+/*
+ * event_wait() for io_wait_dowork().  While the rings have packets
+ * left from the last wakeup, return 0 without a syscall and let
+ * io_wait_uring_status() report them; queued writes keep collecting
+ * in the submission queue meanwhile.  Every URING_SKIP_MAX calls the
+ * other event sources get a look without sleeping.
+ */
+static int
+io_wait_uring(struct context *c, unsigned int socket, unsigned int tuntap,
+              struct event_set_return *esr, int outlen)
+{
+    struct link_socket *sock = c->c2.link_socket;
+    struct tuntap *tt = c->c1.tuntap;
+    const struct timeval tv_zero = { 0, 0 };
+
+    if (io_wait_uring_ready(c, socket, tuntap) && c->c2.uring_skip < URING_SKIP_MAX)
+    {
+        ++c->c2.uring_skip;
+        return 0;
+    }
+    c->c2.uring_skip = 0;
+
+    if (sock && sock->uring)
+    {
+        uring_flush(sock->uring, false);
+    }
+    if (tt && tt->uring)
+    {
+        uring_flush(tt->uring, false);
+    }
+
+    return event_wait(c->c2.event_set,
+                      io_wait_uring_ready(c, socket, tuntap) ? &tv_zero : &c->c2.timeval,
+                      esr, outlen);
+}
+
+/*
+ * The eventfd of a ring only says that the kernel has work for us,
+ * replace its status bits with what the ring can actually do.
+ */
+static void
+io_wait_uring_status(struct context *c, unsigned int socket, unsigned int tuntap)
+{
+    struct link_socket *sock = c->c2.link_socket;
+    struct tuntap *tt = c->c1.tuntap;
+    unsigned int *status = &c->c2.event_set_status;
+
+    if (*status & ES_ERROR)
+    {
+        return;
+    }
+
+    if (sock && sock->uring)
+    {
+        /* uring_skip is only set if event_wait() was skipped */
+        if (!c->c2.uring_skip)
+        {
+            uring_flush(sock->uring, *status & SOCKET_READ);
+        }
+        *status &= ~(SOCKET_READ | SOCKET_WRITE);
+        *status |= uring_ready(sock->uring, socket) << SOCKET_SHIFT;
+    }
+    if (tt && tt->uring)
+    {
+        if (!c->c2.uring_skip)
+        {
+            uring_flush(tt->uring, *status & TUN_READ);
+        }
+        *status &= ~(TUN_READ | TUN_WRITE);
+        *status |= uring_ready(tt->uring, tuntap) << TUN_SHIFT;
+    }
+
+    if (*status & (SOCKET_READ | SOCKET_WRITE | TUN_READ | TUN_WRITE))
+    {
+        *status &= ~ES_TIMEOUT;
+    }
+}
+
+#endif /* ENABLE_IO_URING */
+
 /*
  * Wait for I/O events.  Used for both TCP & UDP sockets
  * in point-to-point mode and for UDP sockets in
@@ -2060,6 +2201,7 @@ io_wait_dowork(struct context *c, const unsigned int flags)
 #if defined(TARGET_LINUX) || defined(TARGET_FREEBSD)
     static int dco_shift = DCO_SHIFT;    /* Event from DCO linux kernel module */
 #endif
+    static int sign_shift = SIGN_SHIFT;  /* Signature for a paused handshake */
 
     /*
      * Decide what kind of events we want to wait for.
@@ -2162,6 +2304,10 @@ io_wait_dowork(struct context *c, const unsigned int flags)
     }
 #endif
 
+#if ENABLE_IO_URING
+    io_wait_uring_open(c);
+#endif
+
     /*
      * Configure event wait based on socket, tuntap flags.
      */
@@ -2189,6 +2335,11 @@ io_wait_dowork(struct context *c, const unsigned int flags)
     }
 #endif
 
+    if (xkey_async_event_fd() >= 0)
+    {
+        event_ctl(c->c2.event_set, xkey_async_event_fd(), EVENT_READ, (void *)&sign_shift);
+    }
+
     /*
      * Possible scenarios:
      *  (1) tcp/udp port has data available to read
@@ -2217,7 +2368,11 @@ io_wait_dowork(struct context *c, const unsigned int flags)
             /*
              * Wait for something to happen.
              */
+#if ENABLE_IO_URING
+            status = io_wait_uring(c, socket, tuntap, esr, SIZE(esr));
+#else
             status = event_wait(c->c2.event_set, &c->c2.timeval, esr, SIZE(esr));
+#endif
 
             check_status(status, "event_wait", NULL, NULL);
 
@@ -2235,6 +2390,9 @@ io_wait_dowork(struct context *c, const unsigned int flags)
             {
                 c->c2.event_set_status = ES_TIMEOUT;
             }
+#if ENABLE_IO_URING
+            io_wait_uring_status(c, socket, tuntap);
+#endif
         }
         else
         {
@@ -2254,6 +2412,65 @@ io_wait_dowork(struct context *c, const unsigned int flags)
     dmsg(D_EVENT_WAIT, "I/O WAIT status=0x%04x", c->c2.event_set_status);
 }
 
+/*
+ * With --io-batch, keep moving packets from TUN/TAP to the UDP port
+ * until the device has no more data, instead of going through
+ * pre_select() and io_wait() for every packet.  --fast-io guarantees
+ * that the socket write does not need to wait for EVENT_WRITE.
+ *
+ * Input:  c->c2.to_link from the packet that triggered the wakeup
+ * Output: c->c2.to_link, possibly still holding the last packet
+ */
+static void
+process_io_batch_tun(struct context *c)
+{
+    for (int i = 1; i < c->c2.io_batch && c->c2.to_link.len > 0; ++i)
+    {
+        process_outgoing_link(c);
+        if (IS_SIG(c))
+        {
+            break;
+        }
+
+        read_incoming_tun(c);
+        if (IS_SIG(c) || c->c2.buf.len <= 0)
+        {
+            break;
+        }
+        process_incoming_tun(c);
+    }
+}
+
+/*
+ * The same for the other direction, from the UDP port to TUN/TAP.
+ * Anything but a data packet for the tunnel (control channel, pings,
+ * packets that need a reply) ends the batch, so that pre_select()
+ * gets to look at it without delay.
+ *
+ * Input:  c->c2.to_tun from the packet that triggered the wakeup
+ * Output: c->c2.to_tun, possibly still holding the last packet
+ */
+static void
+process_io_batch_link(struct context *c)
+{
+    for (int i = 1; i < c->c2.io_batch && c->c2.to_tun.len > 0
+         && c->c2.to_link.len <= 0; ++i)
+    {
+        process_outgoing_tun(c);
+        if (IS_SIG(c))
+        {
+            break;
+        }
+
+        read_incoming_link(c);
+        if (IS_SIG(c) || c->c2.buf.len <= 0)
+        {
+            break;
+        }
+        process_incoming_link(c);
+    }
+}
+
 void
 process_io(struct context *c)
 {
@@ -2267,6 +2484,13 @@ process_io(struct context *c)
     }
 #endif
 
+    /* a paused handshake can continue, see xkey_async.h */
+    if (status & SIGN_DONE)
+    {
+        xkey_async_clear_event();
+        interval_action(&c->c2.tmp_int);
+    }
+
     /* TCP/UDP port ready to accept write */
     if (status & SOCKET_WRITE)
     {
@@ -2284,6 +2508,10 @@ process_io(struct context *c)
         if (!IS_SIG(c))
         {
             process_incoming_link(c);
+            if (c->c2.io_batch > 1 && !IS_SIG(c))
+            {
+                process_io_batch_link(c);
+            }
         }
     }
     /* Incoming data on TUN device */
@@ -2293,6 +2521,10 @@ process_io(struct context *c)
         if (!IS_SIG(c))
         {
             process_incoming_tun(c);
+            if (c->c2.io_batch > 1 && !IS_SIG(c))
+            {
+                process_io_batch_tun(c);
+            }
         }
     }
     else if (status & DCO_READ)
@@ -3082,6 +3082,11 @@ do_init_tls_wrap_key(struct context *c)
             tls_crypt_v2_init_server_key(&c->c1.ks.tls_crypt_v2_server_key,
                                          true, options->ce.tls_crypt_v2_file,
                                          options->ce.tls_crypt_v2_file_inline);
+            /* children share the cache of the context they inherit from */
+            if (!c->c1.ks.tls_crypt_v2_cache)
+            {
+                c->c1.ks.tls_crypt_v2_cache = tls_crypt_v2_cache_new();
+            }
         }
         else
         {
@@ -3411,6 +3416,7 @@ do_init_crypto_tls(struct context *c, const unsigned int flags)
         if (options->tls_server)
         {
             to.tls_wrap.tls_crypt_v2_server_key = c->c1.ks.tls_crypt_v2_server_key;
+            to.tls_wrap.tls_crypt_v2_cache = c->c1.ks.tls_crypt_v2_cache;
             to.tls_crypt_v2_verify_script = c->options.tls_crypt_v2_verify_script;
             if (options->ce.tls_crypt_v2_force_cookie)
             {
@@ -3864,6 +3870,12 @@ do_close_free_key_schedule(struct context *c, bool free_ssl_ctx)
      * be reloaded from memory (pre-cached)
      */
     free_key_ctx(&c->c1.ks.tls_crypt_v2_server_key);
+    /* the cached client keys were unwrapped with the server key */
+    if (free_ssl_ctx)
+    {
+        tls_crypt_v2_cache_free(c->c1.ks.tls_crypt_v2_cache);
+    }
+    c->c1.ks.tls_crypt_v2_cache = NULL;
     free_key_ctx_bi(&c->c1.ks.tls_wrap_key);
     CLEAR(c->c1.ks.tls_wrap_key);
     buf_clear(&c->c1.ks.tls_crypt_v2_wkc);
@@ -3891,6 +3903,7 @@ do_close_link_socket(struct context *c)
 
     if (c->c2.link_socket && c->c2.link_socket_owned)
     {
+        dco_release_link_socket(c);
         link_socket_close(c->c2.link_socket);
         c->c2.link_socket = NULL;
     }
@@ -4081,6 +4094,9 @@ do_env_set_destroy(struct context *c)
  * (1) The platform is not Windows
  * (2) --proto udp is enabled
  * (3) --shaper is disabled
+ *
+ * --io-batch additionally requires --fast-io to be active and
+ * --fragment to be disabled.
  */
 static void
 do_setup_fast_io(struct context *c)
@@ -4107,6 +4123,22 @@ do_setup_fast_io(struct context *c)
         }
 #endif
     }
+
+    if (c->options.io_batch > 1)
+    {
+        if (!c->c2.fast_io)
+        {
+            msg(M_INFO, "NOTE: --io-batch is disabled since --fast-io is not active");
+        }
+        else if (c->options.ce.fragment)
+        {
+            msg(M_INFO, "NOTE: --io-batch is disabled since we are using --fragment");
+        }
+        else
+        {
+            c->c2.io_batch = c->options.io_batch;
+        }
+    }
 }
 
 static void
@@ -4804,6 +4836,7 @@ inherit_context_child(struct context *dest,
     dest->c1.ks.tls_wrap_key = src->c1.ks.tls_wrap_key;
     dest->c1.ks.tls_auth_key_type = src->c1.ks.tls_auth_key_type;
     dest->c1.ks.tls_crypt_v2_server_key = src->c1.ks.tls_crypt_v2_server_key;
+    dest->c1.ks.tls_crypt_v2_cache = src->c1.ks.tls_crypt_v2_cache;
     /* inherit pre-NCP ciphers */
     dest->options.ciphername = src->options.ciphername;
     dest->options.authname = src->options.authname;
@@ -30,7 +30,7 @@
  * Baseline maximum number of events
  * to wait for.
  */
-#define BASE_N_EVENTS 5
+#define BASE_N_EVENTS 6
 
 void context_clear(struct context *c);
 
@@ -42,6 +42,7 @@
 #include "manage.h"
 #include "openvpn.h"
 #include "dco.h"
+#include "xkey_async.h"
 
 #include "memdbg.h"
 
@@ -67,6 +68,8 @@ static void man_output_standalone(struct management *man, volatile int *signal_r
 
 static void man_reset_client_socket(struct management *man, const bool exiting);
 
+static void man_client_stats_start(struct management *man, const bool delta);
+
 static void
 man_help(void)
 {
@@ -109,15 +112,22 @@ man_help(void)
     msg(M_CLIENT, "client-pending-auth CID KID MSG timeout : Instruct OpenVPN to send AUTH_PENDING and INFO_PRE msg");
     msg(M_CLIENT, "                                      to the client and wait for a final client-auth/client-deny");
     msg(M_CLIENT, "client-kill CID [M]    : Kill client instance CID with message M (def=RESTART)");
+    msg(M_CLIENT, "client-shaper CID n [b] : Restrict the data sent to client instance CID to n bytes");
+    msg(M_CLIENT, "                         per second with bursts of b bytes, n=0 removes the limit");
+    msg(M_CLIENT, "client-stats [n]       : Stream the byte counters of all clients as JSON lines,");
+    msg(M_CLIENT, "                         then those that changed every n secs (0=off).");
     msg(M_CLIENT, "env-filter [level]     : Set env-var filter level");
     msg(M_CLIENT, "rsa-sig                : Enter a signature in response to >RSA_SIGN challenge");
     msg(M_CLIENT, "                         Enter signature base64 on subsequent lines followed by END");
     msg(M_CLIENT, "pk-sig                 : Enter a signature in response to >PK_SIGN challenge");
     msg(M_CLIENT, "                         Enter signature base64 on subsequent lines followed by END");
+    msg(M_CLIENT, "pk-sig id              : Enter a signature in response to >PK_SIGN_ASYNC:id challenge");
+    msg(M_CLIENT, "                         Enter signature base64 on subsequent lines followed by END");
     msg(M_CLIENT, "certificate            : Enter a client certificate in response to >NEED-CERT challenge");
     msg(M_CLIENT, "                         Enter certificate base64 on subsequent lines followed by END");
     msg(M_CLIENT, "signal s               : Send signal s to daemon,");
     msg(M_CLIENT, "                         s = SIGHUP|SIGTERM|SIGUSR1|SIGUSR2.");
+    msg(M_CLIENT, "snapshot-reload        : Re-read the --config-snapshot files for new clients.");
     msg(M_CLIENT, "state [on|off] [N|all] : Like log, but show state history.");
     msg(M_CLIENT, "status [n]             : Show current daemon status info using format #n.");
     msg(M_CLIENT, "test n                 : Produce n lines of output for testing/debugging.");
@@ -534,6 +544,120 @@ man_bytecount_output_server(const counter_type *bytes_in_total,
     mdac->bytecount_last_update = now;
 }
 
+/*
+ * Produce the next chunk of a client-stats pass, but only once the
+ * previous output has been written, so that a large client list is
+ * formatted a piece at a time across event loop iterations instead
+ * of all at once.
+ */
+static void
+man_client_stats_continue(struct management *man)
+{
+    struct man_connection *mc = &man->connection;
+    struct gc_arena gc;
+    struct buffer out;
+
+    if (!mc->client_stats_running || buffer_list_defined(mc->out))
+    {
+        return;
+    }
+
+    gc = gc_new();
+    out = alloc_buf_gc(MAN_CLIENT_STATS_CHUNK, &gc);
+    mc->client_stats_index = (*man->persist.callback.client_stats)
+                                 (man->persist.callback.arg, &out,
+                                 mc->client_stats_index, mc->client_stats_delta,
+                                 &mc->client_stats_count);
+    if (mc->client_stats_index < 0)
+    {
+        buf_printf(&out, ">CLIENT-STATS:{\"end\":%u,\"clients\":%d}\r\n",
+                   (unsigned int)now, mc->client_stats_count);
+        mc->client_stats_running = false;
+    }
+    man_output_list_push_str(man, BSTR(&out));
+    man_output_list_push_finalize(man);
+    gc_free(&gc);
+
+    if (!mc->client_stats_running && mc->client_stats_full_pending)
+    {
+        mc->client_stats_full_pending = false;
+        man_client_stats_start(man, false);
+    }
+}
+
+static void
+man_client_stats_start(struct management *man, const bool delta)
+{
+    struct man_connection *mc = &man->connection;
+
+    if (mc->client_stats_running)
+    {
+        /* a delta pass is never needed on top of a running pass */
+        mc->client_stats_full_pending |= !delta;
+        return;
+    }
+
+    mc->client_stats_running = true;
+    mc->client_stats_delta = delta;
+    mc->client_stats_index = 0;
+    mc->client_stats_count = 0;
+    msg(M_CLIENT, ">CLIENT-STATS:{\"begin\":%u,\"delta\":%s}",
+        (unsigned int)now, delta ? "true" : "false");
+    man_client_stats_continue(man);
+}
+
+static void
+man_snapshot_reload(struct management *man)
+{
+    if (man->persist.callback.snapshot_reload)
+    {
+        if ((*man->persist.callback.snapshot_reload)(man->persist.callback.arg))
+        {
+            msg(M_CLIENT, "SUCCESS: snapshot-reload command succeeded");
+        }
+        else
+        {
+            msg(M_CLIENT, "ERROR: snapshot-reload command failed");
+        }
+    }
+    else
+    {
+        man_command_unsupported("snapshot-reload");
+    }
+}
+
+static void
+man_client_stats(struct management *man, const char *interval)
+{
+    if (!man->persist.callback.client_stats)
+    {
+        man_command_unsupported("client-stats");
+        return;
+    }
+
+    if (interval)
+    {
+        const int seconds = atoi(interval);
+        man->connection.client_stats_seconds = max_int(seconds, 0);
+        man->connection.client_stats_next = now + seconds;
+    }
+    msg(M_CLIENT, "SUCCESS: client-stats started");
+    man_client_stats_start(man, false);
+}
+
+void
+management_check_client_stats(struct management *man)
+{
+    struct man_connection *mc = &man->connection;
+
+    if (mc->client_stats_seconds > 0 && now >= mc->client_stats_next
+        && !mc->client_stats_running && management_connected(man))
+    {
+        mc->client_stats_next = now + mc->client_stats_seconds;
+        man_client_stats_start(man, true);
+    }
+}
+
 static void
 man_kill(struct management *man, const char *victim)
 {
@@ -975,6 +1099,82 @@ in_extra_reset(struct man_connection *mc, const int mode)
     }
 }
 
+/* an outstanding >PK_SIGN_ASYNC request */
+struct man_pk_sig_req
+{
+    unsigned int id;
+    bool done;
+    char *sig;                  /* base64 signature, NULL if none was given */
+    struct man_pk_sig_req *next;
+};
+
+static struct man_pk_sig_req **
+man_pk_sig_find(struct man_connection *mc, const unsigned int id)
+{
+    struct man_pk_sig_req **r = &mc->pk_sig_reqs;
+    while (*r && (*r)->id != id)
+    {
+        r = &(*r)->next;
+    }
+    return r;
+}
+
+static void
+man_pk_sig_async_done(struct management *man, const unsigned int id,
+                      struct buffer_list *input)
+{
+    struct man_pk_sig_req *req = *man_pk_sig_find(&man->connection, id);
+
+    if (!req || req->done)
+    {
+        /* cancelled while the signature was entered */
+        msg(M_CLIENT, "ERROR: pk-sig %u is no longer pending", id);
+        return;
+    }
+
+    if (buffer_list_defined(input))
+    {
+        buffer_list_aggregate(input, 2048);
+        const struct buffer *buf = buffer_list_peek(input);
+        if (buf && BLEN(buf) > 0)
+        {
+            req->sig = string_alloc(BSTR(buf), NULL);
+        }
+    }
+    req->done = true;
+    xkey_async_signal();
+    report_command_status(true, "pk-sig");
+}
+
+/* fail the outstanding requests, so that their handshakes continue */
+static void
+man_pk_sig_async_fail(struct man_connection *mc)
+{
+    bool signal = false;
+
+    for (struct man_pk_sig_req *req = mc->pk_sig_reqs; req; req = req->next)
+    {
+        signal |= !req->done;
+        req->done = true;
+    }
+    if (signal)
+    {
+        xkey_async_signal();
+    }
+}
+
+static void
+man_pk_sig_async_free(struct man_connection *mc)
+{
+    while (mc->pk_sig_reqs)
+    {
+        struct man_pk_sig_req *req = mc->pk_sig_reqs;
+        mc->pk_sig_reqs = req->next;
+        free(req->sig);
+        free(req);
+    }
+}
+
 static void
 in_extra_dispatch(struct management *man)
 {
@@ -1007,6 +1207,11 @@ in_extra_dispatch(struct management *man)
             man->connection.in_extra = NULL;
             return;
 
+        case IEC_PK_SIGN_ASYNC:
+            man_pk_sig_async_done(man, (unsigned int) man->connection.in_extra_cid,
+                                  man->connection.in_extra);
+            break;
+
         case IEC_CERTIFICATE:
             man->connection.ext_cert_state = EKS_READY;
             buffer_list_free(man->connection.ext_cert_input);
@@ -1164,6 +1369,37 @@ man_client_kill(struct management *man, const char *cid_str, const char *kill_ms
     }
 }
 
+static void
+man_client_shaper(struct management *man, const char *cid_str,
+                  const char *rate_str, const char *burst_str)
+{
+    unsigned long cid = 0;
+    unsigned int rate = 0;
+    unsigned int burst = 0;
+
+    if (parse_cid(cid_str, &cid)
+        && parse_uint(rate_str, "RATE", &rate)
+        && (!burst_str || parse_uint(burst_str, "BURST", &burst)))
+    {
+        if (man->persist.callback.shaper_by_cid)
+        {
+            const bool status = (*man->persist.callback.shaper_by_cid)(man->persist.callback.arg, cid, rate, burst);
+            if (status)
+            {
+                msg(M_CLIENT, "SUCCESS: client-shaper command succeeded");
+            }
+            else
+            {
+                msg(M_CLIENT, "ERROR: client-shaper command failed");
+            }
+        }
+        else
+        {
+            man_command_unsupported("client-shaper");
+        }
+    }
+}
+
 static void
 man_client_n_clients(struct management *man)
 {
@@ -1202,6 +1438,29 @@ man_pk_sig(struct management *man, const char *cmd_name)
     }
 }
 
+static void
+man_pk_sig_async(struct management *man, const char *id_str)
+{
+    struct man_connection *mc = &man->connection;
+    unsigned int id = 0;
+    const struct man_pk_sig_req *req = NULL;
+
+    if (sscanf(id_str, "%u", &id) == 1)
+    {
+        req = *man_pk_sig_find(mc, id);
+    }
+    if (req && !req->done)
+    {
+        mc->in_extra_cmd = IEC_PK_SIGN_ASYNC;
+        in_extra_reset(mc, IER_NEW);
+        mc->in_extra_cid = id;
+    }
+    else
+    {
+        msg(M_CLIENT, "ERROR: no pending signature request %s", id_str);
+    }
+}
+
 static void
 man_certificate(struct management *man)
 {
@@ -1569,6 +1828,21 @@ man_dispatch_command(struct management *man, struct status_output *so, const cha
             man_client_kill(man, p[1], p[2]);
         }
     }
+    else if (streq(p[0], "snapshot-reload"))
+    {
+        man_snapshot_reload(man);
+    }
+    else if (streq(p[0], "client-stats"))
+    {
+        man_client_stats(man, p[1]);
+    }
+    else if (streq(p[0], "client-shaper"))
+    {
+        if (man_need(man, p, 2, MN_AT_LEAST))
+        {
+            man_client_shaper(man, p[1], p[2], p[3]);
+        }
+    }
     else if (streq(p[0], "client-deny"))
     {
         if (man_need(man, p, 3, MN_AT_LEAST))
@@ -1601,6 +1875,10 @@ man_dispatch_command(struct management *man, struct status_output *so, const cha
     {
         man_pk_sig(man, "rsa-sig");
     }
+    else if (streq(p[0], "pk-sig") && p[1])
+    {
+        man_pk_sig_async(man, p[1]);
+    }
     else if (streq(p[0], "pk-sig"))
     {
         man_pk_sig(man, "pk-sig");
@@ -1706,6 +1984,12 @@ man_connection_settings_reset(struct management *man)
     man->connection.log_realtime = false;
     man->connection.echo_realtime = false;
     man->connection.bytecount_update_seconds = 0;
+    man->connection.client_stats_seconds = 0;
+    man->connection.client_stats_running = false;
+    man->connection.client_stats_full_pending = false;
+#ifdef TARGET_ANDROID
+    man->connection.tun_config_pending = 0;
+#endif
     man->connection.password_verified = false;
     man->connection.password_tries = 0;
     man->connection.halt = false;
@@ -1998,6 +2282,7 @@ man_reset_client_socket(struct management *man, const bool exiting)
         command_line_reset(man->connection.in);
         buffer_list_reset(man->connection.out);
         in_extra_reset(&man->connection, IER_RESET);
+        man_pk_sig_async_fail(&man->connection);
         msg(D_MANAGEMENT, "MANAGEMENT: Client disconnected");
     }
     if (!exiting)
@@ -2183,6 +2468,64 @@ man_recv_with_fd(int fd, void *ptr, size_t nbytes, int flags, int *recvfd)
     return (n);
 }
 
+/*
+ * Is command part of the tun configuration that a newer GUI takes
+ * without confirmation?
+ */
+static bool
+man_android_tun_config_item(const struct management *man, const char *command)
+{
+    static const char *const items[] = {
+        "IFCONFIG", "IFCONFIG6", "ROUTE", "ROUTE6",
+        "DNSSERVER", "DNS6SERVER", "DNSDOMAIN", "HTTPPROXY"
+    };
+
+    if (man->connection.client_version < MAN_CLIENT_VERSION_TUNCFG
+        || !management_connected(man))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < SIZE(items); ++i)
+    {
+        if (streq(command, items[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Queue a tun configuration item.  It is written together with the
+ * other queued items before the next query, PERSIST_TUN_ACTION or
+ * OPENTUN, whose answer confirms them all.
+ */
+static void
+man_android_tun_config_push(struct management *man, const char *command, const char *msg)
+{
+    struct gc_arena gc = gc_new();
+    struct buffer out = alloc_buf_gc(strlen(command) + strlen(msg) + 16, &gc);
+
+    buf_printf(&out, ">TUNCFG:%s %s\r\n", command, msg);
+    man_output_list_push_str(man, BSTR(&out));
+    ++man->connection.tun_config_pending;
+    gc_free(&gc);
+}
+
+static void
+man_android_query(struct management *man, struct user_pass *up, const char *command)
+{
+    const int pending = man->connection.tun_config_pending;
+
+    man->connection.tun_config_pending = 0;
+    management_query_user_pass(man, up, command, GET_USER_PASS_NEED_OK, (void *) 0);
+    if (pending)
+    {
+        msg(D_MANAGEMENT, "MANAGEMENT: %d tun configuration items sent with %s",
+            pending, command);
+    }
+}
+
 /*
  * The android control method will instruct the GUI part of openvpn to do
  * the route/ifconfig/open tun command.   See doc/android.txt for details.
@@ -2194,11 +2537,18 @@ management_android_control(struct management *man, const char *command, const ch
     {
         msg(M_FATAL, "Required management interface not available.");
     }
+
+    if (man_android_tun_config_item(man, command))
+    {
+        man_android_tun_config_push(man, command, msg);
+        return true;
+    }
+
     struct user_pass up;
     CLEAR(up);
     strncpy(up.username, msg, sizeof(up.username)-1);
 
-    management_query_user_pass(management, &up, command, GET_USER_PASS_NEED_OK, (void *) 0);
+    man_android_query(man, &up, command);
     return strcmp("ok", up.password)==0;
 }
 
@@ -2214,8 +2564,7 @@ managment_android_persisttun_action(struct management *man)
     struct user_pass up;
     CLEAR(up);
     strcpy(up.username, "tunmethod");
-    management_query_user_pass(management, &up, "PERSIST_TUN_ACTION",
-                               GET_USER_PASS_NEED_OK, (void *) 0);
+    man_android_query(man, &up, "PERSIST_TUN_ACTION");
     if (!strcmp("NOACTION", up.password))
     {
         return ANDROID_KEEP_OLD_TUN;
@@ -2354,6 +2703,7 @@ man_write(struct management *man)
         if (sent >= 0)
         {
             buffer_list_advance(man->connection.out, sent);
+            man_client_stats_continue(man);
         }
         else if (sent < 0)
         {
@@ -2632,6 +2982,7 @@ man_connection_close(struct management *man)
 
     in_extra_reset(&man->connection, IER_RESET);
     buffer_list_free(mc->ext_key_input);
+    man_pk_sig_async_free(mc);
     man_connection_clear(mc);
 }
 
@@ -3770,6 +4121,67 @@ management_query_pk_sig(struct management *man, const char *b64_data,
     return ret;
 }
 
+unsigned int
+management_pk_sig_async(struct management *man, const char *b64_data,
+                        const char *algorithm)
+{
+    struct man_connection *mc = &man->connection;
+    struct man_pk_sig_req *req;
+
+    if (!management_connected(man))
+    {
+        return 0;
+    }
+
+    ALLOC_OBJ_CLEAR(req, struct man_pk_sig_req);
+    do
+    {
+        req->id = ++mc->pk_sig_next_id;
+    } while (!req->id);
+    req->next = mc->pk_sig_reqs;
+    mc->pk_sig_reqs = req;
+
+    msg(M_CLIENT, ">PK_SIGN_ASYNC:%u,%s,%s", req->id, b64_data, algorithm);
+    return req->id;
+}
+
+bool
+management_pk_sig_async_result(struct management *man, const unsigned int id,
+                               char **sig)
+{
+    struct man_pk_sig_req **r = man_pk_sig_find(&man->connection, id);
+    struct man_pk_sig_req *req = *r;
+
+    if (req && !req->done)
+    {
+        return false;
+    }
+
+    /* a request that is gone has been freed with the connection */
+    *sig = NULL;
+    if (req)
+    {
+        *sig = req->sig;
+        *r = req->next;
+        free(req);
+    }
+    return true;
+}
+
+void
+management_pk_sig_async_cancel(struct management *man, const unsigned int id)
+{
+    struct man_pk_sig_req **r = man_pk_sig_find(&man->connection, id);
+    struct man_pk_sig_req *req = *r;
+
+    if (req)
+    {
+        *r = req->next;
+        free(req->sig);
+        free(req);
+    }
+}
+
 char *
 management_query_cert(struct management *man, const char *cert_name)
 {
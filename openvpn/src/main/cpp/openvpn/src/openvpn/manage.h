@@ -43,6 +43,7 @@
 #define MF_EXTERNAL_CERT            (1<<15)
 #define MF_EXTERNAL_KEY_PSSPAD      (1<<16)
 #define MF_EXTERNAL_KEY_DIGEST      (1<<17)
+#define MF_EXTERNAL_KEY_ASYNC       (1<<18)
 
 
 #ifdef ENABLE_MANAGEMENT
@@ -72,6 +73,10 @@ struct man_def_auth_context {
     unsigned int mda_key_id_counter;
 
     time_t bytecount_last_update;
+
+    /* byte counters at the last client-stats record of this client */
+    counter_type stats_bytes_in;
+    counter_type stats_bytes_out;
 };
 
 /*
@@ -185,6 +190,15 @@ struct management_callback
     int (*n_clients) (void *arg);
     bool (*send_cc_message) (void *arg, const char *message, const char *parameter);
     bool (*kill_by_cid)(void *arg, const unsigned long cid, const char *kill_msg);
+    bool (*shaper_by_cid)(void *arg, const unsigned long cid,
+                          const unsigned int rate, const unsigned int burst);
+    /*
+     * Append client-stats records to out, starting at client slot index.
+     * Returns the slot to continue at, or -1 once all slots are done.
+     */
+    int (*client_stats)(void *arg, struct buffer *out, int index,
+                        const bool delta, int *n_clients);
+    bool (*snapshot_reload)(void *arg);
     bool (*client_auth) (void *arg,
                          const unsigned long cid,
                          const unsigned int mda_key_id,
@@ -300,6 +314,7 @@ struct man_connection {
 #define IEC_RSA_SIGN    3
 #define IEC_CERTIFICATE 4
 #define IEC_PK_SIGN     5
+#define IEC_PK_SIGN_ASYNC 6
     int in_extra_cmd;
     struct buffer_list *in_extra;
     unsigned long in_extra_cid;
@@ -312,6 +327,9 @@ struct man_connection {
     struct buffer_list *ext_key_input;
     int ext_cert_state;
     struct buffer_list *ext_cert_input;
+    /* management-external-key async: requests waiting for "pk-sig <id>" */
+    struct man_pk_sig_req *pk_sig_reqs;
+    unsigned int pk_sig_next_id;
     struct event_set *es;
     int env_filter_level;
 
@@ -321,6 +339,15 @@ struct man_connection {
     int bytecount_update_seconds;
     struct event_timeout bytecount_update_interval;
 
+    /* client-stats stream, produced a chunk at a time */
+    int client_stats_seconds;   /* delta interval, 0 = off */
+    time_t client_stats_next;   /* time of the next delta pass */
+    bool client_stats_running;
+    bool client_stats_delta;
+    bool client_stats_full_pending;
+    int client_stats_index;
+    int client_stats_count;
+
     const char *up_query_type;
     int up_query_mode;
     struct user_pass up_query;
@@ -328,6 +355,7 @@ struct man_connection {
 #ifdef TARGET_ANDROID
     int fdtosend;
     int lastfdreceived;
+    int tun_config_pending;     /* >TUNCFG lines not yet confirmed */
 #endif
     int client_version;
 };
@@ -382,6 +410,9 @@ bool management_query_user_pass(struct management *man,
                                 const char *static_challenge);
 
 #ifdef TARGET_ANDROID
+/* GUIs announcing this version take the tun configuration as >TUNCFG lines */
+#define MAN_CLIENT_VERSION_TUNCFG 4
+
 bool management_android_control(struct management *man, const char *command, const char *msg);
 
 #define ANDROID_KEEP_OLD_TUN 1
@@ -430,6 +461,28 @@ void management_notify_client_cr_response(unsigned mda_key_id,
 char *management_query_pk_sig(struct management *man, const char *b64_data,
                               const char *algorithm);
 
+/**
+ * Send a signature request that the management client answers with
+ * "pk-sig <id>", in any order relative to other requests
+ * (--management-external-key async).
+ *
+ * @return  the request id, or 0 if no management client is connected
+ */
+unsigned int management_pk_sig_async(struct management *man, const char *b64_data,
+                                     const char *algorithm);
+
+/**
+ * Check whether the answer to an asynchronous signature request has
+ * arrived.  If so, the request is forgotten and *sig is set to the
+ * allocated base64 signature, or to NULL if the client sent none or
+ * disconnected.
+ */
+bool management_pk_sig_async_result(struct management *man, unsigned int id,
+                                    char **sig);
+
+/** Forget an asynchronous signature request that is no longer needed. */
+void management_pk_sig_async_cancel(struct management *man, unsigned int id);
+
 char *management_query_cert(struct management *man, const char *cert_name);
 
 static inline bool
@@ -555,6 +608,19 @@ management_bytes_server(struct management *man,
 void
 man_persist_client_stats(struct management *man, struct context *c);
 
+/*
+ * Size of a client-stats chunk, and room that must be left in it
+ * before another client record is appended.
+ */
+#define MAN_CLIENT_STATS_CHUNK  8192
+#define MAN_CLIENT_STATS_RECORD 1024
+
+/*
+ * Start a client-stats delta pass if the interval set by
+ * 'client-stats n' has passed.  Called once a second by servers.
+ */
+void management_check_client_stats(struct management *man);
+
 #endif /* ifdef ENABLE_MANAGEMENT */
 
 /**
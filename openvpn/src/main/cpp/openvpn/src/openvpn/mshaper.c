@@ -0,0 +1,417 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syshead.h"
+
+#include "integer.h"
+#include "otime.h"
+#include "mshaper.h"
+
+#include "memdbg.h"
+
+static void
+mshaper_bucket_init(struct mshaper_bucket *b, int rate, int burst)
+{
+    b->rate = rate;
+    b->burst = burst ? burst : max_int(rate / 10, 2 * MSHAPER_QUANTUM);
+    b->credit = (int64_t)b->burst * 1000000;
+    ASSERT(!openvpn_gettimeofday(&b->last, NULL));
+}
+
+static void
+mshaper_bucket_refill(struct mshaper_bucket *b, const struct timeval *tv)
+{
+    const int64_t usec = (int64_t)(tv->tv_sec - b->last.tv_sec) * 1000000
+                         + (tv->tv_usec - b->last.tv_usec);
+    const int64_t full = (int64_t)b->burst * 1000000;
+
+    if (!b->rate)
+    {
+        return;
+    }
+    if (usec > 0)
+    {
+        /* divide instead of multiplying usec, which may be large */
+        if (usec >= (full - b->credit) / b->rate)
+        {
+            b->credit = full;
+        }
+        else
+        {
+            b->credit += usec * b->rate;
+        }
+    }
+    b->last = *tv;
+}
+
+static inline bool
+mshaper_bucket_ok(const struct mshaper_bucket *b)
+{
+    return !b->rate || b->credit >= 0;
+}
+
+static inline void
+mshaper_bucket_take(struct mshaper_bucket *b, int len)
+{
+    if (b->rate)
+    {
+        b->credit -= (int64_t)len * 1000000;
+    }
+}
+
+/* microseconds until the bucket is no longer in debt */
+static inline int
+mshaper_bucket_wait(const struct mshaper_bucket *b)
+{
+    if (mshaper_bucket_ok(b))
+    {
+        return 0;
+    }
+    return (int)((-b->credit + b->rate - 1) / b->rate);
+}
+
+void
+mshaper_init(struct mshaper *s, int rate, int burst, int payload_size)
+{
+    CLEAR(*s);
+    s->enabled = true;
+    s->payload_size = payload_size;
+    s->free_head = -1;
+    mshaper_bucket_init(&s->total, rate, burst);
+}
+
+void
+mshaper_free(struct mshaper *s)
+{
+    if (s->slots)
+    {
+        for (int i = 0; i < MSHAPER_POOL_SIZE; ++i)
+        {
+            free_buf(&s->slots[i].buf);
+        }
+        free(s->slots);
+    }
+    CLEAR(*s);
+}
+
+void
+mshaper_class_init(struct mshaper_class *c, struct multi_instance *mi)
+{
+    CLEAR(*c);
+    c->instance = mi;
+    c->head = -1;
+    c->tail = -1;
+}
+
+void
+mshaper_class_set(struct mshaper_class *c, int rate, int burst)
+{
+    mshaper_bucket_init(&c->bucket, rate, burst);
+}
+
+static void
+mshaper_activate(struct mshaper *s, struct mshaper_class *c)
+{
+    c->next = NULL;
+    if (s->active_tail)
+    {
+        s->active_tail->next = c;
+    }
+    else
+    {
+        s->active = c;
+    }
+    s->active_tail = c;
+    c->active = true;
+    ++s->n_active;
+}
+
+static void
+mshaper_deactivate(struct mshaper *s, struct mshaper_class *c,
+                   struct mshaper_class *prev)
+{
+    if (prev)
+    {
+        prev->next = c->next;
+    }
+    else
+    {
+        s->active = c->next;
+    }
+    if (s->active_tail == c)
+    {
+        s->active_tail = prev;
+    }
+    c->next = NULL;
+    c->active = false;
+    c->deficit = 0;
+    --s->n_active;
+}
+
+/* move the head of the round robin list to its end */
+static void
+mshaper_rotate(struct mshaper *s)
+{
+    struct mshaper_class *c = s->active;
+    if (c->next)
+    {
+        s->active = c->next;
+        s->active_tail->next = c;
+        s->active_tail = c;
+        c->next = NULL;
+    }
+}
+
+static int
+mshaper_pop(struct mshaper *s, struct mshaper_class *c)
+{
+    const int slot = c->head;
+
+    c->head = s->slots[slot].next;
+    if (c->head < 0)
+    {
+        c->tail = -1;
+    }
+    --c->n_queued;
+    c->bytes_queued -= BLEN(&s->slots[slot].buf);
+    --s->n_queued;
+    return slot;
+}
+
+void
+mshaper_release(struct mshaper *s, int slot)
+{
+    s->slots[slot].next = s->free_head;
+    s->free_head = slot;
+}
+
+void
+mshaper_class_flush(struct mshaper *s, struct mshaper_class *c)
+{
+    if (c->active)
+    {
+        struct mshaper_class *prev = NULL;
+        for (struct mshaper_class *i = s->active; i != c; i = i->next)
+        {
+            prev = i;
+        }
+        mshaper_deactivate(s, c, prev);
+    }
+    while (c->n_queued)
+    {
+        mshaper_release(s, mshaper_pop(s, c));
+    }
+}
+
+bool
+mshaper_admit(struct mshaper *s, struct mshaper_class *c, int len)
+{
+    struct timeval tv;
+
+    /* keep the order of the packets */
+    if (c->active)
+    {
+        return false;
+    }
+
+    ASSERT(!openvpn_gettimeofday(&tv, NULL));
+    mshaper_bucket_refill(&s->total, &tv);
+    mshaper_bucket_refill(&c->bucket, &tv);
+    if (!mshaper_bucket_ok(&s->total) || !mshaper_bucket_ok(&c->bucket))
+    {
+        return false;
+    }
+
+    mshaper_bucket_take(&s->total, len);
+    mshaper_bucket_take(&c->bucket, len);
+    return true;
+}
+
+static int
+mshaper_queue_limit(const struct mshaper *s, const struct mshaper_class *c)
+{
+    const int rate = c->bucket.rate ? c->bucket.rate : s->total.rate;
+    return max_int(rate / (1000 / MSHAPER_QUEUE_MSEC),
+                   MSHAPER_QUEUE_MIN * s->payload_size);
+}
+
+static void
+mshaper_drop_longest(struct mshaper *s)
+{
+    struct mshaper_class *longest = s->active;
+    struct mshaper_class *longest_prev = NULL;
+    struct mshaper_class *prev = NULL;
+
+    for (struct mshaper_class *c = s->active; c; prev = c, c = c->next)
+    {
+        if (c->bytes_queued > longest->bytes_queued)
+        {
+            longest = c;
+            longest_prev = prev;
+        }
+    }
+
+    mshaper_release(s, mshaper_pop(s, longest));
+    if (!longest->n_queued)
+    {
+        mshaper_deactivate(s, longest, longest_prev);
+    }
+    ++s->dropped;
+}
+
+bool
+mshaper_enqueue(struct mshaper *s, struct mshaper_class *c,
+                const struct buffer *buf)
+{
+    const int len = BLEN(buf);
+
+    if (len > s->payload_size || c->bytes_queued + len > mshaper_queue_limit(s, c))
+    {
+        ++s->dropped;
+        return false;
+    }
+
+    if (!s->slots)
+    {
+        ALLOC_ARRAY_CLEAR(s->slots, struct mshaper_slot, MSHAPER_POOL_SIZE);
+        for (int i = MSHAPER_POOL_SIZE - 1; i >= 0; --i)
+        {
+            s->slots[i].buf = alloc_buf(s->payload_size);
+            mshaper_release(s, i);
+        }
+    }
+    if (s->free_head < 0)
+    {
+        mshaper_drop_longest(s);
+    }
+
+    const int slot = s->free_head;
+    struct buffer *b = &s->slots[slot].buf;
+    s->free_head = s->slots[slot].next;
+
+    ASSERT(buf_init(b, 0));
+    ASSERT(buf_copy(b, buf));
+
+    s->slots[slot].next = -1;
+    if (c->tail >= 0)
+    {
+        s->slots[c->tail].next = slot;
+    }
+    else
+    {
+        c->head = slot;
+    }
+    c->tail = slot;
+    ++c->n_queued;
+    c->bytes_queued += len;
+    ++s->n_queued;
+
+    if (!c->active)
+    {
+        mshaper_activate(s, c);
+    }
+    return true;
+}
+
+int
+mshaper_dequeue(struct mshaper *s, struct mshaper_class **cls)
+{
+    struct timeval tv;
+    int blocked = 0;
+
+    if (!s->n_active)
+    {
+        return -1;
+    }
+
+    ASSERT(!openvpn_gettimeofday(&tv, NULL));
+    mshaper_bucket_refill(&s->total, &tv);
+    if (!mshaper_bucket_ok(&s->total))
+    {
+        return -1;
+    }
+
+    /* deficit round robin, skipping classes without tokens */
+    while (blocked < s->n_active)
+    {
+        struct mshaper_class *c = s->active;
+
+        mshaper_bucket_refill(&c->bucket, &tv);
+        if (!mshaper_bucket_ok(&c->bucket))
+        {
+            mshaper_rotate(s);
+            ++blocked;
+            continue;
+        }
+
+        const int len = BLEN(&s->slots[c->head].buf);
+        if (c->deficit < len)
+        {
+            c->deficit += MSHAPER_QUANTUM;
+            mshaper_rotate(s);
+            blocked = 0;
+            continue;
+        }
+
+        const int slot = mshaper_pop(s, c);
+        c->deficit -= len;
+        mshaper_bucket_take(&s->total, len);
+        mshaper_bucket_take(&c->bucket, len);
+        if (!c->n_queued)
+        {
+            mshaper_deactivate(s, c, NULL);
+        }
+        *cls = c;
+        return slot;
+    }
+    return -1;
+}
+
+int
+mshaper_delay(struct mshaper *s)
+{
+    struct timeval tv;
+    int delay = INT_MAX;
+
+    ASSERT(!openvpn_gettimeofday(&tv, NULL));
+    mshaper_bucket_refill(&s->total, &tv);
+    if (!mshaper_bucket_ok(&s->total))
+    {
+        return mshaper_bucket_wait(&s->total);
+    }
+
+    for (struct mshaper_class *c = s->active; c; c = c->next)
+    {
+        mshaper_bucket_refill(&c->bucket, &tv);
+        delay = min_int(delay, mshaper_bucket_wait(&c->bucket));
+        if (!delay)
+        {
+            break;
+        }
+    }
+    return delay;
+}
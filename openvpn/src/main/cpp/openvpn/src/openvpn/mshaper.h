@@ -0,0 +1,182 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MSHAPER_H
+#define MSHAPER_H
+
+/*
+ * Token bucket traffic shaper for the data channel packets that a UDP
+ * server sends to its clients (--shaper-total, --shaper-client).
+ *
+ * Every client has a class with an optional token bucket of its own.
+ * All classes share the optional bucket of the whole server.  A packet
+ * may be sent when both buckets have tokens left; otherwise it is
+ * copied into a slot of a fixed pool and queued on its class.  Queued
+ * packets are sent in deficit round robin order over all classes, so
+ * a client with a large backlog cannot starve the others when the
+ * server bucket is the bottleneck.
+ */
+
+#include "basic.h"
+#include "buffer.h"
+#include "common.h"
+
+struct multi_instance;
+
+/* maximum number of queued packets over all clients */
+#define MSHAPER_POOL_SIZE 2048
+
+/* bytes a class may send per round robin turn */
+#define MSHAPER_QUANTUM 1500
+
+/* a class queues at most this many milliseconds of its rate... */
+#define MSHAPER_QUEUE_MSEC 200
+
+/* ...but always room for this many packets */
+#define MSHAPER_QUEUE_MIN 8
+
+struct mshaper_bucket
+{
+    int rate;                   /**< bytes per second, 0 = unlimited */
+    int burst;                  /**< bucket size in bytes */
+    int64_t credit;             /**< tokens in bytes * 1000000, below
+                                 *   zero after a packet larger than
+                                 *   the remaining tokens was sent */
+    struct timeval last;        /**< time of the last refill */
+};
+
+/** Queued packets and token bucket of one client */
+struct mshaper_class
+{
+    struct mshaper_bucket bucket;
+    struct multi_instance *instance;
+    int head;                   /**< first queued slot, -1 if none */
+    int tail;
+    int n_queued;
+    int bytes_queued;
+    int deficit;                /**< round robin credit in bytes */
+    bool active;                /**< on the round robin list */
+    struct mshaper_class *next;
+};
+
+struct mshaper_slot
+{
+    struct buffer buf;
+    int next;
+};
+
+struct mshaper
+{
+    bool enabled;               /**< UDP server */
+    struct mshaper_bucket total;
+    int payload_size;           /**< size of the slot buffers */
+    struct mshaper_slot *slots; /**< allocated on first use */
+    int free_head;
+    struct mshaper_class *active; /**< round robin list of classes with
+                                   *   queued packets */
+    struct mshaper_class *active_tail;
+    int n_active;
+    int n_queued;
+    counter_type dropped;
+};
+
+void mshaper_init(struct mshaper *s, int rate, int burst, int payload_size);
+
+void mshaper_free(struct mshaper *s);
+
+void mshaper_class_init(struct mshaper_class *c, struct multi_instance *mi);
+
+/**
+ * Change the rate of a class.
+ *
+ * @param c         the class
+ * @param rate      bytes per second, 0 removes the limit
+ * @param burst     bucket size in bytes, 0 selects a default
+ */
+void mshaper_class_set(struct mshaper_class *c, int rate, int burst);
+
+/**
+ * Drop the queued packets of a class and take it off the round robin
+ * list, before its instance is closed.
+ */
+void mshaper_class_flush(struct mshaper *s, struct mshaper_class *c);
+
+/**
+ * Ask whether a packet of a class may be sent right away.  If yes, its
+ * tokens are taken.  While a class has queued packets, new ones are
+ * queued behind them.
+ *
+ * @return          true if the packet may be sent
+ */
+bool mshaper_admit(struct mshaper *s, struct mshaper_class *c, int len);
+
+/**
+ * Copy a packet into the queue of a class.  If the class has used up
+ * its share, the packet is dropped; if the pool is exhausted, the
+ * oldest packet of the longest queue is dropped to make room.
+ *
+ * @return          false if the packet was dropped
+ */
+bool mshaper_enqueue(struct mshaper *s, struct mshaper_class *c,
+                     const struct buffer *buf);
+
+/**
+ * Take the next packet that may be sent now off the queues and take
+ * its tokens.  The slot must be returned with mshaper_release() once
+ * the packet has been sent.
+ *
+ * @param cls       returns the class of the packet
+ *
+ * @return          slot index, or -1 if no packet may be sent now
+ */
+int mshaper_dequeue(struct mshaper *s, struct mshaper_class **cls);
+
+void mshaper_release(struct mshaper *s, int slot);
+
+/**
+ * Return 0 if a queued packet may be sent now, otherwise the number
+ * of microseconds until that will be the case.  Only valid if some
+ * packets are queued.
+ */
+int mshaper_delay(struct mshaper *s);
+
+static inline struct buffer *
+mshaper_slot_buf(struct mshaper *s, int slot)
+{
+    return &s->slots[slot].buf;
+}
+
+/** Is the traffic to the client of this class shaped at all? */
+static inline bool
+mshaper_limited(const struct mshaper *s, const struct mshaper_class *c)
+{
+    return s->enabled && (s->total.rate || c->bucket.rate);
+}
+
+static inline bool
+mshaper_backlog(const struct mshaper *s)
+{
+    return s->n_active > 0;
+}
+
+#endif /* MSHAPER_H */
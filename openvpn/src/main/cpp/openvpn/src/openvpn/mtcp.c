@@ -29,6 +29,7 @@
 
 #include "multi.h"
 #include "forward.h"
+#include "xkey_async.h"
 
 #include "memdbg.h"
 
@@ -60,6 +61,7 @@
 #define MTCP_MANAGEMENT ((void *)4)
 #define MTCP_FILE_CLOSE_WRITE ((void *)5)
 #define MTCP_DCO        ((void *)6)
+#define MTCP_SIGN_DONE  ((void *)7)
 
 #define MTCP_N           ((void *)16) /* upper bound on MTCP_x */
 
@@ -297,6 +299,11 @@ multi_tcp_wait(const struct context *c,
     event_ctl(mtcp->es, c->c2.inotify_fd, EVENT_READ, MTCP_FILE_CLOSE_WRITE);
 #endif
 
+    if (xkey_async_event_fd() >= 0)
+    {
+        event_ctl(mtcp->es, xkey_async_event_fd(), EVENT_READ, MTCP_SIGN_DONE);
+    }
+
     status = event_wait(mtcp->es, &c->c2.timeval, mtcp->esr, mtcp->maxevents);
     update_time();
     mtcp->n_esr = 0;
@@ -761,6 +768,10 @@ multi_tcp_process_io(struct multi_context *m)
                 multi_process_file_closed(m, MPP_PRE_SELECT | MPP_RECORD_TOUCH);
             }
 #endif
+            else if (e->arg == MTCP_SIGN_DONE)
+            {
+                multi_process_sign_done(m);
+            }
         }
         if (IS_SIG(&m->top))
         {
@@ -58,6 +58,7 @@ send_hmac_reset_packet(struct multi_context *m,
     buf_copy(&c->c2.buffers->aux_buf, &buf);
     m->hmac_reply = c->c2.buffers->aux_buf;
     m->hmac_reply_dest = &m->top.c2.from;
+    m->initial_stats.hmac_resets++;
     msg(D_MULTI_DEBUG, "Reset packet from client, sending HMAC based reset challenge");
 }
 
@@ -86,6 +87,7 @@ do_pre_decrypt_check(struct multi_context *m,
          * responses */
         if (!reflect_filter_rate_limit_check(m->initial_rate_limiter))
         {
+            m->initial_stats.drop_initial++;
             return false;
         }
     }
@@ -161,6 +163,7 @@ do_pre_decrypt_check(struct multi_context *m,
 
         if (!ret)
         {
+            m->initial_stats.drop_invalid++;
             msg(D_MULTI_MEDIUM, "Packet (%s) with invalid or missing SID from %s",
                 packet_opcode_name(op), peer);
         }
@@ -175,6 +178,7 @@ do_pre_decrypt_check(struct multi_context *m,
     }
 
     /* VERDICT_INVALID */
+    m->initial_stats.drop_invalid++;
     return false;
 }
 
@@ -236,13 +240,24 @@ multi_get_create_instance_udp(struct multi_context *m, bool *floated)
         /* we have no existing multi instance for this connection */
         if (!mi)
         {
+            uint8_t scratch[TLS_PRE_DECRYPT_SCRATCH_SIZE];
             struct tls_pre_decrypt_state state = {0};
+            buf_set_write(&state.scratch, scratch, sizeof(scratch));
             if (m->deferred_shutdown_signal.signal_received)
             {
                 msg(D_MULTI_ERRORS,
                     "MULTI: Connection attempt from %s ignored while server is "
                     "shutting down", mroute_addr_print(&real, &gc));
             }
+            else if (m->prefix_rate_limiter
+                     && !prefix_rate_limit_check(m->prefix_rate_limiter,
+                                                 &m->top.c2.from.dest))
+            {
+                /* Checked before any HMAC or parsing work so a flood from
+                 * one network is dropped as cheaply as possible. Drops
+                 * are logged as a summary by the limiter. */
+                m->initial_stats.drop_prefix++;
+            }
             else if (do_pre_decrypt_check(m, &state, real))
             {
                 /* This is an unknown session but with valid tls-auth/tls-crypt
@@ -250,7 +265,15 @@ multi_get_create_instance_udp(struct multi_context *m, bool *floated)
                  * session, we just send a reply with a HMAC session id and
                  * do not generate a session slot */
 
-                if (frequency_limit_event_allowed(m->new_connection_limiter))
+                if (!multi_handshake_admit(m))
+                {
+                    /* Still stateless: the client repeats this packet
+                     * and is admitted once a pending handshake is done */
+                    msg(D_MULTI_MEDIUM,
+                        "MULTI: Connection from %s would exceed maximum number of pending handshakes as controlled by --max-pending-handshakes",
+                        mroute_addr_print(&real, &gc));
+                }
+                else if (frequency_limit_event_allowed(m->new_connection_limiter))
                 {
                     /* a successful three-way handshake only counts against
                      * connect-freq but not against connect-freq-initial */
@@ -301,17 +324,79 @@ multi_get_create_instance_udp(struct multi_context *m, bool *floated)
     return mi;
 }
 
+/*
+ * Maximum number of queued bcast/mcast packets encrypted
+ * and sent per socket write event.
+ */
+#define MBUF_BATCH_MAX 32
+
+/*
+ * All instances write through the socket of the top context.
+ */
+static inline bool
+multi_link_write_blocked(const struct multi_context *m)
+{
+    return m->top.c2.link_socket->write_blocked;
+}
+
 /*
  * Send a packet to UDP socket.
  */
 static inline void
 multi_process_outgoing_link(struct multi_context *m, const unsigned int mpp_flags)
 {
-    struct multi_instance *mi = multi_process_outgoing_link_pre(m);
+    struct multi_instance *mi = m->pending;
+
+    /* we were called because the socket is writable */
+    m->top.c2.link_socket->write_blocked = false;
+    if (!mi && mbuf_defined(m->mbuf))
+    {
+        mi = multi_get_queue(m->mbuf);
+        if (mi)
+        {
+            multi_shape_outgoing_link(m, mi);
+        }
+    }
     if (mi)
     {
         multi_process_outgoing_link_dowork(m, mi, mpp_flags);
     }
+
+    /* A broadcast queues one packet per client.  Instead of going
+     * back to io_wait() for every recipient, keep draining the queue
+     * while no instance has other output pending.  All recipients
+     * share the cleartext buffer, only the encryption is done per
+     * client.  Once the socket buffer is full the rest stays queued
+     * until the socket is writable again. */
+    for (int i = 1; i < MBUF_BATCH_MAX && !m->pending && !multi_link_write_blocked(m)
+         && mbuf_defined(m->mbuf); ++i)
+    {
+        mi = multi_get_queue(m->mbuf);
+        if (!mi)
+        {
+            break;
+        }
+        multi_shape_outgoing_link(m, mi);
+        multi_process_outgoing_link_dowork(m, mi, mpp_flags);
+    }
+
+    /* Then the packets held back by the shaper whose clients have
+     * tokens again.  The slot is sent from directly. */
+    for (int i = 0; i < MBUF_BATCH_MAX && !m->pending && !multi_link_write_blocked(m)
+         && mshaper_backlog(&m->shaper); ++i)
+    {
+        struct mshaper_class *cls;
+        const int slot = mshaper_dequeue(&m->shaper, &cls);
+        if (slot < 0)
+        {
+            break;
+        }
+        mi = cls->instance;
+        mi->context.c2.to_link = *mshaper_slot_buf(&m->shaper, slot);
+        mi->context.c2.to_link_addr = &mi->context.c2.from;
+        multi_process_outgoing_link_dowork(m, mi, mpp_flags);
+        mshaper_release(&m->shaper, slot);
+    }
     if (m->hmac_reply_dest && m->hmac_reply.len > 0)
     {
         msg_set_prefix("Connection Attempt");
@@ -402,6 +487,11 @@ multi_process_io_udp(struct multi_context *m)
         multi_process_file_closed(m, mpp_flags);
     }
 #endif
+    /* a signature for a paused handshake is done */
+    else if (status & SIGN_DONE)
+    {
+        multi_process_sign_done(m);
+    }
 #if defined(ENABLE_DCO) && (defined(TARGET_LINUX) || defined(TARGET_FREEBSD))
     else if (status & DCO_READ)
     {
@@ -422,7 +512,7 @@ multi_process_io_udp(struct multi_context *m)
  * a point-to-multipoint tunnel.
  */
 static inline unsigned int
-p2mp_iow_flags(const struct multi_context *m)
+p2mp_iow_flags(struct multi_context *m)
 {
     unsigned int flags = IOW_WAIT_SIGNAL;
     if (m->pending)
@@ -444,6 +534,10 @@ p2mp_iow_flags(const struct multi_context *m)
     {
         flags |= IOW_TO_LINK;
     }
+    else if (mshaper_backlog(&m->shaper) && !mshaper_delay(&m->shaper))
+    {
+        flags |= IOW_TO_LINK;
+    }
     else
     {
         flags |= IOW_READ;
@@ -41,6 +41,7 @@
 #include "mstats.h"
 #include "ssl_verify.h"
 #include "ssl_ncp.h"
+#include "tls_crypt.h"
 #include "vlan.h"
 #include <inttypes.h>
 
@@ -51,6 +52,7 @@
 #include "ssl_util.h"
 #include "dco.h"
 #include "reflect_filter.h"
+#include "xkey_async.h"
 
 /*#define MULTI_DEBUG_EVENT_LOOP*/
 
@@ -297,6 +299,12 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode)
         t->options.real_hash_size,
         t->options.virtual_hash_size);
 
+    /*
+     * The global push list is final now, serialize it once
+     * for all clients that inherit it unmodified.
+     */
+    cache_push_list(&t->options);
+
     /*
      * Get tun/tap/null device type
      */
@@ -307,6 +315,18 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode)
      */
     CLEAR(*m);
 
+    if (t->options.config_snapshot)
+    {
+        m->snapshot_push_base = t->options.push_list;
+        m->snapshot = config_snapshot_new(t->options.client_config_dir,
+                                          t->options.config_snapshot_push_file,
+                                          &m->snapshot_push_base);
+        if (!m->snapshot)
+        {
+            msg(M_FATAL, "Cannot read --config-snapshot");
+        }
+    }
+
     /*
      * Real address hash table (source port number is
      * considered to be part of the address).  Used
@@ -369,12 +389,36 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode)
                                                      t->options.cf_per);
     m->initial_rate_limiter = initial_rate_limit_init(t->options.cf_initial_max,
                                                       t->options.cf_initial_per);
+    if (t->options.cf_prefix_max > 0)
+    {
+        m->prefix_rate_limiter = prefix_rate_limit_init(t->options.cf_prefix_max,
+                                                        t->options.cf_prefix_per);
+    }
+
+    /*
+     * Limit the number of clients in the handshake and
+     * authentication phase, so that they can complete in time
+     * when many clients connect at once.
+     */
+    m->handshakes.max_pending = t->options.max_pending_handshakes;
+    m->handshakes.backoff = t->options.handshake_backoff;
 
     /*
      * Allocate broadcast/multicast buffer list
      */
     m->mbuf = mbuf_init(t->options.n_bcast_buf);
 
+    /*
+     * Traffic shaping towards the clients, only the UDP
+     * server sends all packets from one place
+     */
+    if (!tcp_mode)
+    {
+        mshaper_init(&m->shaper, t->options.shaper_total,
+                     t->options.shaper_total_burst,
+                     t->c2.frame.buf.payload_size);
+    }
+
     /*
      * Different status file format options are available
      */
@@ -598,6 +642,33 @@ multi_client_disconnect_script(struct multi_context *m, struct multi_instance *m
 #endif
 }
 
+/*
+ * Give back the --max-pending-handshakes slot of an instance that
+ * completed or gave up authentication.
+ */
+static void
+multi_handshake_release(struct multi_context *m, struct multi_instance *mi,
+                        bool completed)
+{
+    struct tls_multi *tls_multi = mi->context.c2.tls_multi;
+    if (!tls_multi || !tls_multi->handshake_pending)
+    {
+        return;
+    }
+
+    tls_multi->handshake_pending = false;
+    m->handshakes.pending--;
+    if (completed)
+    {
+        m->handshakes.completed++;
+        m->handshakes.seconds += now - mi->created;
+    }
+    else
+    {
+        m->handshakes.failed++;
+    }
+}
+
 void
 multi_close_instance(struct multi_context *m,
                      struct multi_instance *mi,
@@ -607,6 +678,7 @@ multi_close_instance(struct multi_context *m,
 
     ASSERT(!mi->halt);
     mi->halt = true;
+    m->bcast_members_dirty = true;
 
     dmsg(D_MULTI_DEBUG, "MULTI: multi_close_instance called");
 
@@ -615,6 +687,8 @@ multi_close_instance(struct multi_context *m,
     update_mstat_n_clients(m->n_clients);
     mi->n_clients_delta = 0;
 
+    multi_handshake_release(m, mi, false);
+
     /* prevent dangling pointers */
     if (m->pending == mi)
     {
@@ -671,6 +745,8 @@ multi_close_instance(struct multi_context *m,
         }
 
         mbuf_dereference_instance(m->mbuf, mi);
+
+        mshaper_class_flush(&m->shaper, &mi->shaper);
     }
 
 #ifdef ENABLE_MANAGEMENT
@@ -684,6 +760,9 @@ multi_close_instance(struct multi_context *m,
 
     close_context(&mi->context, SIGTERM, CC_GC_FREE);
 
+    config_snapshot_release(mi->snapshot);
+    mi->snapshot = NULL;
+
     multi_tcp_instance_specific_free(mi);
 
     ungenerate_prefix(mi);
@@ -729,17 +808,29 @@ multi_uninit(struct multi_context *m)
         m->hash = NULL;
 
         free(m->instances);
+        free(m->bcast_members);
 
 #ifdef ENABLE_ASYNC_PUSH
         hash_free(m->inotify_watchers);
         m->inotify_watchers = NULL;
 #endif
 
+        while (m->sign_wait)
+        {
+            struct multi_instance *mi = m->sign_wait;
+            m->sign_wait = mi->sign_wait_next;
+            multi_instance_dec_refcount(mi);
+        }
+
         schedule_free(m->schedule);
         mbuf_free(m->mbuf);
+        mshaper_free(&m->shaper);
+        config_snapshot_release(m->snapshot);
+        m->snapshot = NULL;
         ifconfig_pool_free(m->ifconfig_pool);
         frequency_limit_free(m->new_connection_limiter);
         initial_rate_limit_free(m->initial_rate_limiter);
+        prefix_rate_limit_free(m->prefix_rate_limiter);
         multi_reap_free(m->reaper);
         mroute_helper_free(m->route_helper);
         multi_tcp_free(m->mtcp);
@@ -766,6 +857,7 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
     mi->vaddr_handle = -1;
     mi->created = now;
     mroute_addr_init(&mi->real);
+    mshaper_class_init(&mi->shaper, mi);
 
     if (real)
     {
@@ -781,12 +873,28 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
 
     mi->context.c2.tls_multi->multi_state = CAS_NOT_CONNECTED;
 
+    mi->snapshot = config_snapshot_acquire(m->snapshot);
+    mi->context.c2.tls_multi->opt.config_snapshot = mi->snapshot;
+
     if (hash_n_elements(m->hash) >= m->max_clients)
     {
         msg(D_MULTI_ERRORS, "MULTI: new incoming connection would exceed maximum number of clients (%d)", m->max_clients);
         goto err;
     }
 
+    if (!multi_handshake_admit(m))
+    {
+        msg(D_MULTI_MEDIUM, "MULTI: new incoming connection would exceed maximum number of pending handshakes (%d)",
+            m->handshakes.max_pending);
+        goto err;
+    }
+    if (m->handshakes.max_pending)
+    {
+        mi->context.c2.tls_multi->opt.handshake_budget = &m->handshakes;
+        mi->context.c2.tls_multi->handshake_pending = true;
+        m->handshakes.pending++;
+    }
+
     if (!real) /* TCP mode? */
     {
         if (!multi_tcp_instance_specific_init(m, mi))
@@ -803,6 +911,7 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
         goto err;
     }
     mi->did_iter = true;
+    m->bcast_members_dirty = true;
 
 #ifdef ENABLE_MANAGEMENT
     do
@@ -917,6 +1026,50 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
                 status_printf(so, "Max bcast/mcast queue length,%d",
                               mbuf_maximum_queued(m->mbuf));
             }
+            if (proto_is_udp(m->top.options.ce.proto))
+            {
+                status_printf(so, "Initial HMAC resets sent," counter_format,
+                              m->initial_stats.hmac_resets);
+                status_printf(so, "Initial packets dropped (prefix limit)," counter_format,
+                              m->initial_stats.drop_prefix);
+                status_printf(so, "Initial packets dropped (rate limit)," counter_format,
+                              m->initial_stats.drop_initial);
+                status_printf(so, "Initial packets dropped (invalid)," counter_format,
+                              m->initial_stats.drop_invalid);
+            }
+            if (m->handshakes.max_pending)
+            {
+                const struct handshake_budget *hb = &m->handshakes;
+                status_printf(so, "Pending handshakes,%d", hb->pending);
+                status_printf(so, "Handshakes dropped (budget used up)," counter_format,
+                              hb->dropped);
+                status_printf(so, "Handshakes postponed (no auth-token)," counter_format,
+                              hb->busy);
+                status_printf(so, "Handshakes prioritized (auth-token)," counter_format,
+                              hb->token);
+                status_printf(so, "Handshakes completed," counter_format,
+                              hb->completed);
+                status_printf(so, "Handshakes failed," counter_format,
+                              hb->failed);
+                status_printf(so, "Handshake time total (seconds)," counter_format,
+                              hb->seconds);
+            }
+            if (m->shaper.slots)
+            {
+                status_printf(so, "Shaper queued packets,%d", m->shaper.n_queued);
+                status_printf(so, "Shaper packets dropped," counter_format,
+                              m->shaper.dropped);
+            }
+            if (m->top.c1.ks.tls_crypt_v2_cache)
+            {
+                const struct tls_crypt_v2_cache *cache = m->top.c1.ks.tls_crypt_v2_cache;
+                status_printf(so, "tls-crypt-v2 client keys cached," counter_format,
+                              cache->hits);
+                status_printf(so, "tls-crypt-v2 client keys unwrapped," counter_format,
+                              cache->misses);
+                status_printf(so, "tls-crypt-v2 client keys rejected (cached)," counter_format,
+                              cache->rejected);
+            }
 
             status_printf(so, "END");
         }
@@ -1003,6 +1156,52 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
             }
 
             status_printf(so, "GLOBAL_STATS%cdco_enabled%c%d", sep, sep, dco_enabled(&m->top.options));
+            if (proto_is_udp(m->top.options.ce.proto))
+            {
+                status_printf(so, "GLOBAL_STATS%cinitial_hmac_resets%c" counter_format,
+                              sep, sep, m->initial_stats.hmac_resets);
+                status_printf(so, "GLOBAL_STATS%cinitial_drop_prefix%c" counter_format,
+                              sep, sep, m->initial_stats.drop_prefix);
+                status_printf(so, "GLOBAL_STATS%cinitial_drop_rate%c" counter_format,
+                              sep, sep, m->initial_stats.drop_initial);
+                status_printf(so, "GLOBAL_STATS%cinitial_drop_invalid%c" counter_format,
+                              sep, sep, m->initial_stats.drop_invalid);
+            }
+            if (m->handshakes.max_pending)
+            {
+                const struct handshake_budget *hb = &m->handshakes;
+                status_printf(so, "GLOBAL_STATS%chandshake_pending%c%d",
+                              sep, sep, hb->pending);
+                status_printf(so, "GLOBAL_STATS%chandshake_dropped%c" counter_format,
+                              sep, sep, hb->dropped);
+                status_printf(so, "GLOBAL_STATS%chandshake_busy%c" counter_format,
+                              sep, sep, hb->busy);
+                status_printf(so, "GLOBAL_STATS%chandshake_token%c" counter_format,
+                              sep, sep, hb->token);
+                status_printf(so, "GLOBAL_STATS%chandshake_completed%c" counter_format,
+                              sep, sep, hb->completed);
+                status_printf(so, "GLOBAL_STATS%chandshake_failed%c" counter_format,
+                              sep, sep, hb->failed);
+                status_printf(so, "GLOBAL_STATS%chandshake_seconds%c" counter_format,
+                              sep, sep, hb->seconds);
+            }
+            if (m->shaper.slots)
+            {
+                status_printf(so, "GLOBAL_STATS%cshaper_queued%c%d",
+                              sep, sep, m->shaper.n_queued);
+                status_printf(so, "GLOBAL_STATS%cshaper_dropped%c" counter_format,
+                              sep, sep, m->shaper.dropped);
+            }
+            if (m->top.c1.ks.tls_crypt_v2_cache)
+            {
+                const struct tls_crypt_v2_cache *cache = m->top.c1.ks.tls_crypt_v2_cache;
+                status_printf(so, "GLOBAL_STATS%ctls_crypt_v2_cache_hits%c" counter_format,
+                              sep, sep, cache->hits);
+                status_printf(so, "GLOBAL_STATS%ctls_crypt_v2_cache_misses%c" counter_format,
+                              sep, sep, cache->misses);
+                status_printf(so, "GLOBAL_STATS%ctls_crypt_v2_cache_rejected%c" counter_format,
+                              sep, sep, cache->rejected);
+            }
             status_printf(so, "END");
         }
         else
@@ -2501,9 +2700,20 @@ multi_client_connect_late_setup(struct multi_context *m,
     mi->reporting_addr = mi->context.c2.push_ifconfig_local;
     mi->reporting_addr_ipv6 = mi->context.c2.push_ifconfig_ipv6_local;
 
+    /* --shaper-client may come from the client specific options */
+    if (m->shaper.enabled && mi->context.options.shaper_client)
+    {
+        mshaper_class_set(&mi->shaper, mi->context.options.shaper_client,
+                          mi->context.options.shaper_client_burst);
+        msg(D_MULTI_LOW, "MULTI: traffic to %s shaped to %d bytes per second",
+            multi_instance_string(mi, false, &gc), mi->shaper.bucket.rate);
+    }
+
     /* set context-level authentication flag */
     mi->context.c2.tls_multi->multi_state = CAS_CONNECT_DONE;
 
+    multi_handshake_release(m, mi, true);
+
     /* authentication complete, calculate dynamic client specific options */
     if (!multi_client_set_protocol_options(&mi->context))
     {
@@ -2613,29 +2823,51 @@ multi_client_connect_source_ccd(struct multi_context *m,
     {
         struct gc_arena gc = gc_new();
         const char *ccd_file = NULL;
+        const char *ccd_snapshot = NULL;
 
-        const char *ccd_client =
-            platform_gen_path(mi->context.options.client_config_dir,
-                              tls_common_name(mi->context.c2.tls_multi, false),
-                              &gc);
+        if (mi->snapshot)
+        {
+            /* common-name or default file, without file system access */
+            ccd_snapshot = config_snapshot_ccd(mi->snapshot,
+                                               tls_common_name(mi->context.c2.tls_multi, false),
+                                               true);
+        }
+        else
+        {
+            const char *ccd_client =
+                platform_gen_path(mi->context.options.client_config_dir,
+                                  tls_common_name(mi->context.c2.tls_multi, false),
+                                  &gc);
 
-        const char *ccd_default =
-            platform_gen_path(mi->context.options.client_config_dir,
-                              CCD_DEFAULT, &gc);
+            const char *ccd_default =
+                platform_gen_path(mi->context.options.client_config_dir,
+                                  CCD_DEFAULT, &gc);
 
 
-        /* try common-name file */
-        if (platform_test_file(ccd_client))
-        {
-            ccd_file = ccd_client;
+            /* try common-name file */
+            if (platform_test_file(ccd_client))
+            {
+                ccd_file = ccd_client;
+            }
+            /* try default file */
+            else if (platform_test_file(ccd_default))
+            {
+                ccd_file = ccd_default;
+            }
         }
-        /* try default file */
-        else if (platform_test_file(ccd_default))
+
+        if (ccd_snapshot)
         {
-            ccd_file = ccd_default;
+            msg(D_PUSH, "OPTIONS IMPORT: reading client specific options from snapshot of: %s",
+                mi->context.options.client_config_dir);
+            options_string_import(&mi->context.options,
+                                  ccd_snapshot,
+                                  D_IMPORT_ERRORS|M_OPTERR,
+                                  CLIENT_CONNECT_OPT_MASK,
+                                  option_types_found,
+                                  mi->context.c2.es);
         }
-
-        if (ccd_file)
+        else if (ccd_file)
         {
             options_server_import(&mi->context.options,
                                   ccd_file,
@@ -2643,6 +2875,10 @@ multi_client_connect_source_ccd(struct multi_context *m,
                                   CLIENT_CONNECT_OPT_MASK,
                                   option_types_found,
                                   mi->context.c2.es);
+        }
+
+        if (ccd_snapshot || ccd_file)
+        {
             /*
              * Select a virtual address from either --ifconfig-push in
              * --client-config-dir file or --ifconfig-pool.
@@ -2873,6 +3109,33 @@ multi_process_file_closed(struct multi_context *m, const unsigned int mpp_flags)
 }
 #endif /* ifdef ENABLE_ASYNC_PUSH */
 
+void
+multi_process_sign_done(struct multi_context *m)
+{
+    struct multi_instance *mi = m->sign_wait;
+
+    xkey_async_clear_event();
+    m->sign_wait = NULL;
+
+    /* The event does not tell whose signature is done.  Processing a
+     * handshake that still waits only pauses its job again, and the
+     * instance puts itself back on the list in multi_process_post(). */
+    while (mi)
+    {
+        struct multi_instance *next = mi->sign_wait_next;
+        mi->sign_wait = false;
+        if (!mi->halt)
+        {
+            interval_action(&mi->context.c2.tmp_int);
+            ASSERT(!openvpn_gettimeofday(&mi->wakeup, NULL));
+            schedule_add_entry(m->schedule, (struct schedule_entry *) mi,
+                               &mi->wakeup, 0);
+        }
+        multi_instance_dec_refcount(mi);
+        mi = next;
+    }
+}
+
 /*
  * Add a mbuf buffer to a particular
  * instance.
@@ -2914,8 +3177,47 @@ multi_unicast(struct multi_context *m,
     }
 }
 
+/*
+ * Rebuild the flat list of broadcast recipients from the
+ * iterator hash after instances were added or removed.
+ */
+static void
+multi_bcast_members_update(struct multi_context *m)
+{
+    struct hash_iterator hi;
+    struct hash_element *he;
+    const int n = hash_n_elements(m->iter);
+
+    if (n > m->bcast_members_capacity)
+    {
+        free(m->bcast_members);
+        m->bcast_members_capacity = max_int(n, 2 * m->bcast_members_capacity);
+        ALLOC_ARRAY(m->bcast_members, struct multi_instance *,
+                    m->bcast_members_capacity);
+    }
+
+    m->n_bcast_members = 0;
+    hash_iterator_init(m->iter, &hi);
+    while ((he = hash_iterator_next(&hi)))
+    {
+        struct multi_instance *mi = (struct multi_instance *) he->value;
+        if (!mi->halt)
+        {
+            m->bcast_members[m->n_bcast_members++] = mi;
+        }
+    }
+    hash_iterator_free(&hi);
+    m->bcast_members_dirty = false;
+}
+
 /*
  * Broadcast a packet to all clients.
+ *
+ * All recipients share one reference counted copy of the
+ * packet, which is encrypted for each of them when the mbuf
+ * queue is drained.  Clients that would drop the packet anyway
+ * (not fully connected yet, other VLAN) are skipped here so they
+ * do not take up queue slots.
  */
 static void
 multi_bcast(struct multi_context *m,
@@ -2924,8 +3226,6 @@ multi_bcast(struct multi_context *m,
             const struct mroute_addr *sender_addr,
             uint16_t vid)
 {
-    struct hash_iterator hi;
-    struct hash_element *he;
     struct multi_instance *mi;
     struct mbuf_buffer *mb;
 
@@ -2935,23 +3235,32 @@ multi_bcast(struct multi_context *m,
 #ifdef MULTI_DEBUG_EVENT_LOOP
         printf("BCAST len=%d\n", BLEN(buf));
 #endif
+        if (m->bcast_members_dirty)
+        {
+            multi_bcast_members_update(m);
+        }
+
         mb = mbuf_alloc_buf(buf);
-        hash_iterator_init(m->iter, &hi);
 
-        while ((he = hash_iterator_next(&hi)))
+        for (int i = 0; i < m->n_bcast_members; ++i)
         {
-            mi = (struct multi_instance *) he->value;
-            if (mi != sender_instance && !mi->halt)
+            mi = m->bcast_members[i];
+            if (mi == sender_instance || mi->halt)
             {
-                if (vid != 0 && vid != mi->context.options.vlan_pvid)
-                {
-                    continue;
-                }
-                multi_add_mbuf(m, mi, mb);
+                continue;
+            }
+            if (vid != 0 && vid != mi->context.options.vlan_pvid)
+            {
+                continue;
             }
+            /* encrypt_sign() would drop the packet anyway */
+            if (mi->context.c2.tls_multi->multi_state < CAS_CONNECT_DONE)
+            {
+                continue;
+            }
+            multi_add_mbuf(m, mi, mb);
         }
 
-        hash_iterator_free(&hi);
         mbuf_free_buf(mb);
         perf_pop();
     }
@@ -3030,6 +3339,27 @@ add_inotify_file_watch(struct multi_context *m, struct multi_instance *mi,
 }
 #endif /* if defined(ENABLE_ASYNC_PUSH) */
 
+void
+multi_shape_outgoing_link_dowork(struct multi_context *m, struct multi_instance *mi)
+{
+    struct buffer *buf = &mi->context.c2.to_link;
+    const int op = *BPTR(buf) >> P_OPCODE_SHIFT;
+
+    if ((op != P_DATA_V1 && op != P_DATA_V2) || BLEN(buf) > m->shaper.payload_size)
+    {
+        return;
+    }
+    if (!mshaper_admit(&m->shaper, &mi->shaper, BLEN(buf)))
+    {
+        if (!mshaper_enqueue(&m->shaper, &mi->shaper, buf))
+        {
+            dmsg(D_MULTI_DROPPED, "MULTI: shaper queue full, dropped packet len=%d",
+                 BLEN(buf));
+        }
+        buf->len = 0;
+    }
+}
+
 /*
  * Figure instance-specific timers, convert
  * earliest to absolute time in mi->wakeup,
@@ -3042,6 +3372,8 @@ multi_process_post(struct multi_context *m, struct multi_instance *mi, const uns
 {
     bool ret = true;
 
+    multi_shape_outgoing_link(m, mi);
+
     if (!IS_SIG(&mi->context) && ((flags & MPP_PRE_SELECT) || ((flags & MPP_CONDITIONAL_PRE_SELECT) && !ANY_OUT(&mi->context))))
     {
 #if defined(ENABLE_ASYNC_PUSH)
@@ -3058,6 +3390,17 @@ multi_process_post(struct multi_context *m, struct multi_instance *mi, const uns
          * to_link packets (such as ping or TLS control) */
         pre_select(&mi->context);
 
+        /* handshake paused until its signature is done? */
+        if (xkey_async_event_fd() >= 0 && !mi->sign_wait
+            && mi->context.c2.tls_multi
+            && tls_multi_async_pending(mi->context.c2.tls_multi))
+        {
+            multi_instance_inc_refcount(mi);
+            mi->sign_wait = true;
+            mi->sign_wait_next = m->sign_wait;
+            m->sign_wait = mi;
+        }
+
 #if defined(ENABLE_ASYNC_PUSH)
         /*
          * if we see the state transition from unauthenticated to deferred
@@ -3810,6 +4153,14 @@ multi_process_per_second_timers_dowork(struct multi_context *m)
     {
         check_stale_routes(m);
     }
+
+#ifdef ENABLE_MANAGEMENT
+    /* possibly stream client counter deltas to the management interface */
+    if (management)
+    {
+        management_check_client_stats(management);
+    }
+#endif
 }
 
 void
@@ -3817,6 +4168,12 @@ multi_top_init(struct multi_context *m, struct context *top)
 {
     inherit_context_top(&m->top, top);
     m->top.c2.buffers = init_context_buffers(&top->c2.frame);
+
+    /* new clients inherit the push list of the snapshot */
+    if (m->snapshot)
+    {
+        m->top.options.push_list = m->snapshot->opt.push_list;
+    }
 }
 
 void
@@ -4018,6 +4375,132 @@ management_kill_by_cid(void *arg, const unsigned long cid, const char *kill_msg)
     }
 }
 
+static bool
+management_shaper_by_cid(void *arg, const unsigned long cid,
+                         const unsigned int rate, const unsigned int burst)
+{
+    struct multi_context *m = (struct multi_context *) arg;
+    struct multi_instance *mi = lookup_by_cid(m, cid);
+
+    if (!mi || !m->shaper.enabled
+        || (rate && (rate < SHAPER_MIN || rate > SHAPER_MAX))
+        || burst > SHAPER_MAX)
+    {
+        return false;
+    }
+
+    mshaper_class_set(&mi->shaper, rate, burst);
+    return true;
+}
+
+static bool
+management_snapshot_reload(void *arg)
+{
+    struct multi_context *m = (struct multi_context *) arg;
+
+    if (!m->snapshot)
+    {
+        return false;
+    }
+
+    struct config_snapshot *s = config_snapshot_new(m->top.options.client_config_dir,
+                                                    m->top.options.config_snapshot_push_file,
+                                                    &m->snapshot_push_base);
+    if (!s)
+    {
+        return false;
+    }
+
+    /* connected clients keep a reference to the old snapshot */
+    config_snapshot_release(m->snapshot);
+    m->snapshot = s;
+    m->top.options.push_list = s->opt.push_list;
+    return true;
+}
+
+/* append str as a JSON string */
+static void
+buf_json_string(struct buffer *buf, const char *str)
+{
+    buf_printf(buf, "\"");
+    for (const unsigned char *c = (const unsigned char *)str; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            buf_printf(buf, "\\%c", *c);
+        }
+        else if (*c < 0x20 || *c == 0x7f)
+        {
+            buf_printf(buf, "\\u%04x", *c);
+        }
+        else
+        {
+            buf_write_u8(buf, *c);
+        }
+    }
+    buf_printf(buf, "\"");
+}
+
+static int
+management_client_stats(void *arg, struct buffer *out, int index,
+                        const bool delta, int *n_clients)
+{
+    struct multi_context *m = (struct multi_context *) arg;
+
+    if (index == 0 && dco_enabled(&m->top.options))
+    {
+        dco_get_peer_stats_multi(&m->top.c1.tuntap->dco, m);
+    }
+
+    for (; index < m->max_clients; ++index)
+    {
+        struct multi_instance *mi = m->instances[index];
+
+        if (buf_forward_capacity(out) < MAN_CLIENT_STATS_RECORD)
+        {
+            return index;
+        }
+        if (!mi || mi->halt)
+        {
+            continue;
+        }
+
+        struct man_def_auth_context *mdac = &mi->context.c2.mda_context;
+        const counter_type bytes_in = mi->context.c2.link_read_bytes
+                                      + mi->context.c2.dco_read_bytes;
+        const counter_type bytes_out = mi->context.c2.link_write_bytes
+                                       + mi->context.c2.dco_write_bytes;
+
+        if (delta && bytes_in == mdac->stats_bytes_in
+            && bytes_out == mdac->stats_bytes_out)
+        {
+            continue;
+        }
+
+        struct gc_arena gc = gc_new();
+        buf_printf(out, ">CLIENT-STATS:{\"cid\":%lu,\"peer_id\":%d,\"common_name\":",
+                   mdac->cid, index);
+        buf_json_string(out, tls_common_name(mi->context.c2.tls_multi, false));
+        buf_printf(out, ",\"real_address\":\"%s\",\"virtual_address\":\"%s\","
+                   "\"virtual_ipv6_address\":\"%s\",\"connected_since\":%u,"
+                   "\"bytes_in\":" counter_format ",\"bytes_out\":" counter_format ","
+                   "\"delta_in\":" counter_format ",\"delta_out\":" counter_format "}\r\n",
+                   mroute_addr_print(&mi->real, &gc),
+                   print_in_addr_t(mi->reporting_addr, IA_EMPTY_IF_UNDEF, &gc),
+                   print_in6_addr(mi->reporting_addr_ipv6, IA_EMPTY_IF_UNDEF, &gc),
+                   (unsigned int)mi->created,
+                   bytes_in, bytes_out,
+                   bytes_in - mdac->stats_bytes_in,
+                   bytes_out - mdac->stats_bytes_out);
+        gc_free(&gc);
+
+        mdac->stats_bytes_in = bytes_in;
+        mdac->stats_bytes_out = bytes_out;
+        ++*n_clients;
+    }
+    return -1;
+}
+
 static bool
 management_client_pending_auth(void *arg,
                                const unsigned long cid,
@@ -4132,6 +4615,9 @@ init_management_callback_multi(struct multi_context *m)
         cb.delete_event = management_delete_event;
         cb.n_clients = management_callback_n_clients;
         cb.kill_by_cid = management_kill_by_cid;
+        cb.shaper_by_cid = management_shaper_by_cid;
+        cb.client_stats = management_client_stats;
+        cb.snapshot_reload = management_snapshot_reload;
         cb.client_auth = management_client_auth;
         cb.client_pending_auth = management_client_pending_auth;
         cb.get_peer_info = management_get_peer_info;
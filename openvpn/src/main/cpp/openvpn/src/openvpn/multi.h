@@ -32,6 +32,8 @@
 #include "forward.h"
 #include "mroute.h"
 #include "mbuf.h"
+#include "mshaper.h"
+#include "snapshot.h"
 #include "list.h"
 #include "schedule.h"
 #include "pool.h"
@@ -139,6 +141,14 @@ struct multi_instance {
 #ifdef ENABLE_ASYNC_PUSH
     int inotify_watch; /* watch descriptor for acf */
 #endif
+    bool sign_wait;             /**< on multi_context.sign_wait */
+    struct multi_instance *sign_wait_next;
+
+    struct mshaper_class shaper; /**< --shaper-client rate and the
+                                  *   packets held back by it */
+
+    struct config_snapshot *snapshot; /**< --config-snapshot this instance
+                                       *   inherited its push list from */
 };
 
 
@@ -167,11 +177,23 @@ struct multi_context {
     struct mbuf_set *mbuf;      /**< Set of buffers for passing data
                                  *   channel packets between VPN tunnel
                                  *   instances. */
+    struct multi_instance **bcast_members; /**< Flat copy of the live
+                                            *   instances in \c iter, walked
+                                            *   by multi_bcast() instead of
+                                            *   the hash table. */
+    int n_bcast_members;
+    int bcast_members_capacity;
+    bool bcast_members_dirty;   /**< Instances were added or removed,
+                                 *   rebuild \c bcast_members before
+                                 *   the next broadcast. */
     struct multi_tcp *mtcp;     /**< State specific to OpenVPN using TCP
                                  *   as external transport. */
     struct ifconfig_pool *ifconfig_pool;
     struct frequency_limit *new_connection_limiter;
     struct initial_packet_rate_limit *initial_rate_limiter;
+    struct prefix_rate_limit *prefix_rate_limiter; /**< NULL unless
+                                                    *   --connect-freq-prefix
+                                                    *   is set */
     struct mroute_helper *route_helper;
     struct multi_reap *reaper;
     struct mroute_addr local;
@@ -198,6 +220,33 @@ struct multi_context {
     struct buffer hmac_reply;
     struct link_socket_actual *hmac_reply_dest;
 
+    /** Packets from sources without a client instance, counted before
+     *  any per-client state is created.  UDP only, shown as GLOBAL_STATS
+     *  in the status output. */
+    struct {
+        counter_type hmac_resets;   /**< HMAC cookie challenges sent */
+        counter_type drop_prefix;   /**< over --connect-freq-prefix */
+        counter_type drop_initial;  /**< over --connect-freq-initial */
+        counter_type drop_invalid;  /**< bad opcode, HMAC or cookie */
+    } initial_stats;
+
+    /** Instances that did not complete authentication yet, limited by
+     *  --max-pending-handshakes */
+    struct handshake_budget handshakes;
+
+    /** Instances whose handshake waits for a signature, each
+     *  holding a reference, see multi_process_sign_done() */
+    struct multi_instance *sign_wait;
+
+    /** --shaper-total bucket and the queues of the shaped clients,
+     *  UDP only */
+    struct mshaper shaper;
+
+    /** Current --config-snapshot, and the push list of the configuration
+     *  that every new snapshot starts from */
+    struct config_snapshot *snapshot;
+    struct push_list snapshot_push_base;
+
     /*
      * Timer object for stale route check
      */
@@ -399,6 +448,34 @@ void multi_process_file_closed(struct multi_context *m, const unsigned int mpp_f
 
 #endif
 
+/**
+ * Called when xkey_async_event_fd() is readable, i.e. a --tls-sign-workers
+ * thread or the management client has provided a signature.  Schedules
+ * the instances whose handshake waited for one, so that they continue
+ * right away.
+ *
+ * @param m multi_context
+ */
+void multi_process_sign_done(struct multi_context *m);
+
+/*
+ * Return true if another client instance may start its handshake
+ * without exceeding --max-pending-handshakes, count the attempt
+ * as dropped otherwise.
+ */
+static inline bool
+multi_handshake_admit(struct multi_context *m)
+{
+    struct handshake_budget *hb = &m->handshakes;
+    if (hb->max_pending && hb->pending >= hb->max_pending)
+    {
+        hb->dropped++;
+        hb->last_dropped = now;
+        return false;
+    }
+    return true;
+}
+
 /*
  * Return true if our output queue is not full
  */
@@ -628,6 +705,16 @@ multi_get_timeout(struct multi_context *m, struct timeval *dest)
         dest->tv_sec = REAP_MAX_WAKEUP;
         dest->tv_usec = 0;
     }
+
+    /* wake up when a packet held back by the shaper may be sent */
+    if (mshaper_backlog(&m->shaper))
+    {
+        const int delay = mshaper_delay(&m->shaper);
+        if (delay && shaper_soonest_event(dest, delay))
+        {
+            m->earliest_wakeup = NULL;
+        }
+    }
 }
 
 
@@ -683,6 +770,22 @@ multi_process_outgoing_link_dowork(struct multi_context *m, struct multi_instanc
     return ret;
 }
 
+void multi_shape_outgoing_link_dowork(struct multi_context *m, struct multi_instance *mi);
+
+/*
+ * Hold back a data channel packet for a client while the client or the
+ * whole server are over their --shaper-client or --shaper-total rate.
+ * Control channel packets are never delayed.
+ */
+static inline void
+multi_shape_outgoing_link(struct multi_context *m, struct multi_instance *mi)
+{
+    if (LINK_OUT(&mi->context) && mshaper_limited(&m->shaper, &mi->shaper))
+    {
+        multi_shape_outgoing_link_dowork(m, mi);
+    }
+}
+
 /*
  * Check for signals.
  */
@@ -69,6 +69,7 @@ struct key_schedule
      * renegotiation key */
     struct key2 original_wrap_keydata;
     struct key_ctx tls_crypt_v2_server_key;
+    struct tls_crypt_v2_cache *tls_crypt_v2_cache; /**< Shared with children */
     struct buffer tls_crypt_v2_wkc;             /**< Wrapped client key */
     struct key_ctx auth_token_key;
 };
@@ -426,6 +427,15 @@ struct context_2
     /* don't wait for TUN/TAP/UDP to be ready to accept write */
     bool fast_io;
 
+    /* max packets moved per direction for each io_wait() wakeup */
+    int io_batch;
+
+#if ENABLE_IO_URING
+    /* io_wait() calls in a row that were answered from io_uring
+     * without looking at the event set */
+    int uring_skip;
+#endif
+
     /* --ifconfig endpoints to be pushed to client */
     bool push_request_received;
     bool push_ifconfig_defined;
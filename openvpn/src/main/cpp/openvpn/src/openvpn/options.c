@@ -59,6 +59,7 @@
 #include "ssl_verify.h"
 #include "platform.h"
 #include "xkey_common.h"
+#include "xkey_async.h"
 #include "dco.h"
 #include <ctype.h>
 
@@ -183,6 +184,10 @@ static const char usage_message[] =
     "                  /dev/net/tun, /dev/tun, /dev/tap, etc.\n"
 #if defined(ENABLE_DCO)
     "--disable-dco   : Do not attempt using Data Channel Offload.\n"
+#endif
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+    "--dco-userspace [n] : Run Data Channel Offload in n worker threads instead of\n"
+    "                  the ovpn-dco kernel module (default: one per CPU).\n"
 #endif
     "--lladdr hw     : Set the link layer address of the tap device.\n"
     "--topology t    : Set --dev tun topology: 'net30', 'p2p', or 'subnet'.\n"
@@ -269,6 +274,11 @@ static const char usage_message[] =
     "--multihome     : Configure a multi-homed UDP server.\n"
 #endif
     "--fast-io       : Optimize TUN/TAP/UDP writes.\n"
+    "--io-batch n    : With --fast-io, move up to n packets per direction for\n"
+    "                  each event loop wakeup (default=1).\n"
+#if ENABLE_IO_URING
+    "--disable-io-uring : Do not use io_uring for TUN/TAP and UDP packet I/O.\n"
+#endif
     "--remap-usr1 s  : On SIGUSR1 signals, remap signal (s='SIGHUP' or 'SIGTERM').\n"
     "--persist-tun   : Keep tun/tap device open across SIGUSR1 or --ping-restart.\n"
     "--persist-remote-ip : Keep remote IP address across SIGUSR1 or --ping-restart.\n"
@@ -468,6 +478,9 @@ static const char usage_message[] =
     "--client-disconnect cmd : Run command cmd on client disconnection.\n"
     "--client-config-dir dir : Directory for custom client config files.\n"
     "--ccd-exclusive : Refuse connection unless custom client config is found.\n"
+    "--config-snapshot [file] : Keep the --client-config-dir files and the push\n"
+    "                  options, changed by the push lines of file, in memory\n"
+    "                  until the snapshot-reload management command.\n"
     "--tmp-dir dir   : Temporary directory, used for --client-connect return file and plugin communication.\n"
     "--hash-size r v : Set the size of the real address hash table to r and the\n"
     "                  virtual address table to v.\n"
@@ -478,8 +491,20 @@ static const char usage_message[] =
     "--learn-address cmd : Run command cmd to validate client virtual addresses.\n"
     "--connect-freq n s : Allow a maximum of n new connections per s seconds.\n"
     "--connect-freq-initial n s : Allow a maximum of n replies for initial connections attempts per s seconds.\n"
+    "--connect-freq-prefix n s : Accept a maximum of n packets from unknown sources\n"
+    "                  per s seconds and source /24 (IPv4) or /64 (IPv6) prefix.\n"
     "--max-clients n : Allow a maximum of n simultaneously connected clients.\n"
+    "--max-pending-handshakes n [s] : Allow a maximum of n clients in the handshake\n"
+    "                  and authentication phase.  Ask new clients without a\n"
+    "                  valid auth-token to retry after s seconds (default=30)\n"
+    "                  while the limit is reached.\n"
+    "--tls-sign-workers n : Compute the private key signatures of TLS handshakes\n"
+    "                  in n worker threads.\n"
     "--max-routes-per-client n : Allow a maximum of n internal routes per client.\n"
+    "--shaper-total n [b] : Restrict the data sent to all clients together to\n"
+    "                  n bytes per second, with bursts of up to b bytes.\n"
+    "--shaper-client n [b] : Restrict the data sent to each client to n bytes\n"
+    "                  per second, with bursts of up to b bytes.\n"
     "--stale-routes-check n [t] : Remove routes with a last activity timestamp\n"
     "                             older than n seconds. Run this check every t\n"
     "                             seconds (defaults to n).\n"
@@ -848,7 +873,9 @@ init_options(struct options *o, const bool init_gc)
     o->virtual_hash_size = 256;
     o->n_bcast_buf = 256;
     o->tcp_queue_limit = 64;
+    o->io_batch = 1;
     o->max_clients = 1024;
+    o->handshake_backoff = HANDSHAKE_BACKOFF_DEFAULT;
     o->cf_initial_per = 10;
     o->cf_initial_max = 100;
     o->max_routes_per_client = 256;
@@ -1550,6 +1577,8 @@ show_p2mp_parms(const struct options *o)
     SHOW_STR(client_crresponse_script);
     SHOW_STR(client_config_dir);
     SHOW_BOOL(ccd_exclusive);
+    SHOW_BOOL(config_snapshot);
+    SHOW_STR(config_snapshot_push_file);
     SHOW_STR(tmp_dir);
     SHOW_BOOL(push_ifconfig_defined);
     msg(D_SHOW_PARMS, "  push_ifconfig_local = %s", print_in_addr_t(o->push_ifconfig_local, 0, &gc));
@@ -1563,8 +1592,17 @@ show_p2mp_parms(const struct options *o)
     SHOW_INT(cf_per);
     SHOW_INT(cf_initial_max);
     SHOW_INT(cf_initial_per);
+    SHOW_INT(cf_prefix_max);
+    SHOW_INT(cf_prefix_per);
     SHOW_INT(max_clients);
+    SHOW_INT(max_pending_handshakes);
+    SHOW_INT(handshake_backoff);
+    SHOW_INT(tls_sign_workers);
     SHOW_INT(max_routes_per_client);
+    SHOW_INT(shaper_total);
+    SHOW_INT(shaper_total_burst);
+    SHOW_INT(shaper_client);
+    SHOW_INT(shaper_client_burst);
     SHOW_STR(auth_user_pass_verify_script);
     SHOW_BOOL(auth_user_pass_verify_script_via_file);
     SHOW_BOOL(auth_token_generate);
@@ -1828,6 +1866,10 @@ show_settings(const struct options *o)
     SHOW_STR(dev_node);
 #if defined(ENABLE_DCO)
     SHOW_BOOL(tuntap_options.disable_dco);
+#endif
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+    SHOW_BOOL(tuntap_options.dco_userspace);
+    SHOW_INT(tuntap_options.dco_user_threads);
 #endif
     SHOW_STR(lladdr);
     SHOW_INT(topology);
@@ -1901,6 +1943,8 @@ show_settings(const struct options *o)
     SHOW_INT(sockflags);
 
     SHOW_BOOL(fast_io);
+    SHOW_INT(io_batch);
+    SHOW_BOOL(disable_io_uring);
 
     SHOW_INT(comp.alg);
     SHOW_INT(comp.flags);
@@ -2586,6 +2630,10 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--mode server requires --tls-server");
         }
+        if (options->tls_sign_workers && !options->priv_key_file)
+        {
+            msg(M_USAGE, "--tls-sign-workers requires a private key file (--key)");
+        }
         if (ce->remote)
         {
             msg(M_USAGE, "--remote cannot be used with --mode server");
@@ -2615,6 +2663,11 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--shaper cannot be used with --mode server");
         }
+        if ((options->shaper_total || options->shaper_client)
+            && !proto_is_udp(ce->proto))
+        {
+            msg(M_USAGE, "--shaper-total and --shaper-client require --proto udp");
+        }
         if (options->ipchange)
         {
             msg(M_USAGE,
@@ -2629,6 +2682,10 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--connect-freq only works with --mode server --proto udp.  Try --max-clients instead.");
         }
+        if (!proto_is_udp(ce->proto) && options->cf_prefix_max)
+        {
+            msg(M_USAGE, "--connect-freq-prefix only works with --mode server --proto udp.");
+        }
         if (!(dev == DEV_TYPE_TAP || (dev == DEV_TYPE_TUN && options->topology == TOP_SUBNET)) && options->ifconfig_pool_netmask)
         {
             msg(M_USAGE, "The third parameter to --ifconfig-pool (netmask) is only valid in --dev tap mode");
@@ -2668,6 +2725,12 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--ccd-exclusive must be used with --client-config-dir");
         }
+#ifdef _WIN32
+        if (options->config_snapshot && options->client_config_dir)
+        {
+            msg(M_USAGE, "--config-snapshot cannot be used with --client-config-dir on Windows");
+        }
+#endif
         if (options->auth_token_generate && !options->renegotiate_seconds)
         {
             msg(M_USAGE, "--auth-gen-token needs a non-infinite "
@@ -2755,6 +2818,10 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--client-config-dir/--ccd-exclusive requires --mode server");
         }
+        if (options->config_snapshot)
+        {
+            msg(M_USAGE, "--config-snapshot requires --mode server");
+        }
         if (options->enable_c2c)
         {
             msg(M_USAGE, "--client-to-client requires --mode server");
@@ -2767,6 +2834,26 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--connect-freq requires --mode server");
         }
+        if (options->cf_prefix_max)
+        {
+            msg(M_USAGE, "--connect-freq-prefix requires --mode server");
+        }
+        if (options->max_pending_handshakes)
+        {
+            msg(M_USAGE, "--max-pending-handshakes requires --mode server");
+        }
+        if (options->tls_sign_workers)
+        {
+            msg(M_USAGE, "--tls-sign-workers requires --mode server");
+        }
+        if (options->shaper_total)
+        {
+            msg(M_USAGE, "--shaper-total requires --mode server");
+        }
+        if (options->shaper_client)
+        {
+            msg(M_USAGE, "--shaper-client requires --mode server");
+        }
         if (options->ssl_flags & (SSLF_CLIENT_CERT_NOT_REQUIRED|SSLF_CLIENT_CERT_OPTIONAL))
         {
             msg(M_USAGE, "--verify-client-cert requires --mode server");
@@ -4160,6 +4247,9 @@ options_postprocess_filechecks(struct options *options)
     /* ** Config related ** */
     errs |= check_file_access_chroot(options->chroot_dir, CHKACC_FILE, options->client_config_dir,
                                      R_OK|X_OK, "--client-config-dir");
+    errs |= check_file_access_chroot(options->chroot_dir, CHKACC_FILE,
+                                     options->config_snapshot_push_file,
+                                     R_OK, "--config-snapshot");
     errs |= check_file_access_chroot(options->chroot_dir, CHKACC_FILE, options->tmp_dir,
                                      R_OK|W_OK|X_OK, "Temporary directory (--tmp-dir)");
 
@@ -5711,6 +5801,32 @@ show_compression_warning(struct compress_options *info)
     }
 }
 
+/*
+ * Parse the "n [b]" arguments of --shaper-total and --shaper-client.
+ */
+static bool
+parse_shaper_rate(char *p[], int msglevel, int *rate, int *burst)
+{
+    const int n = atoi(p[1]);
+    const int b = p[2] ? atoi(p[2]) : 0;
+
+    if (n < SHAPER_MIN || n > SHAPER_MAX)
+    {
+        msg(msglevel, "Bad --%s value, must be between %d and %d",
+            p[0], SHAPER_MIN, SHAPER_MAX);
+        return false;
+    }
+    if (p[2] && (b < 1 || b > SHAPER_MAX))
+    {
+        msg(msglevel, "Bad --%s burst, must be between 1 and %d",
+            p[0], SHAPER_MAX);
+        return false;
+    }
+    *rate = n;
+    *burst = b;
+    return true;
+}
+
 bool
 key_is_external(const struct options *options)
 {
@@ -5943,6 +6059,10 @@ add_option(struct options *options,
             {
                 options->management_flags |= MF_EXTERNAL_KEY_DIGEST;
             }
+            else if (streq(p[j], "async"))
+            {
+                options->management_flags |= MF_EXTERNAL_KEY_ASYNC;
+            }
             else
             {
                 msg(msglevel, "Unknown management-external-key flag: %s", p[j]);
@@ -6037,6 +6157,24 @@ add_option(struct options *options,
     {
         options->tuntap_options.disable_dco = true;
     }
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+    else if (streq(p[0], "dco-userspace") && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->tuntap_options.dco_userspace = true;
+        if (p[1])
+        {
+            int threads = positive_atoi(p[1]);
+            if (threads < 1 || threads > DCO_USER_THREADS_MAX)
+            {
+                msg(msglevel, "--dco-userspace: number of threads must be "
+                    "between 1 and %d", DCO_USER_THREADS_MAX);
+                goto err;
+            }
+            options->tuntap_options.dco_user_threads = threads;
+        }
+    }
+#endif
     else if (streq(p[0], "dev-node") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -6735,6 +6873,25 @@ add_option(struct options *options,
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->fast_io = true;
     }
+    else if (streq(p[0], "io-batch") && p[1] && !p[2])
+    {
+        int io_batch;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        io_batch = atoi(p[1]);
+        if (io_batch < 1 || io_batch > IO_BATCH_MAX)
+        {
+            msg(msglevel, "--io-batch parameter must be between 1 and %d",
+                IO_BATCH_MAX);
+            goto err;
+        }
+        options->io_batch = io_batch;
+    }
+    else if (streq(p[0], "disable-io-uring") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->disable_io_uring = true;
+    }
     else if (streq(p[0], "inactive") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
@@ -7544,6 +7701,24 @@ add_option(struct options *options,
         options->cf_initial_max = cf_max;
         options->cf_initial_per = cf_per;
     }
+    else if (streq(p[0], "connect-freq-prefix") && p[1] && p[2] && !p[3])
+    {
+        long cf_max, cf_per;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        char *e1, *e2;
+        cf_max = strtol(p[1], &e1, 10);
+        cf_per = strtol(p[2], &e2, 10);
+        if (cf_max < 0 || cf_per < 1 || cf_max > INT_MAX || cf_per > INT_MAX
+            || *e1 != '\0' || *e2 != '\0')
+        {
+            msg(msglevel, "--connect-freq-prefix parameters must be integers, "
+                "n >= 0 and s >= 1");
+            goto err;
+        }
+        options->cf_prefix_max = cf_max;
+        options->cf_prefix_per = cf_per;
+    }
     else if (streq(p[0], "max-clients") && p[1] && !p[2])
     {
         int max_clients;
@@ -7562,6 +7737,59 @@ add_option(struct options *options,
         }
         options->max_clients = max_clients;
     }
+    else if (streq(p[0], "max-pending-handshakes") && p[1] && !p[3])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        int max_pending = atoi(p[1]);
+        int backoff = p[2] ? atoi(p[2]) : HANDSHAKE_BACKOFF_DEFAULT;
+        if (max_pending < 1)
+        {
+            msg(msglevel, "--max-pending-handshakes must be at least 1");
+            goto err;
+        }
+        if (backoff < 1)
+        {
+            msg(msglevel, "--max-pending-handshakes backoff must be at least 1 second");
+            goto err;
+        }
+        options->max_pending_handshakes = max_pending;
+        options->handshake_backoff = backoff;
+    }
+    else if (streq(p[0], "tls-sign-workers") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef ENABLE_XKEY_ASYNC
+        int workers = atoi(p[1]);
+        if (workers < 1 || workers > XKEY_ASYNC_THREADS_MAX)
+        {
+            msg(msglevel, "--tls-sign-workers must be between 1 and %d",
+                XKEY_ASYNC_THREADS_MAX);
+            goto err;
+        }
+        options->tls_sign_workers = workers;
+#else
+        msg(msglevel, "--tls-sign-workers requires OpenSSL 3.0 on Linux");
+        goto err;
+#endif
+    }
+    else if (streq(p[0], "shaper-total") && p[1] && !p[3])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        if (!parse_shaper_rate(p, msglevel, &options->shaper_total,
+                               &options->shaper_total_burst))
+        {
+            goto err;
+        }
+    }
+    else if (streq(p[0], "shaper-client") && p[1] && !p[3])
+    {
+        VERIFY_PERMISSION(OPT_P_INHERIT);
+        if (!parse_shaper_rate(p, msglevel, &options->shaper_client,
+                               &options->shaper_client_burst))
+        {
+            goto err;
+        }
+    }
     else if (streq(p[0], "max-routes-per-client") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_INHERIT);
@@ -7731,6 +7959,12 @@ add_option(struct options *options,
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ccd_exclusive = true;
     }
+    else if (streq(p[0], "config-snapshot") && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->config_snapshot = true;
+        options->config_snapshot_push_file = p[1];
+    }
     else if (streq(p[0], "bcast-buffers") && p[1] && !p[2])
     {
         int n_bcast_buf;
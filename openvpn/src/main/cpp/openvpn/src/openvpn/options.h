@@ -51,6 +51,11 @@
  */
 #define MAX_PARMS 16
 
+/*
+ * Default for the retry hint of --max-pending-handshakes, in seconds.
+ */
+#define HANDSHAKE_BACKOFF_DEFAULT 30
+
 /*
  * Max size of options line and parameter.
  */
@@ -392,6 +397,13 @@ struct options
     /* optimize TUN/TAP/UDP writes */
     bool fast_io;
 
+    /* max packets moved per event loop wakeup with --fast-io */
+#define IO_BATCH_MAX 64
+    int io_batch;
+
+    /* do TUN/TAP and UDP packet I/O with plain syscalls, not io_uring */
+    bool disable_io_uring;
+
     struct compress_options comp;
 
     /* buffer sizes */
@@ -488,6 +500,8 @@ struct options
     const char *client_crresponse_script;
     const char *client_config_dir;
     bool ccd_exclusive;
+    bool config_snapshot;
+    const char *config_snapshot_push_file;
     bool disable;
     int n_bcast_buf;
     int tcp_queue_limit;
@@ -515,8 +529,18 @@ struct options
     int cf_initial_max;
     int cf_initial_per;
 
+    int cf_prefix_max;
+    int cf_prefix_per;
+
     int max_clients;
+    int max_pending_handshakes;
+    int handshake_backoff;
+    int tls_sign_workers;
     int max_routes_per_client;
+    int shaper_total;
+    int shaper_total_burst;
+    int shaper_client;
+    int shaper_client_burst;
     int stale_routes_check_interval;
     int stale_routes_ageing_time;
 
@@ -783,9 +783,15 @@ send_push_reply(struct context *c, struct push_list *per_client_push_list)
 
     buf_printf(&buf, "%s", push_reply_cmd);
 
-    /* send options which are common to all clients */
-    if (!send_push_options(c, &buf, &c->options.push_list, safe_cap,
-                           &push_sent, &multi_push))
+    /* send options which are common to all clients, in one go if the
+     * serialized list fits into the first message */
+    const struct push_list *push_list = &c->options.push_list;
+    if (push_list->cached && BLEN(&buf) + push_list->cached_len < safe_cap)
+    {
+        buf_printf(&buf, "%s", push_list->cached);
+    }
+    else if (!send_push_options(c, &buf, &c->options.push_list, safe_cap,
+                                &push_sent, &multi_push))
     {
         goto fail;
     }
@@ -836,10 +842,48 @@ fail:
     return false;
 }
 
+/*
+ * Give push_list its own copy of the entries if it still shares them
+ * with the options it was detached from, and drop the cached
+ * serialization, as the caller is about to modify the list.
+ */
+static void
+push_list_unshare(struct gc_arena *gc, struct push_list *push_list)
+{
+    push_list->cached = NULL;
+    push_list->cached_len = 0;
+
+    if (push_list->shared)
+    {
+        const struct push_entry *e = push_list->head;
+
+        CLEAR(*push_list);
+        while (e)
+        {
+            struct push_entry *copy;
+            ALLOC_OBJ_CLEAR_GC(copy, struct push_entry, gc);
+            copy->enable = e->enable;
+            copy->option = string_alloc(e->option, gc);
+            if (push_list->tail)
+            {
+                push_list->tail->next = copy;
+            }
+            else
+            {
+                push_list->head = copy;
+            }
+            push_list->tail = copy;
+            e = e->next;
+        }
+    }
+}
+
 static void
 push_option_ex(struct gc_arena *gc, struct push_list *push_list,
                const char *opt, bool enable, int msglevel)
 {
+    push_list_unshare(gc, push_list);
+
     if (!string_class(opt, CC_ANY, CC_COMMA))
     {
         msg(msglevel, "PUSH OPTION FAILED (illegal comma (',') in string): '%s'", opt);
@@ -874,17 +918,40 @@ push_option(struct options *o, const char *opt, int msglevel)
 void
 clone_push_list(struct options *o)
 {
+    /* the entries are copied on the first modification only, so clients
+     * without ccd push changes keep using the parent's list and its
+     * cached serialization */
     if (o->push_list.head)
     {
-        const struct push_entry *e = o->push_list.head;
-        push_reset(o);
-        while (e)
+        o->push_list.shared = true;
+    }
+}
+
+void
+cache_push_list(struct options *o)
+{
+    const struct push_entry *e;
+    int len = 0;
+
+    for (e = o->push_list.head; e; e = e->next)
+    {
+        if (e->enable)
         {
-            push_option_ex(&o->gc, &o->push_list,
-                           string_alloc(e->option, &o->gc), true, M_FATAL);
-            e = e->next;
+            len += strlen(e->option) + 1;
         }
     }
+
+    struct buffer buf = alloc_buf_gc(len + 1, &o->gc);
+    for (e = o->push_list.head; e; e = e->next)
+    {
+        if (e->enable)
+        {
+            buf_printf(&buf, ",%s", e->option);
+        }
+    }
+
+    o->push_list.cached = BSTR(&buf);
+    o->push_list.cached_len = BLEN(&buf);
 }
 
 void
@@ -940,6 +1007,7 @@ push_remove_option(struct options *o, const char *p)
 
     if (o && o->push_list.head)
     {
+        push_list_unshare(&o->gc, &o->push_list);
         struct push_entry *e = o->push_list.head;
 
         /* cycle through the push list */
@@ -1115,6 +1183,7 @@ remove_iroutes_from_push_route_list(struct options *o)
 {
     if (o && o->push_list.head && (o->iroutes || o->iroutes_ipv6))
     {
+        push_list_unshare(&o->gc, &o->push_list);
         struct gc_arena gc = gc_new();
         struct push_entry *e = o->push_list.head;
 
@@ -59,6 +59,14 @@ void incoming_push_message(struct context *c, const struct buffer *buffer);
 
 void clone_push_list(struct options *o);
 
+/**
+ * Serialize the enabled entries of the push list once, so that
+ * send_push_reply() does not have to walk the list again for every
+ * client that inherits it unmodified.  Any later change to the list
+ * drops the cached string.
+ */
+void cache_push_list(struct options *o);
+
 void push_option(struct options *o, const char *opt, int msglevel);
 
 void push_options(struct options *o, char **p, int msglevel,
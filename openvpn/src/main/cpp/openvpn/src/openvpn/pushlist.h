@@ -35,6 +35,16 @@ struct push_entry {
 struct push_list {
     struct push_entry *head;
     struct push_entry *tail;
+
+    /* entries are still owned by the options this list was detached
+     * from and must be copied before they are modified, see
+     * clone_push_list() */
+    bool shared;
+
+    /* the enabled entries serialized as ",opt1,opt2,...", or NULL if
+     * the list changed since cache_push_list() */
+    const char *cached;
+    int cached_len;
 };
 
 #endif /* if !defined(PUSHLIST_H) */
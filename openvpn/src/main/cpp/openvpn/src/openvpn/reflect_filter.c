@@ -36,6 +36,8 @@
 #include <memory.h>
 
 #include "crypto.h"
+#include "integer.h"
+#include "socket.h"
 #include "reflect_filter.h"
 
 
@@ -103,3 +105,131 @@ initial_rate_limit_free(struct initial_packet_rate_limit *irl)
 {
     free(irl);
 }
+
+/* 64 bit finalizer of MurmurHash3, good enough to spread prefixes over
+ * the buckets, the random key keeps the mapping unpredictable */
+static inline uint64_t
+prefix_hash_mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* returns 0 for address families that are not rate limited */
+static uint64_t
+prefix_hash(const struct prefix_rate_limit *prl,
+            const struct openvpn_sockaddr *from)
+{
+    uint64_t prefix;
+    uint64_t family;
+
+    if (from->addr.sa.sa_family == AF_INET)
+    {
+        prefix = ntohl(from->addr.in4.sin_addr.s_addr) >> (32 - PREFIX_RATE_LIMIT_BITS_IPV4);
+        family = AF_INET;
+    }
+    else if (from->addr.sa.sa_family == AF_INET6
+             && IN6_IS_ADDR_V4MAPPED(&from->addr.in6.sin6_addr))
+    {
+        /* count IPv4 clients on a dual stack socket like native ones */
+        uint32_t a;
+        memcpy(&a, &from->addr.in6.sin6_addr.s6_addr[12], sizeof(a));
+        prefix = ntohl(a) >> (32 - PREFIX_RATE_LIMIT_BITS_IPV4);
+        family = AF_INET;
+    }
+    else if (from->addr.sa.sa_family == AF_INET6)
+    {
+        memcpy(&prefix, from->addr.in6.sin6_addr.s6_addr, sizeof(prefix));
+        prefix = ntohll(prefix) >> (64 - PREFIX_RATE_LIMIT_BITS_IPV6);
+        family = AF_INET6;
+    }
+    else
+    {
+        return 0;
+    }
+
+    uint64_t h = prefix_hash_mix(prefix ^ prl->hash_key[0]);
+    h = prefix_hash_mix(h ^ family ^ prl->hash_key[1]);
+
+    /* 0 marks an unused bucket */
+    return h | 1;
+}
+
+bool
+prefix_rate_limit_check(struct prefix_rate_limit *prl,
+                        const struct openvpn_sockaddr *from)
+{
+    if (now > prl->last_report + prl->period_length)
+    {
+        if (prl->dropped_since_report > 0)
+        {
+            msg(D_TLS_DEBUG_LOW, "Dropped %" PRId64 " packets from unknown "
+                "sources due to --connect-freq-prefix %" PRId64 " %d",
+                prl->dropped_since_report, prl->max_per_period,
+                prl->period_length);
+            prl->dropped_since_report = 0;
+        }
+        prl->last_report = now;
+    }
+
+    const uint64_t tag = prefix_hash(prl, from);
+    if (!tag)
+    {
+        return true;
+    }
+
+    struct prefix_rate_limit_bucket *b =
+        &prl->buckets[tag & (PREFIX_RATE_LIMIT_BUCKETS - 1)];
+    const int64_t capacity = prl->max_per_period * prl->period_length;
+
+    if (b->tag != tag)
+    {
+        /* new prefix or hash collision, start with a full bucket */
+        b->tag = tag;
+        b->tokens = capacity;
+        b->last_refill = now;
+    }
+    else if (now > b->last_refill)
+    {
+        /* max_per_period packets per period are max_per_period tokens
+         * per second, since one packet costs period_length tokens */
+        b->tokens += (int64_t)(now - b->last_refill) * prl->max_per_period;
+        if (b->tokens > capacity)
+        {
+            b->tokens = capacity;
+        }
+        b->last_refill = now;
+    }
+
+    if (b->tokens < prl->period_length)
+    {
+        prl->dropped_since_report++;
+        return false;
+    }
+    b->tokens -= prl->period_length;
+    return true;
+}
+
+struct prefix_rate_limit *
+prefix_rate_limit_init(int max_per_period, int period_length)
+{
+    struct prefix_rate_limit *prl;
+
+    ALLOC_OBJ_CLEAR(prl, struct prefix_rate_limit);
+
+    prl->max_per_period = max_per_period;
+    prl->period_length = period_length;
+    prng_bytes((uint8_t *)prl->hash_key, sizeof(prl->hash_key));
+
+    return prl;
+}
+
+void
+prefix_rate_limit_free(struct prefix_rate_limit *prl)
+{
+    free(prl);
+}
@@ -25,6 +25,8 @@
 
 #include <limits.h>
 
+struct openvpn_sockaddr;
+
 /** struct that handles all the rate limiting logic for initial
  * responses */
 struct initial_packet_rate_limit {
@@ -72,4 +74,68 @@ initial_rate_limit_init(int max_per_period, int period_length);
  * free the initial-packet rate limiter structure
  */
 void initial_rate_limit_free(struct initial_packet_rate_limit *irl);
+
+/** Number of token buckets of the per source prefix limiter, must be a
+ * power of 2 */
+#define PREFIX_RATE_LIMIT_BUCKETS 4096
+
+/** Source prefix lengths that share one token bucket */
+#define PREFIX_RATE_LIMIT_BITS_IPV4 24
+#define PREFIX_RATE_LIMIT_BITS_IPV6 64
+
+struct prefix_rate_limit_bucket {
+    /** keyed hash of the source prefix, 0 if the bucket is unused */
+    uint64_t tag;
+
+    /** available tokens, one packet costs period_length tokens */
+    int64_t tokens;
+
+    /** last time tokens were added to this bucket */
+    time_t last_refill;
+};
+
+/** struct that limits packets from unknown sources per source prefix,
+ * so a flood from one network cannot use up the budget of
+ * --connect-freq-initial for everybody else. The table has a fixed size
+ * and is never resized, a bucket is taken over by another prefix when
+ * their hashes collide. */
+struct prefix_rate_limit {
+    /** maximum number of packets per prefix and period (burst size) */
+    int64_t max_per_period;
+
+    /** period length in seconds */
+    int period_length;
+
+    /** random key for the prefix hash so that an attacker cannot
+     * predict which prefixes share a bucket */
+    uint64_t hash_key[2];
+
+    /** packets dropped since the last log message */
+    int64_t dropped_since_report;
+
+    /** last time a summary of dropped packets was logged */
+    time_t last_report;
+
+    struct prefix_rate_limit_bucket buckets[PREFIX_RATE_LIMIT_BUCKETS];
+};
+
+/**
+ * checks if a packet from an unknown source is allowed under the rate
+ * limit of its source prefix and takes a token from the bucket if it is.
+ * Drops are logged as a summary once per period.
+ */
+bool
+prefix_rate_limit_check(struct prefix_rate_limit *prl,
+                        const struct openvpn_sockaddr *from);
+
+/**
+ * allocate and initialize the per source prefix rate limiter structure
+ */
+struct prefix_rate_limit *
+prefix_rate_limit_init(int max_per_period, int period_length);
+
+/**
+ * free the per source prefix rate limiter structure
+ */
+void prefix_rate_limit_free(struct prefix_rate_limit *prl);
 #endif /* ifndef REFLECT_FILTER_H */
@@ -0,0 +1,242 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syshead.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#include "crypto.h"
+#include "platform.h"
+#include "push.h"
+#include "snapshot.h"
+
+#include "memdbg.h"
+
+static uint32_t
+snapshot_hash_function(const void *key, uint32_t iv)
+{
+    const char *k = (const char *) key;
+    return hash_func((const uint8_t *) k, (uint32_t) strlen(k), iv);
+}
+
+static bool
+snapshot_compare_function(const void *key1, const void *key2)
+{
+    return streq((const char *) key1, (const char *) key2);
+}
+
+/* read a file into the arena of the snapshot, "" if it is empty */
+static const char *
+snapshot_read_file(struct config_snapshot *s, const char *path)
+{
+    platform_stat_t st;
+
+    if (platform_stat(path, &st) < 0)
+    {
+        return NULL;
+    }
+    if (st.st_size == 0)
+    {
+        return "";
+    }
+
+    struct buffer buf = buffer_read_from_file(path, &s->opt.gc);
+    return buf_valid(&buf) ? BSTR(&buf) : NULL;
+}
+
+static bool
+snapshot_read_ccd(struct config_snapshot *s, const char *dir)
+{
+#ifdef _WIN32
+    msg(M_WARN, "--config-snapshot cannot read --client-config-dir on Windows");
+    return false;
+#else
+    struct gc_arena gc = gc_new();
+    bool ret = true;
+    DIR *d = opendir(dir);
+    const struct dirent *de;
+
+    if (!d)
+    {
+        msg(M_WARN | M_ERRNO, "Cannot read --client-config-dir %s", dir);
+        gc_free(&gc);
+        return false;
+    }
+
+    while ((de = readdir(d)))
+    {
+        /* NULL for names that no common name maps to, like . and .. */
+        const char *path = platform_gen_path(dir, de->d_name, &gc);
+        platform_stat_t st;
+
+        if (!path || platform_stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+        {
+            continue;
+        }
+
+        const char *contents = snapshot_read_file(s, path);
+        if (!contents)
+        {
+            msg(M_WARN | M_ERRNO, "Cannot read client config file %s", path);
+            ret = false;
+            break;
+        }
+        hash_add(s->ccd, string_alloc(de->d_name, &s->opt.gc),
+                 (void *) contents, true);
+        ++s->n_ccd;
+    }
+
+    closedir(d);
+    gc_free(&gc);
+    return ret;
+#endif /* ifdef _WIN32 */
+}
+
+static bool
+snapshot_read_push_file(struct config_snapshot *s, const char *file)
+{
+    char line[OPTION_LINE_SIZE];
+    struct buffer multiline;
+    int line_num = 0;
+    bool ret = true;
+
+    const char *contents = snapshot_read_file(s, file);
+    if (!contents)
+    {
+        msg(M_WARN | M_ERRNO, "Cannot read --config-snapshot push file %s", file);
+        return false;
+    }
+
+    buf_set_read(&multiline, (const uint8_t *) contents, strlen(contents));
+    while (ret && buf_parse(&multiline, '\n', line, sizeof(line)))
+    {
+        char *p[MAX_PARMS+1];
+        CLEAR(p);
+        ++line_num;
+        if (parse_line(line, p, SIZE(p)-1, file, line_num, M_WARN, &s->opt.gc))
+        {
+            if (streq(p[0], "push") && p[1] && !p[2])
+            {
+                push_options(&s->opt, &p[1], M_WARN, &s->opt.gc);
+            }
+            else if (streq(p[0], "push-remove") && p[1] && !p[2])
+            {
+                push_remove_option(&s->opt, p[1]);
+            }
+            else if (streq(p[0], "push-reset") && !p[1])
+            {
+                push_reset(&s->opt);
+            }
+            else
+            {
+                msg(M_WARN, "%s:%d: only push, push-remove and push-reset are allowed",
+                    file, line_num);
+                ret = false;
+            }
+        }
+    }
+    secure_memzero(line, sizeof(line));
+    return ret;
+}
+
+struct config_snapshot *
+config_snapshot_new(const char *ccd_dir, const char *push_file,
+                    const struct push_list *base)
+{
+    struct config_snapshot *s;
+
+    ALLOC_OBJ_CLEAR(s, struct config_snapshot);
+    s->refcount = 1;
+    s->opt.gc = gc_new();
+    s->ccd = hash_init(256, get_random(),
+                       snapshot_hash_function, snapshot_compare_function);
+
+    for (const struct push_entry *e = base->head; e; e = e->next)
+    {
+        if (e->enable)
+        {
+            push_option(&s->opt, e->option, M_WARN);
+        }
+    }
+
+    if ((ccd_dir && !snapshot_read_ccd(s, ccd_dir))
+        || (push_file && !snapshot_read_push_file(s, push_file)))
+    {
+        config_snapshot_release(s);
+        return NULL;
+    }
+
+    cache_push_list(&s->opt);
+    msg(M_INFO, "Config snapshot: %d client config files, %d bytes of push options",
+        s->n_ccd, s->opt.push_list.cached_len);
+    return s;
+}
+
+struct config_snapshot *
+config_snapshot_acquire(struct config_snapshot *s)
+{
+    if (s)
+    {
+        ++s->refcount;
+    }
+    return s;
+}
+
+void
+config_snapshot_release(struct config_snapshot *s)
+{
+    if (s && --s->refcount == 0)
+    {
+        hash_free(s->ccd);
+        gc_free(&s->opt.gc);
+        free(s);
+    }
+}
+
+const char *
+config_snapshot_ccd(const struct config_snapshot *s, const char *common_name,
+                    const bool use_default)
+{
+    struct gc_arena gc = gc_new();
+    const char *ret = NULL;
+
+    /* the same name platform_gen_path() would open */
+    const char *name = common_name ? platform_gen_path(NULL, common_name, &gc) : NULL;
+    if (name)
+    {
+        ret = (const char *) hash_lookup(s->ccd, name);
+    }
+    if (!ret && use_default)
+    {
+        ret = (const char *) hash_lookup(s->ccd, CCD_DEFAULT);
+    }
+
+    gc_free(&gc);
+    return ret;
+}
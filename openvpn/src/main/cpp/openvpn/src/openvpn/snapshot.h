@@ -0,0 +1,78 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+ * In-memory copy of the --client-config-dir files and of the global
+ * push list of a server (--config-snapshot).
+ *
+ * Connecting clients take their ccd options from the snapshot instead
+ * of reading the files.  The 'snapshot-reload' management command
+ * builds a new snapshot and swaps it in at once; clients keep a
+ * reference to the snapshot they were created with, as their push
+ * list shares its entries.
+ */
+
+#include "list.h"
+#include "options.h"
+
+struct config_snapshot
+{
+    int refcount;
+    struct hash *ccd;           /**< common name -> ccd file contents */
+    int n_ccd;
+    struct options opt;         /**< only gc and push_list are used */
+};
+
+/**
+ * Read a new snapshot.
+ *
+ * @param ccd_dir       --client-config-dir, or NULL
+ * @param push_file     file with push, push-remove and push-reset
+ *                      lines that are applied to base, or NULL
+ * @param base          the push list of the configuration
+ *
+ * @return              the snapshot with a reference count of one, or
+ *                      NULL if a file could not be read
+ */
+struct config_snapshot *config_snapshot_new(const char *ccd_dir,
+                                            const char *push_file,
+                                            const struct push_list *base);
+
+struct config_snapshot *config_snapshot_acquire(struct config_snapshot *s);
+
+void config_snapshot_release(struct config_snapshot *s);
+
+/**
+ * Return the contents of the ccd file of a common name, or NULL if
+ * there is none.
+ *
+ * @param use_default   fall back to the DEFAULT file
+ */
+const char *config_snapshot_ccd(const struct config_snapshot *s,
+                                const char *common_name,
+                                const bool use_default);
+
+#endif /* SNAPSHOT_H */
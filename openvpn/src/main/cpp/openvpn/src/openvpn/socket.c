@@ -1827,6 +1827,7 @@ link_socket_new(void)
     ALLOC_OBJ_CLEAR(sock, struct link_socket);
     sock->sd = SOCKET_UNDEFINED;
     sock->ctrl_sd = SOCKET_UNDEFINED;
+    sock->dco_ctrl_sd = SOCKET_UNDEFINED;
     return sock;
 }
 
@@ -2304,6 +2305,11 @@ link_socket_close(struct link_socket *sock)
         const int gremlin = 0;
 #endif
 
+#if ENABLE_IO_URING
+        uring_close(sock->uring);
+        sock->uring = NULL;
+#endif
+
         if (socket_defined(sock->sd))
         {
 #ifdef _WIN32
@@ -3364,6 +3370,40 @@ link_socket_read_udp_posix_recvmsg(struct link_socket *sock,
 }
 #endif /* if ENABLE_IP_PKTINFO */
 
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+/*
+ * With --dco-userspace the offload engine owns the UDP socket and hands
+ * us the packets it does not process itself, each one prefixed with the
+ * link_socket_actual it was received from.
+ */
+static int
+link_socket_read_dco_ctrl(struct link_socket *sock,
+                          struct buffer *buf,
+                          struct link_socket_actual *from)
+{
+    struct iovec iov[2];
+    struct msghdr mesg = {0};
+
+    iov[0].iov_base = from;
+    iov[0].iov_len = sizeof(*from);
+    iov[1].iov_base = BPTR(buf);
+    iov[1].iov_len = buf_forward_capacity_total(buf);
+    mesg.msg_iov = iov;
+    mesg.msg_iovlen = 2;
+
+    const ssize_t len = recvmsg(sock->dco_ctrl_sd, &mesg, 0);
+    if (len < 0)
+    {
+        buf->len = -1;
+    }
+    else
+    {
+        buf->len = max_int((int)(len - sizeof(*from)), 0);
+    }
+    return buf->len;
+}
+#endif /* if defined(ENABLE_DCO) && defined(TARGET_LINUX) */
+
 int
 link_socket_read_udp_posix(struct link_socket *sock,
                            struct buffer *buf,
@@ -3375,6 +3415,21 @@ link_socket_read_udp_posix(struct link_socket *sock,
 
     ASSERT(sock->sd >= 0);                      /* can't happen */
 
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+    if (socket_defined(sock->dco_ctrl_sd))
+    {
+        return link_socket_read_dco_ctrl(sock, buf, from);
+    }
+#endif
+
+#if ENABLE_IO_URING
+    if (sock->uring)
+    {
+        buf->len = uring_recv(sock->uring, BPTR(buf), buf_forward_capacity(buf),
+                              &from->dest.addr.sa, &fromlen);
+    }
+    else
+#endif
 #if ENABLE_IP_PKTINFO
     /* Both PROTO_UDPv4 and PROTO_UDPv6 */
     if (sock->info.proto == PROTO_UDP && sock->sockflags & SF_USE_IP_PKTINFO)
@@ -3870,6 +3925,22 @@ sockethandle_finalize(sockethandle_t sh,
 
 #endif /* _WIN32 */
 
+#if ENABLE_IO_URING
+bool
+link_socket_uring_open(struct link_socket *sock, int buf_size)
+{
+    /* --multihome needs the packet info of recvmsg() and sendmsg() */
+    if (sock->uring || !socket_defined(sock->sd) || !proto_is_udp(sock->info.proto)
+        || (sock->sockflags & SF_USE_IP_PKTINFO))
+    {
+        return true;
+    }
+
+    sock->uring = uring_open(sock->sd, true, buf_size, "TCP/UDP socket");
+    return sock->uring != NULL;
+}
+#endif
+
 /*
  * Socket event notification
  */
@@ -3896,9 +3967,29 @@ socket_set(struct link_socket *s,
         }
 #endif
 
+#if defined(ENABLE_DCO) && defined(TARGET_LINUX)
+        /* --dco-userspace reads the socket, we read what it hands back */
+        if (socket_defined(s->dco_ctrl_sd))
+        {
+            event_ctl(es, s->dco_ctrl_sd, rwflags & EVENT_READ, arg);
+            event_ctl(es, socket_event_handle(s), rwflags & EVENT_WRITE, arg);
+            if (persistent)
+            {
+                *persistent = rwflags;
+            }
+        }
+        else
+#endif
         /* if persistent is defined, call event_ctl only if rwflags has changed since last call */
         if (!persistent || *persistent != rwflags)
         {
+#if ENABLE_IO_URING
+            if (s->uring)
+            {
+                uring_set(s->uring, es, rwflags, arg);
+            }
+            else
+#endif
             event_ctl(es, socket_event_handle(s), rwflags, arg);
             if (persistent)
             {
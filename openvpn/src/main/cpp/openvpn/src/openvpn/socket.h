@@ -35,6 +35,7 @@
 #include "socks.h"
 #include "misc.h"
 #include "tun.h"
+#include "uring.h"
 
 /*
  * OpenVPN's default port number as assigned by IANA.
@@ -168,6 +169,7 @@ struct link_socket
 
     socket_descriptor_t sd;
     socket_descriptor_t ctrl_sd; /* only used for UDP over Socks */
+    socket_descriptor_t dco_ctrl_sd; /* packets handed back by --dco-userspace */
 
 #ifdef _WIN32
     struct overlapped_io reads;
@@ -176,9 +178,17 @@ struct link_socket
     struct rw_handle listen_handle; /* For listening on TCP socket in server mode */
 #endif
 
+#if ENABLE_IO_URING
+    struct uring *uring;        /* UDP packet I/O through io_uring */
+#endif
+
     /* used for printing status info only */
     unsigned int rwflags_debug;
 
+    /* the last write did not take the whole packet, because the socket
+     * buffer was full (EAGAIN) or the write was short */
+    bool write_blocked;
+
     /* used for long-term queueing of pre-accepted socket listen */
     bool listen_persistent_queued;
 
@@ -1145,6 +1155,13 @@ link_socket_write_udp_posix(struct link_socket *sock,
                             struct buffer *buf,
                             struct link_socket_actual *to)
 {
+#if ENABLE_IO_URING
+    if (sock->uring)
+    {
+        return uring_send(sock->uring, BPTR(buf), BLEN(buf), &to->dest.addr.sa,
+                          (socklen_t) af_addr_size(to->dest.addr.sa.sa_family));
+    }
+#endif
 #if ENABLE_IP_PKTINFO
     if (proto_is_udp(sock->info.proto) && (sock->sockflags & SF_USE_IP_PKTINFO)
         && addr_defined_ipi(to))
@@ -1255,6 +1272,17 @@ socket_event_handle(const struct link_socket *s)
 
 event_t socket_listen_event_handle(struct link_socket *s);
 
+#if ENABLE_IO_URING
+/**
+ * Move a UDP socket to io_uring, see uring.h.  Does nothing for
+ * sockets that cannot use it.
+ *
+ * @return false if setting up the ring failed
+ */
+bool link_socket_uring_open(struct link_socket *sock, int buf_size);
+
+#endif
+
 unsigned int
 socket_set(struct link_socket *s,
            struct event_set *es,
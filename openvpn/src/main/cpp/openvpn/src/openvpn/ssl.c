@@ -510,7 +510,7 @@ init_ssl(const struct options *options, struct tls_root_ctx *new_ctx, bool in_ch
 
     tls_clear_error();
 
-    if (key_is_external(options))
+    if (key_is_external(options) || options->tls_sign_workers)
     {
         load_xkey_provider();
     }
@@ -608,6 +608,12 @@ init_ssl(const struct options *options, struct tls_root_ctx *new_ctx, bool in_ch
     }
 #endif
 
+    if (options->tls_sign_workers
+        && !tls_ctx_set_sign_workers(new_ctx, options->tls_sign_workers))
+    {
+        goto err;
+    }
+
     if (options->ca_file || options->ca_path)
     {
         tls_ctx_load_ca(new_ctx, options->ca_file, options->ca_file_inline,
@@ -3336,6 +3342,22 @@ nohard:
     return (tas == TLS_AUTHENTICATION_FAILED) ? TLSMP_KILL : active;
 }
 
+bool
+tls_multi_async_pending(const struct tls_multi *multi)
+{
+    for (int i = 0; i < TM_SIZE; ++i)
+    {
+        for (int j = 0; j < KS_SIZE; ++j)
+        {
+            if (key_state_ssl_async_pending(&multi->session[i].key[j].ks_ssl))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 /**
  * We have not found a matching key to decrypt data channel packet,
  * try to generate a sensible error message and print it
@@ -239,6 +239,14 @@ int tls_multi_process(struct tls_multi *multi,
                       struct link_socket_info *to_link_socket_info,
                       interval_t *wakeup);
 
+/**
+ * Return true if a handshake of \c multi waits for a private key
+ * signature from the --tls-sign-workers threads or from the management
+ * client (--management-external-key async).  tls_multi_process()
+ * needs to be called again when xkey_async_event_fd() is readable.
+ */
+bool tls_multi_async_pending(const struct tls_multi *multi);
+
 
 /**************************************************************************/
 /**
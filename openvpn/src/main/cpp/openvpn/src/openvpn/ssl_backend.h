@@ -287,6 +287,20 @@ void tls_ctx_load_cert_file(struct tls_root_ctx *ctx, const char *cert_file,
 int tls_ctx_load_priv_file(struct tls_root_ctx *ctx, const char *priv_key_file,
                            bool priv_key_file_inline);
 
+/**
+ * Compute the private key signatures of the TLS handshakes in worker
+ * threads, so that the main loop can continue in the meantime
+ * (--tls-sign-workers).  Must be called after the private key has been
+ * loaded with tls_ctx_load_priv_file().
+ *
+ * @param ctx                   TLS context to use
+ * @param workers               Number of worker threads
+ *
+ * @return                      true on success, false if the TLS library
+ *                              does not support it.
+ */
+bool tls_ctx_set_sign_workers(struct tls_root_ctx *ctx, int workers);
+
 #ifdef ENABLE_MANAGEMENT
 
 /**
@@ -376,6 +390,17 @@ key_state_ssl_shutdown(struct key_state_ssl *ks_ssl);
  */
 void key_state_ssl_free(struct key_state_ssl *ks_ssl);
 
+/**
+ * Return true if the handshake of the SSL channel is paused until a
+ * worker thread has computed the private key signature, see
+ * tls_ctx_set_sign_workers(), or until the management client has sent
+ * it (--management-external-key async).  The key state has to be
+ * processed again when xkey_async_event_fd() becomes readable.
+ *
+ * @param ks_ssl        The SSL channel's state info
+ */
+bool key_state_ssl_async_pending(const struct key_state_ssl *ks_ssl);
+
 /**
  * Reload the Certificate Revocation List for the SSL channel
  *
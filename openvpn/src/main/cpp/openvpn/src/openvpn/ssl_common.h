@@ -273,6 +273,8 @@ struct tls_wrap_ctx
     struct crypto_options opt;  /**< Crypto state */
     struct buffer work;         /**< Work buffer (only for --tls-crypt) */
     struct key_ctx tls_crypt_v2_server_key;  /**< Decrypts client keys */
+    struct tls_crypt_v2_cache *tls_crypt_v2_cache; /**< Client keys
+                                                    *   recently unwrapped */
     const struct buffer *tls_crypt_v2_wkc;   /**< Wrapped client key,
                                               *   sent to server */
     struct buffer tls_crypt_v2_metadata;     /**< Received from client */
@@ -289,6 +291,36 @@ struct tls_wrap_ctx
     struct key2 original_wrap_keydata;
 };
 
+/*
+ * Clients without auth-token are only postponed while connection
+ * attempts were dropped within this many seconds, i.e. while other
+ * clients are still waiting to start their handshake.
+ */
+#define HANDSHAKE_BUSY_WINDOW 10
+
+/**
+ * Handshake admission state of a server, shared by all its client
+ * instances, see --max-pending-handshakes.
+ */
+struct handshake_budget
+{
+    int max_pending;            /**< 0 if the number is not limited */
+    int backoff;                /**< seconds sent in the TEMP[backoff] hint */
+    int pending;                /**< instances that are not authenticated yet */
+    time_t last_dropped;        /**< time an attempt was dropped last */
+
+    counter_type dropped;       /**< attempts dropped before an instance
+                                 *   was created */
+    counter_type busy;          /**< clients without auth-token asked to
+                                 *   come back later */
+    counter_type token;         /**< clients authenticated by auth-token
+                                 *   while the budget was used up */
+    counter_type completed;     /**< instances that completed authentication */
+    counter_type failed;        /**< instances closed before that */
+    counter_type seconds;       /**< sum of the time from instance creation
+                                 *   to completed authentication */
+};
+
 /*
  * Our const options, obtained directly or derived from
  * command line options.
@@ -390,9 +422,17 @@ struct tls_options
 
     struct key_ctx auth_token_key;
 
+    /** Admission state of the server, NULL unless this is a client
+     *  instance of a server with --max-pending-handshakes */
+    struct handshake_budget *handshake_budget;
+
     /* use the client-config-dir as a positive authenticator */
     const char *client_config_dir_exclusive;
 
+    /** The --config-snapshot this client instance was created with,
+     *  looked up instead of client_config_dir_exclusive */
+    const struct config_snapshot *config_snapshot;
+
     /* instance-wide environment variable set */
     struct env_set *es;
     openvpn_net_ctx_t *net_ctx;
@@ -610,6 +650,9 @@ struct tls_multi
     int n_sessions;             /**< Number of sessions negotiated thus
                                  *   far. */
     enum multi_status multi_state;
+    bool handshake_pending;     /**< Counted in \c opt.handshake_budget,
+                                 *   until authentication completes or
+                                 *   fails. */
 
     /*
      * Number of errors.
@@ -610,6 +610,13 @@ tls_ctx_load_priv_file(struct tls_root_ctx *ctx, const char *priv_key_file,
     return 0;
 }
 
+bool
+tls_ctx_set_sign_workers(struct tls_root_ctx *ctx, int workers)
+{
+    msg(M_WARN, "--tls-sign-workers is not supported with mbed TLS");
+    return false;
+}
+
 /**
  * external_pkcs1_sign implements a mbed TLS rsa_sign_func callback, that uses
  * the management interface to request an RSA signature for the supplied hash.
@@ -814,6 +821,11 @@ cleanup:
 int
 tls_ctx_use_management_external_key(struct tls_root_ctx *ctx)
 {
+    if (management->settings.flags & MF_EXTERNAL_KEY_ASYNC)
+    {
+        msg(M_WARN, "WARNING: management-external-key async is not "
+            "supported with mbed TLS, signatures are requested synchronously");
+    }
     return tls_ctx_use_external_signing_func(ctx, management_sign_func, NULL);
 }
 
@@ -1292,6 +1304,12 @@ key_state_ssl_free(struct key_state_ssl *ks_ssl)
     }
 }
 
+bool
+key_state_ssl_async_pending(const struct key_state_ssl *ks_ssl)
+{
+    return false;
+}
+
 int
 key_state_write_plaintext(struct key_state_ssl *ks, struct buffer *buf)
 {
@@ -44,6 +44,7 @@
 #include "base64.h"
 #include "openssl_compat.h"
 #include "xkey_common.h"
+#include "xkey_async.h"
 
 #ifdef ENABLE_CRYPTOAPI
 #include "cryptoapi.h"
@@ -91,6 +92,7 @@ tls_init_lib(void)
 void
 tls_free_lib(void)
 {
+    xkey_async_uninit();
 }
 
 void
@@ -1064,6 +1066,38 @@ end:
     return ret;
 }
 
+bool
+tls_ctx_set_sign_workers(struct tls_root_ctx *ctx, int workers)
+{
+#ifdef ENABLE_XKEY_ASYNC
+    ASSERT(NULL != ctx);
+
+    EVP_PKEY *privkey = SSL_CTX_get0_privatekey(ctx->ctx);
+    X509 *cert = SSL_CTX_get0_certificate(ctx->ctx);
+    ASSERT(privkey && cert);
+
+    if (!xkey_async_init(workers))
+    {
+        return false;
+    }
+
+    EVP_PKEY *pkey = xkey_async_load_key(tls_libctx, privkey, X509_get0_pubkey(cert));
+    if (!SSL_CTX_use_PrivateKey(ctx->ctx, pkey))
+    {
+        crypto_msg(M_WARN, "Cannot use private key for --tls-sign-workers");
+        EVP_PKEY_free(pkey);
+        return false;
+    }
+    EVP_PKEY_free(pkey);
+
+    SSL_CTX_set_mode(ctx->ctx, SSL_MODE_ASYNC);
+    return true;
+#else  /* ifdef ENABLE_XKEY_ASYNC */
+    msg(M_WARN, "--tls-sign-workers requires OpenSSL 3.0 on Linux");
+    return false;
+#endif /* ifdef ENABLE_XKEY_ASYNC */
+}
+
 void
 backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
                            bool crl_inline)
@@ -1476,7 +1510,31 @@ tls_ctx_use_management_external_key(struct tls_root_ctx *ctx)
         goto cleanup;
     }
     EVP_PKEY_free(privkey);
+
+    if (management->settings.flags & MF_EXTERNAL_KEY_ASYNC)
+    {
+#ifdef ENABLE_XKEY_ASYNC
+        /* the handshake runs in an ASYNC_JOB that xkey_management_sign()
+         * pauses until the signature has arrived */
+        if (xkey_async_event_init())
+        {
+            SSL_CTX_set_mode(ctx->ctx, SSL_MODE_ASYNC);
+        }
+        else
+#endif
+        {
+            msg(M_WARN, "WARNING: management-external-key async is not "
+                "supported on this platform, signatures are requested "
+                "synchronously");
+        }
+    }
 #else  /* ifdef HAVE_XKEY_PROVIDER */
+    if (management->settings.flags & MF_EXTERNAL_KEY_ASYNC)
+    {
+        msg(M_WARN, "WARNING: management-external-key async requires "
+            "OpenSSL 3.0, signatures are requested synchronously");
+    }
+
 #if OPENSSL_VERSION_NUMBER < 0x30000000L
     if (EVP_PKEY_id(pkey) == EVP_PKEY_RSA)
 #else /* OPENSSL_VERSION_NUMBER < 0x30000000L */
@@ -1786,6 +1844,22 @@ bio_debug_oc(const char *mode, BIO *bio)
 
 #endif /* ifdef BIO_DEBUG */
 
+/*
+ * BIO_f_ssl() does not set a retry flag when SSL_read() or SSL_write()
+ * returned SSL_ERROR_WANT_ASYNC, i.e. paused for --tls-sign-workers.
+ */
+static bool
+bio_async_paused(BIO *bio)
+{
+#ifdef ENABLE_XKEY_ASYNC
+    SSL *ssl = NULL;
+    return BIO_method_type(bio) == BIO_TYPE_SSL
+           && BIO_get_ssl(bio, &ssl) > 0 && SSL_waiting_for_async(ssl);
+#else
+    return false;
+#endif
+}
+
 /*
  * Write to an OpenSSL BIO in non-blocking mode.
  */
@@ -1810,7 +1884,7 @@ bio_write(BIO *bio, const uint8_t *data, int size, const char *desc)
 
         if (i < 0)
         {
-            if (!BIO_should_retry(bio))
+            if (!BIO_should_retry(bio) && !bio_async_paused(bio))
             {
                 crypto_msg(D_TLS_ERRORS, "TLS ERROR: BIO write %s error", desc);
                 ret = -1;
@@ -1878,7 +1952,7 @@ bio_read(BIO *bio, struct buffer *buf, const char *desc)
     int ret = 0;
     if (i < 0)
     {
-        if (!BIO_should_retry(bio))
+        if (!BIO_should_retry(bio) && !bio_async_paused(bio))
         {
             crypto_msg(D_TLS_ERRORS, "TLS_ERROR: BIO read %s error", desc);
             buf->len = 0;
@@ -1946,11 +2020,64 @@ key_state_ssl_shutdown(struct key_state_ssl *ks_ssl)
     SSL_set_shutdown(ks_ssl->ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
 }
 
+/*
+ * A call that returned SSL_ERROR_WANT_ASYNC resumes the paused ASYNC_JOB
+ * when it is repeated, and returns what the job returns.  So only the
+ * same call may be made until the job has finished.
+ */
+static bool
+key_state_async_busy(const struct key_state_ssl *ks_ssl, int op)
+{
+    return ks_ssl->async_op && ks_ssl->async_op != op;
+}
+
+static void
+key_state_async_update(struct key_state_ssl *ks_ssl, int op)
+{
+#ifdef ENABLE_XKEY_ASYNC
+    ks_ssl->async_op = SSL_waiting_for_async(ks_ssl->ssl) ? op : 0;
+#endif
+}
+
+bool
+key_state_ssl_async_pending(const struct key_state_ssl *ks_ssl)
+{
+    return ks_ssl->async_op != 0;
+}
+
 void
 key_state_ssl_free(struct key_state_ssl *ks_ssl)
 {
     if (ks_ssl->ssl)
     {
+#ifdef ENABLE_XKEY_ASYNC
+        /* The paused job holds the signature request on its stack: let
+         * the workers complete it and run the job to its end, so that
+         * the job is released.  A shutdown would keep the calls below
+         * from resuming it.  Requests to the management client fail
+         * instead of waiting for the answer. */
+        if (SSL_waiting_for_async(ks_ssl->ssl))
+        {
+            SSL_set_shutdown(ks_ssl->ssl, 0);
+        }
+        xkey_async_set_closing(true);
+        while (SSL_waiting_for_async(ks_ssl->ssl))
+        {
+            uint8_t dummy;
+            xkey_async_wait();
+            if (ks_ssl->async_op == KS_ASYNC_WRITE)
+            {
+                SSL_write(ks_ssl->ssl, &dummy, sizeof(dummy));
+            }
+            else
+            {
+                SSL_read(ks_ssl->ssl, &dummy, sizeof(dummy));
+            }
+        }
+        xkey_async_set_closing(false);
+        ks_ssl->async_op = 0;
+        ERR_clear_error();
+#endif
 #ifdef BIO_DEBUG
         bio_debug_oc("close ssl_bio", ks_ssl->ssl_bio);
         bio_debug_oc("close ct_in", ks_ssl->ct_in);
@@ -1969,9 +2096,13 @@ key_state_write_plaintext(struct key_state_ssl *ks_ssl, struct buffer *buf)
 
     ASSERT(NULL != ks_ssl);
 
-    ret = bio_write(ks_ssl->ssl_bio, BPTR(buf), BLEN(buf),
-                    "tls_write_plaintext");
-    bio_write_post(ret, buf);
+    if (!key_state_async_busy(ks_ssl, KS_ASYNC_WRITE))
+    {
+        ret = bio_write(ks_ssl->ssl_bio, BPTR(buf), BLEN(buf),
+                        "tls_write_plaintext");
+        bio_write_post(ret, buf);
+        key_state_async_update(ks_ssl, KS_ASYNC_WRITE);
+    }
 
     perf_pop();
     return ret;
@@ -1985,7 +2116,11 @@ key_state_write_plaintext_const(struct key_state_ssl *ks_ssl, const uint8_t *dat
 
     ASSERT(NULL != ks_ssl);
 
-    ret = bio_write(ks_ssl->ssl_bio, data, len, "tls_write_plaintext_const");
+    if (!key_state_async_busy(ks_ssl, KS_ASYNC_WRITE))
+    {
+        ret = bio_write(ks_ssl->ssl_bio, data, len, "tls_write_plaintext_const");
+        key_state_async_update(ks_ssl, KS_ASYNC_WRITE);
+    }
 
     perf_pop();
     return ret;
@@ -2028,7 +2163,11 @@ key_state_read_plaintext(struct key_state_ssl *ks_ssl, struct buffer *buf)
 
     ASSERT(NULL != ks_ssl);
 
-    ret = bio_read(ks_ssl->ssl_bio, buf, "tls_read_plaintext");
+    if (!key_state_async_busy(ks_ssl, KS_ASYNC_READ))
+    {
+        ret = bio_read(ks_ssl->ssl_bio, buf, "tls_read_plaintext");
+        key_state_async_update(ks_ssl, KS_ASYNC_READ);
+    }
 
     perf_pop();
     return ret;
@@ -47,8 +47,12 @@ struct key_state_ssl {
     BIO *ssl_bio;                       /* read/write plaintext from here */
     BIO *ct_in;                 /* write ciphertext to here */
     BIO *ct_out;                        /* read ciphertext from here */
+    int async_op;               /* KS_ASYNC_READ/WRITE: that call is paused for --tls-sign-workers */
 };
 
+#define KS_ASYNC_READ  1
+#define KS_ASYNC_WRITE 2
+
 /**
  * Allocate space in SSL objects in which to store a struct tls_session
  * pointer back to parent.
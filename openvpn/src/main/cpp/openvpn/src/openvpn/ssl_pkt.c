@@ -244,7 +244,18 @@ read_control_auth(struct buffer *buf,
     }
     else if (ctx->mode == TLS_WRAP_CRYPT)
     {
-        struct buffer tmp = alloc_buf_gc(buf_forward_capacity_total(buf), &gc);
+        /* this runs for every packet from an unauthenticated source, so
+         * unwrap on the stack unless the packet is unusually large */
+        uint8_t scratch[TLS_PRE_DECRYPT_SCRATCH_SIZE];
+        struct buffer tmp;
+        if (BLEN(buf) + TLS_CRYPT_BLOCK_SIZE <= (int)sizeof(scratch))
+        {
+            buf_set_write(&tmp, scratch, sizeof(scratch));
+        }
+        else
+        {
+            tmp = alloc_buf_gc(buf_forward_capacity_total(buf), &gc);
+        }
         if (!tls_crypt_unwrap(buf, &tmp, &ctx->opt))
         {
             msg(D_TLS_ERRORS, "TLS Error: tls-crypt unwrapping failed from %s",
@@ -284,7 +295,10 @@ cleanup:
 void
 free_tls_pre_decrypt_state(struct tls_pre_decrypt_state *state)
 {
-    free_buf(&state->newbuf);
+    if (state->newbuf.data != state->scratch.data)
+    {
+        free_buf(&state->newbuf);
+    }
     free_buf(&state->tls_wrap_tmp.tls_crypt_v2_metadata);
     if (state->tls_wrap_tmp.cleanup_key_ctx)
     {
@@ -366,7 +380,16 @@ tls_pre_decrypt_lite(const struct tls_auth_standalone *tas,
         goto error;
     }
 
-    state->newbuf = clone_buf(buf);
+    if (state->scratch.data && BLEN(buf) <= state->scratch.capacity)
+    {
+        state->newbuf = state->scratch;
+        ASSERT(buf_init(&state->newbuf, 0));
+        ASSERT(buf_copy(&state->newbuf, buf));
+    }
+    else
+    {
+        state->newbuf = clone_buf(buf);
+    }
     state->tls_wrap_tmp = tas->tls_wrap;
 
     /* HMAC test and unwrapping the encrypted part of the control message
@@ -97,6 +97,11 @@ enum first_packet_verdict {
     VERDICT_INVALID
 };
 
+/** Size of the stack buffers used to check initial packets and to unwrap
+ * tls-crypt packets without a heap allocation.  Larger packets use the
+ * heap. */
+#define TLS_PRE_DECRYPT_SCRATCH_SIZE 2048
+
 /**
  * struct that stores the temporary data for the tls lite decrypt
  * functions
@@ -104,6 +109,9 @@ enum first_packet_verdict {
 struct tls_pre_decrypt_state {
     struct tls_wrap_ctx tls_wrap_tmp;
     struct buffer newbuf;
+    /** optional caller provided storage for newbuf, used instead of a
+     * heap copy of the packet when it is large enough */
+    struct buffer scratch;
     struct session_id peer_session_id;
     struct session_id server_session_id;
 };
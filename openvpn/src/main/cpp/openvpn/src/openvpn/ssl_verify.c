@@ -45,6 +45,7 @@
 #endif
 #include "auth_token.h"
 #include "push.h"
+#include "snapshot.h"
 #include "ssl_util.h"
 
 /** Maximum length of common name */
@@ -1582,6 +1583,55 @@ set_verify_user_pass_env(struct user_pass *up, struct tls_multi *multi,
     }
 }
 
+/*
+ * With --max-pending-handshakes and --auth-gen-token, a new client that
+ * does not present a valid auth-token is told to come back later while
+ * the server has used up its handshake budget and turns away other
+ * clients.  This leaves the budget to reconnecting clients, which do not
+ * need the external auth methods.  Only clients that understand
+ * AUTH_FAILED,TEMP are turned away.
+ */
+static bool
+verify_user_pass_server_busy(struct tls_multi *multi,
+                             struct tls_session *session)
+{
+    struct handshake_budget *hb = session->opt->handshake_budget;
+    const struct key_state *ks = &session->key[KS_PRIMARY];
+
+    if (!hb || !hb->max_pending || hb->pending < hb->max_pending
+        || now - hb->last_dropped >= HANDSHAKE_BUSY_WINDOW
+        || !session->opt->auth_token_generate
+        || multi->multi_state >= CAS_CONNECT_DONE)
+    {
+        return false;
+    }
+
+    if ((ks->auth_token_state_flags & AUTH_TOKEN_HMAC_OK)
+        && !(ks->auth_token_state_flags & AUTH_TOKEN_EXPIRED))
+    {
+        hb->token++;
+        return false;
+    }
+
+    if (!(extract_iv_proto(multi->peer_info) & IV_PROTO_AUTH_FAIL_TEMP))
+    {
+        return false;
+    }
+
+    /* spread the returning clients over up to twice the backoff time */
+    char reason[64];
+    const int backoff = hb->backoff + (int)(get_random() % (hb->backoff + 1));
+    snprintf(reason, sizeof(reason), "TEMP[backoff %d]: server busy", backoff);
+    auth_set_client_reason(multi, reason);
+    hb->busy++;
+
+    /* the client is on its way out, free its slot right away */
+    multi->handshake_pending = false;
+    hb->pending--;
+    hb->failed++;
+    return true;
+}
+
 /**
  * Main username/password verification entry point
  *
@@ -1660,6 +1710,15 @@ verify_user_pass(struct user_pass *up, struct tls_multi *multi,
         }
     }
 
+    if (verify_user_pass_server_busy(multi, session))
+    {
+        ks->authenticated = KS_AUTH_FALSE;
+        msg(D_HANDSHAKE, "TLS: Username/Password authentication postponed "
+            "for username '%s', --max-pending-handshakes reached",
+            up->username);
+        return;
+    }
+
     int plugin_status = OPENVPN_PLUGIN_FUNC_SUCCESS;
     int script_status = OPENVPN_PLUGIN_FUNC_SUCCESS;
     /* Set the environment variables used by all auth variants */
@@ -1819,7 +1878,10 @@ verify_final_auth_checks(struct tls_multi *multi, struct tls_session *session)
         const char *cn = session->common_name;
         const char *path = platform_gen_path(session->opt->client_config_dir_exclusive,
                                              cn, &gc);
-        if (!cn || !strcmp(cn, CCD_DEFAULT) || !platform_test_file(path))
+        const bool found = session->opt->config_snapshot
+                           ? config_snapshot_ccd(session->opt->config_snapshot, cn, false) != NULL
+                           : platform_test_file(path);
+        if (!cn || !strcmp(cn, CCD_DEFAULT) || !found)
         {
             ks->authenticated = KS_AUTH_FALSE;
             wipe_auth_token(multi);
@@ -106,6 +106,7 @@
 /* These headers belong to C99 and should be always be present */
 #include <stdlib.h>
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdarg.h>
 #include <signal.h>
@@ -200,6 +201,10 @@
 #include <linux/errqueue.h>
 #endif
 
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
 #ifdef HAVE_NETINET_TCP_H
 #include <netinet/tcp.h>
 #endif
@@ -509,6 +514,16 @@ socket_defined(const socket_descriptor_t sd)
 #define EPOLL 0
 #endif
 
+/*
+ * Can we do packet I/O through io_uring?  Everything uring.c needs
+ * came with IORING_SETUP_DEFER_TASKRUN in Linux 6.1.
+ */
+#if defined(TARGET_LINUX) && defined(IORING_SETUP_DEFER_TASKRUN) && EPOLL
+#define ENABLE_IO_URING 1
+#else
+#define ENABLE_IO_URING 0
+#endif
+
 /*
  * Compression support
  */
@@ -609,6 +609,180 @@ cleanup:
     return ret;
 }
 
+struct tls_crypt_v2_cache *
+tls_crypt_v2_cache_new(void)
+{
+    struct tls_crypt_v2_cache *cache;
+    ALLOC_OBJ_CLEAR(cache, struct tls_crypt_v2_cache);
+    return cache;
+}
+
+static void
+tls_crypt_v2_cache_clear_entry(struct tls_crypt_v2_cache_entry *e)
+{
+    e->expire = 0;
+    e->valid = false;
+    secure_memzero(&e->client_key, sizeof(e->client_key));
+    buf_clear(&e->wkc);
+    buf_clear(&e->metadata);
+}
+
+void
+tls_crypt_v2_cache_free(struct tls_crypt_v2_cache *cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+    for (int i = 0; i < TLS_CRYPT_V2_CACHE_SIZE; i++)
+    {
+        struct tls_crypt_v2_cache_entry *e = &cache->entries[i];
+        tls_crypt_v2_cache_clear_entry(e);
+        free_buf(&e->wkc);
+        free_buf(&e->metadata);
+    }
+    free(cache);
+}
+
+/**
+ * Returns the i-th slot a wrapped client key may be stored in.  A valid
+ * key starts with its authentication tag, so its leading bytes are
+ * random enough to index the cache.
+ */
+static struct tls_crypt_v2_cache_entry *
+tls_crypt_v2_cache_slot(struct tls_crypt_v2_cache *cache,
+                        const struct buffer *wkc, int i)
+{
+    uint32_t h = 0;
+    memcpy(&h, BPTR(wkc), min_int(BLEN(wkc), sizeof(h)));
+    return &cache->entries[(h + i) & (TLS_CRYPT_V2_CACHE_SIZE - 1)];
+}
+
+static const struct tls_crypt_v2_cache_entry *
+tls_crypt_v2_cache_get(struct tls_crypt_v2_cache *cache,
+                       const struct buffer *wkc)
+{
+    for (int i = 0; i < TLS_CRYPT_V2_CACHE_WAYS; i++)
+    {
+        const struct tls_crypt_v2_cache_entry *e =
+            tls_crypt_v2_cache_slot(cache, wkc, i);
+        if (e->expire > now && buf_equal(&e->wkc, wkc))
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Remember a wrapped client key, with the key and metadata it unwrapped
+ * to, or as invalid if client_key is NULL.  An invalid key never evicts
+ * a valid one, so that garbage cannot push legitimate clients out of the
+ * cache.
+ */
+static void
+tls_crypt_v2_cache_put(struct tls_crypt_v2_cache *cache,
+                       const struct buffer *wkc,
+                       const struct key2 *client_key,
+                       const struct buffer *metadata)
+{
+    if (BLEN(wkc) > TLS_CRYPT_V2_MAX_WKC_LEN)
+    {
+        return;
+    }
+
+    struct tls_crypt_v2_cache_entry *victim = NULL;
+    for (int i = 0; i < TLS_CRYPT_V2_CACHE_WAYS; i++)
+    {
+        struct tls_crypt_v2_cache_entry *e =
+            tls_crypt_v2_cache_slot(cache, wkc, i);
+        if (e->expire <= now)
+        {
+            victim = e;
+            break;
+        }
+        if (e->valid && !client_key)
+        {
+            continue;
+        }
+        /* prefer invalid entries, then the one expiring first */
+        if (!victim || (victim->valid && !e->valid)
+            || (victim->valid == e->valid && e->expire < victim->expire))
+        {
+            victim = e;
+        }
+    }
+    if (!victim)
+    {
+        return;
+    }
+
+    tls_crypt_v2_cache_clear_entry(victim);
+    if (!victim->wkc.data)
+    {
+        victim->wkc = alloc_buf(TLS_CRYPT_V2_MAX_WKC_LEN);
+    }
+    buf_copy(&victim->wkc, wkc);
+    if (client_key)
+    {
+        if (!victim->metadata.data)
+        {
+            victim->metadata = alloc_buf(TLS_CRYPT_V2_MAX_METADATA_LEN);
+        }
+        victim->client_key = *client_key;
+        buf_copy(&victim->metadata, metadata);
+        victim->valid = true;
+        victim->expire = now + TLS_CRYPT_V2_CACHE_TTL;
+    }
+    else
+    {
+        victim->expire = now + TLS_CRYPT_V2_CACHE_INVALID_TTL;
+    }
+}
+
+/**
+ * Unwrap a client key into ctx, or take it from the client key cache of
+ * the server if it has one.
+ */
+static bool
+tls_crypt_v2_unwrap_cached(struct tls_wrap_ctx *ctx,
+                           struct buffer wrapped_client_key)
+{
+    struct tls_crypt_v2_cache *cache = ctx->tls_crypt_v2_cache;
+
+    if (cache)
+    {
+        const struct tls_crypt_v2_cache_entry *e =
+            tls_crypt_v2_cache_get(cache, &wrapped_client_key);
+        if (e && !e->valid)
+        {
+            cache->rejected++;
+            dmsg(D_TLS_DEBUG_LOW, "%s: client key failed to unwrap before",
+                 __func__);
+            return false;
+        }
+        if (e)
+        {
+            cache->hits++;
+            ctx->original_wrap_keydata = e->client_key;
+            return buf_copy(&ctx->tls_crypt_v2_metadata, &e->metadata);
+        }
+        cache->misses++;
+    }
+
+    bool ret = tls_crypt_v2_unwrap_client_key(&ctx->original_wrap_keydata,
+                                              &ctx->tls_crypt_v2_metadata,
+                                              wrapped_client_key,
+                                              &ctx->tls_crypt_v2_server_key);
+    if (cache)
+    {
+        tls_crypt_v2_cache_put(cache, &wrapped_client_key,
+                               ret ? &ctx->original_wrap_keydata : NULL,
+                               &ctx->tls_crypt_v2_metadata);
+    }
+    return ret;
+}
+
 bool
 tls_crypt_v2_extract_client_key(struct buffer *buf,
                                 struct tls_wrap_ctx *ctx,
@@ -642,10 +816,7 @@ tls_crypt_v2_extract_client_key(struct buffer *buf,
     }
 
     ctx->tls_crypt_v2_metadata = alloc_buf(TLS_CRYPT_V2_MAX_METADATA_LEN);
-    if (!tls_crypt_v2_unwrap_client_key(&ctx->original_wrap_keydata,
-                                        &ctx->tls_crypt_v2_metadata,
-                                        wrapped_client_key,
-                                        &ctx->tls_crypt_v2_server_key))
+    if (!tls_crypt_v2_unwrap_cached(ctx, wrapped_client_key))
     {
         msg(D_TLS_ERRORS, "Can not unwrap tls-crypt-v2 client key");
         secure_memzero(&ctx->original_wrap_keydata, sizeof(ctx->original_wrap_keydata));
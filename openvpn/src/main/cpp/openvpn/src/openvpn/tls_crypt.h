@@ -102,6 +102,44 @@
                                                  - (TLS_CRYPT_V2_CLIENT_KEY_LEN + TLS_CRYPT_V2_TAG_SIZE \
                                                     + sizeof(uint16_t)))
 
+/** Number of slots of a tls-crypt-v2 client key cache, a power of two */
+#define TLS_CRYPT_V2_CACHE_SIZE 256
+/** Number of slots a wrapped client key may be stored in */
+#define TLS_CRYPT_V2_CACHE_WAYS 4
+/** Seconds an unwrapped client key is remembered */
+#define TLS_CRYPT_V2_CACHE_TTL 60
+/** Seconds a wrapped client key that failed to unwrap is remembered */
+#define TLS_CRYPT_V2_CACHE_INVALID_TTL 10
+
+struct tls_crypt_v2_cache_entry
+{
+    time_t expire;              /**< 0 if the slot was never used */
+    bool valid;                 /**< false if the key failed to unwrap */
+    struct buffer wkc;          /**< Wrapped client key, as received */
+    struct key2 client_key;     /**< Unwrapped client key, if valid */
+    struct buffer metadata;     /**< Client key metadata, if valid */
+};
+
+/**
+ * Wrapped client keys recently seen by a tls-crypt-v2 server.
+ *
+ * A client sends its wrapped key with every hard reset, so that
+ * retransmitted resets, reconnects and the second pass over a reset
+ * once its instance exists would unwrap the same key again.  The cache
+ * remembers the unwrapped key and metadata for a short time, and also
+ * keys that failed to unwrap, so that a flood of the same bogus reset is
+ * rejected without decrypting it.  An entry is only used if the whole
+ * wrapped key is equal to the one received.  Shared by all client
+ * instances of a server.
+ */
+struct tls_crypt_v2_cache
+{
+    struct tls_crypt_v2_cache_entry entries[TLS_CRYPT_V2_CACHE_SIZE];
+    counter_type hits;          /**< Keys taken from the cache */
+    counter_type rejected;      /**< Invalid keys rejected by the cache */
+    counter_type misses;        /**< Keys that had to be unwrapped */
+};
+
 /**
  * Initialize a key_ctx_bi structure for use with --tls-crypt.
  *
@@ -213,6 +251,16 @@ bool tls_crypt_v2_extract_client_key(struct buffer *buf,
                                      struct tls_wrap_ctx *ctx,
                                      const struct tls_options *opt);
 
+/**
+ * Allocate an empty tls-crypt-v2 client key cache.
+ */
+struct tls_crypt_v2_cache *tls_crypt_v2_cache_new(void);
+
+/**
+ * Free a tls-crypt-v2 client key cache, wiping the keys it holds.
+ */
+void tls_crypt_v2_cache_free(struct tls_crypt_v2_cache *cache);
+
 /**
  * Generate a tls-crypt-v2 server key, and write to file.
  *
@@ -2057,6 +2057,9 @@ open_tun_dco_generic(const char *dev, const char *dev_type,
 static void
 close_tun_generic(struct tuntap *tt)
 {
+#if ENABLE_IO_URING
+    uring_close(tt->uring);
+#endif
     if (tt->fd >= 0)
     {
         close(tt->fd);
@@ -2371,15 +2374,41 @@ close_tun(struct tuntap *tt, openvpn_net_ctx_t *ctx)
 int
 write_tun(struct tuntap *tt, uint8_t *buf, int len)
 {
+#if ENABLE_IO_URING
+    if (tt->uring)
+    {
+        return uring_send(tt->uring, buf, len, NULL, 0);
+    }
+#endif
     return write(tt->fd, buf, len);
 }
 
 int
 read_tun(struct tuntap *tt, uint8_t *buf, int len)
 {
+#if ENABLE_IO_URING
+    if (tt->uring)
+    {
+        return uring_recv(tt->uring, buf, len, NULL, NULL);
+    }
+#endif
     return read(tt->fd, buf, len);
 }
 
+#if ENABLE_IO_URING
+bool
+tun_uring_open(struct tuntap *tt, int buf_size)
+{
+    if (tt->uring || !tuntap_defined(tt))
+    {
+        return true;
+    }
+
+    tt->uring = uring_open(tt->fd, false, buf_size, "TUN/TAP device");
+    return tt->uring != NULL;
+}
+#endif
+
 #elif defined(TARGET_SOLARIS)
 
 #ifndef TUNNEWPPA
@@ -41,6 +41,7 @@
 #include "networking.h"
 #include "ring_buffer.h"
 #include "dco.h"
+#include "uring.h"
 
 #ifdef _WIN32
 #define WINTUN_COMPONENT_ID "wintun"
@@ -148,6 +149,8 @@ struct tuntap_options {
 struct tuntap_options {
     int txqueuelen;
     bool disable_dco;
+    bool dco_userspace;
+    int dco_user_threads; /* 0 = one per CPU */
 };
 
 #elif defined(TARGET_FREEBSD)
@@ -222,6 +225,10 @@ struct tuntap
     int fd; /* file descriptor for TUN/TAP dev */
 #endif /* ifdef _WIN32 */
 
+#if ENABLE_IO_URING
+    struct uring *uring; /* packet I/O through io_uring */
+#endif
+
 #ifdef TARGET_SOLARIS
     int ip_fd;
 #endif
@@ -737,6 +744,13 @@ tun_set(struct tuntap *tt,
     /* if persistent is defined, call event_ctl only if rwflags has changed since last call */
     if (!persistent || *persistent != rwflags)
     {
+#if ENABLE_IO_URING
+        if (tt->uring)
+        {
+            uring_set(tt->uring, es, rwflags, arg);
+        }
+        else
+#endif
         event_ctl(es, tun_event_handle(tt), rwflags, arg);
         if (persistent)
         {
@@ -753,6 +767,16 @@ tun_set(struct tuntap *tt,
 
 }
 
+#if ENABLE_IO_URING
+/**
+ * Move the TUN/TAP device to io_uring, see uring.h.
+ *
+ * @return false if setting up the ring failed
+ */
+bool tun_uring_open(struct tuntap *tt, int buf_size);
+
+#endif
+
 const char *tun_stat(const struct tuntap *tt, unsigned int rwflags, struct gc_arena *gc);
 bool tun_name_is_fixed(const char *dev);
 
@@ -0,0 +1,564 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syshead.h"
+
+#if ENABLE_IO_URING
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "buffer.h"
+#include "error.h"
+#include "integer.h"
+#include "uring.h"
+
+#include "memdbg.h"
+
+/* user_data of receive requests, send requests use their slot index */
+#define URING_UD_RECV ((uint64_t) -1)
+
+static int
+sys_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                   unsigned int flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                         flags, NULL, 0);
+}
+
+static int
+sys_io_uring_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+#if HAVE_DECL_IORING_OP_READ_MULTISHOT
+static bool
+uring_op_supported(const struct uring *u, int op)
+{
+    const size_t len = sizeof(struct io_uring_probe)
+                       + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    bool ret = false;
+
+    check_malloc_return(probe);
+    if (sys_io_uring_register(u->fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0)
+    {
+        ret = op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ret;
+}
+#endif
+
+static inline unsigned int
+uring_sq_pending(const struct uring *u)
+{
+    return *u->sq_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static void
+uring_enter(struct uring *u)
+{
+    /* Completions posted while we are in the kernel anyway must not
+     * wake up the next event_wait() through the eventfd.  Work that
+     * the kernel queues for us in this window still sets
+     * IORING_SQ_TASKRUN, in that case signal the eventfd ourselves. */
+    __atomic_fetch_or(u->cq_flags, IORING_CQ_EVENTFD_DISABLED, __ATOMIC_SEQ_CST);
+    const int ret = sys_io_uring_enter(u->fd, uring_sq_pending(u), 0,
+                                       IORING_ENTER_GETEVENTS);
+    __atomic_fetch_and(u->cq_flags, ~IORING_CQ_EVENTFD_DISABLED, __ATOMIC_SEQ_CST);
+
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+        msg(D_LINK_ERRORS | M_ERRNO, "io_uring_enter failed on %s", u->name);
+    }
+    if (__atomic_load_n(u->sq_flags, __ATOMIC_SEQ_CST) & IORING_SQ_TASKRUN)
+    {
+        const uint64_t one = 1;
+        if (write(u->efd, &one, sizeof(one)) < 0)
+        {
+            msg(D_LINK_ERRORS | M_ERRNO, "io_uring eventfd write failed on %s", u->name);
+        }
+    }
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(struct uring *u)
+{
+    if (uring_sq_pending(u) >= u->sq_entries)
+    {
+        uring_enter(u);
+    }
+
+    const unsigned int tail = *u->sq_tail;
+    const unsigned int idx = tail & u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+
+    CLEAR(*sqe);
+    u->sq_array[idx] = idx;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+static inline uint8_t *
+uring_rbuf(const struct uring *u, unsigned int bid)
+{
+    return u->rbufs + (size_t) bid * u->rbuf_size;
+}
+
+/* hand a receive buffer back to the kernel */
+static void
+uring_provide(struct uring *u, unsigned short bid)
+{
+    struct io_uring_buf *b = &u->br->bufs[u->br_tail & (URING_RECV_BUFS - 1)];
+
+    b->addr = (uintptr_t) uring_rbuf(u, bid);
+    b->len = u->rbuf_size;
+    b->bid = bid;
+    __atomic_store_n(&u->br->tail, ++u->br_tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Queue receive requests until recv_target are in flight.  A request
+ * that runs out of buffers ends with ENOBUFS; wait until half of them
+ * are back before re-arming, so that we do not spin on that error.
+ */
+static void
+uring_arm_recv(struct uring *u)
+{
+    if (u->rq_len > URING_RECV_BUFS / 2)
+    {
+        return;
+    }
+
+    while (u->recv_armed < u->recv_target)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+        sqe->fd = u->io_fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = URING_UD_RECV;
+        if (u->is_socket)
+        {
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->addr = (uintptr_t) &u->recv_msg;
+            sqe->len = 1;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+        }
+#if HAVE_DECL_IORING_OP_READ_MULTISHOT
+        else if (u->multishot)
+        {
+            sqe->opcode = IORING_OP_READ_MULTISHOT;
+        }
+#endif
+        else
+        {
+            sqe->opcode = IORING_OP_READ;
+            sqe->len = u->rbuf_size;
+        }
+        ++u->recv_armed;
+    }
+}
+
+static void
+uring_recv_done(struct uring *u, const struct io_uring_cqe *cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+    {
+        --u->recv_armed;
+    }
+
+    if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED)
+    {
+        return;
+    }
+    if (u->rq_len < URING_RECV_BUFS)
+    {
+        struct uring_recv *r = &u->rq[(u->rq_head + u->rq_len++) & (URING_RECV_BUFS - 1)];
+        r->res = cqe->res;
+        r->bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    }
+    else if (cqe->flags & IORING_CQE_F_BUFFER)
+    {
+        /* cannot happen, every queued receive holds a buffer */
+        uring_provide(u, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+}
+
+static void
+uring_send_done(struct uring *u, const struct io_uring_cqe *cqe)
+{
+    if (cqe->res < 0 && cqe->res != -ECANCELED)
+    {
+        errno = -cqe->res;
+        msg(D_LINK_ERRORS | M_ERRNO, "%s write failed", u->name);
+    }
+    u->free_slots[u->n_free++] = (int) cqe->user_data;
+}
+
+static void
+uring_reap(struct uring *u)
+{
+    unsigned int head = *u->cq_head;
+    const unsigned int tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+        if (cqe->user_data == URING_UD_RECV)
+        {
+            uring_recv_done(u, cqe);
+        }
+        else
+        {
+            uring_send_done(u, cqe);
+        }
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+void
+uring_flush(struct uring *u, bool signalled)
+{
+    if (signalled)
+    {
+        uint64_t val;
+        if (read(u->efd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        {
+            msg(D_LINK_ERRORS | M_ERRNO, "io_uring eventfd read failed on %s", u->name);
+        }
+    }
+
+    uring_arm_recv(u);
+    if (signalled || uring_sq_pending(u)
+        || (__atomic_load_n(u->sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_TASKRUN))
+    {
+        uring_enter(u);
+    }
+    uring_reap(u);
+}
+
+int
+uring_recv(struct uring *u, uint8_t *data, int len,
+           struct sockaddr *from, socklen_t *fromlen)
+{
+    if (!u->rq_len)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    const struct uring_recv r = u->rq[u->rq_head];
+    u->rq_head = (u->rq_head + 1) & (URING_RECV_BUFS - 1);
+    --u->rq_len;
+
+    if (r.res < 0)
+    {
+        errno = -r.res;
+        return -1;
+    }
+
+    const uint8_t *p = uring_rbuf(u, r.bid);
+    int n = r.res;
+    if (u->is_socket)
+    {
+        /* see the io_uring_recvmsg_out layout in io_uring_prep_recvmsg_multishot(3) */
+        const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out *) p;
+        const int skip = (int) (sizeof(*out) + u->recv_msg.msg_namelen);
+
+        if (from)
+        {
+            memcpy(from, p + sizeof(*out),
+                   min_int((int) out->namelen, min_int(*fromlen, u->recv_msg.msg_namelen)));
+            *fromlen = out->namelen;
+        }
+        n = min_int((int) out->payloadlen, r.res - skip);
+        p += skip;
+    }
+    n = min_int(n, len);
+    memcpy(data, p, n);
+    uring_provide(u, r.bid);
+    return n;
+}
+
+int
+uring_send(struct uring *u, const uint8_t *data, int len,
+           const struct sockaddr *to, socklen_t tolen)
+{
+    if (len > u->buf_size || tolen > sizeof(u->slots[0].to))
+    {
+        /* does not fit a send slot, should not happen */
+        return to ? (int) sendto(u->io_fd, data, len, 0, to, tolen)
+               : (int) write(u->io_fd, data, len);
+    }
+
+    if (!u->n_free)
+    {
+        uring_reap(u);
+    }
+    if (!u->n_free)
+    {
+        uring_flush(u, false);
+    }
+    if (!u->n_free)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    const int slot = u->free_slots[--u->n_free];
+    struct uring_send *s = &u->slots[slot];
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+
+    memcpy(s->data, data, len);
+    sqe->fd = u->io_fd;
+    sqe->user_data = slot;
+    if (to)
+    {
+        memcpy(&s->to, to, tolen);
+        s->iov.iov_base = s->data;
+        s->iov.iov_len = len;
+        s->msg.msg_name = &s->to;
+        s->msg.msg_namelen = tolen;
+        s->msg.msg_iov = &s->iov;
+        s->msg.msg_iovlen = 1;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = (uintptr_t) &s->msg;
+        sqe->len = 1;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->addr = (uintptr_t) s->data;
+        sqe->len = len;
+    }
+    return len;
+}
+
+static bool
+uring_map(struct uring *u, const struct io_uring_params *p)
+{
+    const size_t sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned int);
+    const size_t cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+    u->ring_size = max_int((int) sq_size, (int) cq_size);
+    u->ring = mmap(NULL, u->ring_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->ring == MAP_FAILED)
+    {
+        u->ring = NULL;
+        return false;
+    }
+    u->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED)
+    {
+        u->sqes = NULL;
+        return false;
+    }
+
+    u->sq_head = (unsigned int *) (u->ring + p->sq_off.head);
+    u->sq_tail = (unsigned int *) (u->ring + p->sq_off.tail);
+    u->sq_flags = (unsigned int *) (u->ring + p->sq_off.flags);
+    u->sq_array = (unsigned int *) (u->ring + p->sq_off.array);
+    u->sq_mask = *(unsigned int *) (u->ring + p->sq_off.ring_mask);
+    u->sq_entries = p->sq_entries;
+    u->cq_head = (unsigned int *) (u->ring + p->cq_off.head);
+    u->cq_tail = (unsigned int *) (u->ring + p->cq_off.tail);
+    u->cq_flags = (unsigned int *) (u->ring + p->cq_off.flags);
+    u->cq_mask = *(unsigned int *) (u->ring + p->cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *) (u->ring + p->cq_off.cqes);
+    return true;
+}
+
+static bool
+uring_init_buffers(struct uring *u, int buf_size)
+{
+    struct io_uring_buf_reg reg;
+
+    u->buf_size = buf_size;
+    u->rbuf_size = buf_size;
+    if (u->is_socket)
+    {
+        /* multishot recvmsg puts a header and the source address
+         * in front of the payload */
+        u->recv_msg.msg_namelen = sizeof(struct sockaddr_in6);
+        u->rbuf_size += sizeof(struct io_uring_recvmsg_out) + u->recv_msg.msg_namelen;
+    }
+
+    u->br_size = URING_RECV_BUFS * sizeof(struct io_uring_buf);
+    u->br = mmap(NULL, u->br_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->br == MAP_FAILED)
+    {
+        u->br = NULL;
+        return false;
+    }
+
+    CLEAR(reg);
+    reg.ring_addr = (uintptr_t) u->br;
+    reg.ring_entries = URING_RECV_BUFS;
+    reg.bgid = 0;
+    if (sys_io_uring_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        return false;
+    }
+
+    ALLOC_ARRAY(u->rbufs, uint8_t, (size_t) URING_RECV_BUFS * u->rbuf_size);
+    for (int i = 0; i < URING_RECV_BUFS; ++i)
+    {
+        uring_provide(u, (unsigned short) i);
+    }
+
+    ALLOC_ARRAY_CLEAR(u->slots, struct uring_send, URING_SEND_SLOTS);
+    ALLOC_ARRAY(u->sbufs, uint8_t, (size_t) URING_SEND_SLOTS * buf_size);
+    for (int i = 0; i < URING_SEND_SLOTS; ++i)
+    {
+        u->slots[i].data = u->sbufs + (size_t) i * buf_size;
+        u->free_slots[u->n_free++] = i;
+    }
+    return true;
+}
+
+struct uring *
+uring_open(int fd, bool is_socket, int buf_size, const char *name)
+{
+    struct io_uring_params p;
+    struct uring *u;
+
+    ALLOC_OBJ_CLEAR(u, struct uring);
+    u->efd = -1;
+    u->io_fd = fd;
+    u->is_socket = is_socket;
+    u->name = name;
+
+    /* DEFER_TASKRUN (Linux 6.1) also guarantees multishot recvmsg and
+     * provided buffer rings */
+    CLEAR(p);
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN
+              | IORING_SETUP_TASKRUN_FLAG;
+    u->fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    if (u->fd < 0)
+    {
+        goto err;
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP))
+    {
+        errno = EOPNOTSUPP;
+        goto err;
+    }
+
+    if (!uring_map(u, &p) || !uring_init_buffers(u, buf_size))
+    {
+        goto err;
+    }
+
+    u->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (u->efd < 0
+        || sys_io_uring_register(u->fd, IORING_REGISTER_EVENTFD, &u->efd, 1) < 0)
+    {
+        goto err;
+    }
+
+    u->recv_target = 1;
+    if (!is_socket)
+    {
+#if HAVE_DECL_IORING_OP_READ_MULTISHOT
+        u->multishot = uring_op_supported(u, IORING_OP_READ_MULTISHOT);
+#endif
+        if (!u->multishot)
+        {
+            u->recv_target = URING_TUN_READS;
+        }
+    }
+    else
+    {
+        u->multishot = true;
+    }
+    uring_arm_recv(u);
+
+    msg(D_LOW, "io_uring: using %s receives on %s",
+        u->multishot ? "multishot" : "single-shot", name);
+    return u;
+
+err:
+    msg(M_INFO | M_ERRNO, "NOTE: cannot use io_uring for %s, using epoll", name);
+    uring_close(u);
+    return NULL;
+}
+
+void
+uring_close(struct uring *u)
+{
+    if (!u)
+    {
+        return;
+    }
+
+    if (u->fd >= 0)
+    {
+        /* do not drop what is still queued, an exit notification
+         * might be among it */
+        if (u->sq_tail && uring_sq_pending(u))
+        {
+            sys_io_uring_enter(u->fd, uring_sq_pending(u), 0, IORING_ENTER_GETEVENTS);
+        }
+        close(u->fd);
+    }
+    if (u->efd >= 0)
+    {
+        close(u->efd);
+    }
+    if (u->ring)
+    {
+        munmap(u->ring, u->ring_size);
+    }
+    if (u->sqes)
+    {
+        munmap(u->sqes, u->sqes_size);
+    }
+    if (u->br)
+    {
+        munmap(u->br, u->br_size);
+    }
+    free(u->rbufs);
+    free(u->sbufs);
+    free(u->slots);
+    free(u);
+}
+
+#endif /* ENABLE_IO_URING */
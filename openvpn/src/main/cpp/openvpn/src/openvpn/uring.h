@@ -0,0 +1,203 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+/*
+ * io_uring based packet I/O for the UDP link socket and the TUN/TAP
+ * device on Linux.
+ *
+ * Each descriptor gets its own ring.  Receives are kept armed in the
+ * kernel (a multishot recvmsg on the socket, a multishot or a few
+ * single-shot reads on the tun device) and complete into a ring of
+ * provided buffers, so reading a packet is a copy out of memory that
+ * the kernel already filled.  Writes are copied into a send slot and
+ * queued as an SQE; queued SQEs are handed to the kernel in one
+ * io_uring_enter() call by uring_flush(), which io_wait_dowork() calls
+ * before it sleeps.
+ *
+ * The ring is set up with IORING_SETUP_DEFER_TASKRUN, so completions
+ * are only posted from inside io_uring_enter().  An eventfd registered
+ * with the ring takes the place of the descriptor in the event set and
+ * becomes readable when the kernel has work for us.  Readiness for the
+ * caller comes from uring_ready(), which only looks at completions we
+ * already reaped.
+ */
+
+#if ENABLE_IO_URING
+
+#include "basic.h"
+#include "event.h"
+
+/* size of the submission queue */
+#define URING_ENTRIES     256
+
+/* number of provided receive buffers, must be a power of 2 */
+#define URING_RECV_BUFS   128
+
+/* number of writes that can be in flight */
+#define URING_SEND_SLOTS  64
+
+/* single-shot reads kept armed on the tun device when the kernel
+ * does not have IORING_OP_READ_MULTISHOT */
+#define URING_TUN_READS   8
+
+/* a completed receive, waiting to be picked up by uring_recv() */
+struct uring_recv
+{
+    int res;
+    unsigned short bid;
+};
+
+/* a queued write, the data is copied so that the caller can reuse
+ * its buffer at once */
+struct uring_send
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct sockaddr_in6 to;
+    uint8_t *data;
+};
+
+struct uring
+{
+    int fd;           /* the ring */
+    int efd;          /* eventfd that stands in for io_fd in the event set */
+    int io_fd;        /* the UDP socket or the tun device */
+    bool is_socket;
+    const char *name; /* for log messages */
+
+    /* shared ring memory */
+    uint8_t *ring;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_flags;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_flags;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* provided buffer ring for receives */
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    uint8_t *rbufs;
+    int rbuf_size;    /* receive buffer, including the recvmsg header */
+    int buf_size;     /* largest packet */
+    unsigned short br_tail;
+    struct msghdr recv_msg;
+    bool multishot;
+    int recv_armed;   /* receive requests in flight */
+    int recv_target;  /* receive requests we want in flight */
+
+    /* completed receives, in order */
+    struct uring_recv rq[URING_RECV_BUFS];
+    unsigned int rq_head;
+    unsigned int rq_len;
+
+    /* send slots */
+    struct uring_send *slots;
+    uint8_t *sbufs;
+    int free_slots[URING_SEND_SLOTS];
+    int n_free;
+};
+
+/**
+ * Set up a ring for a descriptor.
+ *
+ * @param fd        the UDP socket or the tun device, non-blocking
+ * @param is_socket true for the UDP socket
+ * @param buf_size  largest packet that is read or written
+ * @param name      how to call the descriptor in log messages
+ *
+ * @return the ring, or NULL if the kernel does not support what we
+ *         need, in which case the caller keeps using plain syscalls
+ */
+struct uring *uring_open(int fd, bool is_socket, int buf_size, const char *name);
+
+/**
+ * Submit what is still queued, then tear down the ring.  Requests
+ * still in flight are cancelled by the kernel.
+ */
+void uring_close(struct uring *u);
+
+/**
+ * Submit queued SQEs and re-armed receives, run the work the kernel
+ * deferred for us and reap all completions.
+ *
+ * @param signalled the eventfd was reported readable
+ */
+void uring_flush(struct uring *u, bool signalled);
+
+/**
+ * Copy the oldest received packet to data.  Returns its length, or -1
+ * with errno set to EAGAIN if nothing was received, or to the error
+ * the kernel reported for the receive.  from may be NULL.
+ */
+int uring_recv(struct uring *u, uint8_t *data, int len,
+               struct sockaddr *from, socklen_t *fromlen);
+
+/**
+ * Queue a packet for sending, to may be NULL for the tun device.
+ * Returns len, or -1 with errno set to EAGAIN if all send slots are
+ * in flight.
+ */
+int uring_send(struct uring *u, const uint8_t *data, int len,
+               const struct sockaddr *to, socklen_t tolen);
+
+/**
+ * Register the ring in an event set, in place of its descriptor.
+ */
+static inline void
+uring_set(struct uring *u, struct event_set *es, unsigned int rwflags, void *arg)
+{
+    event_ctl(es, u->efd, rwflags ? EVENT_READ : 0, arg);
+}
+
+/**
+ * Return which of rwflags can be done without waiting.
+ */
+static inline unsigned int
+uring_ready(const struct uring *u, unsigned int rwflags)
+{
+    unsigned int ret = 0;
+    if ((rwflags & EVENT_READ) && u->rq_len)
+    {
+        ret |= EVENT_READ;
+    }
+    if ((rwflags & EVENT_WRITE) && u->n_free)
+    {
+        ret |= EVENT_WRITE;
+    }
+    return ret;
+}
+
+#endif /* ENABLE_IO_URING */
+#endif /* URING_H */
@@ -0,0 +1,390 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syshead.h"
+#include "error.h"
+#include "xkey_async.h"
+
+#ifdef ENABLE_XKEY_ASYNC
+
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <openssl/async.h>
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+/**
+ * A signature request.  It lives on the stack of the paused ASYNC_JOB,
+ * which is not released before the request is done.
+ */
+struct xkey_async_req
+{
+    EVP_PKEY *pkey;
+    const XKEY_SIGALG *sigalg;
+    const unsigned char *tbs;
+    size_t tbslen;
+    unsigned char *sig;
+    size_t *siglen;
+    int ret;
+    bool done;                  /**< protected by xkey_async_pool.lock */
+    struct xkey_async_req *next;
+};
+
+static struct xkey_async_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /**< new request or shutdown */
+    pthread_cond_t idle;        /**< a request was completed */
+    struct xkey_async_req *head;
+    struct xkey_async_req *tail;
+    int busy;                   /**< requests queued or being signed */
+    bool stop;
+    bool closing;               /**< see xkey_async_set_closing() */
+    int event_fd;
+    int n_threads;
+    pthread_t threads[XKEY_ASYNC_THREADS_MAX];
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .event_fd = -1,
+}; /* GLOBAL */
+
+/**
+ * Sign with a native key.  Runs in the worker threads, so it must not
+ * log: the result is reported by xkey_async_sign().
+ */
+static int
+xkey_async_sign_key(EVP_PKEY *pkey, unsigned char *sig, size_t *siglen,
+                    const unsigned char *tbs, size_t tbslen,
+                    const XKEY_SIGALG *sigalg)
+{
+    int ret = 0;
+
+    if (!strcmp(sigalg->keytype, "ED448") || !strcmp(sigalg->keytype, "ED25519"))
+    {
+        /* EdDSA signs the message itself and has no separate digest */
+        EVP_MD_CTX *mctx = EVP_MD_CTX_new();
+        if (mctx && EVP_DigestSignInit_ex(mctx, NULL, NULL, NULL, NULL, pkey, NULL) == 1)
+        {
+            ret = EVP_DigestSign(mctx, sig, siglen, tbs, tbslen);
+        }
+        EVP_MD_CTX_free(mctx);
+        return ret;
+    }
+
+    /* same parameters as in xkey_native_sign() */
+    int i = 0;
+    OSSL_PARAM params[5];
+    if (EVP_PKEY_get_id(pkey) == EVP_PKEY_RSA)
+    {
+        params[i++] = OSSL_PARAM_construct_utf8_string(OSSL_SIGNATURE_PARAM_DIGEST, (char *) sigalg->mdname, 0);
+        params[i++] = OSSL_PARAM_construct_utf8_string(OSSL_SIGNATURE_PARAM_PAD_MODE, (char *) sigalg->padmode, 0);
+        if (!strcmp(sigalg->padmode, "pss"))
+        {
+            params[i++] = OSSL_PARAM_construct_utf8_string(OSSL_SIGNATURE_PARAM_PSS_SALTLEN, (char *) sigalg->saltlen, 0);
+            /* same digest for mgf1 */
+            params[i++] = OSSL_PARAM_construct_utf8_string(OSSL_SIGNATURE_PARAM_MGF1_DIGEST, (char *) sigalg->mdname, 0);
+        }
+    }
+    params[i++] = OSSL_PARAM_construct_end();
+
+    EVP_PKEY_CTX *ectx = EVP_PKEY_CTX_new_from_pkey(NULL, pkey, NULL);
+    if (ectx && EVP_PKEY_sign_init_ex(ectx, params) == 1)
+    {
+        ret = EVP_PKEY_sign(ectx, sig, siglen, tbs, tbslen);
+    }
+    EVP_PKEY_CTX_free(ectx);
+
+    return ret;
+}
+
+static void *
+xkey_async_worker(void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&pool.lock);
+    while (true)
+    {
+        while (!pool.head && !pool.stop)
+        {
+            pthread_cond_wait(&pool.work, &pool.lock);
+        }
+        struct xkey_async_req *req = pool.head;
+        if (!req)
+        {
+            break;
+        }
+        pool.head = req->next;
+        if (!pool.head)
+        {
+            pool.tail = NULL;
+        }
+        pthread_mutex_unlock(&pool.lock);
+
+        int ret = xkey_async_sign_key(req->pkey, req->sig, req->siglen,
+                                      req->tbs, req->tbslen, req->sigalg);
+        if (ret != 1)
+        {
+            ERR_clear_error();
+        }
+
+        pthread_mutex_lock(&pool.lock);
+        req->ret = ret;
+        req->done = true;
+        pool.busy--;
+        pthread_cond_broadcast(&pool.idle);
+        xkey_async_signal();
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return NULL;
+}
+
+static bool
+xkey_async_done(struct xkey_async_req *req)
+{
+    pthread_mutex_lock(&pool.lock);
+    bool done = req->done;
+    pthread_mutex_unlock(&pool.lock);
+    return done;
+}
+
+/**
+ * Sign op called from xkey provider.  From within an ASYNC_JOB, the
+ * request is passed to the workers and the job is paused until it has
+ * been completed.  Otherwise the signature is computed right here.
+ */
+static int
+xkey_async_sign(void *handle, unsigned char *sig, size_t *siglen,
+                const unsigned char *tbs, size_t tbslen, XKEY_SIGALG sigalg)
+{
+    EVP_PKEY *pkey = handle;
+    unsigned char buf[EVP_MAX_MD_SIZE];
+    size_t buflen = sizeof(buf);
+
+    if (!strcmp(sigalg.op, "DigestSign")
+        && strcmp(sigalg.keytype, "ED448") && strcmp(sigalg.keytype, "ED25519"))
+    {
+        if (!xkey_digest(tbs, tbslen, buf, &buflen, sigalg.mdname))
+        {
+            return 0;
+        }
+        tbs = buf;
+        tbslen = buflen;
+        sigalg.op = "Sign";
+    }
+
+    if (!pool.n_threads || !ASYNC_get_current_job())
+    {
+        int ret = xkey_async_sign_key(pkey, sig, siglen, tbs, tbslen, &sigalg);
+        if (ret != 1)
+        {
+            msg(M_NONFATAL, "xkey_async: private key signature failed");
+        }
+        return ret;
+    }
+
+    struct xkey_async_req req = {
+        .pkey = pkey,
+        .sigalg = &sigalg,
+        .tbs = tbs,
+        .tbslen = tbslen,
+        .sig = sig,
+        .siglen = siglen,
+    };
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.tail)
+    {
+        pool.tail->next = &req;
+    }
+    else
+    {
+        pool.head = &req;
+    }
+    pool.tail = &req;
+    pool.busy++;
+    pthread_cond_signal(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    while (!xkey_async_done(&req))
+    {
+        if (!ASYNC_pause_job())
+        {
+            xkey_async_wait();
+        }
+    }
+
+    if (req.ret != 1)
+    {
+        msg(M_NONFATAL, "xkey_async: private key signature failed");
+    }
+    return req.ret;
+}
+
+static void
+xkey_async_free(void *handle)
+{
+    EVP_PKEY_free(handle);
+}
+
+bool
+xkey_async_init(int workers)
+{
+    if (pool.n_threads)
+    {
+        return true;
+    }
+
+    ASSERT(workers > 0 && workers <= XKEY_ASYNC_THREADS_MAX);
+
+    if (!xkey_async_event_init())
+    {
+        return false;
+    }
+
+    pool.stop = false;
+    for (int i = 0; i < workers; i++)
+    {
+        int err = pthread_create(&pool.threads[i], NULL, xkey_async_worker, NULL);
+        if (err)
+        {
+            msg(M_WARN, "--tls-sign-workers: cannot create thread: %s", strerror(err));
+            xkey_async_uninit();
+            return false;
+        }
+        pool.n_threads++;
+    }
+
+    msg(M_INFO, "TLS private key signatures run in %d worker thread(s)",
+        pool.n_threads);
+    return true;
+}
+
+bool
+xkey_async_event_init(void)
+{
+    if (pool.event_fd >= 0)
+    {
+        return true;
+    }
+
+    if (!ASYNC_is_capable())
+    {
+        msg(M_WARN, "OpenSSL cannot run ASYNC jobs on this platform");
+        return false;
+    }
+
+    pool.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pool.event_fd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "xkey_async: eventfd failed");
+        return false;
+    }
+    return true;
+}
+
+void
+xkey_async_uninit(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < pool.n_threads; i++)
+    {
+        pthread_join(pool.threads[i], NULL);
+    }
+    pool.n_threads = 0;
+
+    if (pool.event_fd >= 0)
+    {
+        close(pool.event_fd);
+        pool.event_fd = -1;
+    }
+}
+
+EVP_PKEY *
+xkey_async_load_key(OSSL_LIB_CTX *libctx, EVP_PKEY *privkey, EVP_PKEY *pubkey)
+{
+    /* the reference is released by xkey_async_free() */
+    EVP_PKEY_up_ref(privkey);
+    return xkey_load_generic_key(libctx, privkey, pubkey,
+                                 xkey_async_sign, xkey_async_free);
+}
+
+int
+xkey_async_event_fd(void)
+{
+    return pool.event_fd;
+}
+
+void
+xkey_async_clear_event(void)
+{
+    uint64_t count;
+    ssize_t n = read(pool.event_fd, &count, sizeof(count));
+    (void) n; /* EAGAIN if nothing was completed since the last call */
+}
+
+void
+xkey_async_signal(void)
+{
+    const uint64_t one = 1;
+    ssize_t n = write(pool.event_fd, &one, sizeof(one));
+    (void) n; /* the counter cannot overflow in practice */
+}
+
+void
+xkey_async_set_closing(bool closing)
+{
+    pool.closing = closing;
+}
+
+bool
+xkey_async_closing(void)
+{
+    return pool.closing;
+}
+
+void
+xkey_async_wait(void)
+{
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy)
+    {
+        pthread_cond_wait(&pool.idle, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
+
+#endif /* ENABLE_XKEY_ASYNC */
@@ -0,0 +1,154 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef XKEY_ASYNC_H_
+#define XKEY_ASYNC_H_
+
+#include "xkey_common.h"
+
+#if defined(HAVE_XKEY_PROVIDER) && defined(TARGET_LINUX)
+#define ENABLE_XKEY_ASYNC 1
+#endif
+
+/**
+ * @file
+ * Private key signatures in worker threads (--tls-sign-workers).
+ *
+ * The private key of the TLS context is replaced by an ovpn.xkey key
+ * whose sign operation hands the request to a pool of worker threads.
+ * The TLS context runs in SSL_MODE_ASYNC, so OpenSSL executes the
+ * handshake in an ASYNC_JOB: the sign operation pauses the job until a
+ * worker has produced the signature and SSL_read() returns
+ * SSL_ERROR_WANT_ASYNC in the meantime.  Each finished signature makes
+ * xkey_async_event_fd() readable; the main loop then processes the
+ * TLS objects that wait for a signature again, which resumes their job.
+ *
+ * Everything but the signature itself still runs in the main thread.
+ *
+ * With --management-external-key async, the sign operation of the
+ * management key pauses the job in the same way until the management
+ * client has answered the request; the answer makes the descriptor
+ * readable as well.
+ */
+
+/** Upper limit for --tls-sign-workers */
+#define XKEY_ASYNC_THREADS_MAX 64
+
+#ifdef ENABLE_XKEY_ASYNC
+
+/**
+ * Start the worker threads.  Does nothing if they are already running.
+ *
+ * @param workers   number of threads
+ *
+ * @return          true on success
+ */
+bool xkey_async_init(int workers);
+
+/**
+ * Create the descriptor returned by xkey_async_event_fd() without
+ * starting any worker threads.  Does nothing if it already exists.
+ *
+ * @return          true on success, false if OpenSSL cannot run
+ *                  ASYNC_JOBs here
+ */
+bool xkey_async_event_init(void);
+
+/**
+ * Stop the worker threads.  Pending requests are completed first.
+ */
+void xkey_async_uninit(void);
+
+/**
+ * Wrap a private key so that its signatures are computed by the
+ * worker threads when requested from within an ASYNC_JOB, and inline
+ * otherwise.
+ *
+ * @param libctx    library context in which xkey provider has been loaded
+ * @param privkey   the private key; it is up-refd
+ * @param pubkey    corresponding pubkey in the default provider's context
+ *
+ * @returns a new EVP_PKEY in the provider's keymgmt context.
+ */
+EVP_PKEY *xkey_async_load_key(OSSL_LIB_CTX *libctx, EVP_PKEY *privkey,
+                              EVP_PKEY *pubkey);
+
+/**
+ * Return the descriptor that becomes readable when a signature has
+ * been completed, or -1 if the workers are not running.
+ */
+int xkey_async_event_fd(void);
+
+/**
+ * Reset the descriptor returned by xkey_async_event_fd().
+ */
+void xkey_async_clear_event(void);
+
+/**
+ * Make the descriptor returned by xkey_async_event_fd() readable, after
+ * a request that a paused job waits for has been completed.
+ */
+void xkey_async_signal(void);
+
+/**
+ * Set while a paused job is resumed only to let it finish, before its
+ * SSL object is freed.  Requests that wait for something outside of
+ * this process, like the management client, fail then instead of
+ * pausing the job again.
+ */
+void xkey_async_set_closing(bool closing);
+
+bool xkey_async_closing(void);
+
+/**
+ * Block until all queued signature requests have been completed.  A
+ * paused ASYNC_JOB can then be resumed without pausing for the same
+ * request again.
+ */
+void xkey_async_wait(void);
+
+#else  /* ifdef ENABLE_XKEY_ASYNC */
+
+static inline void
+xkey_async_uninit(void)
+{
+}
+
+static inline int
+xkey_async_event_fd(void)
+{
+    return -1;
+}
+
+static inline void
+xkey_async_clear_event(void)
+{
+}
+
+static inline void
+xkey_async_signal(void)
+{
+}
+
+#endif /* ifdef ENABLE_XKEY_ASYNC */
+#endif /* XKEY_ASYNC_H_ */
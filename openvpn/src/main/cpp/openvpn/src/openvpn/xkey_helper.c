@@ -30,6 +30,7 @@
 #include "error.h"
 #include "buffer.h"
 #include "xkey_common.h"
+#include "xkey_async.h"
 #include "manage.h"
 #include "base64.h"
 
@@ -43,6 +44,9 @@
 #include <openssl/store.h>
 #include <openssl/evp.h>
 #include <openssl/err.h>
+#ifdef ENABLE_XKEY_ASYNC
+#include <openssl/async.h>
+#endif
 
 static const char *const props = XKEY_PROV_PROPS;
 
@@ -148,6 +152,39 @@ xkey_load_generic_key(OSSL_LIB_CTX *libctx, void *handle, EVP_PKEY *pubkey,
 }
 
 #ifdef ENABLE_MANAGEMENT
+#ifdef ENABLE_XKEY_ASYNC
+/**
+ * Request a signature from the management client without blocking
+ * (management-external-key async): the request is sent with an id and
+ * the ASYNC_JOB of the handshake is paused until the answer has
+ * arrived, so the main loop serves other sessions in the meantime.
+ *
+ * @return              allocated base64 signature or NULL on error
+ */
+static char *
+xkey_management_sign_async(const char *b64_data, const char *algorithm)
+{
+    char *out_b64 = NULL;
+
+    unsigned int id = management_pk_sig_async(management, b64_data, algorithm);
+    if (!id)
+    {
+        /* no client connected yet: wait for one */
+        return management_query_pk_sig(management, b64_data, algorithm);
+    }
+
+    while (management && !management_pk_sig_async_result(management, id, &out_b64))
+    {
+        if (xkey_async_closing() || !ASYNC_pause_job())
+        {
+            management_pk_sig_async_cancel(management, id);
+            break;
+        }
+    }
+    return out_b64;
+}
+#endif /* ifdef ENABLE_XKEY_ASYNC */
+
 /**
  * Signature callback for xkey_provider with management-external-key
  *
@@ -265,6 +302,13 @@ xkey_management_sign(void *unused, unsigned char *sig, size_t *siglen,
 
     if (management && bencret > 0)
     {
+#ifdef ENABLE_XKEY_ASYNC
+        if (ASYNC_get_current_job())
+        {
+            out_b64 = xkey_management_sign_async(in_b64, alg_str);
+        }
+        else
+#endif
         out_b64 = management_query_pk_sig(management, in_b64, alg_str);
     }
     if (out_b64)
@@ -31,7 +31,31 @@
 #include <cmocka.h>
 
 #include "buffer.h"
+
+/* count the heap allocations made by buffer.c, see
+ * test_buffer_gc_malloc_count() */
+static int heap_allocs;
+
+static void *
+counting_malloc(size_t size)
+{
+    heap_allocs++;
+    return malloc(size);
+}
+
+static void *
+counting_calloc(size_t nmemb, size_t size)
+{
+    heap_allocs++;
+    return calloc(nmemb, size);
+}
+
+#define malloc counting_malloc
+#define calloc counting_calloc
 #include "buffer.c"
+#undef malloc
+#undef calloc
+
 #include "test_common.h"
 
 static void
@@ -290,6 +314,104 @@ test_buffer_free_gc_two(void **state)
     gc_free(&gc);
 }
 
+static int
+gc_count_entries(const struct gc_arena *gc)
+{
+    int n = 0;
+    for (const struct gc_entry *e = gc->list; e; e = e->next)
+    {
+        n++;
+    }
+    return n;
+}
+
+static void
+test_buffer_gc_chunk(void **state)
+{
+    struct gc_arena gc = gc_new();
+
+    /* small allocations share chunks and are aligned */
+    char *prev = NULL;
+    for (int i = 0; i < 1000; i++)
+    {
+        char *s = string_alloc("10.29.41.2", &gc);
+        assert_string_equal(s, "10.29.41.2");
+        assert_int_equal((uintptr_t)s % GC_CHUNK_ALIGN, 0);
+        assert_ptr_not_equal(s, prev);
+        prev = s;
+    }
+    assert_in_range(gc_count_entries(&gc), 1, 1000 * 16 / GC_CHUNK_SIZE + 1);
+
+    /* large allocations get their own entry and can be freed early */
+    int n = gc_count_entries(&gc);
+    struct buffer big = alloc_buf_gc(GC_CHUNK_MAX_ALLOC + 1, &gc);
+    assert_ptr_equal(gc.list + 1, big.data);
+    assert_int_equal(gc_count_entries(&gc), n + 1);
+    free_buf_gc(&big, &gc);
+    assert_int_equal(gc_count_entries(&gc), n);
+
+    /* freeing a small buffer leaves its chunk alone */
+    struct buffer small = alloc_buf_gc(16, &gc);
+    buf_printf(&small, "abc");
+    free_buf_gc(&small, &gc);
+    assert_int_equal(gc_count_entries(&gc), n);
+    assert_null(small.data);
+
+    gc_free(&gc);
+    assert_null(gc.list);
+
+    /* the arena is usable again after gc_free() */
+    assert_string_equal(string_alloc("abc", &gc), "abc");
+    assert_int_equal(gc_count_entries(&gc), 1);
+    gc_free(&gc);
+}
+
+/*
+ * Allocation count benchmark.  Runs the two typical gc_arena patterns,
+ * a short-lived arena per packet with a few strings, as in
+ * process_outgoing_link(), and one arena collecting many strings, as in
+ * multi_print_status(), and counts the malloc() calls they need.
+ */
+static void
+test_buffer_gc_malloc_count(void **state)
+{
+    const int rounds = 10000;
+    const uint8_t sid[8] = { 0 };
+    int allocs = 0;
+
+    heap_allocs = 0;
+    clock_t start = clock();
+    for (int i = 0; i < rounds; i++)
+    {
+        struct gc_arena gc = gc_new();
+        struct buffer out = alloc_buf_gc(64, &gc);
+        buf_printf(&out, "%s:%d", string_alloc("10.29.41.2", &gc), i);
+        format_hex(sid, sizeof(sid), 0, &gc);
+        allocs += 3;
+        gc_free(&gc);
+    }
+    print_message("per-packet arena: %d allocations, %d malloc calls, %.1f ms\n",
+                  allocs, heap_allocs, (clock() - start) * 1000.0 / CLOCKS_PER_SEC);
+    /* one chunk per arena */
+    assert_int_equal(heap_allocs, rounds);
+
+    struct gc_arena gc = gc_new();
+    allocs = 0;
+    heap_allocs = 0;
+    start = clock();
+    for (int i = 0; i < rounds; i++)
+    {
+        struct buffer out = alloc_buf_gc(64, &gc);
+        buf_printf(&out, "client%d,10.29.%d.%d:1194,%s", i, i / 256, i % 256,
+                   string_alloc("10.8.0.2", &gc));
+        format_hex(sid, sizeof(sid), 0, &gc);
+        allocs += 3;
+    }
+    gc_free(&gc);
+    print_message("status arena: %d allocations, %d malloc calls, %.1f ms\n",
+                  allocs, heap_allocs, (clock() - start) * 1000.0 / CLOCKS_PER_SEC);
+    assert_in_range(heap_allocs, 1, allocs / 8);
+}
 
 static void
 test_buffer_gc_realloc(void **state)
@@ -458,6 +580,8 @@ main(void)
                                         test_buffer_list_teardown),
         cmocka_unit_test(test_buffer_free_gc_one),
         cmocka_unit_test(test_buffer_free_gc_two),
+        cmocka_unit_test(test_buffer_gc_chunk),
+        cmocka_unit_test(test_buffer_gc_malloc_count),
         cmocka_unit_test(test_buffer_gc_realloc),
         cmocka_unit_test(test_character_class),
         cmocka_unit_test(test_character_string_mod_buf),
@@ -0,0 +1,205 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2024 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "syshead.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "mshaper.h"
+#include "shaper.h"
+#include "test_common.h"
+
+#define PAYLOAD_SIZE 1600
+
+/* fake instances, only used as tags */
+static struct multi_instance *const mi_a = (struct multi_instance *) 0x1000;
+static struct multi_instance *const mi_b = (struct multi_instance *) 0x2000;
+
+/* queue a packet of len bytes whose first byte is tag */
+static bool
+enqueue(struct mshaper *s, struct mshaper_class *c, int len, uint8_t tag)
+{
+    uint8_t data[PAYLOAD_SIZE] = { tag };
+    struct buffer buf;
+
+    buf_set_read(&buf, data, len);
+    return mshaper_enqueue(s, c, &buf);
+}
+
+/* dequeue a packet, check its class and return its tag */
+static int
+dequeue(struct mshaper *s, const struct mshaper_class *expect)
+{
+    struct mshaper_class *c = NULL;
+    const int slot = mshaper_dequeue(s, &c);
+    if (slot < 0)
+    {
+        return -1;
+    }
+    if (expect)
+    {
+        assert_ptr_equal(c, expect);
+    }
+    const int tag = *BPTR(mshaper_slot_buf(s, slot));
+    mshaper_release(s, slot);
+    return tag;
+}
+
+static void
+test_mshaper_order(void **state)
+{
+    struct mshaper s;
+    struct mshaper_class a;
+
+    mshaper_init(&s, 0, 0, PAYLOAD_SIZE);
+    mshaper_class_init(&a, mi_a);
+    mshaper_class_set(&a, 100000, 0);
+
+    /* use up the burst and then some */
+    assert_true(mshaper_admit(&s, &a, 20000));
+    assert_false(mshaper_admit(&s, &a, 100));
+
+    for (int i = 1; i <= 5; ++i)
+    {
+        assert_true(enqueue(&s, &a, 1000, i));
+    }
+    assert_true(mshaper_backlog(&s));
+    assert_int_equal(s.n_queued, 5);
+
+    /* no tokens yet, 100ms until the debt is paid */
+    assert_int_equal(dequeue(&s, &a), -1);
+    assert_in_range(mshaper_delay(&s), 1, 100000);
+
+    /* with tokens, queued packets must not be overtaken */
+    a.bucket.credit = (int64_t)a.bucket.burst * 1000000;
+    assert_false(mshaper_admit(&s, &a, 100));
+    for (int i = 1; i <= 5; ++i)
+    {
+        assert_int_equal(dequeue(&s, &a), i);
+    }
+    assert_false(mshaper_backlog(&s));
+    assert_int_equal(dequeue(&s, NULL), -1);
+
+    mshaper_free(&s);
+}
+
+static void
+test_mshaper_fair(void **state)
+{
+    struct mshaper s;
+    struct mshaper_class a, b;
+
+    mshaper_init(&s, 1000000, 0, PAYLOAD_SIZE);
+    mshaper_class_init(&a, mi_a);
+    mshaper_class_init(&b, mi_b);
+
+    /* a heavy user queues first, then a light one */
+    s.total.credit = -10000LL * 1000000;
+    for (int i = 0; i < 20; ++i)
+    {
+        assert_true(enqueue(&s, &a, 1000, 'a'));
+    }
+    assert_true(enqueue(&s, &b, 1000, 'b'));
+    assert_true(enqueue(&s, &b, 1000, 'b'));
+    assert_int_equal(dequeue(&s, NULL), -1);
+
+    /* both get their turns, b is not stuck behind the queue of a */
+    s.total.credit = (int64_t)s.total.burst * 1000000;
+    int n_b = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dequeue(&s, NULL) == 'b')
+        {
+            ++n_b;
+        }
+    }
+    assert_int_equal(n_b, 2);
+    assert_int_equal(s.n_active, 1);
+
+    mshaper_class_flush(&s, &a);
+    assert_false(mshaper_backlog(&s));
+    assert_int_equal(s.n_queued, 0);
+
+    mshaper_free(&s);
+}
+
+static void
+test_mshaper_limits(void **state)
+{
+    struct mshaper s;
+    struct mshaper_class a, b;
+
+    mshaper_init(&s, 0, 0, PAYLOAD_SIZE);
+    mshaper_class_init(&a, mi_a);
+    mshaper_class_init(&b, mi_b);
+
+    /* 200ms of 100 bytes per second is less than the minimum queue */
+    mshaper_class_set(&a, 100, 0);
+    for (int i = 0; i < MSHAPER_QUEUE_MIN; ++i)
+    {
+        assert_true(enqueue(&s, &a, PAYLOAD_SIZE, 'a'));
+    }
+    assert_false(enqueue(&s, &a, PAYLOAD_SIZE, 'a'));
+    assert_false(enqueue(&s, &a, PAYLOAD_SIZE + 1, 'a'));
+    assert_int_equal(s.dropped, 2);
+    mshaper_class_flush(&s, &a);
+
+    /* fill the whole pool, then the longest queue makes room */
+    mshaper_class_set(&a, SHAPER_MAX, 0);
+    mshaper_class_set(&b, SHAPER_MAX, 0);
+    for (int i = 0; i < MSHAPER_POOL_SIZE - 1; ++i)
+    {
+        assert_true(enqueue(&s, &a, 100, 'a'));
+    }
+    assert_true(enqueue(&s, &b, 100, 'b'));
+    assert_true(enqueue(&s, &b, 100, 'b'));
+    assert_int_equal(s.dropped, 3);
+    assert_int_equal(a.n_queued, MSHAPER_POOL_SIZE - 2);
+    assert_int_equal(b.n_queued, 2);
+    assert_int_equal(s.n_queued, MSHAPER_POOL_SIZE);
+
+    mshaper_class_flush(&s, &b);
+    mshaper_class_flush(&s, &a);
+    assert_int_equal(s.n_active, 0);
+
+    mshaper_free(&s);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_mshaper_order),
+        cmocka_unit_test(test_mshaper_fair),
+        cmocka_unit_test(test_mshaper_limits),
+    };
+
+    return cmocka_run_group_tests_name("mshaper tests", tests, NULL, NULL);
+}
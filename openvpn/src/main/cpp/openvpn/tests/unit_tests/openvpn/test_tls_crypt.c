@@ -538,6 +538,62 @@ tls_crypt_v2_wrap_unwrap_max_metadata(void **state)
     tls_wrap_free(&wrap_ctx);
 }
 
+/**
+ * Check that a server with a client key cache unwraps a client key only
+ * once, and remembers a client key that failed to unwrap.
+ */
+static void
+tls_crypt_v2_extract_client_key_cached(void **state)
+{
+    struct test_tls_crypt_v2_context *ctx =
+        (struct test_tls_crypt_v2_context *) *state;
+
+    uint8_t *metadata = buf_write_alloc(&ctx->metadata, 32);
+    assert_true(rand_bytes(metadata, 32));
+    assert_true(tls_crypt_v2_wrap_client_key(&ctx->wkc, &ctx->client_key2,
+                                             &ctx->metadata,
+                                             &ctx->server_keys.encrypt,
+                                             &ctx->gc));
+
+    struct tls_crypt_v2_cache *cache = tls_crypt_v2_cache_new();
+    for (int i = 0; i < 2; i++)
+    {
+        struct buffer wkc = ctx->wkc;
+        struct tls_wrap_ctx wrap_ctx = {
+            .mode = TLS_WRAP_CRYPT,
+            .tls_crypt_v2_server_key = ctx->server_keys.encrypt,
+            .tls_crypt_v2_cache = cache,
+        };
+        assert_true(tls_crypt_v2_extract_client_key(&wkc, &wrap_ctx, NULL));
+        assert_memory_equal(ctx->client_key2.keys,
+                            wrap_ctx.original_wrap_keydata.keys,
+                            sizeof(ctx->client_key2.keys));
+        assert_true(buf_equal(&ctx->metadata, &wrap_ctx.tls_crypt_v2_metadata));
+        tls_wrap_free(&wrap_ctx);
+    }
+    assert_int_equal(cache->misses, 1);
+    assert_int_equal(cache->hits, 1);
+
+    /* Corrupt the tag */
+    BPTR(&ctx->wkc)[0] ^= 0x01;
+    for (int i = 0; i < 2; i++)
+    {
+        struct buffer wkc = ctx->wkc;
+        struct tls_wrap_ctx wrap_ctx = {
+            .mode = TLS_WRAP_CRYPT,
+            .tls_crypt_v2_server_key = ctx->server_keys.encrypt,
+            .tls_crypt_v2_cache = cache,
+        };
+        assert_false(tls_crypt_v2_extract_client_key(&wkc, &wrap_ctx, NULL));
+        tls_wrap_free(&wrap_ctx);
+    }
+    assert_int_equal(cache->misses, 2);
+    assert_int_equal(cache->rejected, 1);
+    assert_int_equal(cache->hits, 1);
+
+    tls_crypt_v2_cache_free(cache);
+}
+
 /**
  * Check that wrapping a tls-crypt-v2 client key with too long metadata fails
  * as expected.
@@ -703,6 +759,9 @@ main(void)
         cmocka_unit_test_setup_teardown(tls_crypt_v2_wrap_unwrap_max_metadata,
                                         test_tls_crypt_v2_setup,
                                         test_tls_crypt_v2_teardown),
+        cmocka_unit_test_setup_teardown(tls_crypt_v2_extract_client_key_cached,
+                                        test_tls_crypt_v2_setup,
+                                        test_tls_crypt_v2_teardown),
         cmocka_unit_test_setup_teardown(tls_crypt_v2_wrap_too_long_metadata,
                                         test_tls_crypt_v2_setup,
                                         test_tls_crypt_v2_teardown),
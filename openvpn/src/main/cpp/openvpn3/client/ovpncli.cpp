@@ -92,12 +92,14 @@
 #include <openvpn/common/count.hpp>
 #include <openvpn/asio/asiostop.hpp>
 #include <openvpn/time/asiotimer.hpp>
+#include <openvpn/time/coalesce.hpp>
 #include <openvpn/client/cliconnect.hpp>
 #include <openvpn/client/cliopthelper.hpp>
 #include <openvpn/options/merge.hpp>
 #include <openvpn/error/excode.hpp>
 #include <openvpn/crypto/selftest.hpp>
 #include <openvpn/client/clievent.hpp>
+#include <openvpn/client/clistatspage.hpp>
 
 // copyright
 #include <openvpn/legal/copyright.hpp>
@@ -162,6 +164,20 @@ class MySessionStats : public SessionStats
         return errors[index];
     }
 
+    // milliseconds since the last packet was received, or -1 if undefined
+    int last_packet_received_ms() const
+    {
+        const Time &lpr = last_packet_received();
+        if (lpr.defined())
+        {
+            const Time::Duration dur = Time::now() - lpr;
+            const unsigned int delta = (unsigned int)dur.to_binary_ms();
+            if (delta <= 60 * 60 * 24 * 1024) // only define for time periods <= 1 day
+                return delta;
+        }
+        return -1;
+    }
+
     void detach_from_parent()
     {
         parent = nullptr;
@@ -221,6 +237,10 @@ class MyClientEvents : public ClientEvent::Queue
                     last_connected = std::move(event);
                 else if (event->id() == ClientEvent::DISCONNECTED)
                     parent->on_disconnect();
+                else if (event->id() == ClientEvent::PAUSE)
+                    parent->on_pause(true);
+                else if (event->id() == ClientEvent::RESUME)
+                    parent->on_pause(false);
 
                 parent->event(ev);
             }
@@ -393,12 +413,16 @@ class MyRemoteOverride : public RemoteList::RemoteOverride
 class MyClockTick
 {
   public:
+    typedef void (OpenVPNClient::*Action)();
+
     MyClockTick(openvpn_io::io_context &io_context,
                 OpenVPNClient *parent_arg,
-                const unsigned int ms)
+                const unsigned int ms,
+                const Action action_arg = &OpenVPNClient::clock_tick)
         : timer(io_context),
           parent(parent_arg),
-          period(Time::Duration::milliseconds(ms))
+          period(Time::Duration::milliseconds(ms)),
+          action(action_arg)
     {
     }
 
@@ -412,15 +436,25 @@ class MyClockTick
         parent = nullptr;
     }
 
+    void set_coalesce(TimerCoalesce::Ptr coalesce_arg)
+    {
+        coalesce = std::move(coalesce_arg);
+    }
+
     void schedule()
     {
-        timer.expires_after(period);
+        if (coalesce)
+            timer.expires_at(coalesce->align_after(period, Time::now()));
+        else
+            timer.expires_after(period);
         timer.async_wait([this](const openvpn_io::error_code &error)
                          {
 			   if (!parent || error)
 			     return;
+			   if (coalesce)
+			     coalesce->wakeup(Time::now());
 			   try {
-			     parent->clock_tick();
+			     (parent->*action)();
 			   }
 			   catch (...)
 			     {
@@ -432,6 +466,8 @@ class MyClockTick
     AsioTimer timer;
     OpenVPNClient *parent;
     const Time::Duration period;
+    const Action action;
+    TimerCoalesce::Ptr coalesce;
 };
 
 namespace Private {
@@ -449,6 +485,8 @@ class ClientState
     MyClientEvents::Ptr events;
     ClientConnect::Ptr session;
     std::unique_ptr<MyClockTick> clock_tick;
+    std::unique_ptr<ClientStatsPage> stats_page;
+    std::unique_ptr<MyClockTick> stats_page_tick;
 
     // extra settings submitted by API client
     ClientConfigParsed clientconf;
@@ -516,6 +554,8 @@ class ClientState
         remote_override.detach_from_parent();
         if (clock_tick)
             clock_tick->detach_from_parent();
+        if (stats_page_tick)
+            stats_page_tick->detach_from_parent();
         if (stats)
             stats->detach_from_parent();
         if (events)
@@ -566,6 +606,23 @@ class ClientState
     {
         if (clock_tick)
             clock_tick->cancel();
+        if (stats_page_tick)
+            stats_page_tick->cancel();
+    }
+
+    // pause/resume
+    void on_pause(const bool paused)
+    {
+        // The stats do not change while paused, so the stats page
+        // needs no wakeups until the session resumes.  The clock tick
+        // keeps running, as clients may use it to resume.
+        if (stats_page_tick)
+        {
+            if (paused)
+                stats_page_tick->cancel();
+            else
+                stats_page_tick->schedule();
+        }
     }
 
     void setup_async_stop_scopes()
@@ -1025,9 +1082,19 @@ OPENVPN_CLIENT_EXPORT void OpenVPNClient::connect_setup(Status &status, bool &se
     if (state->clientconf.clockTickMS)
     {
         state->clock_tick.reset(new MyClockTick(*state->io_context(), this, state->clientconf.clockTickMS));
+        state->clock_tick->set_coalesce(client_options->timer_coalesce());
         state->clock_tick->schedule();
     }
 
+    // shared memory stats page
+    if (state->clientconf.statsPageMS)
+    {
+        state->stats_page.reset(new ClientStatsPage(MySessionStats::combined_n(), state->clientconf.statsPageMS));
+        state->stats_page_tick.reset(new MyClockTick(*state->io_context(), this, state->clientconf.statsPageMS, &OpenVPNClient::update_stats_page));
+        state->stats_page_tick->set_coalesce(client_options->timer_coalesce());
+        state->stats_page_tick->schedule();
+    }
+
     // start VPN
     state->session->start(); // queue reads on socket/tun
     session_started = true;
@@ -1258,18 +1325,7 @@ OPENVPN_CLIENT_EXPORT TransportStats OpenVPNClient::transport_stats() const
             ret.bytesIn = stats->stat_count(SessionStats::BYTES_IN);
             ret.packetsOut = stats->stat_count(SessionStats::PACKETS_OUT);
             ret.packetsIn = stats->stat_count(SessionStats::PACKETS_IN);
-
-            // calculate time since last packet received
-            {
-                const Time &lpr = stats->last_packet_received();
-                if (lpr.defined())
-                {
-                    const Time::Duration dur = Time::now() - lpr;
-                    const unsigned int delta = (unsigned int)dur.to_binary_ms();
-                    if (delta <= 60 * 60 * 24 * 1024) // only define for time periods <= 1 day
-                        ret.lastPacketReceived = delta;
-                }
-            }
+            ret.lastPacketReceived = stats->last_packet_received_ms();
             return ret;
         }
     }
@@ -1281,6 +1337,29 @@ OPENVPN_CLIENT_EXPORT TransportStats OpenVPNClient::transport_stats() const
     return ret;
 }
 
+OPENVPN_CLIENT_EXPORT StatsPageBuffer OpenVPNClient::stats_page() const
+{
+    StatsPageBuffer ret;
+    if (state->is_foreign_thread_access() && state->stats_page)
+    {
+        ret.data = state->stats_page->data();
+        ret.size = state->stats_page->size();
+    }
+    return ret;
+}
+
+OPENVPN_CLIENT_EXPORT void OpenVPNClient::update_stats_page()
+{
+    MySessionStats *stats = state->stats.get();
+    if (stats && state->stats_page)
+    {
+        stats->dco_update();
+        state->stats_page->publish([stats](const size_t i)
+                                   { return stats->combined_value(i); },
+                                   stats->last_packet_received_ms());
+    }
+}
+
 OPENVPN_CLIENT_EXPORT void OpenVPNClient::stop()
 {
     if (state->is_foreign_thread_access())
@@ -1317,6 +1396,16 @@ OPENVPN_CLIENT_EXPORT void OpenVPNClient::reconnect(int seconds)
     }
 }
 
+OPENVPN_CLIENT_EXPORT void OpenVPNClient::migrate_transport(int seconds)
+{
+    if (state->is_foreign_thread_access())
+    {
+        ClientConnect *session = state->session.get();
+        if (session)
+            session->thread_safe_migrate_transport(seconds);
+    }
+}
+
 OPENVPN_CLIENT_EXPORT void OpenVPNClient::post_cc_msg(const std::string &msg)
 {
     if (state->is_foreign_thread_access())
@@ -1423,9 +1512,18 @@ OPENVPN_CLIENT_EXPORT void OpenVPNClient::clock_tick()
 
 OPENVPN_CLIENT_EXPORT void OpenVPNClient::on_disconnect()
 {
+    // leave the final counts in the stats page
+    update_stats_page();
     state->on_disconnect();
 }
 
+OPENVPN_CLIENT_EXPORT void OpenVPNClient::on_pause(const bool paused)
+{
+    if (paused)
+        update_stats_page();
+    state->on_pause(paused);
+}
+
 OPENVPN_CLIENT_EXPORT std::string OpenVPNClientHelper::crypto_self_test()
 {
     return SelfTest::crypto_self_test();
@@ -215,6 +215,12 @@ struct ConfigCommon
     // Keep tun interface active during pauses or reconnections
     bool tunPersist = false;
 
+    // With tunPersist, when a reconnect changes only routes, DNS servers,
+    // search domains or the remote address, hand just the changes to the
+    // tun builder (tun_builder_reconfigure_begin()) instead of building
+    // a new tun interface.
+    bool tunReconfigure = false;
+
     // If true and a redirect-gateway profile doesn't also define
     // DNS servers, use the standard Google DNS servers.
     bool googleDnsFallback = false;
@@ -284,6 +290,15 @@ struct ConfigCommon
     std::string proxyPassword;            // proxy credentials (optional)
     bool proxyAllowCleartextAuth = false; // enables HTTP Basic auth
 
+    // While connected through the HTTP proxy, keep a spare tunnel through
+    // it open and idle, and remember the proxy credentials, so that a
+    // reconnect can skip the proxy handshake.  Applies to a proxy set in
+    // the profile as well.  The spare tunnel is replaced every 45 seconds,
+    // before the server's --hand-window runs out, so the server sees one
+    // more pending connection per client and about 80 connects per hour.
+    // These count against its --connect-freq and --max-pending-handshakes.
+    bool proxyPreconnect = false;
+
     // Custom proxy implementation
     bool altProxy = false;
 
@@ -316,6 +331,19 @@ struct ConfigCommon
     // Set to 0 to disable.
     unsigned int clockTickMS = 0;
 
+    // Keep the stats returned by stats_bundle() and transport_stats()
+    // in a shared memory page, updated every statsPageMS milliseconds
+    // by the thread executing connect().  See stats_page().
+    // Set to 0 to disable.
+    unsigned int statsPageMS = 0;
+
+    // Delay timer deadlines by up to timerSlackMS milliseconds, so that
+    // the housekeeping, keepalive and clock tick timers of an idle
+    // session fire together in fewer wakeups.  Short timers such as
+    // retransmits get proportionally less slack.
+    // Set to 0 to disable.
+    unsigned int timerSlackMS = 0;
+
     // Gremlin configuration (requires that the core is built with OPENVPN_GREMLIN)
     std::string gremlinConfig;
 
@@ -481,6 +509,13 @@ struct TransportStats
     int lastPacketReceived;
 };
 
+// Memory of the shared stats page, see OpenVPNClient::stats_page()
+struct StatsPageBuffer
+{
+    void *data = nullptr;
+    size_t size = 0;
+};
+
 // return value of merge_config methods
 struct MergeConfig
 {
@@ -661,6 +696,13 @@ class OpenVPNClient : public TunBuilderBase,             // expose tun builder v
     // from a different thread when connect() is running.
     void reconnect(int seconds);
 
+    // Move a connected UDP session to the current network after a
+    // network change, keeping its keys and peer-id.  Falls back to
+    // reconnect(seconds) if the session cannot be migrated, e.g. over
+    // TCP or if the server did not push a peer-id.  May be called from
+    // a different thread when connect() is running.
+    void migrate_transport(int seconds);
+
     // When a connection is close to timeout, the core will call this
     // method.  If it returns false, the core will disconnect with a
     // CONNECTION_TIMEOUT event.  If true, the core will enter a PAUSE
@@ -688,6 +730,13 @@ class OpenVPNClient : public TunBuilderBase,             // expose tun builder v
     // return transport stats only
     TransportStats transport_stats() const;
 
+    // return the shared stats page, or an empty buffer if Config::statsPageMS
+    // is 0 or connect() has not started the session yet.  The page stays
+    // valid until this object is destroyed.  Its layout is described in
+    // openvpn/client/clistatspage.hpp; the SWIG Java wrapper returns it as
+    // a direct java.nio.ByteBuffer.
+    StatsPageBuffer stats_page() const;
+
     // post control channel message
     void post_cc_msg(const std::string &msg);
 
@@ -772,6 +821,8 @@ class OpenVPNClient : public TunBuilderBase,             // expose tun builder v
 
     friend class MyClientEvents;
     void on_disconnect();
+    void on_pause(const bool paused);
+    void update_stats_page();
 
     // from ExternalPKIBase
     bool sign(const std::string &alias,
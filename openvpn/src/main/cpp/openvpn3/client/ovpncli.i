@@ -48,6 +48,20 @@
 %rename(ClientAPI_ExternalPKISignRequest) ExternalPKISignRequest;
 %rename(ClientAPI_RemoteOverride) RemoteOverride;
 
+#ifdef SWIGJAVA
+// return the shared stats page as a direct ByteBuffer over the same memory
+%ignore openvpn::ClientAPI::StatsPageBuffer;
+%typemap(jni) openvpn::ClientAPI::StatsPageBuffer "jobject"
+%typemap(jtype) openvpn::ClientAPI::StatsPageBuffer "java.nio.ByteBuffer"
+%typemap(jstype) openvpn::ClientAPI::StatsPageBuffer "java.nio.ByteBuffer"
+%typemap(javaout) openvpn::ClientAPI::StatsPageBuffer {
+    return $jnicall;
+  }
+%typemap(out) openvpn::ClientAPI::StatsPageBuffer %{
+  $result = $1.data ? jenv->NewDirectByteBuffer($1.data, (jlong)$1.size) : nullptr;
+%}
+#endif
+
 // declare vectors
 namespace std {
   %template(ClientAPI_ServerEntryVector) vector<openvpn::ClientAPI::ServerEntry>;
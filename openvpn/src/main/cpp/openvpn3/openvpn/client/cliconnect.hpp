@@ -225,6 +225,18 @@ class ClientConnect : ClientProto::NotifyCallback,
         }
     }
 
+    // Migrate the transport of the session to the current network, or
+    // reconnect if that is not possible.
+    void migrate_transport(int seconds)
+    {
+        if (!halt)
+        {
+            if (client && !paused && client->migrate_transport())
+                return;
+            reconnect(seconds);
+        }
+    }
+
     void thread_safe_pause(const std::string &reason)
     {
         if (!halt)
@@ -252,6 +264,15 @@ class ClientConnect : ClientProto::NotifyCallback,
 		     self->reconnect(seconds); });
     }
 
+    void thread_safe_migrate_transport(int seconds)
+    {
+        if (!halt)
+            openvpn_io::post(io_context, [self = Ptr(this), seconds]()
+                             {
+		     OPENVPN_ASYNC_HANDLER;
+		     self->migrate_transport(seconds); });
+    }
+
     void dont_restart()
     {
         dont_restart_ = true;
@@ -63,6 +63,7 @@ enum Type
     PAUSE,
     RESUME,
     RELAY,
+    TRANSPORT_MIGRATED,
     COMPRESSION_ENABLED,
     UNSUPPORTED_FEATURE,
 
@@ -126,6 +127,7 @@ inline const char *event_name(const Type type)
         "PAUSE",
         "RESUME",
         "RELAY",
+        "TRANSPORT_MIGRATED",
         "COMPRESSION_ENABLED",
         "UNSUPPORTED_FEATURE",
 
@@ -524,6 +526,14 @@ struct Pause : public ReasonBase
     }
 };
 
+struct TransportMigrated : public ReasonBase
+{
+    TransportMigrated(std::string reason)
+        : ReasonBase(TRANSPORT_MIGRATED, std::move(reason))
+    {
+    }
+};
+
 struct ProxyError : public ReasonBase
 {
     ProxyError(std::string reason)
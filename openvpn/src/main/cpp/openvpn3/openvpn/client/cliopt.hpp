@@ -214,6 +214,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
           cli_events(config.cli_events),
           server_poll_timeout_(10),
           tcp_queue_limit(64),
+          tcp_send_gather(65536),
+          tcp_recv_batch(65536),
           proto_context_options(config.proto_context_options),
           http_proxy_options(config.http_proxy_options),
           autologin(false),
@@ -241,6 +243,9 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         rng.reset(new SSLLib::RandomAPI());
         prng.reset(new MTRand(time(nullptr)));
 
+        // timer coalescing
+        timer_coalesce_.reset(new TimerCoalesce(Time::Duration::milliseconds(clientconf.timerSlackMS), cli_stats));
+
         // frame
         // get tun-mtu and tun-mtu-max parameter from config
         const unsigned int tun_mtu = parse_tun_mtu(opt, 0);
@@ -252,6 +257,12 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         // TCP queue limit
         tcp_queue_limit = opt.get_num<decltype(tcp_queue_limit)>("tcp-queue-limit", 1, tcp_queue_limit, 1, 65536);
 
+        // max bytes of queued packets per TCP send, 0 to send one packet at a time
+        tcp_send_gather = opt.get_num<decltype(tcp_send_gather)>("tcp-send-gather", 1, tcp_send_gather, 0, 1048576);
+
+        // max bytes per TCP read, 0 to read one frame at a time
+        tcp_recv_batch = opt.get_num<decltype(tcp_recv_batch)>("tcp-recv-batch", 1, tcp_recv_batch, 0, 1048576);
+
         // route-nopull
         pushed_options_filter.reset(new PushedOptionsFilter(opt));
 
@@ -282,6 +293,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         // If HTTP proxy parameters are not supplied by API, try to get them from config
         if (!http_proxy_options)
             http_proxy_options = HTTPProxyTransport::Options::parse(opt);
+        if (http_proxy_options && clientconf.proxyPreconnect)
+            http_proxy_preconnect.reset(new HTTPProxyTransport::PreConnect());
 
         // load remote list
         if (config.remote_override)
@@ -433,6 +446,7 @@ class ClientOptions : public RC<thread_unsafe_refcount>
 #endif
                 if (config.clientconf.tunPersist)
                     tunconf->tun_persist.reset(new TunBuilderClient::TunPersist(true, tunconf->retain_sd ? TunWrapObjRetain::RETAIN : TunWrapObjRetain::NO_RETAIN, config.builder));
+                tunconf->tun_reconfigure = config.clientconf.tunReconfigure;
                 tun_factory = tunconf;
             }
 #elif defined(OPENVPN_PLATFORM_LINUX) && !defined(OPENVPN_FORCE_TUN_NULL)
@@ -1165,6 +1179,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
         cli_config->cli_stats = cli_stats;
         cli_config->cli_events = cli_events;
         cli_config->creds = creds;
+        cli_config->timer_coalesce = timer_coalesce_;
+        cli_config->transport_migration = !dco; // dco owns the socket
         cli_config->pushed_options_filter = pushed_options_filter;
         cli_config->tcp_queue_limit = tcp_queue_limit;
         cli_config->echo = clientconf.echo;
@@ -1227,6 +1243,10 @@ class ClientOptions : public RC<thread_unsafe_refcount>
     {
         return cli_stats;
     }
+    const TimerCoalesce::Ptr &timer_coalesce() const
+    {
+        return timer_coalesce_;
+    }
     ClientEvent::Queue &events()
     {
         return *cli_events;
@@ -1273,6 +1293,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
     {
         if (tun_factory)
             tun_factory->finalize(disconnected);
+        if (disconnected && http_proxy_preconnect)
+            http_proxy_preconnect->stop();
     }
 
   private:
@@ -1398,7 +1420,9 @@ class ClientOptions : public RC<thread_unsafe_refcount>
             httpconf->stats = cli_stats;
             httpconf->digest_factory.reset(new CryptoDigestFactory<SSLLib::CryptoAPI>(cp_main->ssl_factory->libctx()));
             httpconf->socket_protect = socket_protect;
+            httpconf->send_gather_max_size = tcp_send_gather;
             httpconf->http_proxy_options = http_proxy_options;
+            httpconf->preconnect = http_proxy_preconnect;
             httpconf->rng = rng;
 #ifdef PRIVATE_TUNNEL_PROXY
             httpconf->skip_html = true;
@@ -1433,6 +1457,8 @@ class ClientOptions : public RC<thread_unsafe_refcount>
                 tcpconf->frame = frame;
                 tcpconf->stats = cli_stats;
                 tcpconf->socket_protect = socket_protect;
+                tcpconf->send_gather_max_size = tcp_send_gather;
+                tcpconf->recv_batch_size = tcp_recv_batch;
 #ifdef OPENVPN_TLS_LINK
                 if (transport_protocol.is_tls())
                     tcpconf->use_tls = true;
@@ -1468,10 +1494,14 @@ class ClientOptions : public RC<thread_unsafe_refcount>
     SessionStats::Ptr cli_stats;
     ClientEvent::Queue::Ptr cli_events;
     ClientCreds::Ptr creds;
+    TimerCoalesce::Ptr timer_coalesce_;
     unsigned int server_poll_timeout_;
     unsigned int tcp_queue_limit;
+    unsigned int tcp_send_gather;
+    unsigned int tcp_recv_batch;
     ProtoContextCompressionOptions::Ptr proto_context_options;
     HTTPProxyTransport::Options::Ptr http_proxy_options;
+    HTTPProxyTransport::PreConnect::Ptr http_proxy_preconnect;
 #ifdef OPENVPN_GREMLIN
     Gremlin::Config::Ptr gremlin_config;
 #endif
@@ -64,6 +64,7 @@
 #include <openvpn/client/optfilt.hpp>
 #include <openvpn/time/asiotimer.hpp>
 #include <openvpn/time/coarsetime.hpp>
+#include <openvpn/time/coalesce.hpp>
 #include <openvpn/time/durhelper.hpp>
 #include <openvpn/error/excode.hpp>
 
@@ -139,12 +140,14 @@ class Session : ProtoContextCallbackInterface,
         SessionStats::Ptr cli_stats;
         ClientEvent::Queue::Ptr cli_events;
         ClientCreds::Ptr creds;
+        TimerCoalesce::Ptr timer_coalesce;
         OptionList::Limits pushed_options_limit;
         OptionList::FilterBase::Ptr pushed_options_filter;
         unsigned int tcp_queue_limit = 0;
         bool echo = false;
         bool info = false;
         bool autologin_sessions = false;
+        bool transport_migration = false;
     };
 
     Session(openvpn_io::io_context &io_context_arg,
@@ -163,11 +166,14 @@ class Session : ProtoContextCallbackInterface,
           proto_context_options(config.proto_context_options),
           cli_stats(config.cli_stats),
           cli_events(config.cli_events),
+          timer_coalesce(config.timer_coalesce),
           echo(config.echo),
           info(config.info),
           pushed_options_limit(config.pushed_options_limit),
           pushed_options_filter(config.pushed_options_filter),
           inactive_timer(io_context_arg),
+          transport_migration(config.transport_migration),
+          migrate_timer(io_context_arg),
           info_hold_timer(io_context_arg)
     {
 #ifdef OPENVPN_PACKET_LOG
@@ -224,6 +230,33 @@ class Session : ProtoContextCallbackInterface,
             proto_context.send_explicit_exit_notify();
     }
 
+    // Replace the UDP transport with a new one, e.g. after the network
+    // changed, but keep the keys and the peer-id of the session.  The
+    // first packet sent by the new transport is a keepalive, so that the
+    // server floats the session to our new address.  Returns false if
+    // the session cannot be migrated and must be restarted instead.
+    bool migrate_transport()
+    {
+        if (halt
+            || !connected_
+            || !transport_migration
+            || !transport
+            || transport_factory->is_relay()
+            || !transport->transport_protocol().is_udp()
+            || !proto_context.conf().enable_op32 // the server needs the peer-id to float
+            || !proto_context.data_channel_ready())
+            return false;
+
+        OPENVPN_LOG("Migrating transport from " << server_endpoint_render());
+        transport->stop();
+        migrating = true;
+        migrate_pending = false;
+        transport = transport_factory->new_transport_client_obj(io_context, this);
+        transport_has_send_queue = transport->transport_has_send_queue();
+        transport->transport_start();
+        return true;
+    }
+
     void tun_set_disconnect()
     {
         if (tun)
@@ -264,6 +297,7 @@ class Session : ProtoContextCallbackInterface,
             inactive_timer.cancel();
 
             info_hold_timer.cancel();
+            migrate_timer.cancel();
             if (notify_callback && call_terminate_callback)
                 notify_callback->client_proto_terminate();
             if (tun)
@@ -345,6 +379,10 @@ class Session : ProtoContextCallbackInterface,
             // update last packet received
             proto_context.stat().update_last_packet_received(proto_context.now());
 
+            // the server answers on the migrated transport
+            if (migrate_pending)
+                migrate_done();
+
             // log connecting event (only on first packet received)
             if (!first_packet_received_)
             {
@@ -495,6 +533,8 @@ class Session : ProtoContextCallbackInterface,
 
     void transport_pre_resolve() override
     {
+        if (migrating)
+            return;
         ClientEvent::Base::Ptr ev = new ClientEvent::Resolve();
         cli_events->add_event(std::move(ev));
     }
@@ -516,6 +556,8 @@ class Session : ProtoContextCallbackInterface,
 
     void transport_wait() override
     {
+        if (migrating)
+            return;
         ClientEvent::Base::Ptr ev = new ClientEvent::Wait();
         cli_events->add_event(std::move(ev));
     }
@@ -524,6 +566,11 @@ class Session : ProtoContextCallbackInterface,
     {
         try
         {
+            if (migrating)
+            {
+                migrate_probe();
+                return;
+            }
             proto_context.conf().build_connect_time_peer_info_string(transport);
             OPENVPN_LOG("Connecting to " << server_endpoint_render());
             proto_context.set_protocol(transport->transport_protocol());
@@ -1367,6 +1414,8 @@ class Session : ProtoContextCallbackInterface,
             {
                 // update current time
                 proto_context.update_now();
+                if (timer_coalesce)
+                    timer_coalesce->wakeup(proto_context.now());
 
                 housekeeping_schedule.reset();
                 proto_context.housekeeping();
@@ -1395,6 +1444,8 @@ class Session : ProtoContextCallbackInterface,
             return;
 
         Time next = proto_context.next_housekeeping();
+        if (timer_coalesce)
+            next = timer_coalesce->align(next, proto_context.now());
         if (!housekeeping_schedule.similar(next))
         {
             if (!next.is_infinite())
@@ -1454,13 +1505,60 @@ class Session : ProtoContextCallbackInterface,
 
     void schedule_inactive_timer()
     {
-        inactive_timer.expires_after(inactive_duration);
+        if (timer_coalesce)
+            inactive_timer.expires_at(timer_coalesce->align_after(inactive_duration, Time::now()));
+        else
+            inactive_timer.expires_after(inactive_duration);
         inactive_timer.async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
                                   {
                                     OPENVPN_ASYNC_HANDLER;
                                     self->inactive_callback(error); });
     }
 
+    // the migrated transport is up, send the probe
+    void migrate_probe()
+    {
+        migrating = false;
+        migrate_pending = true;
+        OPENVPN_LOG("Migrated transport to " << server_endpoint_render());
+        proto_context.update_now();
+        proto_context.send_keepalive();
+        proto_context.flush(false);
+        set_housekeeping_timer();
+
+        // The server answers with its next keepalive at the latest.  If
+        // keepalives are disabled, the keepalive timeout of the session
+        // is all we have.
+        const Time::Duration &ping = proto_context.conf().keepalive_ping;
+        if (ping.enabled())
+        {
+            migrate_timer.expires_after(ping * 2 + Time::Duration::seconds(2));
+            migrate_timer.async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
+                                     {
+                                        OPENVPN_ASYNC_HANDLER;
+                                        self->migrate_callback(error); });
+        }
+    }
+
+    void migrate_done()
+    {
+        migrate_pending = false;
+        migrate_timer.cancel();
+        ClientEvent::Base::Ptr ev = new ClientEvent::TransportMigrated(server_endpoint_render());
+        cli_events->add_event(std::move(ev));
+    }
+
+    void migrate_callback(const openvpn_io::error_code &e)
+    {
+        if (!e && !halt && migrate_pending)
+        {
+            if (timer_coalesce)
+                timer_coalesce->wakeup(Time::now());
+            migrate_pending = false;
+            transport_error(Error::UNDEF, "no reply from server after transport migration");
+        }
+    }
+
     void reset_inactive_timer(const count_t bytes_count)
     {
         // Ensure that it's called within the io_context in case it needs to be invoked from a separate thread.
@@ -1483,6 +1581,8 @@ class Session : ProtoContextCallbackInterface,
         {
             if (!e && !halt)
             {
+                if (timer_coalesce)
+                    timer_coalesce->wakeup(Time::now());
                 fatal_ = Error::INACTIVE_TIMEOUT;
                 send_explicit_exit_notify();
                 if (notify_callback)
@@ -1623,6 +1723,7 @@ class Session : ProtoContextCallbackInterface,
 
     SessionStats::Ptr cli_stats;
     ClientEvent::Queue::Ptr cli_events;
+    TimerCoalesce::Ptr timer_coalesce;
 
     ClientEvent::Connected::Ptr connected_;
 
@@ -1644,6 +1745,11 @@ class Session : ProtoContextCallbackInterface,
     std::shared_ptr<SessionStats::inc_callback_t> out_tun_callback_;
     std::shared_ptr<SessionStats::inc_callback_t> in_tun_callback_;
 
+    bool transport_migration;
+    bool migrating = false;
+    bool migrate_pending = false;
+    AsioTimer migrate_timer;
+
     std::unique_ptr<std::vector<ClientEvent::Base::Ptr>> info_hold;
     AsioTimer info_hold_timer;
 
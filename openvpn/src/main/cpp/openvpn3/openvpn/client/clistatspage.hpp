@@ -0,0 +1,206 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2012 - 2024 OpenVPN Inc.
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Affero General Public License Version 3
+//    as published by the Free Software Foundation.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public License
+//    along with this program in the COPYING file.
+//    If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef OPENVPN_CLIENT_CLISTATSPAGE_H
+#define OPENVPN_CLIENT_CLISTATSPAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <openvpn/common/platform.hpp>
+#include <openvpn/common/exception.hpp>
+
+#ifndef OPENVPN_PLATFORM_WIN
+#include <sys/mman.h>
+#endif
+
+namespace openvpn {
+
+// A memory region that the client thread keeps up to date with the
+// session stats, so that the UI can read them without calling into the
+// core.  The stats are published under a sequence lock: the writer makes
+// the sequence number odd, stores the values and makes it even again.
+// A reader copies the values and retries if the sequence number was odd
+// or changed in the meantime.
+//
+// All fields are in native byte order.  Layout of version 1:
+//
+//    offset  size  field
+//    0       4     magic, MAGIC
+//    4       2     version, VERSION
+//    6       2     header size in bytes, offset of the first value
+//    8       4     sequence number
+//    12      4     number of values
+//    16      8     milliseconds since the last packet was received,
+//                  at the time of the last update, or -1 if undefined
+//    24      4     update period in milliseconds
+//    28      4     reserved, zero
+//    32      8*n   values, in the order of OpenVPNClient::stats_name()
+//
+// Later versions only append fields to the header or values to the end,
+// so a reader may accept any version >= 1 as long as it uses the header
+// size and the number of values from the page.
+class ClientStatsPage
+{
+  public:
+    OPENVPN_EXCEPTION(client_stats_page_error);
+
+    enum : std::uint32_t
+    {
+        MAGIC = 0x5053564f, // "OVSP" in little endian
+        VERSION = 1,
+    };
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t header_size;
+        std::atomic<std::uint32_t> seq;
+        std::uint32_t n_values;
+        std::atomic<std::int64_t> last_packet_received;
+        std::uint32_t period_ms;
+        std::uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32, "unexpected stats page header size");
+    static_assert(sizeof(std::atomic<std::int64_t>) == sizeof(std::int64_t),
+                  "stats page values must be plain 64-bit words");
+
+    ClientStatsPage(const std::size_t n_values, const unsigned int period_ms)
+        : size_(sizeof(Header) + n_values * sizeof(std::int64_t))
+    {
+#ifdef OPENVPN_PLATFORM_WIN
+        void *p = std::calloc(1, size_);
+        if (!p)
+            throw client_stats_page_error("cannot allocate stats page");
+#else
+        // anonymous shared mapping, page aligned and zeroed
+        void *p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw client_stats_page_error("cannot map stats page");
+#endif
+        data_ = p;
+
+        Header *h = new (p) Header;
+        h->magic = MAGIC;
+        h->version = VERSION;
+        h->header_size = sizeof(Header);
+        h->seq.store(0, std::memory_order_relaxed);
+        h->n_values = static_cast<std::uint32_t>(n_values);
+        h->last_packet_received.store(-1, std::memory_order_relaxed);
+        h->period_ms = period_ms;
+        h->reserved = 0;
+        for (std::size_t i = 0; i < n_values; ++i)
+            new (&values()[i]) std::atomic<std::int64_t>(0);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    ~ClientStatsPage()
+    {
+#ifdef OPENVPN_PLATFORM_WIN
+        std::free(data_);
+#else
+        ::munmap(data_, size_);
+#endif
+    }
+
+    void *data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    std::size_t n_values() const
+    {
+        return header()->n_values;
+    }
+
+    // Store a new set of values.  Must only be called by one thread.
+    // value(i) is called for every index, last_packet_received is in
+    // milliseconds or -1.
+    template <typename GET_VALUE>
+    void publish(GET_VALUE value, const std::int64_t last_packet_received)
+    {
+        Header *h = header();
+        const std::uint32_t seq = h->seq.load(std::memory_order_relaxed);
+
+        h->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::atomic<std::int64_t> *v = values();
+        for (std::size_t i = 0; i < h->n_values; ++i)
+            v[i].store(static_cast<std::int64_t>(value(i)), std::memory_order_relaxed);
+        h->last_packet_received.store(last_packet_received, std::memory_order_relaxed);
+
+        h->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copy a consistent set of values from the page at data, for readers
+    // in native code.  Returns the last_packet_received field.
+    static std::int64_t read(const void *data, std::vector<long long> &out)
+    {
+        const Header *h = static_cast<const Header *>(data);
+        const std::atomic<std::int64_t> *v = reinterpret_cast<const std::atomic<std::int64_t> *>(static_cast<const unsigned char *>(data) + h->header_size);
+        out.resize(h->n_values);
+        while (true)
+        {
+            const std::uint32_t seq = h->seq.load(std::memory_order_acquire);
+            if (seq & 1)
+                continue;
+            for (std::size_t i = 0; i < out.size(); ++i)
+                out[i] = v[i].load(std::memory_order_relaxed);
+            const std::int64_t lpr = h->last_packet_received.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (h->seq.load(std::memory_order_relaxed) == seq)
+                return lpr;
+        }
+    }
+
+  private:
+    ClientStatsPage(const ClientStatsPage &) = delete;
+    ClientStatsPage &operator=(const ClientStatsPage &) = delete;
+
+    Header *header() const
+    {
+        return static_cast<Header *>(data_);
+    }
+
+    std::atomic<std::int64_t> *values() const
+    {
+        return reinterpret_cast<std::atomic<std::int64_t> *>(static_cast<unsigned char *>(data_) + sizeof(Header));
+    }
+
+    const std::size_t size_;
+    void *data_ = nullptr;
+};
+
+} // namespace openvpn
+
+#endif
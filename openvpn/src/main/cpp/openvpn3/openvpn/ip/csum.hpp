@@ -24,13 +24,151 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 
 #include <openvpn/common/endian.hpp>
 #include <openvpn/common/socktypes.hpp>
 #include <openvpn/common/size.hpp>
 
+// Vectorized summing of the 32-bit aligned body of the buffer.
+// Define OPENVPN_IPCHECKSUM_NO_SIMD to force the portable scalar loop.
+#if !defined(OPENVPN_IPCHECKSUM_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPENVPN_IPCHECKSUM_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define OPENVPN_IPCHECKSUM_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OPENVPN_IPCHECKSUM_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 namespace openvpn::IPChecksum {
 
+namespace detail {
+
+// Below this size the SIMD setup cost outweighs the gain
+// (IPv4 headers, ICMP headers, TCP option rewrites).
+constexpr size_t SIMD_THRESHOLD = 64;
+
+// Each of the sum32_* functions returns the plain 64-bit sum of the
+// host-order 32-bit words in [buf, buf+len), where len is a multiple
+// of 4.  Since 2^16 == 1 (mod 2^16-1), folding this sum yields the
+// same ones'-complement result as summing 16-bit words.
+
+inline std::uint64_t sum32_scalar(const std::uint8_t *buf, size_t len)
+{
+    std::uint64_t acc = 0;
+    const std::uint8_t *end = buf + len;
+    while (buf < end)
+    {
+        std::uint32_t w;
+        std::memcpy(&w, buf, sizeof(w));
+        acc += w;
+        buf += 4;
+    }
+    return acc;
+}
+
+#ifdef OPENVPN_IPCHECKSUM_SSE2
+inline std::uint64_t sum32_sse2(const std::uint8_t *buf, size_t len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero;
+    __m128i acc1 = zero;
+    while (len >= 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+        buf += 16;
+        len -= 16;
+    }
+    std::uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), _mm_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + sum32_scalar(buf, len);
+}
+#endif
+
+#ifdef OPENVPN_IPCHECKSUM_AVX2
+__attribute__((target("avx2"))) inline std::uint64_t sum32_avx2(const std::uint8_t *buf, size_t len)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero;
+    __m256i acc1 = zero;
+    while (len >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+        buf += 32;
+        len -= 32;
+    }
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum32_sse2(buf, len);
+}
+
+inline bool have_avx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+#ifdef OPENVPN_IPCHECKSUM_NEON
+inline std::uint64_t sum32_neon(const std::uint8_t *buf, size_t len)
+{
+    uint64x2_t acc0 = vdupq_n_u64(0);
+    uint64x2_t acc1 = vdupq_n_u64(0);
+    while (len >= 32)
+    {
+        acc0 = vpadalq_u32(acc0, vreinterpretq_u32_u8(vld1q_u8(buf)));
+        acc1 = vpadalq_u32(acc1, vreinterpretq_u32_u8(vld1q_u8(buf + 16)));
+        buf += 32;
+        len -= 32;
+    }
+    if (len >= 16)
+    {
+        acc0 = vpadalq_u32(acc0, vreinterpretq_u32_u8(vld1q_u8(buf)));
+        buf += 16;
+        len -= 16;
+    }
+    const uint64x2_t acc = vaddq_u64(acc0, acc1);
+    return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1) + sum32_scalar(buf, len);
+}
+#endif
+
+// Sum the 32-bit words of buf with the best implementation
+// available on this CPU.
+inline std::uint64_t sum32(const std::uint8_t *buf, size_t len)
+{
+    if (len >= SIMD_THRESHOLD)
+    {
+#if defined(OPENVPN_IPCHECKSUM_AVX2)
+        if (have_avx2())
+            return sum32_avx2(buf, len);
+#endif
+#if defined(OPENVPN_IPCHECKSUM_SSE2)
+        return sum32_sse2(buf, len);
+#elif defined(OPENVPN_IPCHECKSUM_NEON)
+        return sum32_neon(buf, len);
+#endif
+    }
+    return sum32_scalar(buf, len);
+}
+
+inline std::uint32_t fold64(std::uint64_t sum)
+{
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    return static_cast<std::uint32_t>(sum);
+}
+} // namespace detail
+
 inline std::uint16_t fold(std::uint32_t sum)
 {
     sum = (sum >> 16) + (sum & 0xffff);
@@ -82,17 +220,9 @@ inline std::uint32_t compute(const std::uint8_t *buf, size_t len)
         }
         if (len >= 4)
         {
-            const uint8_t *end = buf + (len & ~3);
-            std::uint32_t carry = 0;
-            do
-            {
-                std::uint32_t w = *(std::uint32_t *)buf;
-                buf += 4;
-                result += carry;
-                result += w;
-                carry = (w > result);
-            } while (buf < end);
-            result += carry;
+            const size_t body = len & ~size_t(3);
+            result = detail::fold64(result + detail::sum32(buf, body));
+            buf += body;
             result = (result & 0xffff) + (result >> 16);
         }
         if (len & 2)
@@ -169,4 +299,42 @@ inline std::uint16_t checksum(const void *data, const size_t size)
 {
     return cfold(compute(data, size));
 }
+
+/**
+ * @brief Incrementally update a checksum after one 16-bit word changed
+ *
+ * Implements eqn. 3 of RFC 1624, HC' = ~(~HC + ~m + m'), which
+ * never produces the -0 (0xffff) ambiguity of the older RFC 1141 method.
+ * All values are in network byte order, exactly as found in the packet.
+ *
+ * @param check   checksum field as currently stored in the header
+ * @param old     the 16-bit word before modification
+ * @param new_    the 16-bit word after modification
+ * @return        the checksum to store back into the header
+ */
+inline std::uint16_t update16(const std::uint16_t check,
+                              const std::uint16_t old,
+                              const std::uint16_t new_)
+{
+    const std::uint32_t sum = std::uint32_t(std::uint16_t(~check))
+                              + std::uint16_t(~old)
+                              + new_;
+    return cfold(sum);
+}
+
+/**
+ * @brief Incrementally update a checksum after one 32-bit word changed
+ *
+ * Same as update16() for a 32-bit aligned field such as an IPv4 address,
+ * processed as its two 16-bit halves.
+ */
+inline std::uint16_t update32(const std::uint16_t check,
+                              const std::uint32_t old,
+                              const std::uint32_t new_)
+{
+    const std::uint32_t sum = std::uint32_t(std::uint16_t(~check))
+                              + std::uint16_t(~old) + std::uint16_t(~(old >> 16))
+                              + std::uint16_t(new_) + std::uint16_t(new_ >> 16);
+    return cfold(sum);
+}
 } // namespace openvpn::IPChecksum
@@ -173,7 +173,7 @@ inline void generate_echo_reply(Buffer &buf,
     std::swap(icmp->head.saddr, icmp->head.daddr);
     const std::uint16_t old_type_code = icmp->type_code;
     icmp->type = ICMPv6::ECHO_REPLY;
-    icmp->checksum = IPChecksum::cfold(IPChecksum::diff2(old_type_code, icmp->type_code, IPChecksum::cunfold(icmp->checksum)));
+    icmp->checksum = IPChecksum::update16(icmp->checksum, old_type_code, icmp->type_code);
 
     if (log_info)
         *log_info = "ECHO6_REPLY size=" + std::to_string(buf.size()) + ' ' + IPv6::Addr::from_in6_addr(&icmp->head.saddr).to_string() + " -> " + IPv6::Addr::from_in6_addr(&icmp->head.daddr).to_string();
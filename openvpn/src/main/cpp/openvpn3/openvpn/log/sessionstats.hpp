@@ -51,6 +51,9 @@ class SessionStats : public RC<thread_safe_refcount>
         TUN_BYTES_OUT,   // tun/tap bytes out
         TUN_PACKETS_IN,  // tun/tap packets in
         TUN_PACKETS_OUT, // tun/tap packets out
+
+        // timer wakeups of the client, see TimerCoalesce
+        TIMER_WAKEUPS_PER_HOUR,
         N_STATS,
     };
 
@@ -98,6 +101,13 @@ class SessionStats : public RC<thread_safe_refcount>
         return stats_[type];
     }
 
+    // for stats that are gauges rather than counters
+    void set_stat(const size_t type, const count_t value)
+    {
+        if (type < N_STATS)
+            stats_[type] = value;
+    }
+
     static const char *stat_name(const size_t type)
     {
         static const char *names[] = {
@@ -109,6 +119,7 @@ class SessionStats : public RC<thread_safe_refcount>
             "TUN_BYTES_OUT",
             "TUN_PACKETS_IN",
             "TUN_PACKETS_OUT",
+            "TIMER_WAKEUPS_PER_HOUR",
         };
 
         if (type < N_STATS)
@@ -4159,6 +4159,17 @@ class ProtoContext : public logging::LoggingMixin<OPENVPN_DEBUG_PROTO,
         keepalive_xmit = *now_ + config->keepalive_ping;
     }
 
+    // Send a keepalive message now rather than when the keepalive
+    // timer expires, e.g. to show the peer our new address.
+    void send_keepalive()
+    {
+        if (primary)
+        {
+            primary->send_keepalive();
+            update_last_sent();
+        }
+    }
+
     // Can we call data_encrypt or data_decrypt yet?
     // Returns true if primary data channel is in ACTIVE state.
     bool data_channel_ready() const
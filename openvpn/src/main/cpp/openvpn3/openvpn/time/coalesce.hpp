@@ -0,0 +1,142 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2012 - 2024 OpenVPN Inc.
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Affero General Public License Version 3
+//    as published by the Free Software Foundation.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public License
+//    along with this program in the COPYING file.
+//    If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef OPENVPN_TIME_COALESCE_H
+#define OPENVPN_TIME_COALESCE_H
+
+#include <openvpn/common/rc.hpp>
+#include <openvpn/common/count.hpp>
+#include <openvpn/log/sessionstats.hpp>
+#include <openvpn/time/time.hpp>
+
+namespace openvpn {
+
+// Coalesces the wakeups of the timers of a client.
+//
+// Deadlines are delayed to the next point of a grid whose step is a
+// power of two in binary milliseconds.  The step is at most the slack,
+// and at most 1/8 of the time left until the deadline, so that short
+// timers such as control channel retransmits are barely delayed while
+// housekeeping, keepalive and clock tick deadlines that are close to
+// each other fire in the same wakeup of the event loop.  A deadline on
+// a coarse grid is also on every finer one, so timers with different
+// steps still line up.
+//
+// Timer handlers report their wakeups, which are published as the
+// TIMER_WAKEUPS_PER_HOUR stat.
+class TimerCoalesce : public RC<thread_unsafe_refcount>
+{
+  public:
+    typedef RCPtr<TimerCoalesce> Ptr;
+
+    TimerCoalesce(const Time::Duration &slack, SessionStats::Ptr stats_arg)
+        : stats(std::move(stats_arg))
+    {
+        const Time::type s = slack.raw();
+        while (step_max * 2 <= s)
+            step_max *= 2;
+        if (step_max < 2)
+            step_max = 0;
+    }
+
+    // return the coalesced deadline for t, which is never before t
+    Time align(const Time &t, const Time &now) const
+    {
+        if (!step_max || !t.defined() || t.is_infinite() || t <= now)
+            return t;
+
+        const Time::type delay = (t - now).raw();
+        Time::type step = step_max;
+        while (step > 1 && step > delay / 8)
+            step /= 2;
+        if (step < 2)
+            return t;
+
+        const Time::type rem = t.raw() & (step - 1);
+        return rem ? t + Time::Duration::binary_ms(step - rem) : t;
+    }
+
+    Time align_after(const Time::Duration &d, const Time &now) const
+    {
+        return align(now + d, now);
+    }
+
+    // Called by a timer handler.  Handlers that run within a few
+    // milliseconds of each other are counted as one wakeup.
+    void wakeup(const Time &now)
+    {
+        if (last_wakeup.defined() && now >= last_wakeup && now - last_wakeup < Time::Duration::binary_ms(8))
+            return;
+        last_wakeup = now;
+        ++wakeups;
+
+        if (!window_start.defined())
+        {
+            window_start = now;
+            window_base = wakeups;
+        }
+        const Time::Duration elapsed = now - window_start;
+        if (elapsed >= Time::Duration::seconds(3600))
+        {
+            // a full hour, start a new window
+            per_hour = wakeups - window_base;
+            window_base = wakeups;
+            window_start = now;
+            full_window = true;
+        }
+        else if (!full_window && elapsed >= Time::Duration::seconds(60))
+        {
+            // extrapolate until the first hour is over
+            per_hour = (wakeups - window_base) * 3600 / count_t(elapsed.to_seconds());
+        }
+        else
+            return;
+
+        if (stats)
+            stats->set_stat(SessionStats::TIMER_WAKEUPS_PER_HOUR, per_hour);
+    }
+
+    bool enabled() const
+    {
+        return step_max != 0;
+    }
+
+    count_t wakeup_count() const
+    {
+        return wakeups;
+    }
+
+  private:
+    SessionStats::Ptr stats;
+    Time::type step_max = 1;
+
+    Time last_wakeup;
+    count_t wakeups = 0;
+
+    Time window_start;
+    count_t window_base = 0;
+    count_t per_hour = 0;
+    bool full_window = false;
+};
+
+} // namespace openvpn
+
+#endif // OPENVPN_TIME_COALESCE_H
@@ -28,6 +28,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm> // for std::min
+#include <iomanip>
 #include <memory>
 
 #include <openvpn/io/io.hpp>
@@ -42,6 +43,7 @@
 #include <openvpn/common/userpass.hpp>
 #include <openvpn/buffer/bufstr.hpp>
 #include <openvpn/buffer/buflimit.hpp>
+#include <openvpn/time/asiotimer.hpp>
 #include <openvpn/transport/tcplink.hpp>
 #include <openvpn/transport/client/transbase.hpp>
 #include <openvpn/transport/socket_protect.hpp>
@@ -206,6 +208,165 @@ class Options : public RC<thread_safe_refcount>
     }
 };
 
+class ClientConfig;
+class Client;
+
+// Pre-connect mode.  While a session is up, keep one more tunnel
+// through the proxy open and idle, so that a reconnect after a drop can
+// take it over and send the OpenVPN reset right away, without the TCP
+// connect, CONNECT and authentication rounds.  Also remembers the Basic
+// or Digest challenge answered last, so that new CONNECT requests carry
+// credentials up front.  NTLM authenticates a connection rather than a
+// request, so it is not cached, but a warm tunnel still saves its rounds.
+//
+// The object outlives the ClientConfig of a single remote and must be
+// stopped when the client disconnects.
+class PreConnect : public TransportClientParent, public RC<thread_unsafe_refcount>
+{
+  public:
+    typedef RCPtr<PreConnect> Ptr;
+
+    // Called when a session has established its tunnel through the proxy.
+    void session_up(openvpn_io::io_context &io_context_arg, ClientConfig *config_arg);
+
+    // Called when the tunnel of the session is closed.  A tunnel that is
+    // already warm is kept for the next session.
+    void session_down();
+
+    // Return the warm tunnel for use by parent, if it leads to the current
+    // remote and is recent enough, else a null pointer.
+    TransportClient::Ptr take(const ClientConfig &current, TransportClientParent *parent);
+
+    void stop();
+
+    HTTPProxy::ProxyAuthenticate::Ptr auth() const
+    {
+        return auth_;
+    }
+
+    void set_auth(const HTTPProxy::ProxyAuthenticate::Ptr &pa)
+    {
+        if (pa != auth_)
+        {
+            auth_ = pa;
+            nonce_count = 1;
+        }
+    }
+
+    void clear_auth()
+    {
+        auth_.reset();
+    }
+
+    unsigned int next_nonce_count()
+    {
+        return ++nonce_count;
+    }
+
+    ~PreConnect();
+
+  private:
+    enum
+    {
+        RETRY_MIN = 5,   // seconds before the first tunnel is opened
+        RETRY_MAX = 300, // cap of the backoff after a tunnel failed
+        REFRESH = 45,    // age at which a ready tunnel is replaced, below
+                         // the 60 seconds of a default server --hand-window
+        TAKE_MAX = 15    // oldest tunnel handed to a session, which needs
+                         // most of the --hand-window for TLS and auth
+    };
+
+    void schedule(const Time::Duration &delay)
+    {
+        timer->expires_after(delay);
+        timer->async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
+                          {
+                              OPENVPN_ASYNC_HANDLER;
+                              if (!error)
+                                  self->open(); });
+    }
+
+    void schedule_refresh()
+    {
+        timer->expires_after(Time::Duration::seconds(REFRESH));
+        timer->async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
+                          {
+                              OPENVPN_ASYNC_HANDLER;
+                              if (!error)
+                                  self->refresh(); });
+    }
+
+    void open();
+    void refresh();
+    void lost(const std::string &reason);
+    void drop();
+
+    // TransportClientParent methods, called by the warm tunnel
+
+    void transport_recv(BufferAllocated &buf) override
+    {
+        lost("unexpected data");
+    }
+
+    void transport_needs_send() override
+    {
+    }
+
+    void transport_error(const Error::Type fatal_err, const std::string &err_text) override
+    {
+        lost(err_text);
+    }
+
+    void proxy_error(const Error::Type fatal_err, const std::string &err_text) override
+    {
+        lost(err_text);
+    }
+
+    bool transport_is_openvpn_protocol() override
+    {
+        return true;
+    }
+
+    void transport_pre_resolve() override
+    {
+    }
+
+    void transport_wait_proxy() override
+    {
+    }
+
+    void transport_wait() override
+    {
+    }
+
+    void transport_connecting() override;
+
+    bool is_keepalive_enabled() const override
+    {
+        return false;
+    }
+
+    void disable_keepalive(unsigned int &keepalive_ping,
+                           unsigned int &keepalive_timeout) override
+    {
+        keepalive_ping = 0;
+        keepalive_timeout = 0;
+    }
+
+    openvpn_io::io_context *io_context = nullptr;
+    std::unique_ptr<AsioTimer> timer;
+    RCPtr<ClientConfig> config; // of the session, used for the next tunnel
+    RCPtr<Client> client;       // the warm tunnel
+    bool ready = false;
+    bool active = false;
+    bool halt = false;
+    Time::Duration retry_delay = Time::Duration::seconds(RETRY_MIN);
+    Time ready_since;
+
+    HTTPProxy::ProxyAuthenticate::Ptr auth_;
+    unsigned int nonce_count = 0;
+};
+
 class ClientConfig : public TransportClientFactory
 {
   public:
@@ -213,6 +374,7 @@ class ClientConfig : public TransportClientFactory
 
     RemoteList::Ptr remote_list;
     size_t free_list_max_size;
+    size_t send_gather_max_size = 0;
     Frame::Ptr frame;
     SessionStats::Ptr stats;
 
@@ -226,6 +388,8 @@ class ClientConfig : public TransportClientFactory
 
     bool skip_html;
 
+    PreConnect::Ptr preconnect; // optional, persists across sessions
+
     static Ptr new_obj()
     {
         return new ClientConfig;
@@ -250,12 +414,22 @@ class Client : public TransportClient, AsyncResolvableTCP
     typedef TCPTransport::TCPLink<openvpn_io::ip::tcp, Client *, false> LinkImpl;
 
     friend class ClientConfig; // calls constructor
+    friend class PreConnect;   // calls constructor
     friend LinkImpl::Base;     // calls tcp_read_handler
 
   public:
     void transport_start() override
     {
-        if (!impl)
+        if (impl)
+        {
+            // tunnel was established in advance by PreConnect
+            if (proxy_established && !halt)
+            {
+                preconnect_session_up();
+                parent->transport_connecting();
+            }
+        }
+        else
         {
             if (!config->http_proxy_options)
             {
@@ -385,6 +559,7 @@ class Client : public TransportClient, AsyncResolvableTCP
            ClientConfig *config_arg,
            TransportClientParent *parent_arg)
         : AsyncResolvableTCP(io_context_arg),
+          io_context(io_context_arg),
           socket(io_context_arg),
           config(config_arg),
           parent(parent_arg),
@@ -393,7 +568,8 @@ class Client : public TransportClient, AsyncResolvableTCP
           proxy_established(false),
           http_reply_status(HTTP::ReplyParser::pending),
           ntlm_phase_2_response_pending(false),
-          drain_content_length(0)
+          drain_content_length(0),
+          proxy_auth_cached(false)
     {
     }
 
@@ -508,6 +684,8 @@ class Client : public TransportClient, AsyncResolvableTCP
                         // we are connected, switch socket to tunnel mode
                         if (http_reply.status_code == HTTP::Status::Connected)
                         {
+                            if (proxy_auth && config->preconnect)
+                                config->preconnect->set_auth(proxy_auth);
                             if (config->skip_html)
                             {
                                 proxy_half_connected();
@@ -546,6 +724,8 @@ class Client : public TransportClient, AsyncResolvableTCP
     void proxy_connected(BufferAllocated &buf, const bool notify_parent)
     {
         proxy_established = true;
+        if (notify_parent)
+            preconnect_session_up();
         if (parent->transport_is_openvpn_protocol())
         {
             // switch socket from HTTP proxy handshake mode to OpenVPN protocol mode
@@ -579,6 +759,7 @@ class Client : public TransportClient, AsyncResolvableTCP
     void proxy_half_connected()
     {
         proxy_established = true;
+        preconnect_session_up();
         if (parent->transport_is_openvpn_protocol())
             impl->set_raw_mode_write(false);
         parent->transport_connecting();
@@ -626,6 +807,13 @@ class Client : public TransportClient, AsyncResolvableTCP
         {
             if (http_reply.status_code == HTTP::Status::ProxyAuthenticationRequired)
             {
+                // cached credentials are stale, answer the new challenge
+                if (proxy_auth_cached)
+                {
+                    config->preconnect->clear_auth();
+                    proxy_auth_cached = false;
+                }
+
                 if (config->http_proxy_options->auth_method == None)
                     throw Exception("HTTP proxy authentication is disabled");
                 if (n_transactions > 1)
@@ -704,14 +892,20 @@ class Client : public TransportClient, AsyncResolvableTCP
 
         std::ostringstream os;
         gen_headers(os);
-        os << "Proxy-Authorization: Basic "
-           << base64->encode(config->http_proxy_options->username + ':' + config->http_proxy_options->password)
-           << "\r\n";
+        basic_auth_header(os);
         http_request = os.str();
+        proxy_auth.reset(&pa);
         reset();
         start_connect_();
     }
 
+    void basic_auth_header(std::ostringstream &os)
+    {
+        os << "Proxy-Authorization: Basic "
+           << base64->encode(config->http_proxy_options->username + ':' + config->http_proxy_options->password)
+           << "\r\n";
+    }
+
     void digest_auth(HTTPProxy::ProxyAuthenticate &pa)
     {
         try
@@ -719,56 +913,12 @@ class Client : public TransportClient, AsyncResolvableTCP
             OPENVPN_LOG("Proxy method: Digest" << std::endl
                                                << pa.to_string());
 
-            // constants
-            const std::string http_method = "CONNECT";
-            const std::string nonce_count = "00000001";
-            const std::string qop = "auth";
-
-            // get values from Proxy-Authenticate header
-            const std::string realm = pa.parms.get_value("realm");
-            const std::string nonce = pa.parms.get_value("nonce");
-            const std::string algorithm = pa.parms.get_value("algorithm");
-            const std::string opaque = pa.parms.get_value("opaque");
-
-            // generate a client nonce
-            unsigned char cnonce_raw[8];
-            config->rng->rand_bytes(cnonce_raw, sizeof(cnonce_raw));
-            const std::string cnonce = render_hex(cnonce_raw, sizeof(cnonce_raw));
-
-            // build URI
-            const std::string uri = server_host + ":" + server_port;
-
-            // calculate session key
-            const std::string session_key = HTTPProxy::Digest::calcHA1(
-                *config->digest_factory,
-                algorithm,
-                config->http_proxy_options->username,
-                realm,
-                config->http_proxy_options->password,
-                nonce,
-                cnonce);
-
-            // calculate response
-            const std::string response = HTTPProxy::Digest::calcResponse(
-                *config->digest_factory,
-                session_key,
-                nonce,
-                nonce_count,
-                cnonce,
-                qop,
-                http_method,
-                uri,
-                "");
-
-            // generate proxy request
             std::ostringstream os;
             gen_headers(os);
-            os << "Proxy-Authorization: Digest username=\"" << config->http_proxy_options->username << "\", realm=\"" << realm << "\", nonce=\"" << nonce << "\", uri=\"" << uri << "\", qop=" << qop << ", nc=" << nonce_count << ", cnonce=\"" << cnonce << "\", response=\"" << response << "\"";
-            if (!opaque.empty())
-                os << ", opaque=\"" + opaque + "\"";
-            os << "\r\n";
+            digest_auth_header(os, pa, 1);
 
             http_request = os.str();
+            proxy_auth.reset(&pa);
             reset();
             start_connect_();
         }
@@ -778,6 +928,95 @@ class Client : public TransportClient, AsyncResolvableTCP
         }
     }
 
+    void digest_auth_header(std::ostringstream &os, const HTTPProxy::ProxyAuthenticate &pa, const unsigned int nc)
+    {
+        // constants
+        const std::string http_method = "CONNECT";
+        const std::string qop = "auth";
+
+        // a nonce may be used again with a higher count
+        std::ostringstream nc_hex;
+        nc_hex << std::hex << std::setw(8) << std::setfill('0') << nc;
+        const std::string nonce_count = nc_hex.str();
+
+        // get values from Proxy-Authenticate header
+        const std::string realm = pa.parms.get_value("realm");
+        const std::string nonce = pa.parms.get_value("nonce");
+        const std::string algorithm = pa.parms.get_value("algorithm");
+        const std::string opaque = pa.parms.get_value("opaque");
+
+        // generate a client nonce
+        unsigned char cnonce_raw[8];
+        config->rng->rand_bytes(cnonce_raw, sizeof(cnonce_raw));
+        const std::string cnonce = render_hex(cnonce_raw, sizeof(cnonce_raw));
+
+        // build URI
+        const std::string uri = server_host + ":" + server_port;
+
+        // calculate session key
+        const std::string session_key = HTTPProxy::Digest::calcHA1(
+            *config->digest_factory,
+            algorithm,
+            config->http_proxy_options->username,
+            realm,
+            config->http_proxy_options->password,
+            nonce,
+            cnonce);
+
+        // calculate response
+        const std::string response = HTTPProxy::Digest::calcResponse(
+            *config->digest_factory,
+            session_key,
+            nonce,
+            nonce_count,
+            cnonce,
+            qop,
+            http_method,
+            uri,
+            "");
+
+        // generate proxy request
+        os << "Proxy-Authorization: Digest username=\"" << config->http_proxy_options->username << "\", realm=\"" << realm << "\", nonce=\"" << nonce << "\", uri=\"" << uri << "\", qop=" << qop << ", nc=" << nonce_count << ", cnonce=\"" << cnonce << "\", response=\"" << response << "\"";
+        if (!opaque.empty())
+            os << ", opaque=\"" + opaque + "\"";
+        os << "\r\n";
+    }
+
+    // If a previous CONNECT was authenticated with Basic or Digest,
+    // answer the same challenge up front, saving a 407 round trip.
+    void cached_auth()
+    {
+        if (!config->preconnect || !http_request.empty())
+            return;
+        HTTPProxy::ProxyAuthenticate::Ptr pa = config->preconnect->auth();
+        if (!pa)
+            return;
+        try
+        {
+            std::ostringstream os;
+            gen_headers(os);
+            if (string::strcasecmp(pa->method, "basic") == 0)
+                basic_auth_header(os);
+            else
+                digest_auth_header(os, *pa, config->preconnect->next_nonce_count());
+            http_request = os.str();
+            proxy_auth = pa;
+            proxy_auth_cached = true;
+        }
+        catch (const std::exception &e)
+        {
+            OPENVPN_LOG("Proxy: cached credentials not used: " << e.what());
+            config->preconnect->clear_auth();
+        }
+    }
+
+    // A session is using this tunnel, so keep another one ready.
+    void preconnect_session_up()
+    {
+        if (config->preconnect && parent != config->preconnect.get())
+            config->preconnect->session_up(io_context, config.get());
+    }
+
     std::string get_ntlm_phase_2_response()
     {
         for (HTTP::HeaderList::const_iterator i = http_reply.headers.begin(); i != http_reply.headers.end(); ++i)
@@ -916,6 +1155,8 @@ class Client : public TransportClient, AsyncResolvableTCP
         if (!halt)
         {
             halt = true;
+            if (proxy_established && config->preconnect && parent != config->preconnect.get())
+                config->preconnect->session_down();
             if (impl)
                 impl->stop();
 
@@ -1010,10 +1251,13 @@ class Client : public TransportClient, AsyncResolvableTCP
                                         (*config->frame)[Frame::READ_LINK_TCP],
                                         config->stats));
                 impl->set_raw_mode(true);
+                impl->set_send_gather(config->send_gather_max_size);
                 impl->start();
                 ++n_transactions;
 
                 // tell proxy to connect through to OpenVPN server
+                if (n_transactions == 1)
+                    cached_auth();
                 http_proxy_send();
             }
             else
@@ -1076,6 +1320,7 @@ class Client : public TransportClient, AsyncResolvableTCP
     std::string server_host;
     std::string server_port;
 
+    openvpn_io::io_context &io_context;
     openvpn_io::ip::tcp::socket socket;
     ClientConfig::Ptr config;
     TransportClientParent *parent;
@@ -1095,12 +1340,146 @@ class Client : public TransportClient, AsyncResolvableTCP
     size_t drain_content_length;
 
     std::unique_ptr<HTTP::HTMLSkip> html_skip;
+
+    HTTPProxy::ProxyAuthenticate::Ptr proxy_auth; // Basic or Digest challenge answered by the request
+    bool proxy_auth_cached;                       // the answer was sent before the proxy asked
 };
 
 inline TransportClient::Ptr ClientConfig::new_transport_client_obj(openvpn_io::io_context &io_context, TransportClientParent *parent)
 {
+    if (preconnect)
+    {
+        TransportClient::Ptr tc = preconnect->take(*this, parent);
+        if (tc)
+            return tc;
+    }
     return TransportClient::Ptr(new Client(io_context, this, parent));
 }
+
+inline void PreConnect::session_up(openvpn_io::io_context &io_context_arg, ClientConfig *config_arg)
+{
+    if (halt)
+        return;
+    if (!timer)
+    {
+        io_context = &io_context_arg;
+        timer.reset(new AsioTimer(io_context_arg));
+    }
+    config.reset(config_arg);
+    active = true;
+    if (!client)
+        schedule(retry_delay);
+}
+
+inline void PreConnect::session_down()
+{
+    active = false;
+    config.reset();
+    if (timer)
+        timer->cancel();
+}
+
+inline TransportClient::Ptr PreConnect::take(const ClientConfig &current, TransportClientParent *parent)
+{
+    if (!client)
+        return TransportClient::Ptr();
+
+    std::string host, port;
+    current.remote_list->endpoint_available(&host, &port, nullptr);
+    if (!ready || client->server_host != host || client->server_port != port
+        || Time::now() >= ready_since + Time::Duration::seconds(TAKE_MAX))
+    {
+        drop();
+        return TransportClient::Ptr();
+    }
+
+    OPENVPN_LOG("Proxy: using pre-connected tunnel to " << host << ':' << port);
+    timer->cancel();
+    client->transport_reparent(parent);
+    retry_delay = Time::Duration::seconds(RETRY_MIN);
+    ready = false;
+    TransportClient::Ptr tc(client);
+    client.reset();
+    return tc;
+}
+
+inline void PreConnect::stop()
+{
+    halt = true;
+    active = false;
+    config.reset();
+    if (timer)
+        timer->cancel();
+    drop();
+    auth_.reset();
+}
+
+inline PreConnect::~PreConnect() = default;
+
+inline void PreConnect::open()
+{
+    if (halt || !active || client)
+        return;
+    client.reset(new Client(*io_context, config.get(), this));
+    client->transport_start();
+}
+
+// Replace the ready tunnel before the server gives up waiting for its
+// reset and logs a failed TLS negotiation.
+inline void PreConnect::refresh()
+{
+    if (!client || !ready || halt || !active)
+        return;
+    OPENVPN_LOG("Proxy: refreshing pre-connected tunnel");
+    drop();
+    open();
+}
+
+// The warm tunnel failed or was closed by the server or proxy.  A tunnel
+// that was ready for a while was closed for being idle, which is expected
+// with a short server handshake window, so open the next one right away.
+// Back off only when tunnels fail to become ready, or die right after.
+inline void PreConnect::lost(const std::string &reason)
+{
+    if (!client)
+        return;
+    OPENVPN_LOG("Proxy: pre-connected tunnel lost: " << reason);
+    const bool idle_close = ready && Time::now() >= ready_since + Time::Duration::seconds(RETRY_MIN);
+    drop();
+    if (!active || halt)
+        return;
+    if (idle_close)
+    {
+        retry_delay = Time::Duration::seconds(RETRY_MIN);
+        timer->cancel();
+        open();
+    }
+    else
+    {
+        retry_delay = std::min(retry_delay * 2, Time::Duration::seconds(RETRY_MAX));
+        schedule(retry_delay);
+    }
+}
+
+inline void PreConnect::drop()
+{
+    ready = false;
+    if (client)
+    {
+        client->stop();
+
+        // we may have been called by the client, release it later
+        openvpn_io::post(*io_context, [c = std::move(client)]() {});
+    }
+}
+
+inline void PreConnect::transport_connecting()
+{
+    OPENVPN_LOG("Proxy: pre-connected tunnel to " << client->server_host << ':' << client->server_port << " is ready");
+    ready = true;
+    ready_since = Time::now();
+    schedule_refresh();
+}
 } // namespace openvpn::HTTPProxyTransport
 
 #endif
@@ -45,6 +45,8 @@ class ClientConfig : public TransportClientFactory
 
     RemoteList::Ptr remote_list;
     size_t free_list_max_size;
+    size_t send_gather_max_size = 0; // not used by the TLS link
+    size_t recv_batch_size = 0;      // not used by the TLS link
     Frame::Ptr frame;
     SessionStats::Ptr stats;
 
@@ -363,12 +365,18 @@ class Client : public TransportClient, AsyncResolvableTCP
                 }
                 else
 #endif
-                    impl.reset(new LinkImpl(this,
-                                            socket,
-                                            0, // send_queue_max_size is unlimited because we regulate size in cliproto.hpp
-                                            config->free_list_max_size,
-                                            (*config->frame)[Frame::READ_LINK_TCP],
-                                            config->stats));
+                {
+                    LinkImpl *link = new LinkImpl(this,
+                                                  socket,
+                                                  0, // send_queue_max_size is unlimited because we regulate size in cliproto.hpp
+                                                  config->free_list_max_size,
+                                                  (*config->frame)[Frame::READ_LINK_TCP],
+                                                  config->stats);
+                    link->set_send_gather(config->send_gather_max_size);
+                    if (parent->transport_is_openvpn_protocol())
+                        link->set_recv_batch(config->recv_batch_size);
+                    impl.reset(link);
+                }
 
 #ifdef OPENVPN_GREMLIN
                 impl->gremlin_config(config->gremlin_config);
@@ -23,6 +23,7 @@
 
 #include <openvpn/common/numeric_util.hpp>
 #include <openvpn/buffer/buffer.hpp>
+#include <openvpn/ip/csum.hpp>
 #include <openvpn/ip/ipcommon.hpp>
 #include <openvpn/ip/ip4.hpp>
 #include <openvpn/ip/ip6.hpp>
@@ -141,11 +142,9 @@ class MSSFix
                         if (mssval > max_mss)
                         {
                             OPENVPN_LOG_MSSFIX("MTU MSS " << mssval << " -> " << max_mss);
-                            int accumulate = htons(mssval);
                             opt[2] = static_cast<uint8_t>((max_mss >> 8) & 0xff);
                             opt[3] = static_cast<uint8_t>(max_mss & 0xff);
-                            accumulate -= htons(max_mss);
-                            tcp_adjust_checksum(accumulate, tcphdr->check);
+                            tcphdr->check = IPChecksum::update16(tcphdr->check, htons(mssval), htons(max_mss));
                         }
                     }
                     else
@@ -23,6 +23,7 @@
 
 #include <algorithm> // for std::min
 #include <cstdint>   // for std::uint16_t, etc.
+#include <cstring>   // for std::memcpy
 #include <limits>
 
 #include <openvpn/common/exception.hpp>
@@ -136,6 +137,30 @@ class PacketStream
         get(ret);
     }
 
+    // Alternative to put()/get() for a stream that is read into one
+    // persistent buffer.  Pass each fully formed packet at the front of
+    // buf to handler(pkt), after copying it into pkt, which is prepared
+    // with frame_context first, so that its allocation is reused if the
+    // handler leaves one behind.  A trailing partial packet is left in buf.
+    template <typename HANDLER>
+    static void get_all(Buffer &buf, BufferAllocated &pkt, const Frame::Context &frame_context, HANDLER &&handler)
+    {
+        while (size_defined(buf))
+        {
+            SIZE_TYPE net_len;
+            std::memcpy(&net_len, buf.c_data(), sizeof(net_len));
+            const size_t size = network_to_host(net_len);
+            validate_size(size, frame_context);
+            if (buf.size() < sizeof(net_len) + size)
+                return;
+            buf.advance(sizeof(net_len));
+            frame_context.prepare(pkt);
+            pkt.write(buf.c_data(), size);
+            buf.advance(size);
+            handler(pkt);
+        }
+    }
+
     // prepend SIZE_TYPE size to buffer
     static void prepend_size(Buffer &buf)
     {
@@ -92,8 +92,13 @@ class TCPLink : public LinkCommon<Protocol,
         OPENVPN_LOG_TCPLINK_VERBOSE("TCP recv raw="
                                     << Base::raw_mode_read << " size=" << bytes_recvd);
 
-        pfp->buf.set_size(bytes_recvd);
-        requeue = Base::process_recv_buffer(pfp->buf);
+        if (Base::recv_batch_pending)
+            requeue = Base::process_recv_batch(bytes_recvd);
+        else
+        {
+            pfp->buf.set_size(bytes_recvd);
+            requeue = Base::process_recv_buffer(pfp->buf);
+        }
         if (!Base::halt && requeue)
             Base::queue_recv(pfp.release()); // reuse PacketFrom object
     }
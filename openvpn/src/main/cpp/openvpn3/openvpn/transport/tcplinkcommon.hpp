@@ -5,6 +5,9 @@
 #ifndef OPENVPN_TRANSPORT_COMMONLINK_H
 #define OPENVPN_TRANSPORT_COMMONLINK_H
 
+#include <algorithm> // for std::max
+#include <array>
+#include <cstdint>
 #include <deque>
 #include <utility> // for std::move
 #include <memory>
@@ -12,6 +15,7 @@
 #include <openvpn/io/io.hpp>
 
 #include <openvpn/common/size.hpp>
+#include <openvpn/common/count.hpp>
 #include <openvpn/common/rc.hpp>
 #include <openvpn/common/socktypes.hpp>
 #include <openvpn/error/excode.hpp>
@@ -83,6 +87,25 @@ class LinkCommon : public LinkBase
         mutate = mutate_arg;
     }
 
+    // Send the queued packets with one scatter-gather send operation of
+    // up to max_size bytes rather than one send operation per packet.
+    // 0 disables gathering.
+    void set_send_gather(const size_t max_size)
+    {
+        send_gather_max_size = max_size;
+    }
+
+    // Read up to size bytes at a time into one persistent buffer, and
+    // extract all the packets of a read in one pass.  Each packet is
+    // copied once into a recycled buffer; only the partial packet at the
+    // end of a read is moved to the front of the buffer.  Must be called
+    // before start(), and read raw mode must not be enabled later.
+    // 0 disables batching.
+    void set_recv_batch(const size_t size)
+    {
+        recv_batch_size = size ? std::max(size, frame_context.payload() + sizeof(std::uint16_t)) : 0;
+    }
+
     bool send_queue_empty() const
     {
         return send_queue_size() == 0;
@@ -182,9 +205,22 @@ class LinkCommon : public LinkBase
         OPENVPN_LOG_TCPLINK_VERBOSE("TLSLink::queue_recv");
         if (!tcpfrom)
             tcpfrom = new PacketFrom();
-        frame_context.prepare(tcpfrom->buf);
 
-        socket.async_receive(frame_context.mutable_buffer_clamp(tcpfrom->buf),
+        openvpn_io::mutable_buffer read_buf;
+        recv_batch_pending = recv_batch_size && !is_raw_mode_read() && !mutate;
+        if (recv_batch_pending)
+        {
+            if (!recv_batch_buf.allocated())
+                recv_batch_buf.reset(recv_batch_size, 0);
+            read_buf = recv_batch_buf.mutable_buffer_append_clamp();
+        }
+        else
+        {
+            frame_context.prepare(tcpfrom->buf);
+            read_buf = frame_context.mutable_buffer_clamp(tcpfrom->buf);
+        }
+
+        socket.async_receive(read_buf,
                              [self = Ptr(this), tcpfrom = PacketFrom::SPtr(tcpfrom)](const openvpn_io::error_code &error, const size_t bytes_recvd) mutable
                              {
             OPENVPN_ASYNC_HANDLER;
@@ -275,6 +311,11 @@ class LinkCommon : public LinkBase
 
     void queue_send()
     {
+        if (send_gather_max_size && queue.size() > 1)
+        {
+            queue_send_gather();
+            return;
+        }
         BufferAllocated &buf = *queue.front();
         socket.async_send(buf.const_buffer_clamp(),
                           [self = Ptr(this)](const openvpn_io::error_code &error, const size_t bytes_sent)
@@ -284,6 +325,31 @@ class LinkCommon : public LinkBase
         });
     }
 
+    // Send the packets at the front of the queue in one operation.  The
+    // queue is not modified until handle_send, so the gathered buffers
+    // remain valid while the send is in progress.
+    void queue_send_gather()
+    {
+        size_t n = 0;
+        size_t size = 0;
+        for (const BufferPtr &buf : queue)
+        {
+            if (n == gather_bufs.size() || (n && size + buf->size() > send_gather_max_size))
+                break;
+            gather_bufs[n] = buf->const_buffer_clamp();
+            size += gather_bufs[n].size();
+            ++n;
+            if (gather_bufs[n - 1].size() < buf->size())
+                break; // a clamped packet must be the last one
+        }
+        socket.async_send(GatherBuffers{gather_bufs.data(), gather_bufs.data() + n},
+                          [self = Ptr(this)](const openvpn_io::error_code &error, const size_t bytes_sent)
+                          {
+            OPENVPN_ASYNC_HANDLER;
+            self->handle_send(error, bytes_sent);
+        });
+    }
+
     void handle_send(const openvpn_io::error_code &error, const size_t bytes_sent)
     {
         if (!halt)
@@ -292,27 +358,38 @@ class LinkCommon : public LinkBase
             {
                 OPENVPN_LOG_TCPLINK_VERBOSE("TLS-TCP send raw=" << raw_mode_write << " size=" << bytes_sent);
                 stats->inc_stat(SessionStats::BYTES_OUT, bytes_sent);
-                stats->inc_stat(SessionStats::PACKETS_OUT, 1);
 
-                BufferPtr buf = queue.front();
-                if (bytes_sent == buf->size())
+                // a gathered send may complete several packets
+                size_t remaining = bytes_sent;
+                count_t n_sent = 0;
+                do
                 {
-                    queue.pop_front();
-                    if (free_list.size() < free_list_max_size)
+                    if (queue.empty())
                     {
-                        buf->reset_content();
-                        free_list.push_back(std::move(buf)); // recycle the buffer for later use
+                        stats->error(Error::TCP_OVERFLOW);
+                        read_handler->tcp_error_handler("TCP_INTERNAL_ERROR"); // error sent more bytes than we asked for
+                        stop();
+                        return;
                     }
-                }
-                else if (bytes_sent < buf->size())
-                    buf->advance(bytes_sent);
-                else
-                {
-                    stats->error(Error::TCP_OVERFLOW);
-                    read_handler->tcp_error_handler("TCP_INTERNAL_ERROR"); // error sent more bytes than we asked for
-                    stop();
-                    return;
-                }
+                    BufferPtr buf = queue.front();
+                    if (remaining >= buf->size())
+                    {
+                        remaining -= buf->size();
+                        ++n_sent;
+                        queue.pop_front();
+                        if (free_list.size() < free_list_max_size)
+                        {
+                            buf->reset_content();
+                            free_list.push_back(std::move(buf)); // recycle the buffer for later use
+                        }
+                    }
+                    else
+                    {
+                        buf->advance(remaining);
+                        remaining = 0;
+                    }
+                } while (remaining);
+                stats->inc_stat(SessionStats::PACKETS_OUT, n_sent ? n_sent : 1);
             }
             else
             {
@@ -373,6 +450,41 @@ class LinkCommon : public LinkBase
         return requeue;
     }
 
+    // process a read of the batch mode, see set_recv_batch()
+    bool process_recv_batch(const size_t bytes_recvd)
+    {
+        bool requeue = true;
+
+        OPENVPN_LOG_TCPLINK_VERBOSE("TLSLink::process_recv_batch: size=" << bytes_recvd);
+
+        recv_batch_buf.inc_size(bytes_recvd);
+        stats->inc_stat(SessionStats::BYTES_IN, bytes_recvd);
+        stats->inc_stat(SessionStats::PACKETS_IN, 1);
+        try
+        {
+            OpenVPNPacketStream::get_all(recv_batch_buf, recv_batch_pkt, frame_context, [&](BufferAllocated &pkt)
+                                         {
+#ifdef OPENVPN_GREMLIN
+                if (gremlin)
+                    requeue = gremlin_recv(pkt);
+                else
+#endif
+                    requeue = read_handler->tcp_read_handler(pkt); });
+        }
+        catch ([[maybe_unused]] const std::exception &e)
+        {
+            OPENVPN_LOG_TCPLINK_ERROR("TLS-TCP packet extract error: " << e.what());
+            stats->error(Error::TCP_SIZE_ERROR);
+            read_handler->tcp_error_handler("TCP_SIZE_ERROR");
+            stop();
+            return false;
+        }
+
+        // move the partial packet to the front
+        recv_batch_buf.realign(0);
+        return requeue;
+    }
+
     void handle_recv(PacketFrom::SPtr pfp, const openvpn_io::error_code &error, const size_t bytes_recvd)
     {
         OPENVPN_LOG_TCPLINK_VERBOSE("TCPLink::handle_recv: " << error.message());
@@ -465,11 +577,39 @@ class LinkCommon : public LinkBase
     bool raw_mode_write;
     bool halt = false;
 
+    // scatter-gather send
+    size_t send_gather_max_size = 0;
+    std::array<openvpn_io::const_buffer, 64> gather_bufs;
+
+    // batch receive
+    size_t recv_batch_size = 0;
+    bool recv_batch_pending = false; // the pending read is a batch read
+    BufferAllocated recv_batch_buf;
+    BufferAllocated recv_batch_pkt;
+
 #ifdef OPENVPN_GREMLIN
     std::unique_ptr<Gremlin::SendRecvQueue> gremlin;
 #endif
 
   private:
+    // A view of the first n elements of gather_bufs, so that the send
+    // operation does not copy a buffer vector.
+    struct GatherBuffers
+    {
+        const openvpn_io::const_buffer *begin() const
+        {
+            return begin_;
+        }
+
+        const openvpn_io::const_buffer *end() const
+        {
+            return end_;
+        }
+
+        const openvpn_io::const_buffer *begin_;
+        const openvpn_io::const_buffer *end_;
+    };
+
     virtual void recv_buffer(PacketFrom::SPtr &pfp, const size_t bytes_recvd) = 0;
     virtual void from_app_send_buffer(BufferPtr &buf) = 0;
 };
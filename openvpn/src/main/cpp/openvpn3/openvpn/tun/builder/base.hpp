@@ -284,6 +284,60 @@ class TunBuilderBase
     {
     }
 
+    // Optional callbacks to reconfigure a persisted tun interface in
+    // place (tunReconfigure).  If a reconnect only changes routes,
+    // excluded routes, DNS servers, search domains or the remote address,
+    // the core calls tun_builder_reconfigure_begin() instead of
+    // tun_builder_new(), then tun_builder_set_remote_address() if the
+    // remote address changed, tun_builder_remove_*() for each item that is
+    // gone, tun_builder_add_route(), tun_builder_exclude_route(),
+    // tun_builder_add_dns_server() and tun_builder_add_search_domain()
+    // for each new item, and finally tun_builder_reconfigure_commit().
+    // DNS servers and search domains are replaced as a whole when they
+    // change, so that their order is kept.
+    // If any of these methods fails, the core discards the changes by
+    // starting over with tun_builder_new().
+    virtual bool tun_builder_reconfigure_begin()
+    {
+        return false;
+    }
+
+    virtual bool tun_builder_remove_route(const std::string &address,
+                                          int prefix_length,
+                                          int metric,
+                                          bool ipv6)
+    {
+        return false;
+    }
+
+    virtual bool tun_builder_remove_exclude_route(const std::string &address,
+                                                  int prefix_length,
+                                                  int metric,
+                                                  bool ipv6)
+    {
+        return false;
+    }
+
+    virtual bool tun_builder_remove_dns_server(const std::string &address, bool ipv6)
+    {
+        return false;
+    }
+
+    virtual bool tun_builder_remove_search_domain(const std::string &domain)
+    {
+        return false;
+    }
+
+    // Apply the changes since tun_builder_reconfigure_begin().  Returns
+    // the socket descriptor to use from now on: the one returned by the
+    // last tun_builder_establish() if it was reconfigured in place, a new
+    // one (which the caller will henceforth own, replacing the previous
+    // one) if the platform had to create it again, or -1 on failure.
+    virtual int tun_builder_reconfigure_commit()
+    {
+        return -1;
+    }
+
     virtual ~TunBuilderBase()
     {
     }
@@ -27,6 +27,7 @@
 
 #include <string>
 #include <sstream>
+#include <unordered_set>
 #include <vector>
 
 #include <openvpn/common/exception.hpp>
@@ -448,6 +449,123 @@ class TunBuilderCapture : public TunBuilderBase, public RC<thread_unsafe_refcoun
 #endif
     };
 
+    // What changed between two captures, as computed by delta().
+    // Routes and excluded routes are compared as sets, so that a server
+    // pushing the same routes in a different order changes nothing.  DNS
+    // servers and search domains are ordered, so they are replaced as a
+    // whole when they differ.
+    class Delta
+    {
+      public:
+        bool interface_changed = false; // anything else differs
+        bool remote_address_changed = false;
+        RemoteAddress remote_address;
+        std::vector<Route> add_routes;
+        std::vector<Route> remove_routes;
+        std::vector<Route> add_exclude_routes;
+        std::vector<Route> remove_exclude_routes;
+        std::vector<DNSServer> add_dns_servers;
+        std::vector<DNSServer> remove_dns_servers;
+        std::vector<SearchDomain> add_search_domains;
+        std::vector<SearchDomain> remove_search_domains;
+
+        // true if nothing needs to be applied
+        bool empty() const
+        {
+            return !interface_changed
+                   && !remote_address_changed
+                   && add_routes.empty()
+                   && remove_routes.empty()
+                   && add_exclude_routes.empty()
+                   && remove_exclude_routes.empty()
+                   && add_dns_servers.empty()
+                   && remove_dns_servers.empty()
+                   && add_search_domains.empty()
+                   && remove_search_domains.empty();
+        }
+
+        // Replay the changes through the tun_builder_reconfigure_begin()
+        // sequence of tb, except for the final commit.  Removals go first,
+        // so that a route that only changed its metric ends up added.
+        bool apply(TunBuilderBase *tb) const
+        {
+            if (interface_changed || !tb->tun_builder_reconfigure_begin())
+                return false;
+            if (remote_address_changed && !tb->tun_builder_set_remote_address(remote_address.address, remote_address.ipv6))
+                return false;
+            for (const auto &r : remove_routes)
+                if (!tb->tun_builder_remove_route(r.address, r.prefix_length, r.metric, r.ipv6))
+                    return false;
+            for (const auto &r : remove_exclude_routes)
+                if (!tb->tun_builder_remove_exclude_route(r.address, r.prefix_length, r.metric, r.ipv6))
+                    return false;
+            for (const auto &d : remove_dns_servers)
+                if (!tb->tun_builder_remove_dns_server(d.address, d.ipv6))
+                    return false;
+            for (const auto &d : remove_search_domains)
+                if (!tb->tun_builder_remove_search_domain(d.domain))
+                    return false;
+            for (const auto &r : add_routes)
+                if (!tb->tun_builder_add_route(r.address, r.prefix_length, r.metric, r.ipv6))
+                    return false;
+            for (const auto &r : add_exclude_routes)
+                if (!tb->tun_builder_exclude_route(r.address, r.prefix_length, r.metric, r.ipv6))
+                    return false;
+            for (const auto &d : add_dns_servers)
+                if (!tb->tun_builder_add_dns_server(d.address, d.ipv6))
+                    return false;
+            for (const auto &d : add_search_domains)
+                if (!tb->tun_builder_add_search_domain(d.domain))
+                    return false;
+            return true;
+        }
+
+        std::string to_string() const
+        {
+            std::ostringstream os;
+            if (interface_changed)
+                os << "Interface changed" << std::endl;
+            if (remote_address_changed)
+                os << "Remote Address: " << remote_address.to_string() << std::endl;
+            render_delta(os, "Routes", add_routes, remove_routes);
+            render_delta(os, "Exclude Routes", add_exclude_routes, remove_exclude_routes);
+            render_delta(os, "DNS Servers", add_dns_servers, remove_dns_servers);
+            render_delta(os, "Search Domains", add_search_domains, remove_search_domains);
+            return os.str();
+        }
+
+      private:
+        template <typename LIST>
+        static void render_delta(std::ostream &os, const std::string &title, const LIST &added, const LIST &removed)
+        {
+            if (added.empty() && removed.empty())
+                return;
+            os << title << ':' << std::endl;
+            for (auto &e : removed)
+                os << "  - " << e.to_string() << std::endl;
+            for (auto &e : added)
+                os << "  + " << e.to_string() << std::endl;
+        }
+    };
+
+    // Return what changes from the settings in prev to those of this
+    // object.  The session name is ignored.
+    Delta delta(const TunBuilderCapture &prev) const
+    {
+        Delta d;
+        d.interface_changed = interface_string() != prev.interface_string();
+        if (remote_address.to_string() != prev.remote_address.to_string())
+        {
+            d.remote_address_changed = true;
+            d.remote_address = remote_address;
+        }
+        delta_set(prev.add_routes, add_routes, d.add_routes, d.remove_routes);
+        delta_set(prev.exclude_routes, exclude_routes, d.add_exclude_routes, d.remove_exclude_routes);
+        delta_list(prev.dns_servers, dns_servers, d.add_dns_servers, d.remove_dns_servers);
+        delta_list(prev.search_domains, search_domains, d.add_search_domains, d.remove_search_domains);
+        return d;
+    }
+
     virtual bool tun_builder_set_remote_address(const std::string &address, bool ipv6) override
     {
         remote_address.address = address;
@@ -819,6 +937,56 @@ class TunBuilderCapture : public TunBuilderBase, public RC<thread_unsafe_refcoun
     std::vector<WINSServer> wins_servers; // Windows WINS servers
 
   private:
+    // the settings that delta() cannot express as added or removed items
+    std::string interface_string() const
+    {
+        std::ostringstream os;
+        os << "Layer: " << layer.str() << std::endl;
+        os << "MTU: " << mtu << std::endl;
+        render_list(os, "Tunnel Addresses", tunnel_addresses);
+        os << "Reroute Gateway: " << reroute_gw.to_string() << std::endl;
+        os << "Block: " << block_ipv4 << block_ipv6 << block_outside_dns << std::endl;
+        os << "Route Metric Default: " << route_metric_default << std::endl;
+        os << "Adapter Domain Suffix: " << adapter_domain_suffix << std::endl;
+        os << dns_options.to_string() << std::endl;
+        render_list(os, "Proxy Bypass", proxy_bypass);
+        os << "Proxy Auto Config URL: " << proxy_auto_config_url.to_string() << std::endl;
+        os << "HTTP Proxy: " << http_proxy.to_string() << std::endl;
+        os << "HTTPS Proxy: " << https_proxy.to_string() << std::endl;
+        render_list(os, "WINS Servers", wins_servers);
+        return os.str();
+    }
+
+    template <typename LIST>
+    static void delta_set(const LIST &prev, const LIST &cur, LIST &added, LIST &removed)
+    {
+        std::unordered_set<std::string> in_prev, in_cur;
+        for (auto &e : prev)
+            in_prev.insert(e.to_string());
+        for (auto &e : cur)
+            in_cur.insert(e.to_string());
+        // inserting also skips duplicates
+        for (auto &e : cur)
+            if (in_prev.insert(e.to_string()).second)
+                added.push_back(e);
+        for (auto &e : prev)
+            if (in_cur.insert(e.to_string()).second)
+                removed.push_back(e);
+    }
+
+    template <typename LIST>
+    static void delta_list(const LIST &prev, const LIST &cur, LIST &added, LIST &removed)
+    {
+        bool equal = prev.size() == cur.size();
+        for (size_t i = 0; equal && i < cur.size(); ++i)
+            equal = prev[i].to_string() == cur[i].to_string();
+        if (!equal)
+        {
+            removed = prev;
+            added = cur;
+        }
+    }
+
     template <typename LIST>
     static void render_list(std::ostream &os, const std::string &title, const LIST &list)
     {
@@ -92,6 +92,7 @@ class ClientConfig : public TunClientFactory
     SessionStats::Ptr stats;
     EmulateExcludeRouteFactory::Ptr eer_factory;
     TunPersist::Ptr tun_persist;
+    bool tun_reconfigure; // apply only what changed to a persisted tun
     TunBuilderBase *builder;
 
     static Ptr new_obj()
@@ -111,7 +112,7 @@ class ClientConfig : public TunClientFactory
 
   private:
     ClientConfig()
-        : n_parallel(8), retain_sd(false), tun_prefix(false), builder(nullptr)
+        : n_parallel(8), retain_sd(false), tun_prefix(false), tun_reconfigure(false), builder(nullptr)
     {
     }
 };
@@ -141,6 +142,7 @@ class Client : public TunClient
             {
                 int sd = -1;
                 const IP::Addr server_addr = transcli.server_endpoint_addr();
+                TunBuilderCapture::Delta delta;
 
                 // Check if persisted tun session matches properties of to-be-created session
                 if (tun_persist->use_persisted_tun(server_addr, config->tun_prop, opt))
@@ -152,6 +154,17 @@ class Client : public TunClient
                     // indicate reconnection with persisted state
                     config->builder->tun_builder_establish_lite();
                 }
+                // Otherwise try to apply only what changed.  Emulated
+                // exclude routes are not in the captured settings.
+                else if (config->tun_reconfigure
+                         && !config->eer_factory
+                         && tun_persist->persisted_tun_delta(delta)
+                         && (sd = reconfigure_tun(delta)) != -1)
+                {
+                    state = tun_persist->state();
+                    OPENVPN_LOG("TunPersist: reconfigured tun context" << std::endl
+                                                                       << delta.to_string());
+                }
                 else
                 {
                     TunBuilderBase *tb = config->builder;
@@ -287,6 +300,22 @@ class Client : public TunClient
     {
     }
 
+    // Apply delta to the persisted tun, returning the socket descriptor
+    // to use, or -1 to configure a new tun instead.
+    int reconfigure_tun(const TunBuilderCapture::Delta &delta)
+    {
+        TunBuilderBase *tb = config->builder;
+        if (delta.empty())
+        {
+            // only the order of items or the session name changed
+            tb->tun_builder_establish_lite();
+            return tun_persist->obj();
+        }
+        if (!delta.apply(tb))
+            return -1;
+        return tb->tun_builder_reconfigure_commit();
+    }
+
     bool send(Buffer &buf)
     {
         if (impl)
@@ -0,0 +1,926 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2012-2022 OpenVPN Inc.
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Affero General Public License Version 3
+//    as published by the Free Software Foundation.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public License
+//    along with this program in the COPYING file.
+//    If not, see <http://www.gnu.org/licenses/>.
+
+// In-process tun interface with a minimal IPv4 TCP/UDP/ICMP stack,
+// intended for benchmarking the client data path without a kernel
+// tun device.  Traffic is generated by a list of configured flows
+// (TCP bulk senders, UDP sources, ICMP pingers) aimed at the VPN
+// gateway or any other address reachable through the tunnel.
+// Incoming ICMP echo requests are answered, everything else that
+// does not belong to a flow is counted and dropped.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <openvpn/common/exception.hpp>
+#include <openvpn/common/number.hpp>
+#include <openvpn/common/split.hpp>
+#include <openvpn/common/lex.hpp>
+#include <openvpn/tun/client/tunbase.hpp>
+#include <openvpn/frame/frame.hpp>
+#include <openvpn/log/sessionstats.hpp>
+#include <openvpn/time/asiotimer.hpp>
+#include <openvpn/addr/ip.hpp>
+#include <openvpn/ip/ip4.hpp>
+#include <openvpn/ip/tcp.hpp>
+#include <openvpn/ip/udp.hpp>
+#include <openvpn/ip/icmp4.hpp>
+#include <openvpn/ip/ping4.hpp>
+#include <openvpn/ip/csum.hpp>
+
+namespace openvpn::TunStack {
+
+OPENVPN_EXCEPTION(tun_stack_error);
+
+typedef std::chrono::steady_clock Clock;
+
+// Configuration of one traffic flow
+struct Flow
+{
+    enum Type
+    {
+        UDP,
+        TCP,
+        PING,
+    };
+
+    Type type = UDP;
+    IP::Addr dest;            // undefined means VPN gateway
+    std::uint16_t port = 9;   // destination port (UDP/TCP)
+    unsigned int rate = 10;   // packets per second (UDP/PING)
+    unsigned int size = 512;  // IP packet size (UDP/PING)
+    std::uint64_t bytes = 0;  // TCP payload to send, 0 for unlimited
+    unsigned int window = 32; // TCP segments in flight
+
+    // Parse a flow spec of the form <type>[,key=value...], for example
+    // "tcp,port=5001,bytes=100000000,window=64" or "ping,rate=5,dest=10.8.0.1"
+    static Flow parse(const std::string &spec)
+    {
+        const std::vector<std::string> terms = Split::by_char<std::vector<std::string>, NullLex, Split::NullLimit>(spec, ',');
+        if (terms.empty())
+            throw tun_stack_error("empty flow spec");
+
+        Flow f;
+        if (terms[0] == "udp")
+            f.type = UDP;
+        else if (terms[0] == "tcp")
+            f.type = TCP;
+        else if (terms[0] == "ping")
+            f.type = PING;
+        else
+            throw tun_stack_error("unknown flow type '" + terms[0] + "'");
+
+        for (size_t i = 1; i < terms.size(); ++i)
+        {
+            const std::string &t = terms[i];
+            const size_t eq = t.find('=');
+            if (eq == std::string::npos)
+                throw tun_stack_error("flow parameter '" + t + "' is not key=value");
+            const std::string key = t.substr(0, eq);
+            const std::string value = t.substr(eq + 1);
+            if (key == "dest")
+                f.dest = IP::Addr::from_string(value, "flow dest");
+            else if (key == "port")
+                f.port = parse_number_throw<std::uint16_t>(value, "flow port");
+            else if (key == "rate")
+                f.rate = parse_number_throw<unsigned int>(value, "flow rate");
+            else if (key == "size")
+                f.size = parse_number_throw<unsigned int>(value, "flow size");
+            else if (key == "bytes")
+                f.bytes = parse_number_throw<std::uint64_t>(value, "flow bytes");
+            else if (key == "window")
+                f.window = std::max(1u, parse_number_throw<unsigned int>(value, "flow window"));
+            else
+                throw tun_stack_error("unknown flow parameter '" + key + "'");
+        }
+        if (f.dest.defined() && f.dest.version() != IP::Addr::V4)
+            throw tun_stack_error("only IPv4 flows are supported");
+        return f;
+    }
+};
+
+// Per-flow results, accumulated across reconnects
+struct FlowStats
+{
+    count_t packets_out = 0;
+    count_t bytes_out = 0; // IP bytes sent into the tunnel
+    count_t packets_in = 0;
+    count_t bytes_in = 0;    // IP bytes received from the tunnel
+    count_t bytes_acked = 0; // TCP payload acknowledged by the peer
+    count_t retransmits = 0;   // TCP retransmission timeouts
+    count_t window_probes = 0; // TCP zero window probes
+    count_t rtt_samples = 0;
+    double rtt_sum_ms = 0.0;
+    double rtt_min_ms = 0.0;
+    double rtt_max_ms = 0.0;
+    unsigned int mss_sent = 0;     // MSS option in our SYN
+    unsigned int mss_received = 0; // MSS option in the peer's SYN-ACK
+    bool established = false;
+    bool finished = false; // all TCP payload acknowledged and FIN acknowledged
+
+    void add_rtt(const Clock::duration d)
+    {
+        const double ms = std::chrono::duration<double, std::milli>(d).count();
+        if (!rtt_samples || ms < rtt_min_ms)
+            rtt_min_ms = ms;
+        if (!rtt_samples || ms > rtt_max_ms)
+            rtt_max_ms = ms;
+        rtt_sum_ms += ms;
+        ++rtt_samples;
+    }
+
+    double rtt_avg_ms() const
+    {
+        return rtt_samples ? rtt_sum_ms / double(rtt_samples) : 0.0;
+    }
+};
+
+class ClientConfig : public TunClientFactory
+{
+  public:
+    typedef RCPtr<ClientConfig> Ptr;
+
+    Frame::Ptr frame;
+    SessionStats::Ptr stats;
+    std::vector<Flow> flows;
+    std::vector<FlowStats> flow_stats; // parallel to flows
+    unsigned int tick_ms = 10;         // pacing granularity of rate-based flows
+
+    static Ptr new_obj()
+    {
+        return new ClientConfig;
+    }
+
+    TunClient::Ptr new_tun_client_obj(openvpn_io::io_context &io_context,
+                                      TunClientParent &parent,
+                                      TransportClient *transcli) override;
+
+  private:
+    ClientConfig()
+    {
+    }
+};
+
+class Client : public TunClient
+{
+    friend class ClientConfig; // calls constructor
+
+    typedef RCPtr<Client> Ptr;
+
+    enum
+    {
+        SYN_OPT_LEN = 4,
+        IP_TCP_HDR = sizeof(IPv4Header) + sizeof(TCPHeader),
+        TCP_FLAG_FIN = 1 << 0,
+        TCP_FLAG_SYN = TCPHeader::FLAG_SYN,
+        TCP_FLAG_RST = 1 << 2,
+        TCP_FLAG_PSH = 1 << 3,
+        TCP_FLAG_ACK = 1 << 4,
+        PING_ID_BASE = 0x4f00,
+        SOURCE_PORT_BASE = 40000,
+    };
+
+    struct FlowState
+    {
+        FlowState(openvpn_io::io_context &io_context, const Flow &flow_arg, FlowStats &stats_arg)
+            : flow(flow_arg),
+              stats(stats_arg),
+              rto_timer(io_context),
+              persist_timer(io_context)
+        {
+        }
+
+        const Flow &flow;
+        FlowStats &stats;
+        IPv4::Addr dest;
+        std::uint16_t sport = 0;
+        std::uint16_t seq_num = 0; // ICMP sequence number
+        double credit = 0.0;       // packets owed to rate-based flows
+
+        // TCP sender, offsets count payload bytes from the first byte after SYN
+        enum State
+        {
+            CLOSED,
+            SYN_SENT,
+            ESTABLISHED,
+            FIN_WAIT,
+            DONE,
+        };
+        State state = CLOSED;
+        std::uint32_t iss = 0;
+        std::uint32_t rcv_nxt = 0;
+        std::uint64_t una_off = 0;
+        std::uint64_t nxt_off = 0;
+        std::uint64_t max_off = 0;
+        std::uint32_t peer_wnd = 0;
+        std::uint16_t mss = 0;
+        bool timing = false; // Karn: one RTT measurement in flight
+        std::uint64_t timed_off = 0;
+        Clock::time_point timed_at;
+        bool have_srtt = false;
+        Clock::duration srtt{};
+        Clock::duration rttvar{};
+        Clock::duration rto = std::chrono::seconds(1);
+        bool rto_pending = false;
+        unsigned int rto_gen = 0; // stale RTO handlers that already fired see a newer value
+        AsioTimer rto_timer;
+        Clock::duration persist{}; // zero window probe interval, zero when idle
+        unsigned int persist_gen = 0;
+        AsioTimer persist_timer;
+
+        std::uint32_t seq(const std::uint64_t off) const
+        {
+            return iss + 1 + static_cast<std::uint32_t>(off);
+        }
+
+        std::uint64_t fin_off() const
+        {
+            return flow.bytes;
+        }
+    };
+
+  public:
+    void tun_start(const OptionList &opt, TransportClient &, CryptoDCSettings &) override
+    {
+        start(opt);
+    }
+
+    // Separate from tun_start() so that the stack can be driven without a transport.
+    void start(const OptionList &opt)
+    {
+        const Option *o = opt.get_ptr("ifconfig");
+        if (!o)
+            throw tun_stack_error("IPv4 ifconfig is required");
+        local = IPv4::Addr::from_string(o->get(1, 256), "ifconfig");
+        const Option *gw = opt.get_ptr("route-gateway");
+        if (gw)
+            gateway = IPv4::Addr::from_string(gw->get(1, 256), "route-gateway");
+        else
+            gateway = IPv4::Addr::from_string(o->get(2, 256), "ifconfig");
+        mtu = opt.get_num<unsigned int>("tun-mtu", 1, 1500, 576, 65535);
+
+        config->flow_stats.resize(config->flows.size());
+        bool rate_based = false;
+        for (size_t i = 0; i < config->flows.size(); ++i)
+        {
+            const Flow &f = config->flows[i];
+            std::unique_ptr<FlowState> fs(new FlowState(io_context, f, config->flow_stats[i]));
+            fs->dest = f.dest.defined() ? f.dest.to_ipv4() : gateway;
+            fs->sport = static_cast<std::uint16_t>(SOURCE_PORT_BASE + i);
+            flows.push_back(std::move(fs));
+            rate_based |= f.type != Flow::TCP && f.rate;
+        }
+
+        parent.tun_connected();
+
+        for (auto &fs : flows)
+            if (fs->flow.type == Flow::TCP)
+                tcp_connect(*fs);
+
+        if (rate_based)
+        {
+            last_tick = Clock::now();
+            schedule_tick();
+        }
+    }
+
+    // packets coming out of the tunnel enter the stack here
+    bool tun_send(BufferAllocated &buf) override
+    {
+        config->stats->inc_stat(SessionStats::TUN_BYTES_OUT, buf.size());
+        config->stats->inc_stat(SessionStats::TUN_PACKETS_OUT, 1);
+        if (!halt)
+            input(buf);
+        return true;
+    }
+
+    std::string tun_name() const override
+    {
+        return "TUN_STACK";
+    }
+
+    std::string vpn_ip4() const override
+    {
+        return local.to_string();
+    }
+
+    std::string vpn_ip6() const override
+    {
+        return "";
+    }
+
+    std::string vpn_gw4() const override
+    {
+        return gateway.to_string();
+    }
+
+    int vpn_mtu() const override
+    {
+        return static_cast<int>(mtu);
+    }
+
+    void set_disconnect() override
+    {
+    }
+
+    void stop() override
+    {
+        halt = true;
+        tick_timer.cancel();
+        for (auto &fs : flows)
+        {
+            fs->rto_timer.cancel();
+            fs->persist_timer.cancel();
+        }
+    }
+
+  private:
+    Client(openvpn_io::io_context &io_context_arg,
+           ClientConfig *config_arg,
+           TunClientParent &parent_arg)
+        : io_context(io_context_arg),
+          config(config_arg),
+          parent(parent_arg),
+          tick_timer(io_context_arg)
+    {
+    }
+
+    // rate-based flows
+
+    void schedule_tick()
+    {
+        tick_timer.expires_after(Time::Duration::milliseconds(config->tick_ms));
+        tick_timer.async_wait([self = Ptr(this)](const openvpn_io::error_code &error)
+                              {
+                                  if (!error && !self->halt)
+                                      self->tick(); });
+    }
+
+    void tick()
+    {
+        const Clock::time_point now = Clock::now();
+        const double dt = std::chrono::duration<double>(now - last_tick).count();
+        last_tick = now;
+        for (auto &fs : flows)
+        {
+            if (fs->flow.type == Flow::TCP || !fs->flow.rate)
+                continue;
+            fs->credit += double(fs->flow.rate) * dt;
+            while (fs->credit >= 1.0 && !halt)
+            {
+                if (fs->flow.type == Flow::UDP)
+                    send_udp(*fs);
+                else
+                    send_ping(*fs);
+                fs->credit -= 1.0;
+            }
+        }
+        schedule_tick();
+    }
+
+    void send_udp(FlowState &fs)
+    {
+        const size_t hdr_size = sizeof(IPv4Header) + sizeof(UDPHeader);
+        const size_t size = std::max(size_t(fs.flow.size), hdr_size);
+        BufferAllocated buf;
+        std::uint8_t *b = alloc(buf, size);
+        if (!b)
+            return;
+        write_ip_header(b, size, IPCommon::UDP, fs.dest);
+        UDPHeader *udp = reinterpret_cast<UDPHeader *>(b + sizeof(IPv4Header));
+        udp->source = htons(fs.sport);
+        udp->dest = htons(fs.flow.port);
+        udp->len = htons(static_cast<std::uint16_t>(size - sizeof(IPv4Header)));
+        udp->check = 0;
+        std::memset(b + hdr_size, 0, size - hdr_size);
+        emit(fs, buf);
+    }
+
+    void send_ping(FlowState &fs)
+    {
+        const std::int64_t ts = Clock::now().time_since_epoch().count();
+        BufferAllocated buf;
+        if (!alloc(buf, 0))
+            return;
+        Ping4::generate_echo_request(buf,
+                                     local,
+                                     fs.dest,
+                                     &ts,
+                                     sizeof(ts),
+                                     ping_id(fs),
+                                     fs.seq_num++,
+                                     std::max(size_t(fs.flow.size), sizeof(ICMPv4) + sizeof(ts)),
+                                     nullptr);
+        emit(fs, buf);
+    }
+
+    std::uint16_t ping_id(const FlowState &fs) const
+    {
+        return static_cast<std::uint16_t>(PING_ID_BASE + (fs.sport - SOURCE_PORT_BASE));
+    }
+
+    // TCP sender
+
+    void tcp_connect(FlowState &fs)
+    {
+        fs.iss = static_cast<std::uint32_t>(Clock::now().time_since_epoch().count()) ^ (std::uint32_t(fs.sport) << 16);
+        fs.mss = static_cast<std::uint16_t>(mtu - IP_TCP_HDR);
+        fs.stats.mss_sent = fs.mss;
+        fs.state = FlowState::SYN_SENT;
+        send_syn(fs);
+        tcp_arm_rto(fs);
+    }
+
+    void send_syn(FlowState &fs)
+    {
+        std::uint8_t opt[SYN_OPT_LEN] = {
+            TCPHeader::OPT_MAXSEG,
+            TCPHeader::OPTLEN_MAXSEG,
+            static_cast<std::uint8_t>(fs.mss >> 8),
+            static_cast<std::uint8_t>(fs.mss & 0xff)};
+        send_tcp(fs, fs.iss, TCP_FLAG_SYN, opt, sizeof(opt), 0);
+    }
+
+    void send_ack(FlowState &fs)
+    {
+        send_tcp(fs, fs.seq(fs.nxt_off), TCP_FLAG_ACK, nullptr, 0, 0);
+    }
+
+    void send_tcp(FlowState &fs,
+                  const std::uint32_t seq,
+                  const std::uint8_t flags,
+                  const std::uint8_t *opt,
+                  const size_t opt_len,
+                  const size_t payload_len)
+    {
+        const size_t tcp_len = sizeof(TCPHeader) + opt_len + payload_len;
+        const size_t size = sizeof(IPv4Header) + tcp_len;
+        BufferAllocated buf;
+        std::uint8_t *b = alloc(buf, size);
+        if (!b)
+            return;
+        write_ip_header(b, size, IPCommon::TCP, fs.dest);
+        TCPHeader *tcp = reinterpret_cast<TCPHeader *>(b + sizeof(IPv4Header));
+        tcp->source = htons(fs.sport);
+        tcp->dest = htons(fs.flow.port);
+        tcp->seq = htonl(seq);
+        tcp->ack_seq = (flags & TCP_FLAG_ACK) ? htonl(fs.rcv_nxt) : 0;
+        tcp->doff_res = static_cast<std::uint8_t>(((sizeof(TCPHeader) + opt_len) / 4) << 4);
+        tcp->flags = flags;
+        tcp->window = htons(0xffff);
+        tcp->check = 0;
+        tcp->urgent_p = 0;
+        std::uint8_t *p = reinterpret_cast<std::uint8_t *>(tcp + 1);
+        if (opt_len)
+            std::memcpy(p, opt, opt_len);
+        std::memset(p + opt_len, 0, payload_len);
+        tcp->check = tcp_checksum(b, tcp_len);
+        emit(fs, buf);
+    }
+
+    // send as much new (or go-back-N retransmitted) data as the window allows
+    void tcp_push(FlowState &fs)
+    {
+        if (fs.state != FlowState::ESTABLISHED)
+            return;
+
+        const std::uint64_t wnd = std::min<std::uint64_t>(std::uint64_t(fs.flow.window) * fs.mss, fs.peer_wnd);
+        while (fs.nxt_off - fs.una_off < wnd && (!fs.flow.bytes || fs.nxt_off < fs.flow.bytes) && !halt)
+        {
+            std::uint64_t len = std::min<std::uint64_t>(fs.mss, wnd - (fs.nxt_off - fs.una_off));
+            if (fs.flow.bytes)
+                len = std::min(len, fs.flow.bytes - fs.nxt_off);
+            if (!fs.timing && fs.nxt_off == fs.max_off)
+            {
+                fs.timing = true;
+                fs.timed_off = fs.nxt_off + len;
+                fs.timed_at = Clock::now();
+            }
+            send_tcp(fs, fs.seq(fs.nxt_off), TCP_FLAG_ACK | TCP_FLAG_PSH, nullptr, 0, static_cast<size_t>(len));
+            fs.nxt_off += len;
+            fs.max_off = std::max(fs.max_off, fs.nxt_off);
+        }
+
+        if (fs.flow.bytes && fs.una_off == fs.flow.bytes)
+        {
+            fs.state = FlowState::FIN_WAIT;
+            send_tcp(fs, fs.seq(fs.fin_off()), TCP_FLAG_FIN | TCP_FLAG_ACK, nullptr, 0, 0);
+            fs.nxt_off = fs.max_off = fs.fin_off() + 1;
+        }
+
+        if (fs.nxt_off != fs.una_off)
+            tcp_arm_rto(fs);
+        else if (fs.state == FlowState::ESTABLISHED && !fs.peer_wnd
+                 && (!fs.flow.bytes || fs.nxt_off < fs.flow.bytes))
+            tcp_arm_persist(fs);
+        else
+            tcp_stop_persist(fs);
+    }
+
+    static Time::Duration to_duration(const Clock::duration d)
+    {
+        return Time::Duration::milliseconds(std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+    }
+
+    void tcp_arm_rto(FlowState &fs)
+    {
+        if (fs.rto_pending)
+            return;
+        fs.rto_pending = true;
+        fs.rto_timer.expires_after(to_duration(fs.rto));
+        fs.rto_timer.async_wait([self = Ptr(this), fsp = &fs, gen = fs.rto_gen](const openvpn_io::error_code &error)
+                                {
+                                    // cancel() does not recall a handler whose timer already expired
+                                    if (error || self->halt || gen != fsp->rto_gen)
+                                        return;
+                                    fsp->rto_pending = false;
+                                    self->tcp_timeout(*fsp); });
+    }
+
+    void tcp_cancel_rto(FlowState &fs)
+    {
+        fs.rto_pending = false;
+        ++fs.rto_gen;
+        fs.rto_timer.cancel();
+    }
+
+    void tcp_rearm_rto(FlowState &fs)
+    {
+        tcp_cancel_rto(fs);
+        if (fs.nxt_off != fs.una_off || fs.state == FlowState::SYN_SENT)
+            tcp_arm_rto(fs);
+    }
+
+    // The peer closed its window and nothing is in flight, so no ACK will
+    // come by itself to reopen it.  Probe with a segment just below
+    // snd.una, which the peer must answer with an ACK carrying its window.
+    void tcp_arm_persist(FlowState &fs)
+    {
+        if (fs.persist != Clock::duration::zero())
+            return;
+        fs.persist = fs.rto;
+        tcp_schedule_persist(fs);
+    }
+
+    void tcp_schedule_persist(FlowState &fs)
+    {
+        fs.persist_timer.expires_after(to_duration(fs.persist));
+        fs.persist_timer.async_wait([self = Ptr(this), fsp = &fs, gen = fs.persist_gen](const openvpn_io::error_code &error)
+                                    {
+                                        if (error || self->halt || gen != fsp->persist_gen)
+                                            return;
+                                        self->tcp_persist_timeout(*fsp); });
+    }
+
+    void tcp_stop_persist(FlowState &fs)
+    {
+        if (fs.persist == Clock::duration::zero())
+            return;
+        fs.persist = Clock::duration::zero();
+        ++fs.persist_gen;
+        fs.persist_timer.cancel();
+    }
+
+    void tcp_persist_timeout(FlowState &fs)
+    {
+        if (fs.state != FlowState::ESTABLISHED || fs.peer_wnd || fs.nxt_off != fs.una_off)
+        {
+            tcp_stop_persist(fs);
+            return;
+        }
+        ++fs.stats.window_probes;
+        send_tcp(fs, fs.seq(fs.una_off) - 1, TCP_FLAG_ACK, nullptr, 0, 0);
+        fs.persist = std::min<Clock::duration>(fs.persist * 2, std::chrono::seconds(60));
+        tcp_schedule_persist(fs);
+    }
+
+    void tcp_timeout(FlowState &fs)
+    {
+        if (fs.state == FlowState::DONE || fs.state == FlowState::CLOSED)
+            return;
+        ++fs.stats.retransmits;
+        fs.rto = std::min<Clock::duration>(fs.rto * 2, std::chrono::seconds(60));
+        fs.timing = false;
+        if (fs.state == FlowState::SYN_SENT)
+        {
+            send_syn(fs);
+            tcp_arm_rto(fs);
+            return;
+        }
+        if (fs.state == FlowState::FIN_WAIT && fs.una_off == fs.fin_off())
+        {
+            send_tcp(fs, fs.seq(fs.fin_off()), TCP_FLAG_FIN | TCP_FLAG_ACK, nullptr, 0, 0);
+            tcp_arm_rto(fs);
+            return;
+        }
+        fs.nxt_off = fs.una_off;
+        tcp_push(fs);
+    }
+
+    void tcp_rtt_sample(FlowState &fs, const Clock::duration r)
+    {
+        fs.stats.add_rtt(r);
+
+        // RFC 6298
+        if (!fs.have_srtt)
+        {
+            fs.srtt = r;
+            fs.rttvar = r / 2;
+            fs.have_srtt = true;
+        }
+        else
+        {
+            const Clock::duration delta = fs.srtt > r ? fs.srtt - r : r - fs.srtt;
+            fs.rttvar = (fs.rttvar * 3 + delta) / 4;
+            fs.srtt = (fs.srtt * 7 + r) / 8;
+        }
+        fs.rto = std::max<Clock::duration>(fs.srtt + fs.rttvar * 4, std::chrono::milliseconds(200));
+    }
+
+    void tcp_input(FlowState &fs, const TCPHeader *tcp, const std::uint8_t *payload, const size_t payload_len)
+    {
+        const std::uint32_t seq = ntohl(tcp->seq);
+        const std::uint32_t ack = ntohl(tcp->ack_seq);
+
+        if (tcp->flags & TCP_FLAG_RST)
+        {
+            fs.state = FlowState::DONE;
+            tcp_cancel_rto(fs);
+            tcp_stop_persist(fs);
+            return;
+        }
+
+        if (fs.state == FlowState::SYN_SENT)
+        {
+            if ((tcp->flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) != (TCP_FLAG_SYN | TCP_FLAG_ACK) || ack != fs.iss + 1)
+                return;
+            fs.rcv_nxt = seq + 1;
+            fs.peer_wnd = ntohs(tcp->window);
+            const unsigned int peer_mss = parse_mss(tcp);
+            fs.stats.mss_received = peer_mss;
+            if (peer_mss && peer_mss < fs.mss)
+                fs.mss = static_cast<std::uint16_t>(peer_mss);
+            fs.state = FlowState::ESTABLISHED;
+            fs.stats.established = true;
+            send_ack(fs);
+            tcp_rearm_rto(fs);
+            tcp_push(fs);
+            return;
+        }
+
+        if (fs.state == FlowState::CLOSED)
+            return;
+
+        // receive side: accept in-order data only, always ACK
+        bool need_ack = false;
+        if (payload_len)
+        {
+            if (seq == fs.rcv_nxt)
+                fs.rcv_nxt += static_cast<std::uint32_t>(payload_len);
+            need_ack = true;
+        }
+        if ((tcp->flags & TCP_FLAG_FIN) && seq + payload_len == fs.rcv_nxt)
+        {
+            fs.rcv_nxt += 1;
+            need_ack = true;
+        }
+
+        // send side
+        if (tcp->flags & TCP_FLAG_ACK)
+        {
+            fs.peer_wnd = ntohs(tcp->window);
+            const std::uint64_t ack_off = fs.una_off + std::uint32_t(ack - fs.seq(fs.una_off));
+            if (ack_off > fs.una_off && ack_off <= fs.max_off)
+            {
+                const std::uint64_t data_end = fs.flow.bytes ? std::min(ack_off, fs.flow.bytes) : ack_off;
+                if (data_end > fs.una_off)
+                    fs.stats.bytes_acked += static_cast<count_t>(data_end - fs.una_off);
+                fs.una_off = ack_off;
+                if (fs.nxt_off < fs.una_off)
+                    fs.nxt_off = fs.una_off;
+                if (fs.timing && ack_off >= fs.timed_off)
+                {
+                    fs.timing = false;
+                    tcp_rtt_sample(fs, Clock::now() - fs.timed_at);
+                }
+                if (fs.state == FlowState::FIN_WAIT && fs.una_off == fs.fin_off() + 1)
+                {
+                    fs.state = FlowState::DONE;
+                    fs.stats.finished = true;
+                }
+                tcp_rearm_rto(fs);
+            }
+        }
+
+        if (need_ack)
+            send_ack(fs);
+        tcp_push(fs);
+    }
+
+    static unsigned int parse_mss(const TCPHeader *tcp)
+    {
+        const unsigned int hlen = TCPHeader::length(tcp->doff_res);
+        const std::uint8_t *opt = reinterpret_cast<const std::uint8_t *>(tcp + 1);
+        size_t olen = hlen > sizeof(TCPHeader) ? hlen - sizeof(TCPHeader) : 0;
+        while (olen > 1)
+        {
+            if (*opt == TCPHeader::OPT_EOL)
+                break;
+            if (*opt == TCPHeader::OPT_NOP)
+            {
+                ++opt;
+                --olen;
+                continue;
+            }
+            const size_t optlen = opt[1];
+            if (optlen < 2 || optlen > olen)
+                break;
+            if (*opt == TCPHeader::OPT_MAXSEG && optlen == TCPHeader::OPTLEN_MAXSEG)
+                return (opt[2] << 8) | opt[3];
+            opt += optlen;
+            olen -= optlen;
+        }
+        return 0;
+    }
+
+    // packet I/O
+
+    void input(BufferAllocated &buf)
+    {
+        if (buf.size() < sizeof(IPv4Header))
+            return;
+        const IPv4Header *ip = reinterpret_cast<const IPv4Header *>(buf.c_data());
+        if (IPCommon::version(ip->version_len) != IPCommon::IPv4)
+            return;
+        const unsigned int hlen = IPv4Header::length(ip->version_len);
+        if (hlen < sizeof(IPv4Header) || hlen > buf.size() || ntohs(ip->tot_len) > buf.size())
+            return;
+        const size_t len = ntohs(ip->tot_len) - hlen;
+        const std::uint8_t *l4 = buf.c_data() + hlen;
+
+        switch (ip->protocol)
+        {
+        case IPCommon::TCP:
+            if (len >= sizeof(TCPHeader))
+            {
+                const TCPHeader *tcp = reinterpret_cast<const TCPHeader *>(l4);
+                const unsigned int thlen = TCPHeader::length(tcp->doff_res);
+                FlowState *fs = find_flow(Flow::TCP, ntohs(tcp->dest));
+                if (fs && thlen >= sizeof(TCPHeader) && thlen <= len)
+                {
+                    count_in(*fs, buf.size());
+                    tcp_input(*fs, tcp, l4 + thlen, len - thlen);
+                }
+            }
+            break;
+        case IPCommon::UDP:
+            if (len >= sizeof(UDPHeader))
+            {
+                const UDPHeader *udp = reinterpret_cast<const UDPHeader *>(l4);
+                FlowState *fs = find_flow(Flow::UDP, ntohs(udp->dest));
+                if (fs)
+                    count_in(*fs, buf.size());
+            }
+            break;
+        case IPCommon::ICMPv4:
+            if (buf.size() >= sizeof(ICMPv4) && hlen == sizeof(IPv4Header))
+            {
+                ICMPv4 *icmp = reinterpret_cast<ICMPv4 *>(buf.data());
+                if (icmp->type == ICMPv4::ECHO_REQUEST && icmp->head.daddr == local.to_uint32_net())
+                {
+                    Ping4::generate_echo_reply(buf, nullptr);
+                    config->stats->inc_stat(SessionStats::TUN_BYTES_IN, buf.size());
+                    config->stats->inc_stat(SessionStats::TUN_PACKETS_IN, 1);
+                    parent.tun_recv(buf);
+                }
+                else if (icmp->type == ICMPv4::ECHO_REPLY)
+                {
+                    const std::uint16_t id = icmp->id;
+                    for (auto &fs : flows)
+                    {
+                        if (fs->flow.type == Flow::PING && htons(ping_id(*fs)) == id
+                            && icmp->head.saddr == fs->dest.to_uint32_net())
+                        {
+                            count_in(*fs, buf.size());
+                            std::int64_t ts;
+                            if (buf.size() >= sizeof(ICMPv4) + sizeof(ts))
+                            {
+                                std::memcpy(&ts, buf.c_data() + sizeof(ICMPv4), sizeof(ts));
+                                fs->stats.add_rtt(Clock::now() - Clock::time_point(Clock::duration(ts)));
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+            break;
+        }
+    }
+
+    FlowState *find_flow(const Flow::Type type, const std::uint16_t dport)
+    {
+        const size_t idx = dport - SOURCE_PORT_BASE;
+        if (dport >= SOURCE_PORT_BASE && idx < flows.size() && flows[idx]->flow.type == type)
+            return flows[idx].get();
+        return nullptr;
+    }
+
+    static void count_in(FlowState &fs, const size_t size)
+    {
+        ++fs.stats.packets_in;
+        fs.stats.bytes_in += size;
+    }
+
+    std::uint8_t *alloc(BufferAllocated &buf, const size_t size)
+    {
+        config->frame->prepare(Frame::READ_TUN, buf);
+        if (size > buf.remaining(0))
+            return nullptr;
+        return size ? buf.write_alloc(size) : buf.data();
+    }
+
+    void write_ip_header(std::uint8_t *b, const size_t size, const std::uint8_t proto, const IPv4::Addr &dest)
+    {
+        IPv4Header *ip = reinterpret_cast<IPv4Header *>(b);
+        ip->version_len = IPv4Header::ver_len(4, sizeof(IPv4Header));
+        ip->tos = 0;
+        ip->tot_len = htons(static_cast<std::uint16_t>(size));
+        ip->id = htons(ip_id++);
+        ip->frag_off = 0;
+        ip->ttl = 64;
+        ip->protocol = proto;
+        ip->check = 0;
+        ip->saddr = local.to_uint32_net();
+        ip->daddr = dest.to_uint32_net();
+        ip->check = IPChecksum::checksum(b, sizeof(IPv4Header));
+    }
+
+    static std::uint16_t tcp_checksum(const std::uint8_t *ip_packet, const size_t tcp_len)
+    {
+        const IPv4Header *ip = reinterpret_cast<const IPv4Header *>(ip_packet);
+        std::uint8_t pseudo[12];
+        std::memcpy(pseudo, &ip->saddr, 4);
+        std::memcpy(pseudo + 4, &ip->daddr, 4);
+        pseudo[8] = 0;
+        pseudo[9] = IPCommon::TCP;
+        pseudo[10] = static_cast<std::uint8_t>(tcp_len >> 8);
+        pseudo[11] = static_cast<std::uint8_t>(tcp_len & 0xff);
+        return IPChecksum::cfold(IPChecksum::partial(ip_packet + sizeof(IPv4Header),
+                                                     tcp_len,
+                                                     IPChecksum::compute(pseudo, sizeof(pseudo))));
+    }
+
+    void emit(FlowState &fs, BufferAllocated &buf)
+    {
+        ++fs.stats.packets_out;
+        fs.stats.bytes_out += buf.size();
+        config->stats->inc_stat(SessionStats::TUN_BYTES_IN, buf.size());
+        config->stats->inc_stat(SessionStats::TUN_PACKETS_IN, 1);
+        parent.tun_recv(buf);
+    }
+
+    openvpn_io::io_context &io_context;
+    ClientConfig::Ptr config;
+    TunClientParent &parent;
+    AsioTimer tick_timer;
+    Clock::time_point last_tick;
+    std::vector<std::unique_ptr<FlowState>> flows;
+    IPv4::Addr local;
+    IPv4::Addr gateway;
+    unsigned int mtu = 1500;
+    std::uint16_t ip_id = 0;
+    bool halt = false;
+};
+
+inline TunClient::Ptr ClientConfig::new_tun_client_obj(openvpn_io::io_context &io_context,
+                                                       TunClientParent &parent,
+                                                       TransportClient *transcli)
+{
+    return TunClient::Ptr(new Client(io_context, this, parent));
+}
+
+} // namespace openvpn::TunStack
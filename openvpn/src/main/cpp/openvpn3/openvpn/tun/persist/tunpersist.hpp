@@ -60,6 +60,7 @@ class TunPersistTemplate : public TunWrapTemplate<SCOPED_OBJ>
     void invalidate()
     {
         options_.clear();
+        persisted_copt_.reset();
     }
 
     void close()
@@ -125,6 +126,20 @@ class TunPersistTemplate : public TunWrapTemplate<SCOPED_OBJ>
         return use_persisted_tun_;
     }
 
+    // Return true and set delta if the persisted tun may be taken over
+    // by the session last passed to use_persisted_tun() by applying only
+    // what changed.  Called if use_persisted_tun() returned false.
+    bool persisted_tun_delta(TunBuilderCapture::Delta &delta) const
+    {
+        if (!TunWrapTemplate<SCOPED_OBJ>::obj_defined()
+            || !copt_
+            || !persisted_copt_
+            || options_.empty())
+            return false;
+        delta = copt_->delta(*persisted_copt_);
+        return !delta.interface_changed && (tb_ ? tb_->tun_builder_persist() : true);
+    }
+
     // Possibly save tunnel fd/handle, state, and options.
     bool persist_tun_state(const typename SCOPED_OBJ::base_type obj,
                            const STATE &state,
@@ -138,6 +153,7 @@ class TunPersistTemplate : public TunWrapTemplate<SCOPED_OBJ>
         {
             state_ = state;
             options_ = copt_->to_string();
+            persisted_copt_ = copt_;
             return true;
         }
         else
@@ -151,6 +167,7 @@ class TunPersistTemplate : public TunWrapTemplate<SCOPED_OBJ>
             tb_->tun_builder_teardown(disconnect);
         state_.reset();
         options_ = "";
+        persisted_copt_.reset();
     }
 
     const bool enable_persistence_;
@@ -159,6 +176,7 @@ class TunPersistTemplate : public TunWrapTemplate<SCOPED_OBJ>
     std::string options_;
 
     TunBuilderCapture::Ptr copt_;
+    TunBuilderCapture::Ptr persisted_copt_; // settings of the persisted tun
     bool use_persisted_tun_;
 
     bool disconnect;
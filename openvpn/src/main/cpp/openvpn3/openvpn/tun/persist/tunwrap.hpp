@@ -122,6 +122,9 @@ class TunWrapTemplate : public RC<thread_unsafe_refcount>
     // is determined by retain_obj_ enum.
     void save_replace_sock(const typename SCOPED_OBJ::base_type obj)
     {
+        // a tun reconfigured in place keeps its handle
+        if (obj_defined() && obj == obj_())
+            return;
         if (retain_obj_ == TunWrapObjRetain::RETAIN)
             obj_.replace(obj);
         else if (!obj_defined() || (retain_obj_ == TunWrapObjRetain::NO_RETAIN))
@@ -0,0 +1,573 @@
+//    OpenVPN -- An application to securely tunnel IP networks
+//               over a single port, with support for SSL/TLS-based
+//               session authentication and key exchange,
+//               packet encryption, packet authentication, and
+//               packet compression.
+//
+//    Copyright (C) 2012-2022 OpenVPN Inc.
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Affero General Public License Version 3
+//    as published by the Free Software Foundation.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public License
+//    along with this program in the COPYING file.
+//    If not, see <http://www.gnu.org/licenses/>.
+
+// OpenVPN 3 multi-client load generator.
+//
+// Runs many client sessions from a single profile over a small pool of
+// io_context threads.  Each session uses the in-process TunStack tun,
+// which, once the tunnel is up, runs the configured TCP/UDP/ICMP flows
+// towards the pushed VPN gateway.  At the end a report with handshake
+// latency percentiles, data channel throughput, per-flow goodput, RTT and
+// MSS, and failure reasons is printed.
+//
+// See README.rst in this directory for running it against a loopback
+// openvpn2 server.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openvpn/log/logbasesimple.hpp>
+
+// if initprocess.hpp is not included first, mingw/windows compilation fails
+// with weird stack struct creation related errors in OpenSSL
+#include <openvpn/init/initprocess.hpp>
+#include <openvpn/time/asiotimer.hpp>
+
+#include <client/ovpncli.hpp>
+#include <openvpn/common/platform.hpp>
+#include <openvpn/common/exception.hpp>
+#include <openvpn/common/number.hpp>
+#include <openvpn/common/getopt.hpp>
+#include <openvpn/addr/ip.hpp>
+#include <openvpn/options/merge.hpp>
+#include <openvpn/tun/extern/fw.hpp>
+#include <openvpn/tun/extern/config.hpp>
+#include <openvpn/client/cliconnect.hpp>
+#include <openvpn/client/cliopthelper.hpp>
+#include <openvpn/tun/client/tunstack.hpp>
+
+using namespace openvpn;
+
+namespace {
+OPENVPN_SIMPLE_EXCEPTION(usage);
+
+typedef std::chrono::steady_clock Clock;
+
+typedef std::vector<TunStack::Flow> Flows;
+
+// Flow stats summed over all sessions, min/max are kept for RTT and MSS
+struct FlowTotals : public TunStack::FlowStats
+{
+    unsigned int established_count = 0;
+    unsigned int finished_count = 0;
+};
+
+// Aggregated results, shared by all worker threads
+class Report
+{
+  public:
+    void add_handshake(const Clock::duration d)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handshake_ms.push_back(std::chrono::duration<double, std::milli>(d).count());
+    }
+
+    void add_error(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++errors[name];
+    }
+
+    void print(std::ostream &os,
+               const double elapsed_sec,
+               const SessionStats &totals,
+               const Flows &flows,
+               const std::vector<FlowTotals> &flow_totals)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::sort(handshake_ms.begin(), handshake_ms.end());
+
+        os << "sessions started   : " << started << std::endl;
+        os << "sessions connected : " << connected << std::endl;
+        os << "reconnects         : " << reconnects << std::endl;
+        os << "elapsed            : " << elapsed_sec << " sec" << std::endl;
+
+        if (!handshake_ms.empty())
+        {
+            os << "handshake ms       :"
+               << " min=" << handshake_ms.front()
+               << " p50=" << percentile(0.50)
+               << " p90=" << percentile(0.90)
+               << " p99=" << percentile(0.99)
+               << " max=" << handshake_ms.back() << std::endl;
+        }
+
+        for (size_t i = 0; i < SessionStats::N_STATS; ++i)
+            os << SessionStats::stat_name(i) << " : " << totals.get_stat(i) << std::endl;
+
+        if (elapsed_sec > 0)
+        {
+            const double mbit_in = double(totals.get_stat(SessionStats::BYTES_IN)) * 8 / elapsed_sec / 1e6;
+            const double mbit_out = double(totals.get_stat(SessionStats::BYTES_OUT)) * 8 / elapsed_sec / 1e6;
+            os << "throughput         : in=" << mbit_in << " Mbit/s out=" << mbit_out << " Mbit/s" << std::endl;
+        }
+
+        for (size_t i = 0; i < flows.size(); ++i)
+            print_flow(os, i, elapsed_sec, flows[i], flow_totals[i]);
+
+        for (const auto &e : errors)
+            os << "error " << e.first << " : " << e.second << std::endl;
+    }
+
+    static void print_flow(std::ostream &os,
+                           const size_t idx,
+                           const double elapsed_sec,
+                           const TunStack::Flow &flow,
+                           const FlowTotals &fs)
+    {
+        static const char *const types[] = {"udp", "tcp", "ping"};
+        os << "flow " << idx << " (" << types[flow.type] << ") :"
+           << " pkts_out=" << fs.packets_out
+           << " pkts_in=" << fs.packets_in;
+        if (flow.type == TunStack::Flow::TCP)
+        {
+            os << " established=" << fs.established_count
+               << " finished=" << fs.finished_count
+               << " retransmits=" << fs.retransmits
+               << " window_probes=" << fs.window_probes
+               << " mss_sent=" << fs.mss_sent
+               << " mss_received=" << fs.mss_received;
+            if (elapsed_sec > 0)
+                os << " goodput=" << double(fs.bytes_acked) * 8 / elapsed_sec / 1e6 << " Mbit/s";
+        }
+        if (fs.rtt_samples)
+            os << " rtt_ms min=" << fs.rtt_min_ms
+               << " avg=" << fs.rtt_avg_ms()
+               << " max=" << fs.rtt_max_ms;
+        os << std::endl;
+    }
+
+    std::atomic<unsigned int> started{0};
+    std::atomic<unsigned int> connected{0};
+    std::atomic<unsigned int> reconnects{0};
+
+  private:
+    double percentile(const double p) const
+    {
+        const size_t idx = std::min(handshake_ms.size() - 1, size_t(p * double(handshake_ms.size())));
+        return handshake_ms[idx];
+    }
+
+    std::mutex mutex;
+    std::vector<double> handshake_ms;
+    std::map<std::string, unsigned int> errors;
+};
+
+// One simulated client.  All methods run on the owning worker thread.
+class LoadSession : public ClientEvent::Queue, public ExternalTun::Factory
+{
+  public:
+    typedef RCPtr<LoadSession> Ptr;
+
+    LoadSession(Report &report_arg, const Flows &flows)
+        : report(report_arg),
+          stats(new SessionStats()),
+          tun_config(TunStack::ClientConfig::new_obj())
+    {
+        tun_config->stats = stats;
+        tun_config->flows = flows;
+    }
+
+    void start(openvpn_io::io_context &io_context,
+               const OptionList &options,
+               ClientOptions::Config cc,
+               const std::string &username,
+               const std::string &password)
+    {
+        cc.cli_events = this;
+        cc.cli_stats = stats;
+        cc.extern_tun_factory = this;
+
+        ClientOptions::Ptr client_options = new ClientOptions(options, cc);
+        if (!username.empty())
+        {
+            ClientCreds::Ptr creds(new ClientCreds());
+            creds->set_username(username);
+            creds->set_password(password);
+            client_options->submit_creds(creds);
+        }
+
+        connect.reset(new ClientConnect(io_context, client_options));
+        start_time = Clock::now();
+        ++report.started;
+        connect->start();
+    }
+
+    void stop()
+    {
+        if (connect)
+        {
+            connect->graceful_stop();
+            connect.reset();
+        }
+    }
+
+    const SessionStats &session_stats() const
+    {
+        return *stats;
+    }
+
+    // empty if the tunnel never came up
+    const std::vector<TunStack::FlowStats> &flow_stats() const
+    {
+        return tun_config->flow_stats;
+    }
+
+    void add_event(ClientEvent::Base::Ptr event) override
+    {
+        switch (event->id())
+        {
+        case ClientEvent::CONNECTED:
+            if (!connected_once)
+            {
+                connected_once = true;
+                ++report.connected;
+                report.add_handshake(Clock::now() - start_time);
+            }
+            else
+                ++report.reconnects;
+            break;
+        default:
+            if (event->is_error())
+                report.add_error(event->name());
+            break;
+        }
+    }
+
+    // the same factory is reused across reconnects so that flow stats accumulate
+    TunClientFactory *new_tun_factory(const ExternalTun::Config &conf, const OptionList &) override
+    {
+        tun_config->frame = conf.frame;
+        return tun_config.get();
+    }
+
+  private:
+    Report &report;
+    SessionStats::Ptr stats;
+    TunStack::ClientConfig::Ptr tun_config;
+    ClientConnect::Ptr connect;
+    Clock::time_point start_time;
+    bool connected_once = false;
+};
+
+class Worker
+{
+  public:
+    Worker(const OptionList &options_arg,
+           const ClientOptions::Config &cc_arg,
+           const std::string &username_arg,
+           const std::string &password_arg)
+        : io_context(1),
+          work(openvpn_io::make_work_guard(io_context)),
+          options(options_arg),
+          cc(cc_arg),
+          username(username_arg),
+          password(password_arg)
+    {
+    }
+
+    void run(const Log::Context::Wrapper &log_wrap)
+    {
+        thread = std::thread([this, log_wrap]()
+                             {
+                                 Log::Context log_context(log_wrap);
+                                 io_context.run(); });
+    }
+
+    void add_session(Report &report, const Flows &flows)
+    {
+        openvpn_io::post(io_context, [this, &report, &flows]()
+                         {
+                             LoadSession::Ptr s(new LoadSession(report, flows));
+                             sessions.push_back(s);
+                             try
+                             {
+                                 s->start(io_context, options, cc, username, password);
+                             }
+                             catch (const std::exception &e)
+                             {
+                                 report.add_error(std::string("start: ") + e.what());
+                             } });
+    }
+
+    void stop()
+    {
+        openvpn_io::post(io_context, [this]()
+                         {
+                             for (auto &s : sessions)
+                                 s->stop(); });
+        work.reset();
+    }
+
+    void join(const unsigned int grace_sec)
+    {
+        const Clock::time_point deadline = Clock::now() + std::chrono::seconds(grace_sec);
+        while (!io_context.stopped() && Clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        io_context.stop();
+        thread.join();
+    }
+
+    // only valid after join()
+    void add_stats(SessionStats &totals, std::vector<FlowTotals> &flow_totals) const
+    {
+        for (const auto &s : sessions)
+        {
+            for (size_t i = 0; i < SessionStats::N_STATS; ++i)
+                totals.inc_stat(i, s->session_stats().get_stat(i));
+            const std::vector<TunStack::FlowStats> &fs = s->flow_stats();
+            for (size_t i = 0; i < fs.size() && i < flow_totals.size(); ++i)
+                add_flow_stats(flow_totals[i], fs[i]);
+        }
+    }
+
+  private:
+    static void add_flow_stats(FlowTotals &t, const TunStack::FlowStats &f)
+    {
+        t.packets_out += f.packets_out;
+        t.bytes_out += f.bytes_out;
+        t.packets_in += f.packets_in;
+        t.bytes_in += f.bytes_in;
+        t.bytes_acked += f.bytes_acked;
+        t.retransmits += f.retransmits;
+        t.window_probes += f.window_probes;
+        if (f.rtt_samples)
+        {
+            if (!t.rtt_samples || f.rtt_min_ms < t.rtt_min_ms)
+                t.rtt_min_ms = f.rtt_min_ms;
+            t.rtt_max_ms = std::max(t.rtt_max_ms, f.rtt_max_ms);
+            t.rtt_sum_ms += f.rtt_sum_ms;
+            t.rtt_samples += f.rtt_samples;
+        }
+        t.mss_sent = std::max(t.mss_sent, f.mss_sent);
+        if (f.mss_received && (!t.mss_received || f.mss_received < t.mss_received))
+            t.mss_received = f.mss_received;
+        t.established_count += f.established;
+        t.finished_count += f.finished;
+    }
+
+    openvpn_io::io_context io_context;
+    openvpn_io::executor_work_guard<openvpn_io::io_context::executor_type> work;
+    OptionList options; // per-thread copy, OptionList is not thread-safe
+    const ClientOptions::Config cc;
+    const std::string username;
+    const std::string password;
+    std::vector<LoadSession::Ptr> sessions;
+    std::thread thread;
+};
+
+int run(int argc, char *argv[])
+{
+    static const struct option longopts[] = {
+        // clang-format off
+        { "clients",        required_argument,  nullptr,      'n' },
+        { "rate",           required_argument,  nullptr,      'r' },
+        { "threads",        required_argument,  nullptr,      'j' },
+        { "duration",       required_argument,  nullptr,      'd' },
+        { "pps",            required_argument,  nullptr,      'p' },
+        { "size",           required_argument,  nullptr,      's' },
+        { "flow",           required_argument,  nullptr,      'f' },
+        { "username",       required_argument,  nullptr,      'u' },
+        { "password",       required_argument,  nullptr,      'P' },
+        { "timeout",        required_argument,  nullptr,      't' },
+        { "verbose",        no_argument,        nullptr,      'v' },
+        { nullptr,          0,                  nullptr,      0 }
+        // clang-format on
+    };
+
+    unsigned int n_clients = 100;
+    unsigned int rate = 50;
+    unsigned int n_threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int duration = 30;
+    unsigned int timeout = 30;
+    bool verbose = false;
+    std::string username;
+    std::string password;
+    unsigned int pps = 0;
+    unsigned int pkt_size = 512;
+    Flows flows;
+
+    try
+    {
+        int ch;
+        while ((ch = getopt_long(argc, argv, "n:r:j:d:p:s:f:u:P:t:v", longopts, nullptr)) != -1)
+        {
+            switch (ch)
+            {
+            case 'n':
+                n_clients = parse_number_throw<unsigned int>(optarg, "clients");
+                break;
+            case 'r':
+                rate = parse_number_throw<unsigned int>(optarg, "rate");
+                break;
+            case 'j':
+                n_threads = parse_number_throw<unsigned int>(optarg, "threads");
+                break;
+            case 'd':
+                duration = parse_number_throw<unsigned int>(optarg, "duration");
+                break;
+            case 'p':
+                pps = parse_number_throw<unsigned int>(optarg, "pps");
+                break;
+            case 's':
+                pkt_size = parse_number_throw<unsigned int>(optarg, "size");
+                break;
+            case 'f':
+                flows.push_back(TunStack::Flow::parse(optarg));
+                break;
+            case 'u':
+                username = optarg;
+                break;
+            case 'P':
+                password = optarg;
+                break;
+            case 't':
+                timeout = parse_number_throw<unsigned int>(optarg, "timeout");
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                throw usage();
+            }
+        }
+        argc -= optind;
+        argv += optind;
+        if (argc != 1 || !n_clients || !rate || !n_threads)
+            throw usage();
+
+        // --pps/--size are shorthand for a UDP flow to the gateway
+        if (pps)
+        {
+            TunStack::Flow udp;
+            udp.rate = pps;
+            udp.size = pkt_size;
+            flows.insert(flows.begin(), udp);
+        }
+    }
+    catch (const usage &)
+    {
+        std::cout << "OpenVPN 3 load generator (ovpnloadgen)" << std::endl;
+        std::cout << "usage: ovpnloadgen [options] <config-file>" << std::endl;
+        std::cout << "--clients, -n  : number of client sessions (default 100)" << std::endl;
+        std::cout << "--rate, -r     : new sessions per second (default 50)" << std::endl;
+        std::cout << "--threads, -j  : io_context worker threads (default: #cpus)" << std::endl;
+        std::cout << "--duration, -d : seconds to keep sessions up after ramp (default 30)" << std::endl;
+        std::cout << "--pps, -p      : synthetic packets/sec per session (default 0)" << std::endl;
+        std::cout << "--size, -s     : synthetic IP packet size (default 512)" << std::endl;
+        std::cout << "--flow, -f     : add a traffic flow per session, may be repeated:" << std::endl;
+        std::cout << "                 udp|tcp|ping[,dest=<ip>][,port=<n>][,rate=<pps>][,size=<n>]" << std::endl;
+        std::cout << "                 [,bytes=<tcp payload, 0=unlimited>][,window=<segments>]" << std::endl;
+        std::cout << "--username, -u : username" << std::endl;
+        std::cout << "--password, -P : password" << std::endl;
+        std::cout << "--timeout, -t  : per-session connection timeout (default 30)" << std::endl;
+        std::cout << "--verbose, -v  : log core messages of all sessions" << std::endl;
+        return 2;
+    }
+
+    // load and parse profile once, every worker gets its own copy
+    const std::string content = ProfileMerge::merge(argv[0],
+                                                    "",
+                                                    "",
+                                                    ProfileMerge::FOLLOW_FULL,
+                                                    ProfileParseLimits::MAX_LINE_SIZE,
+                                                    ProfileParseLimits::MAX_PROFILE_SIZE);
+    OptionList options;
+    const ParseClientConfig pcc = ParseClientConfig::parse(content, nullptr, options);
+    if (pcc.error())
+        OPENVPN_THROW_EXCEPTION("profile error: " << pcc.message());
+
+    ClientOptions::Config cc;
+    cc.conn_timeout = timeout;
+    cc.proto_context_options.reset(new ProtoContextCompressionOptions());
+
+    std::unique_ptr<LogBaseSimple> log;
+    if (verbose)
+        log.reset(new LogBaseSimple());
+    const Log::Context::Wrapper log_wrap;
+
+    Report report;
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned int i = 0; i < n_threads; ++i)
+    {
+        workers.emplace_back(new Worker(options, cc, username, password));
+        workers.back()->run(log_wrap);
+    }
+
+    // ramp up at the requested rate
+    const Clock::time_point begin = Clock::now();
+    for (unsigned int i = 0; i < n_clients; ++i)
+    {
+        std::this_thread::sleep_until(begin + std::chrono::microseconds(1000000ull * i / rate));
+        workers[i % n_threads]->add_session(report, flows);
+    }
+
+    // hold, printing progress once per second
+    const Clock::time_point end = Clock::now() + std::chrono::seconds(duration);
+    while (Clock::now() < end)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::cout << "started=" << report.started
+                  << " connected=" << report.connected
+                  << " reconnects=" << report.reconnects << std::endl;
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    for (auto &w : workers)
+        w->stop();
+    SessionStats totals;
+    std::vector<FlowTotals> flow_totals(flows.size());
+    for (auto &w : workers)
+    {
+        w->join(5);
+        w->add_stats(totals, flow_totals);
+    }
+
+    report.print(std::cout, elapsed, totals, flows, flow_totals);
+    return report.connected == n_clients ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+    InitProcess::Init init;
+
+    try
+    {
+        ret = run(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Main thread exception: " << e.what() << std::endl;
+        ret = 1;
+    }
+    return ret;
+}
@@ -260,7 +260,17 @@ class Client : public ClientBase
     void print_stats()
     {
         const int n = stats_n();
-        std::vector<long long> stats = stats_bundle();
+        std::vector<long long> stats;
+
+        // read the shared stats page if it was enabled with --stats-page
+        const ClientAPI::StatsPageBuffer page = stats_page();
+        if (page.data)
+        {
+            const long long lpr = ClientStatsPage::read(page.data, stats);
+            std::cout << "STATS PAGE: " << page.size << " bytes, last packet received " << lpr << " ms ago" << std::endl;
+        }
+        else
+            stats = stats_bundle();
 
         std::cout << "STATS:" << std::endl;
         for (int i = 0; i < n; ++i)
@@ -821,6 +831,7 @@ class Client : public ClientBase
 };
 
 static Client *the_client = nullptr; // GLOBAL
+static bool hup_migrate = false;     // GLOBAL
 
 static void worker_thread()
 {
@@ -974,7 +985,12 @@ static void handler(int signum)
     case SIGHUP:
         std::cout << "received reconnect signal " << signum << std::endl;
         if (the_client)
-            the_client->reconnect(0);
+        {
+            if (hup_migrate)
+                the_client->migrate_transport(0);
+            else
+                the_client->reconnect(0);
+        }
         break;
     case SIGUSR1:
         if (the_client)
@@ -1046,6 +1062,7 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
         { "acc-protos",     required_argument,  nullptr,      'K' },
         { "gremlin",        required_argument,  nullptr,      'G' },
         { "proxy-basic",    no_argument,        nullptr,      'B' },
+        { "proxy-preconnect", no_argument,      nullptr,       10 },
         { "alt-proxy",      no_argument,        nullptr,      'A' },
 #if defined(ENABLE_KOVPN) || defined(ENABLE_OVPNDCO) || defined(ENABLE_OVPNDCOWIN)
         { "no-dco",         no_argument,        nullptr,      'd' },
@@ -1077,6 +1094,9 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
         { "remote-override",required_argument,  nullptr,       5  },
 #endif
         { "tbc",            no_argument,        nullptr,       6  },
+        { "stats-page",     required_argument,  nullptr,       7  },
+        { "timer-slack",    required_argument,  nullptr,       8  },
+        { "hup-migrate",    no_argument,        nullptr,       9  },
         { "app-custom-protocols", required_argument, nullptr, 'K' },
         { "certcheck-cert", required_argument, nullptr, 'o' },
         { "certcheck-pkey", required_argument, nullptr, 'O' },
@@ -1121,8 +1141,11 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
             bool self_test = false;
             bool disableClientCert = false;
             bool proxyAllowCleartextAuth = false;
+            bool proxyPreconnect = false;
             int defaultKeyDirection = -1;
             int sslDebugLevel = 0;
+            unsigned int statsPageMS = 0;
+            unsigned int timerSlackMS = 0;
             bool googleDnsFallback = false;
             bool autologinSessions = false;
             bool retryOnAuthFailed = false;
@@ -1176,6 +1199,18 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
                 case 6: // --tbc
                     generateTunBuilderCaptureEvent = true;
                     break;
+                case 7: // --stats-page
+                    statsPageMS = ::atoi(optarg);
+                    break;
+                case 8: // --timer-slack
+                    timerSlackMS = ::atoi(optarg);
+                    break;
+                case 9: // --hup-migrate
+                    hup_migrate = true;
+                    break;
+                case 10: // --proxy-preconnect
+                    proxyPreconnect = true;
+                    break;
                 case 'e':
                     eval = true;
                     break;
@@ -1376,11 +1411,14 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
                     config.proxyUsername = proxyUsername;
                     config.proxyPassword = proxyPassword;
                     config.proxyAllowCleartextAuth = proxyAllowCleartextAuth;
+                    config.proxyPreconnect = proxyPreconnect;
                     config.altProxy = altProxy;
                     config.dco = dco;
                     config.generateTunBuilderCaptureEvent = generateTunBuilderCaptureEvent;
                     config.defaultKeyDirection = defaultKeyDirection;
                     config.sslDebugLevel = sslDebugLevel;
+                    config.statsPageMS = statsPageMS;
+                    config.timerSlackMS = timerSlackMS;
                     config.googleDnsFallback = googleDnsFallback;
                     config.autologinSessions = autologinSessions;
                     config.retryOnAuthFailed = retryOnAuthFailed;
@@ -1607,6 +1645,8 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
         std::cout << "--proxy-username, -U       : HTTP proxy username" << std::endl;
         std::cout << "--proxy-password, -W       : HTTP proxy password" << std::endl;
         std::cout << "--proxy-basic, -B          : allow HTTP basic auth" << std::endl;
+        std::cout << "--proxy-preconnect         : keep a spare tunnel through the HTTP proxy for reconnects" << std::endl;
+        std::cout << "                             (the server sees a new unauthenticated connection every 45s)" << std::endl;
         std::cout << "--alt-proxy, -A            : enable alternative proxy module" << std::endl;
 #if defined(ENABLE_KOVPN) || defined(ENABLE_OVPNDCO) || defined(ENABLE_OVPNDCOWIN)
         std::cout << "--no-dco, -d               : disable data channel offload" << std::endl;
@@ -1628,6 +1668,9 @@ int openvpn_client(int argc, char *argv[], const std::string *profile_content)
         std::cout << "--sso-methods              : auth pending methods to announce via IV_SSO" << std::endl;
         std::cout << "--write-url, -Z            : write INFO URL to file" << std::endl;
         std::cout << "--tbc                      : generate INFO_JSON/TUN_BUILDER_CAPTURE event" << std::endl;
+        std::cout << "--stats-page               : update a shared stats page every n milliseconds, read by F2/SIGUSR1" << std::endl;
+        std::cout << "--timer-slack              : coalesce timer wakeups, delaying them by up to n milliseconds" << std::endl;
+        std::cout << "--hup-migrate              : SIGHUP migrates the transport to the current network instead of reconnecting" << std::endl;
         std::cout << "--app-custom-protocols, -K : ACC protocols to advertise" << std::endl;
         std::cout << "--certcheck-cert, -o       : path to certificate PEM for certcheck" << std::endl;
         std::cout << "--certcheck-pkey, -O       : path to decrypted pkey PEM for certcheck" << std::endl;
@@ -5,6 +5,11 @@
 #include <openvpn/common/exception.hpp>
 #include <openvpn/common/file.hpp>
 #include <openvpn/tun/builder/capture.hpp>
+#include <openvpn/tun/persist/tunwrap.hpp>
+#include <openvpn/common/scoped_fd.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace openvpn;
 
@@ -61,3 +66,187 @@ TEST(misc, capture)
 
     ASSERT_EQ(j1_txt, j2_txt) << "round trip failed";
 }
+
+namespace {
+
+TunBuilderCapture::Ptr delta_capture()
+{
+    TunBuilderCapture::Ptr tbc(new TunBuilderCapture);
+    tbc->tun_builder_set_session_name("one");
+    tbc->tun_builder_set_remote_address("52.7.171.249", false);
+    tbc->tun_builder_add_address("10.8.0.2", 24, "10.8.0.1", false, false);
+    tbc->tun_builder_set_mtu(1500);
+    tbc->tun_builder_reroute_gw(true, false, 0);
+    tbc->tun_builder_add_route("192.168.0.0", 16, -1, false);
+    tbc->tun_builder_add_route("10.0.0.0", 8, -1, false);
+    tbc->tun_builder_exclude_route("10.10.0.0", 24, -1, false);
+    tbc->tun_builder_add_dns_server("8.8.8.8", false);
+    tbc->tun_builder_add_dns_server("8.8.4.4", false);
+    tbc->tun_builder_add_search_domain("openvpn.net");
+    return tbc;
+}
+
+// records the reconfiguration calls
+class ReconfigureBuilder : public TunBuilderBase
+{
+  public:
+    bool tun_builder_reconfigure_begin() override
+    {
+        calls.push_back("begin");
+        return allow;
+    }
+
+    bool tun_builder_set_remote_address(const std::string &address, bool ipv6) override
+    {
+        calls.push_back("remote " + address);
+        return true;
+    }
+
+    bool tun_builder_add_route(const std::string &address, int prefix_length, int metric, bool ipv6) override
+    {
+        calls.push_back("add route " + address + "/" + std::to_string(prefix_length));
+        return true;
+    }
+
+    bool tun_builder_remove_route(const std::string &address, int prefix_length, int metric, bool ipv6) override
+    {
+        calls.push_back("remove route " + address + "/" + std::to_string(prefix_length));
+        return true;
+    }
+
+    bool tun_builder_exclude_route(const std::string &address, int prefix_length, int metric, bool ipv6) override
+    {
+        calls.push_back("add exclude " + address + "/" + std::to_string(prefix_length));
+        return true;
+    }
+
+    bool tun_builder_remove_exclude_route(const std::string &address, int prefix_length, int metric, bool ipv6) override
+    {
+        calls.push_back("remove exclude " + address + "/" + std::to_string(prefix_length));
+        return true;
+    }
+
+    bool tun_builder_add_dns_server(const std::string &address, bool ipv6) override
+    {
+        calls.push_back("add dns " + address);
+        return true;
+    }
+
+    bool tun_builder_remove_dns_server(const std::string &address, bool ipv6) override
+    {
+        calls.push_back("remove dns " + address);
+        return true;
+    }
+
+    bool tun_builder_add_search_domain(const std::string &domain) override
+    {
+        calls.push_back("add domain " + domain);
+        return true;
+    }
+
+    bool tun_builder_remove_search_domain(const std::string &domain) override
+    {
+        calls.push_back("remove domain " + domain);
+        return true;
+    }
+
+    bool allow = true;
+    std::vector<std::string> calls;
+};
+
+} // namespace
+
+TEST(misc, capture_delta_unchanged)
+{
+    TunBuilderCapture::Ptr prev = delta_capture();
+    TunBuilderCapture::Ptr cur(new TunBuilderCapture);
+    cur->tun_builder_set_session_name("two");
+    cur->tun_builder_set_remote_address("52.7.171.249", false);
+    cur->tun_builder_add_address("10.8.0.2", 24, "10.8.0.1", false, false);
+    cur->tun_builder_set_mtu(1500);
+    cur->tun_builder_reroute_gw(true, false, 0);
+    // same routes in a different order
+    cur->tun_builder_add_route("10.0.0.0", 8, -1, false);
+    cur->tun_builder_add_route("192.168.0.0", 16, -1, false);
+    cur->tun_builder_exclude_route("10.10.0.0", 24, -1, false);
+    cur->tun_builder_add_dns_server("8.8.8.8", false);
+    cur->tun_builder_add_dns_server("8.8.4.4", false);
+    cur->tun_builder_add_search_domain("openvpn.net");
+
+    ASSERT_NE(prev->to_string(), cur->to_string());
+    ASSERT_TRUE(cur->delta(*prev).empty());
+}
+
+TEST(misc, capture_delta_routes_dns)
+{
+    TunBuilderCapture::Ptr prev = delta_capture();
+    TunBuilderCapture::Ptr cur = delta_capture();
+    cur->tun_builder_set_remote_address("52.7.171.250", false);
+    cur->add_routes.erase(cur->add_routes.begin());
+    cur->tun_builder_add_route("172.16.0.0", 12, -1, false);
+    cur->exclude_routes.clear();
+    cur->reset_dns_servers();
+    cur->tun_builder_add_dns_server("8.8.4.4", false);
+    cur->tun_builder_add_dns_server("8.8.8.8", false);
+
+    const TunBuilderCapture::Delta delta = cur->delta(*prev);
+    ASSERT_FALSE(delta.interface_changed);
+    ASSERT_FALSE(delta.empty());
+
+    ReconfigureBuilder tb;
+    ASSERT_TRUE(delta.apply(&tb));
+    const std::vector<std::string> expected = {
+        "begin",
+        "remote 52.7.171.250",
+        "remove route 192.168.0.0/16",
+        "remove exclude 10.10.0.0/24",
+        "remove dns 8.8.8.8",
+        "remove dns 8.8.4.4",
+        "add route 172.16.0.0/12",
+        "add dns 8.8.4.4",
+        "add dns 8.8.8.8",
+    };
+    ASSERT_EQ(tb.calls, expected);
+
+    // a builder without reconfiguration support
+    ReconfigureBuilder refuse;
+    refuse.allow = false;
+    ASSERT_FALSE(delta.apply(&refuse));
+}
+
+TEST(misc, capture_delta_interface)
+{
+    TunBuilderCapture::Ptr prev = delta_capture();
+
+    TunBuilderCapture::Ptr cur = delta_capture();
+    cur->reset_tunnel_addresses();
+    cur->tun_builder_add_address("10.8.0.3", 24, "10.8.0.1", false, false);
+    ASSERT_TRUE(cur->delta(*prev).interface_changed);
+
+    cur = delta_capture();
+    cur->tun_builder_set_mtu(1400);
+    ASSERT_TRUE(cur->delta(*prev).interface_changed);
+
+    cur = delta_capture();
+    cur->tun_builder_reroute_gw(true, true, 0);
+    const TunBuilderCapture::Delta delta = cur->delta(*prev);
+    ASSERT_TRUE(delta.interface_changed);
+
+    ReconfigureBuilder tb;
+    ASSERT_FALSE(delta.apply(&tb));
+    ASSERT_TRUE(tb.calls.empty());
+}
+
+TEST(misc, tunwrap_replace_same_fd)
+{
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    ::close(fds[1]);
+
+    TunWrapTemplate<ScopedFD>::Ptr tw(new TunWrapTemplate<ScopedFD>(TunWrapObjRetain::NO_RETAIN));
+    tw->save_replace_sock(fds[0]);
+    // a tun reconfigured in place returns the same descriptor
+    tw->save_replace_sock(fds[0]);
+    ASSERT_EQ(tw->obj(), fds[0]);
+    ASSERT_NE(::fcntl(fds[0], F_GETFD), -1);
+}
@@ -65,3 +65,75 @@ TEST(misc, stress_csum)
             << std::endl;
     }
 }
+
+TEST(misc, csum_unaligned_large)
+{
+    RandomAPI::Ptr prng(new MTRand);
+    BufferAllocated buf(2048, 0);
+
+    for (long i = 0; i < 100000; ++i)
+    {
+        buf.init_headroom(prng->rand_get<std::uint8_t>() & 7);
+        const size_t size = prng->rand_get<std::uint16_t>() % 1500;
+        std::uint8_t *raw = buf.write_alloc(size);
+        prng->rand_bytes(raw, size);
+        ASSERT_EQ(IPChecksum::checksum(raw, size), ip_checksum_slow(raw, size))
+            << "size=" << size << " offset=" << (size_t(raw) & 7);
+    }
+}
+
+TEST(misc, csum_simd_kernels)
+{
+    RandomAPI::Ptr prng(new MTRand);
+    std::uint8_t data[1024 + 4];
+
+    for (long i = 0; i < 10000; ++i)
+    {
+        const size_t offset = prng->rand_get<std::uint8_t>() & 3;
+        const size_t size = (prng->rand_get<std::uint16_t>() % 1024) & ~size_t(3);
+        prng->rand_bytes(data, sizeof(data));
+        const std::uint8_t *p = data + offset;
+        const std::uint64_t expected = IPChecksum::detail::sum32_scalar(p, size);
+#ifdef OPENVPN_IPCHECKSUM_SSE2
+        ASSERT_EQ(IPChecksum::detail::sum32_sse2(p, size), expected) << "size=" << size;
+#endif
+#ifdef OPENVPN_IPCHECKSUM_AVX2
+        if (IPChecksum::detail::have_avx2())
+        {
+            ASSERT_EQ(IPChecksum::detail::sum32_avx2(p, size), expected) << "size=" << size;
+        }
+#endif
+#ifdef OPENVPN_IPCHECKSUM_NEON
+        ASSERT_EQ(IPChecksum::detail::sum32_neon(p, size), expected) << "size=" << size;
+#endif
+        ASSERT_EQ(IPChecksum::detail::sum32(p, size), expected) << "size=" << size;
+    }
+}
+
+TEST(misc, csum_incremental_update)
+{
+    RandomAPI::Ptr prng(new MTRand);
+    std::uint8_t data[64];
+
+    for (long i = 0; i < 100000; ++i)
+    {
+        prng->rand_bytes(data, sizeof(data));
+        const std::uint16_t orig_csum = IPChecksum::checksum(data, sizeof(data));
+
+        const size_t idx16 = (prng->rand_get<std::uint8_t>() % (sizeof(data) / 2)) * 2;
+        std::uint16_t old16, new16;
+        std::memcpy(&old16, data + idx16, sizeof(old16));
+        new16 = prng->rand_get<std::uint16_t>();
+        std::memcpy(data + idx16, &new16, sizeof(new16));
+        const std::uint16_t csum16 = IPChecksum::update16(orig_csum, old16, new16);
+        ASSERT_EQ(csum16, IPChecksum::checksum(data, sizeof(data))) << "update16 idx=" << idx16;
+
+        const size_t idx32 = (prng->rand_get<std::uint8_t>() % (sizeof(data) / 4)) * 4;
+        std::uint32_t old32, new32;
+        std::memcpy(&old32, data + idx32, sizeof(old32));
+        new32 = prng->rand_get<std::uint32_t>();
+        std::memcpy(data + idx32, &new32, sizeof(new32));
+        const std::uint16_t csum32 = IPChecksum::update32(csum16, old32, new32);
+        ASSERT_EQ(csum32, IPChecksum::checksum(data, sizeof(data))) << "update32 idx=" << idx32;
+    }
+}
@@ -78,3 +78,32 @@ TEST(HttpProxyClient, Options)
     ASSERT_EQ(po->allow_cleartext_auth, false);
     ASSERT_EQ(po->auth_method, HTTPProxyTransport::AuthMethod::Any);
 }
+
+TEST(HttpProxyClient, PreConnectAuthCache)
+{
+    HTTPProxyTransport::PreConnect::Ptr pc(new HTTPProxyTransport::PreConnect());
+    ASSERT_FALSE(pc->auth());
+
+    HTTPProxy::ProxyAuthenticate::Ptr digest(new HTTPProxy::ProxyAuthenticate("Digest realm=\"r\", nonce=\"n\""));
+    pc->set_auth(digest);
+    ASSERT_EQ(pc->auth(), digest);
+
+    // the nonce was used once by the request that answered the challenge
+    ASSERT_EQ(pc->next_nonce_count(), 2u);
+    ASSERT_EQ(pc->next_nonce_count(), 3u);
+
+    // a cached answer that was accepted keeps the count going
+    pc->set_auth(digest);
+    ASSERT_EQ(pc->next_nonce_count(), 4u);
+
+    // a new challenge starts over
+    pc->set_auth(new HTTPProxy::ProxyAuthenticate("Digest realm=\"r\", nonce=\"m\""));
+    ASSERT_EQ(pc->next_nonce_count(), 2u);
+
+    pc->clear_auth();
+    ASSERT_FALSE(pc->auth());
+
+    pc->set_auth(digest);
+    pc->stop();
+    ASSERT_FALSE(pc->auth());
+}
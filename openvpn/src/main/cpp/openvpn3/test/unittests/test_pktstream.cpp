@@ -144,6 +144,76 @@ TEST(pktstream, test_32_residual)
     do_test<PacketStreamResidual<std::uint32_t>>(true, false);
 }
 
+// Like do_test, but reads the stream into one persistent buffer and
+// extracts the packets with get_all().
+template <typename PKTSTREAM>
+static void do_test_get_all()
+{
+#ifdef HAVE_VALGRIND
+    const int n_iter = 500;
+#else
+    const int n_iter = 25000;
+#endif
+
+    const Frame::Context fc(256, 512, 256, 0, sizeof(size_t), 0);
+    MTRand::Ptr prng(new MTRand());
+
+    for (int iter = 0; iter < n_iter; ++iter)
+    {
+        // build the stream
+        BufferAllocated stream(8192, 0);
+        size_t n_stream = 0;
+        {
+            BufferAllocated src;
+            while (true)
+            {
+                fc.prepare(src);
+                const size_t r = rand_size(*prng);
+                for (size_t i = 0; i < r; ++i)
+                    src.push_back('a' + static_cast<unsigned char>((i + n_stream) % 26));
+                PKTSTREAM::prepend_size(src);
+                if (src.size() > stream.remaining())
+                    break;
+                stream.write(src.data(), src.size());
+                ++n_stream;
+            }
+        }
+        const Buffer orig(stream);
+
+        // read it in random chunks, as a link would
+        BufferAllocated in(1024, 0);
+        BufferAllocated pkt;
+        BufferAllocated cmp(8192, 0);
+        size_t n_cmp = 0;
+        while (stream.size())
+        {
+            const size_t bytes = std::min({stream.size(), in.remaining(), size_t(prng->randrange32(1, 1024))});
+            in.write(stream.data(), bytes);
+            stream.advance(bytes);
+            PKTSTREAM::get_all(in, pkt, fc, [&](BufferAllocated &out)
+                               {
+                PKTSTREAM::prepend_size(out);
+                cmp.write(out.data(), out.size());
+                ++n_cmp; });
+            in.realign(0);
+        }
+
+        ASSERT_TRUE(in.empty());
+        ASSERT_EQ(n_stream, n_cmp);
+        ASSERT_EQ(orig, cmp);
+    }
+}
+
+TEST(pktstream, get_all_16)
+{
+    do_test_get_all<PacketStream<std::uint16_t>>();
+}
+
+TEST(pktstream, get_all_32)
+{
+    do_test_get_all<PacketStream<std::uint32_t>>();
+}
+
 template <typename PKTSTREAM>
 static void validate_size(const Frame::Context &fc, const size_t size, const bool expect_throw)
 {
@@ -0,0 +1,73 @@
+#include "test_common.h"
+
+#include <thread>
+
+#include <openvpn/client/clistatspage.hpp>
+
+using namespace openvpn;
+
+TEST(statspage, layout)
+{
+    ClientStatsPage page(5, 1000);
+    const unsigned char *p = static_cast<const unsigned char *>(page.data());
+
+    ASSERT_EQ(page.size(), 32u + 5 * 8);
+    ASSERT_EQ(page.n_values(), 5u);
+    ASSERT_EQ(std::memcmp(p, "OVSP", 4), 0);
+
+    std::uint16_t version, header_size;
+    std::uint32_t n;
+    std::memcpy(&version, p + 4, sizeof(version));
+    std::memcpy(&header_size, p + 6, sizeof(header_size));
+    std::memcpy(&n, p + 12, sizeof(n));
+    ASSERT_EQ(version, 1);
+    ASSERT_EQ(header_size, 32);
+    ASSERT_EQ(n, 5u);
+
+    page.publish([](const size_t i)
+                 { return (long long)i * 10; },
+                 1234);
+
+    std::uint32_t seq;
+    std::int64_t value, lpr;
+    std::memcpy(&seq, p + 8, sizeof(seq));
+    std::memcpy(&lpr, p + 16, sizeof(lpr));
+    std::memcpy(&value, p + 32 + 3 * 8, sizeof(value));
+    ASSERT_EQ(seq, 2u);
+    ASSERT_EQ(lpr, 1234);
+    ASSERT_EQ(value, 30);
+
+    std::vector<long long> out;
+    ASSERT_EQ(ClientStatsPage::read(page.data(), out), 1234);
+    ASSERT_EQ(out, (std::vector<long long>{0, 10, 20, 30, 40}));
+}
+
+TEST(statspage, consistent_read)
+{
+    ClientStatsPage page(64, 1);
+    std::atomic<bool> done{false};
+
+    std::thread writer([&]()
+                       {
+        for (long long round = 1; round <= 20000; ++round)
+            page.publish([round](const size_t)
+                         { return round; },
+                         round);
+        done = true; });
+
+    std::vector<long long> out;
+    long long last = 0;
+    while (!done)
+    {
+        const long long lpr = ClientStatsPage::read(page.data(), out);
+        if (lpr < 0) // not published yet
+            continue;
+        for (const long long v : out)
+            ASSERT_EQ(v, lpr);
+        ASSERT_GE(lpr, last);
+        last = lpr;
+    }
+    writer.join();
+
+    ASSERT_EQ(ClientStatsPage::read(page.data(), out), 20000);
+}
@@ -0,0 +1,123 @@
+#include "test_common.h"
+
+#include <vector>
+
+#include <openvpn/io/io.hpp>
+#include <openvpn/transport/tcplink.hpp>
+
+using namespace openvpn;
+
+namespace {
+
+struct LinkHandler
+{
+    typedef TCPTransport::TCPLink<openvpn_io::ip::tcp, LinkHandler *, false> Link;
+
+    bool tcp_read_handler(BufferAllocated &buf)
+    {
+        received.emplace_back(buf.c_data(), buf.c_data() + buf.size());
+        if (received.size() == expected && link)
+            link->stop();
+        return received.size() < expected;
+    }
+
+    void tcp_write_queue_needs_send()
+    {
+        ++queue_empty;
+    }
+
+    void tcp_eof_handler()
+    {
+    }
+
+    void tcp_error_handler(const char *error)
+    {
+        errors.emplace_back(error);
+    }
+
+    Link::Ptr link;
+    size_t expected = 0;
+    std::vector<std::vector<unsigned char>> received;
+    std::vector<std::string> errors;
+    unsigned int queue_empty = 0;
+};
+
+void send_packets(const size_t gather, const size_t n_packets, const size_t recv_batch = 0)
+{
+    openvpn_io::io_context io_context;
+    openvpn_io::ip::tcp::acceptor acceptor(io_context, {openvpn_io::ip::make_address("127.0.0.1"), 0});
+    openvpn_io::ip::tcp::socket client(io_context);
+    openvpn_io::ip::tcp::socket server(io_context);
+    client.connect(acceptor.local_endpoint());
+    acceptor.accept(server);
+
+    const Frame::Context frame_context(128, 2048, 128, 0, sizeof(size_t), 0);
+    SessionStats::Ptr client_stats(new SessionStats());
+    SessionStats::Ptr server_stats(new SessionStats());
+
+    LinkHandler sender;
+    LinkHandler receiver;
+    receiver.expected = n_packets;
+
+    sender.link.reset(new LinkHandler::Link(&sender, client, 0, 8, frame_context, client_stats));
+    sender.link->set_send_gather(gather);
+    receiver.link.reset(new LinkHandler::Link(&receiver, server, 0, 8, frame_context, server_stats));
+    receiver.link->set_recv_batch(recv_batch);
+    receiver.link->start();
+
+    // queued while the first send is in progress
+    for (size_t i = 0; i < n_packets; ++i)
+    {
+        BufferAllocated buf;
+        frame_context.prepare(buf);
+        for (size_t j = 0; j < 1 + i % 1400; ++j)
+            buf.push_back(static_cast<unsigned char>(i + j));
+        ASSERT_TRUE(sender.link->send(buf));
+    }
+
+    io_context.run();
+    sender.link->stop();
+
+    ASSERT_TRUE(sender.errors.empty());
+    ASSERT_TRUE(receiver.errors.empty());
+    ASSERT_EQ(receiver.received.size(), n_packets);
+    for (size_t i = 0; i < n_packets; ++i)
+    {
+        const std::vector<unsigned char> &pkt = receiver.received[i];
+        ASSERT_EQ(pkt.size(), 1 + i % 1400);
+        for (size_t j = 0; j < pkt.size(); ++j)
+            ASSERT_EQ(pkt[j], static_cast<unsigned char>(i + j));
+    }
+    ASSERT_TRUE(sender.link->send_queue_empty());
+    ASSERT_GE(sender.queue_empty, 1u);
+    ASSERT_EQ(client_stats->get_stat(SessionStats::BYTES_OUT), server_stats->get_stat(SessionStats::BYTES_IN));
+}
+
+} // namespace
+
+TEST(tcplink, send_one_by_one)
+{
+    send_packets(0, 500);
+}
+
+TEST(tcplink, send_gather)
+{
+    send_packets(65536, 500);
+}
+
+TEST(tcplink, recv_batch)
+{
+    send_packets(65536, 500, 65536);
+}
+
+TEST(tcplink, recv_batch_small)
+{
+    // rounded up to hold the largest packet
+    send_packets(0, 500, 1);
+}
+
+TEST(tcplink, send_gather_small_limit)
+{
+    // smaller than most packets, so that a send has a single packet
+    send_packets(100, 200);
+}
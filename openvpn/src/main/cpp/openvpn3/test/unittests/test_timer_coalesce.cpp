@@ -0,0 +1,80 @@
+#include "test_common.h"
+
+#include <openvpn/time/coalesce.hpp>
+
+using namespace openvpn;
+
+TEST(timer_coalesce, disabled)
+{
+    TimerCoalesce tc(Time::Duration(), nullptr);
+    const Time now = Time::now();
+    const Time t = now + Time::Duration::binary_ms(10001);
+
+    ASSERT_FALSE(tc.enabled());
+    ASSERT_EQ(tc.align(t, now), t);
+}
+
+TEST(timer_coalesce, align)
+{
+    // one second of slack is a step of 1024 binary ms
+    TimerCoalesce tc(Time::Duration::seconds(1), nullptr);
+    const Time now = Time::now();
+    ASSERT_TRUE(tc.enabled());
+
+    // 1000 ms are 1023 binary ms, so the step would be 512
+    ASSERT_EQ(TimerCoalesce(Time::Duration::milliseconds(1000), nullptr).align(now + Time::Duration::binary_ms(10000), now).raw() % 512, 0u);
+
+    // long timers are rounded up to the full step
+    for (unsigned int ms = 8193; ms < 8193 + 3000; ms += 7)
+    {
+        const Time t = now + Time::Duration::binary_ms(ms);
+        const Time a = tc.align(t, now);
+        ASSERT_GE(a, t);
+        ASSERT_LT((a - t).raw(), 1024u);
+        ASSERT_EQ(a.raw() % 1024, 0u);
+    }
+
+    // timers before the same grid point share a deadline
+    const Time grid = tc.align(now + Time::Duration::binary_ms(20000), now);
+    const Time::type d = (grid - now).raw();
+    ASSERT_EQ(tc.align(now + Time::Duration::binary_ms(d - 300), now), grid);
+    ASSERT_EQ(tc.align(now + Time::Duration::binary_ms(d - 1023), now), grid);
+    ASSERT_EQ(tc.align(grid, now), grid);
+
+    // short timers get at most 1/8 of their delay
+    const Time shortt = now + Time::Duration::binary_ms(800);
+    const Time a = tc.align(shortt, now);
+    ASSERT_GE(a, shortt);
+    ASSERT_LE((a - shortt).raw(), 800u / 8);
+
+    // very short and past deadlines are left alone
+    const Time tiny = now + Time::Duration::binary_ms(10);
+    ASSERT_EQ(tc.align(tiny, now), tiny);
+    ASSERT_EQ(tc.align(now, now), now);
+    ASSERT_TRUE(tc.align(Time::infinite(), now).is_infinite());
+}
+
+TEST(timer_coalesce, wakeups)
+{
+    SessionStats::Ptr stats(new SessionStats());
+    TimerCoalesce tc(Time::Duration::seconds(1), stats);
+    Time now = Time::now();
+
+    // one wakeup every 10 seconds, the handlers of a wakeup run together
+    for (int i = 0; i < 60; ++i)
+    {
+        tc.wakeup(now);
+        tc.wakeup(now + Time::Duration::binary_ms(2));
+        now += Time::Duration::seconds(10);
+    }
+    ASSERT_EQ(tc.wakeup_count(), 60);
+    ASSERT_EQ(stats->get_stat(SessionStats::TIMER_WAKEUPS_PER_HOUR), 360);
+
+    // after the first hour, the stat is the count of the last full hour
+    for (int i = 0; i < 400; ++i)
+    {
+        tc.wakeup(now);
+        now += Time::Duration::seconds(30);
+    }
+    ASSERT_EQ(stats->get_stat(SessionStats::TIMER_WAKEUPS_PER_HOUR), 120);
+}
@@ -0,0 +1,289 @@
+#include "test_common.h"
+
+#include <cstring>
+#include <vector>
+
+#include <openvpn/frame/frame_init.hpp>
+#include <openvpn/tun/client/tunstack.hpp>
+
+using namespace openvpn;
+
+namespace {
+
+struct CaptureParent : public TunClientParent
+{
+    void tun_recv(BufferAllocated &buf) override
+    {
+        packets.emplace_back(buf.c_data(), buf.c_data() + buf.size());
+    }
+
+    void tun_error(const Error::Type, const std::string &) override
+    {
+    }
+
+    void tun_pre_tun_config() override
+    {
+    }
+
+    void tun_pre_route_config() override
+    {
+    }
+
+    void tun_connected() override
+    {
+        connected = true;
+    }
+
+    std::vector<std::vector<std::uint8_t>> packets;
+    bool connected = false;
+};
+
+const IPv4Header *ip_of(const std::vector<std::uint8_t> &pkt)
+{
+    return reinterpret_cast<const IPv4Header *>(pkt.data());
+}
+
+const TCPHeader *tcp_of(const std::vector<std::uint8_t> &pkt)
+{
+    return reinterpret_cast<const TCPHeader *>(pkt.data() + sizeof(IPv4Header));
+}
+
+bool tcp_checksum_ok(const std::vector<std::uint8_t> &pkt)
+{
+    const IPv4Header *ip = ip_of(pkt);
+    const size_t tcp_len = pkt.size() - sizeof(IPv4Header);
+    std::uint8_t pseudo[12];
+    std::memcpy(pseudo, &ip->saddr, 4);
+    std::memcpy(pseudo + 4, &ip->daddr, 4);
+    pseudo[8] = 0;
+    pseudo[9] = IPCommon::TCP;
+    pseudo[10] = static_cast<std::uint8_t>(tcp_len >> 8);
+    pseudo[11] = static_cast<std::uint8_t>(tcp_len);
+    const std::uint32_t sum = IPChecksum::partial(pkt.data() + sizeof(IPv4Header), tcp_len, IPChecksum::compute(pseudo, sizeof(pseudo)));
+    return IPChecksum::cfold(sum) == 0 && IPChecksum::checksum(pkt.data(), sizeof(IPv4Header)) == 0;
+}
+
+// build a segment from the peer in reply to one of ours
+BufferAllocated peer_segment(const std::vector<std::uint8_t> &ours,
+                             const std::uint32_t seq,
+                             const std::uint32_t ack,
+                             const std::uint8_t flags,
+                             const std::uint16_t mss = 0,
+                             const std::uint16_t window = 0xffff)
+{
+    const IPv4Header *oip = ip_of(ours);
+    const TCPHeader *otcp = tcp_of(ours);
+    const size_t opt_len = mss ? 4 : 0;
+    const size_t size = sizeof(IPv4Header) + sizeof(TCPHeader) + opt_len;
+    BufferAllocated buf(size, 0);
+    std::uint8_t *b = buf.write_alloc(size);
+    std::memset(b, 0, size);
+
+    IPv4Header *ip = reinterpret_cast<IPv4Header *>(b);
+    ip->version_len = IPv4Header::ver_len(4, sizeof(IPv4Header));
+    ip->tot_len = htons(static_cast<std::uint16_t>(size));
+    ip->ttl = 64;
+    ip->protocol = IPCommon::TCP;
+    ip->saddr = oip->daddr;
+    ip->daddr = oip->saddr;
+    ip->check = IPChecksum::checksum(b, sizeof(IPv4Header));
+
+    TCPHeader *tcp = reinterpret_cast<TCPHeader *>(b + sizeof(IPv4Header));
+    tcp->source = otcp->dest;
+    tcp->dest = otcp->source;
+    tcp->seq = htonl(seq);
+    tcp->ack_seq = htonl(ack);
+    tcp->doff_res = static_cast<std::uint8_t>(((sizeof(TCPHeader) + opt_len) / 4) << 4);
+    tcp->flags = flags;
+    tcp->window = htons(window);
+    if (mss)
+    {
+        std::uint8_t *opt = reinterpret_cast<std::uint8_t *>(tcp + 1);
+        opt[0] = TCPHeader::OPT_MAXSEG;
+        opt[1] = TCPHeader::OPTLEN_MAXSEG;
+        opt[2] = static_cast<std::uint8_t>(mss >> 8);
+        opt[3] = static_cast<std::uint8_t>(mss);
+    }
+    return buf;
+}
+
+struct StackFixture
+{
+    StackFixture(const std::string &flow_spec)
+    {
+        config = TunStack::ClientConfig::new_obj();
+        config->frame = frame_init_simple(2048);
+        config->stats.reset(new SessionStats());
+        config->flows.push_back(TunStack::Flow::parse(flow_spec));
+        tun = config->new_tun_client_obj(io_context, parent, nullptr);
+        const OptionList opt = OptionList::parse_from_config_static("ifconfig 10.29.41.2 255.255.255.0\n"
+                                                                    "route-gateway 10.29.41.1\n",
+                                                                    nullptr);
+        static_cast<TunStack::Client *>(tun.get())->start(opt);
+    }
+
+    ~StackFixture()
+    {
+        tun->stop();
+        io_context.run();
+    }
+
+    openvpn_io::io_context io_context;
+    CaptureParent parent;
+    TunStack::ClientConfig::Ptr config;
+    TunClient::Ptr tun;
+};
+
+} // namespace
+
+TEST(tunstack, flow_parse)
+{
+    const TunStack::Flow f = TunStack::Flow::parse("tcp,port=5001,bytes=1000000,window=64,dest=10.8.0.1");
+    EXPECT_EQ(f.type, TunStack::Flow::TCP);
+    EXPECT_EQ(f.port, 5001);
+    EXPECT_EQ(f.bytes, 1000000u);
+    EXPECT_EQ(f.window, 64u);
+    EXPECT_EQ(f.dest.to_string(), "10.8.0.1");
+
+    EXPECT_EQ(TunStack::Flow::parse("ping").type, TunStack::Flow::PING);
+    EXPECT_THROW(TunStack::Flow::parse("sctp"), TunStack::tun_stack_error);
+    EXPECT_THROW(TunStack::Flow::parse("udp,speed=1"), TunStack::tun_stack_error);
+    EXPECT_THROW(TunStack::Flow::parse("udp,dest=fd00::1"), TunStack::tun_stack_error);
+}
+
+TEST(tunstack, tcp_transfer)
+{
+    StackFixture s("tcp,port=5001,bytes=3000");
+    EXPECT_TRUE(s.parent.connected);
+
+    // SYN with MSS option derived from the default MTU
+    ASSERT_EQ(s.parent.packets.size(), 1u);
+    const std::vector<std::uint8_t> syn = s.parent.packets[0];
+    ASSERT_EQ(syn.size(), sizeof(IPv4Header) + sizeof(TCPHeader) + 4);
+    EXPECT_TRUE(tcp_checksum_ok(syn));
+    EXPECT_EQ(tcp_of(syn)->flags, TCPHeader::FLAG_SYN);
+    EXPECT_EQ(ntohs(tcp_of(syn)->dest), 5001);
+    EXPECT_EQ(ip_of(syn)->daddr, IPv4::Addr::from_string("10.29.41.1").to_uint32_net());
+    const std::uint8_t *opt = syn.data() + sizeof(IPv4Header) + sizeof(TCPHeader);
+    EXPECT_EQ(opt[0], TCPHeader::OPT_MAXSEG);
+    EXPECT_EQ((opt[2] << 8) | opt[3], 1460);
+
+    // SYN-ACK with a smaller MSS clamps the segment size
+    const std::uint32_t iss = ntohl(tcp_of(syn)->seq);
+    const std::uint32_t peer_iss = 7777;
+    BufferAllocated synack = peer_segment(syn, peer_iss, iss + 1, TCPHeader::FLAG_SYN | 0x10, 1000);
+    s.parent.packets.clear();
+    s.tun->tun_send(synack);
+
+    EXPECT_TRUE(s.config->flow_stats[0].established);
+    EXPECT_EQ(s.config->flow_stats[0].mss_received, 1000u);
+    ASSERT_EQ(s.parent.packets.size(), 4u); // ACK + 3 data segments
+    EXPECT_EQ(ntohl(tcp_of(s.parent.packets[0])->ack_seq), peer_iss + 1);
+    for (size_t i = 1; i < 4; ++i)
+    {
+        const std::vector<std::uint8_t> &p = s.parent.packets[i];
+        EXPECT_TRUE(tcp_checksum_ok(p));
+        EXPECT_EQ(p.size(), sizeof(IPv4Header) + sizeof(TCPHeader) + 1000);
+        EXPECT_EQ(ntohl(tcp_of(p)->seq), iss + 1 + 1000 * (i - 1));
+    }
+
+    // acknowledging all data triggers FIN
+    const std::vector<std::uint8_t> last = s.parent.packets[3];
+    BufferAllocated ack = peer_segment(last, peer_iss + 1, iss + 1 + 3000, 0x10);
+    s.parent.packets.clear();
+    s.tun->tun_send(ack);
+    EXPECT_EQ(s.config->flow_stats[0].bytes_acked, 3000);
+    ASSERT_EQ(s.parent.packets.size(), 1u);
+    EXPECT_TRUE(tcp_of(s.parent.packets[0])->flags & 0x01);
+    EXPECT_FALSE(s.config->flow_stats[0].finished);
+
+    // acknowledging the FIN completes the flow
+    BufferAllocated finack = peer_segment(last, peer_iss + 1, iss + 1 + 3001, 0x10);
+    s.tun->tun_send(finack);
+    EXPECT_TRUE(s.config->flow_stats[0].finished);
+    EXPECT_EQ(s.config->flow_stats[0].rtt_samples, 1);
+    EXPECT_EQ(s.config->flow_stats[0].retransmits, 0);
+}
+
+TEST(tunstack, echo_reply)
+{
+    StackFixture s("udp,rate=0");
+    ASSERT_TRUE(s.parent.packets.empty());
+
+    BufferAllocated buf(256, 0);
+    Ping4::generate_echo_request(buf,
+                                 IPv4::Addr::from_string("10.29.41.1"),
+                                 IPv4::Addr::from_string("10.29.41.2"),
+                                 nullptr,
+                                 0,
+                                 0x1234,
+                                 1,
+                                 64,
+                                 nullptr);
+    s.tun->tun_send(buf);
+
+    ASSERT_EQ(s.parent.packets.size(), 1u);
+    const std::vector<std::uint8_t> &reply = s.parent.packets[0];
+    const ICMPv4 *icmp = reinterpret_cast<const ICMPv4 *>(reply.data());
+    EXPECT_EQ(icmp->type, ICMPv4::ECHO_REPLY);
+    EXPECT_EQ(icmp->head.daddr, IPv4::Addr::from_string("10.29.41.1").to_uint32_net());
+    EXPECT_EQ(IPChecksum::checksum(reply.data() + sizeof(IPv4Header), reply.size() - sizeof(IPv4Header)), 0);
+    EXPECT_EQ(s.config->stats->get_stat(SessionStats::TUN_PACKETS_OUT), 1);
+    EXPECT_EQ(s.config->stats->get_stat(SessionStats::TUN_PACKETS_IN), 1);
+}
+
+TEST(tunstack, zero_window_probe)
+{
+    StackFixture s("tcp,port=5001,bytes=3000");
+    const std::vector<std::uint8_t> syn = s.parent.packets[0];
+    const std::uint32_t iss = ntohl(tcp_of(syn)->seq);
+    const std::uint32_t peer_iss = 7777;
+
+    // a closed window holds back all data
+    BufferAllocated synack = peer_segment(syn, peer_iss, iss + 1, TCPHeader::FLAG_SYN | 0x10, 1000, 0);
+    s.parent.packets.clear();
+    s.tun->tun_send(synack);
+    ASSERT_EQ(s.parent.packets.size(), 1u); // ACK only
+
+    // the persist timer sends a probe below snd.una
+    s.parent.packets.clear();
+    for (int i = 0; i < 4 && s.parent.packets.empty(); ++i) // skip the cancelled SYN timer
+        s.io_context.run_one_for(std::chrono::seconds(3));
+    ASSERT_EQ(s.parent.packets.size(), 1u);
+    const std::vector<std::uint8_t> probe = s.parent.packets[0];
+    EXPECT_TRUE(tcp_checksum_ok(probe));
+    EXPECT_EQ(ntohl(tcp_of(probe)->seq), iss);
+    EXPECT_EQ(probe.size(), sizeof(IPv4Header) + sizeof(TCPHeader));
+    EXPECT_EQ(s.config->flow_stats[0].window_probes, 1);
+    EXPECT_EQ(s.config->flow_stats[0].retransmits, 0);
+
+    // the answer to the probe opens the window
+    BufferAllocated ack = peer_segment(probe, peer_iss + 1, iss + 1, 0x10);
+    s.parent.packets.clear();
+    s.tun->tun_send(ack);
+    EXPECT_EQ(s.parent.packets.size(), 3u);
+}
+
+TEST(tunstack, echo_reply_source)
+{
+    StackFixture s("ping,rate=0");
+    const std::uint16_t id = 0x4f00; // first ping flow
+
+    // a reply with the right id from another host is not counted
+    for (const char *src : {"10.29.41.7", "10.29.41.1"})
+    {
+        BufferAllocated buf(256, 0);
+        Ping4::generate_echo_request(buf,
+                                     IPv4::Addr::from_string("10.29.41.2"),
+                                     IPv4::Addr::from_string(src),
+                                     nullptr,
+                                     0,
+                                     id,
+                                     1,
+                                     64,
+                                     nullptr);
+        Ping4::generate_echo_reply(buf, nullptr);
+        s.tun->tun_send(buf);
+    }
+    EXPECT_EQ(s.config->flow_stats[0].packets_in, 1);
+}
@@ -271,6 +271,25 @@ public class NetworkSpace {
         mIpAddresses.add(new IpAddress(address, mask, included));
     }
 
+    void removeIP(CIDRIP cidrIp, boolean include) {
+        removeIpAddress(new IpAddress(cidrIp, include));
+    }
+
+    void removeIPv6(Inet6Address address, int mask, boolean included) {
+        removeIpAddress(new IpAddress(address, mask, included));
+    }
+
+    private void removeIpAddress(IpAddress ip) {
+        // equal networks only differing in included are different routes
+        IpAddress existing = mIpAddresses.ceiling(ip);
+        if (existing != null && existing.equals(ip) && existing.included == ip.included)
+            mIpAddresses.remove(existing);
+    }
+
+    void addAll(NetworkSpace other) {
+        mIpAddresses.addAll(other.mIpAddresses);
+    }
+
     TreeSet<IpAddress> generateIPList() {
 
         PriorityQueue<IpAddress> networks = new PriorityQueue<IpAddress>(mIpAddresses);
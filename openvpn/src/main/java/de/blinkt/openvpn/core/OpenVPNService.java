@@ -106,6 +106,20 @@ public class OpenVPNService extends VpnService implements StateListener, Callbac
         private String mLocalIPv6 = null;
 
         private ProxyInfo mProxyInfo;
+
+        TunConfig() {
+        }
+
+        TunConfig(TunConfig tc) {
+            mDnslist.addAll(tc.mDnslist);
+            mRoutes.addAll(tc.mRoutes);
+            mRoutesv6.addAll(tc.mRoutesv6);
+            mDomain = tc.mDomain;
+            mLocalIP = tc.mLocalIP;
+            mMtu = tc.mMtu;
+            mLocalIPv6 = tc.mLocalIPv6;
+            mProxyInfo = tc.mProxyInfo;
+        }
     };
 
     private TunConfig tunConfig = new TunConfig();
@@ -1187,6 +1201,50 @@ public class OpenVPNService extends VpnService implements StateListener, Callbac
         }
     }
 
+    public void removeDNS(String dns) {
+        tunConfig.mDnslist.remove(dns);
+    }
+
+    public void removeDomain(String domain) {
+        if (domain.equals(tunConfig.mDomain))
+            tunConfig.mDomain = null;
+    }
+
+    public void removeRoute(CIDRIP route, boolean include) {
+        tunConfig.mRoutes.removeIP(route, include);
+    }
+
+    public void removeRoutev6(String network, boolean included) {
+        String[] v6parts = network.split("/");
+
+        try {
+            Inet6Address ip = (Inet6Address) InetAddress.getAllByName(v6parts[0])[0];
+            int mask = Integer.parseInt(v6parts[1]);
+            tunConfig.mRoutesv6.removeIPv6(ip, mask, included);
+        } catch (UnknownHostException e) {
+            VpnStatus.logException(e);
+        }
+    }
+
+    public void resetTunConfig() {
+        tunConfig = new TunConfig();
+    }
+
+    /**
+     * Continue from the configuration of the established tun interface, so
+     * that the OpenVPN 3 core only has to pass what changed on a reconnect.
+     */
+    public boolean startTunReconfigure() {
+        if (mLastTunCfg == null)
+            return false;
+        tunConfig = new TunConfig(mLastTunCfg);
+        return true;
+    }
+
+    public boolean isTunConfigChanged() {
+        return !getTunConfigString(tunConfig).equals(getTunConfigString(mLastTunCfg));
+    }
+
     /**
      * Route that is always included, used by the v3 core
      */
@@ -192,7 +192,7 @@ public class OpenVpnManagementThread implements Runnable, OpenVPNManagement {
 
             // Closing one of the two sockets also closes the other
             //mServerSocketLocal.close();
-            managmentCommand("version 3\n");
+            managmentCommand("version 4\n");
 
             while (true) {
 
@@ -292,6 +292,9 @@ public class OpenVpnManagementThread implements Runnable, OpenVPNManagement {
                 case "NEED-OK":
                     processNeedCommand(argument);
                     break;
+                case "TUNCFG":
+                    processTunConfig(argument);
+                    break;
                 case "BYTECOUNT":
                     processByteCount(argument);
                     break;
@@ -543,6 +546,45 @@ public class OpenVpnManagementThread implements Runnable, OpenVPNManagement {
                 FileDescriptor fdtoprotect = mFDList.pollFirst();
                 protectFileDescriptor(fdtoprotect);
                 break;
+            case "PERSIST_TUN_ACTION":
+                // check if tun cfg stayed the same
+                status = mOpenVPNService.getTunReopenStatus();
+                break;
+            case "OPENTUN":
+                if (sendTunFD(needed, extra))
+                    return;
+                else
+                    status = "cancel";
+                // This not nice or anything but setFileDescriptors accepts only FilDescriptor class :(
+
+                break;
+            default:
+                if (!applyTunConfig(needed, extra, argument)) {
+                    Log.e(TAG, "Unknown needok command " + argument);
+                    return;
+                }
+                break;
+        }
+
+        String cmd = String.format("needok '%s' %s\n", needed, status);
+        managmentCommand(cmd);
+    }
+
+    /**
+     * Tun configuration item sent without confirmation, as announced with version 4.
+     * The items are confirmed by the answer to the following PERSIST_TUN_ACTION or
+     * OPENTUN query.
+     */
+    private void processTunConfig(String argument) {
+        String[] parts = argument.split(" ", 2);
+        String extra = parts.length == 2 ? parts[1] : "";
+
+        if (!applyTunConfig(parts[0], extra, argument))
+            Log.e(TAG, "Unknown tun config item " + argument);
+    }
+
+    private boolean applyTunConfig(String needed, String extra, String argument) {
+        switch (needed) {
             case "DNSSERVER":
             case "DNS6SERVER":
                 mOpenVPNService.addDNS(extra);
@@ -586,18 +628,6 @@ public class OpenVpnManagementThread implements Runnable, OpenVPNManagement {
                 mtu = Integer.parseInt(ifconfig6parts[1]);
                 mOpenVPNService.setMtu(mtu);
                 mOpenVPNService.setLocalIPv6(ifconfig6parts[0]);
-                break;
-            case "PERSIST_TUN_ACTION":
-                // check if tun cfg stayed the same
-                status = mOpenVPNService.getTunReopenStatus();
-                break;
-            case "OPENTUN":
-                if (sendTunFD(needed, extra))
-                    return;
-                else
-                    status = "cancel";
-                // This not nice or anything but setFileDescriptors accepts only FilDescriptor class :(
-
                 break;
             case "HTTPPROXY":
                 String[] httpproxy = extra.split(" ");
@@ -608,12 +638,9 @@ public class OpenVpnManagementThread implements Runnable, OpenVPNManagement {
                 }
                 break;
             default:
-                Log.e(TAG, "Unknown needok command " + argument);
-                return;
+                return false;
         }
-
-        String cmd = String.format("needok '%s' %s\n", needed, status);
-        managmentCommand(cmd);
+        return true;
     }
 
 
@@ -2,10 +2,12 @@ package de.blinkt.openvpn.core;
 
 import android.annotation.SuppressLint;
 import android.content.Context;
+import android.os.Build;
 import android.os.Handler;
 import android.os.HandlerThread;
 import android.os.Looper;
 import android.os.Message;
+import android.os.ParcelFileDescriptor;
 import android.provider.Settings;
 import android.text.TextUtils;
 
@@ -21,6 +23,9 @@ import net.openvpn.ovpn3.ClientAPI_ProvideCreds;
 import net.openvpn.ovpn3.ClientAPI_Status;
 import net.openvpn.ovpn3.ClientAPI_TransportStats;
 
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.Locale;
 
 import de.blinkt.openvpn.R;
@@ -29,9 +34,12 @@ import de.blinkt.openvpn.VpnProfile;
 import static de.blinkt.openvpn.VpnProfile.AUTH_RETRY_NOINTERACT;
 
 import androidx.annotation.NonNull;
+import androidx.annotation.RequiresApi;
 
 public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable, OpenVPNManagement {
     final static long EmulateExcludeRoutes = (1 << 16);
+    /* "OVSP", see openvpn3/openvpn/client/clistatspage.hpp */
+    final static int STATS_PAGE_MAGIC = 0x5053564f;
 
     static {
         System.loadLibrary("ovpn3");
@@ -42,6 +50,15 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
     /* The methods in OpenVPN3 can take a long time, so we do async messages to handle them
      * to avoid ANR on the service main thread */
     private final Handler mHandler;
+    private final Runnable mPollStatus = this::pollStatus;
+    /* Stats the core keeps up to date in shared memory, read without JNI calls */
+    private ByteBuffer mStatsPage;
+    private int mBytesInOffset;
+    private int mBytesOutOffset;
+    /* Descriptor of the tun interface handed to the core, kept when the
+     * core reconfigures it on a reconnect instead of building a new one */
+    private int mTunFd = -1;
+    private boolean mReconfiguring;
 
     public OpenVPNThreadv3(OpenVPNService openVpnService, VpnProfile vp) {
         mVp = vp;
@@ -61,7 +78,7 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
         VpnStatus.logInfo(ClientAPI_OpenVPNClientHelper.platform());
         VpnStatus.logInfo(ClientAPI_OpenVPNClientHelper.copyright());
 
-        mHandler.postDelayed(this::pollStatus, OpenVPNManagement.mBytecountInterval * 1000);
+        mHandler.postDelayed(mPollStatus, OpenVPNManagement.mBytecountInterval * 1000);
 
         ClientAPI_Status status = connect();
         if (status.getError()) {
@@ -69,12 +86,14 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
             VpnStatus.addExtraHints(status.getMessage());
         }
         VpnStatus.updateStateString("NOPROCESS", "OpenVPN3 thread finished", R.string.state_noprocess, ConnectionStatus.LEVEL_NOTCONNECTED);
-        mHandler.removeCallbacks(this::pollStatus);
+        mHandler.removeCallbacks(mPollStatus);
     }
 
     @Override
     public boolean tun_builder_set_remote_address(String address, boolean ipv6) {
-        mService.setMtu(1500);
+        /* a reconfigured interface keeps its MTU */
+        if (!mReconfiguring)
+            mService.setMtu(1500);
         return true;
     }
 
@@ -119,6 +138,64 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
         return true;
     }
 
+    @Override
+    public boolean tun_builder_reconfigure_begin() {
+        mReconfiguring = mTunFd != -1 && mService.startTunReconfigure();
+        return mReconfiguring;
+    }
+
+    @Override
+    public boolean tun_builder_remove_route(String address, int prefix_length, int metric, boolean ipv6) {
+        if (ipv6)
+            mService.removeRoutev6(address + "/" + prefix_length, true);
+        else
+            mService.removeRoute(new CIDRIP(address, prefix_length), true);
+        return true;
+    }
+
+    @Override
+    public boolean tun_builder_remove_exclude_route(String address, int prefix_length, int metric, boolean ipv6) {
+        if (ipv6)
+            mService.removeRoutev6(address + "/" + prefix_length, false);
+        else
+            mService.removeRoute(new CIDRIP(address, prefix_length), false);
+        return true;
+    }
+
+    @Override
+    public boolean tun_builder_remove_dns_server(String address, boolean ipv6) {
+        mService.removeDNS(address);
+        return true;
+    }
+
+    @Override
+    public boolean tun_builder_remove_search_domain(String domain) {
+        mService.removeDomain(domain);
+        return true;
+    }
+
+    @Override
+    public int tun_builder_reconfigure_commit() {
+        mReconfiguring = false;
+        /* Nothing the VpnService knows about changed, e.g. only the remote address */
+        if (!mService.isTunConfigChanged()) {
+            mService.resetTunConfig();
+            return mTunFd;
+        }
+        /* VpnService cannot change an interface, but establish() updates the
+         * existing VPN network in place, so app connections survive */
+        ParcelFileDescriptor pfd = mService.openTun();
+        if (pfd == null)
+            return -1;
+        mTunFd = pfd.detachFd();
+        return mTunFd;
+    }
+
+    @Override
+    public void tun_builder_teardown(boolean disconnect) {
+        mTunFd = -1;
+    }
+
     @Override
     public boolean tun_builder_set_proxy_http(String host, int port)
     {
@@ -133,7 +210,8 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
 
     @Override
     public int tun_builder_establish() {
-        return mService.openTun().detachFd();
+        mTunFd = mService.openTun().detachFd();
+        return mTunFd;
     }
 
     @Override
@@ -153,7 +231,9 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
 
     @Override
     public boolean tun_builder_new() {
-
+        /* drop what an abandoned reconfiguration left behind */
+        mReconfiguring = false;
+        mService.resetTunConfig();
         return true;
     }
 
@@ -183,6 +263,8 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
 
         config.setContent(vpnconfig);
         config.setTunPersist(mVp.mPersistTun);
+        /* Reconnects only pass changed routes and DNS settings to the tun builder */
+        config.setTunReconfigure(mVp.mPersistTun);
         config.setGuiVersion(VpnProfile.getVersionEnvString(mService));
         config.setSsoMethods("openurl,webauth,crtext");
         config.setPlatformVersion(mVp.getPlatformVersionEnvString());
@@ -202,6 +284,11 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
             config.setEnableNonPreferredDCAlgorithms(true);
         if (!TextUtils.isEmpty(mVp.mTlSCertProfile))
             config.setTlsCertProfileOverride(mVp.mTlSCertProfile);
+        /* Let idle housekeeping, keepalive and stats timers share wakeups */
+        config.setTimerSlackMS(2000);
+        /* Reading the page safely needs the VarHandle fences */
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU)
+            config.setStatsPageMS(OpenVPNManagement.mBytecountInterval * 1000);
 
         ClientAPI_EvalConfig ec = eval_config(config);
         if (ec.getExternalPki()) {
@@ -282,7 +369,8 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
 
     @Override
     public void networkChange(boolean sameNetwork) {
-        mHandler.post(() -> { reconnect(1);});
+        // keeps the session if possible, reconnects otherwise
+        mHandler.post(() -> { migrate_transport(1);});
     }
 
     @Override
@@ -320,7 +408,7 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
                     VpnStatus.logInfo(R.string.info_from_server, info);
                 }
             }
-            case "COMPRESSION_ENABLED", "WARN" ->
+            case "COMPRESSION_ENABLED", "WARN", "TRANSPORT_MIGRATED" ->
                     VpnStatus.logInfo(String.format(Locale.US, "%s: %s", name, info));
             case "PAUSE" ->
                     VpnStatus.updateStateString(name, "VPN connection paused", R.string.state_userpause, ConnectionStatus.LEVEL_VPNPAUSED);
@@ -379,9 +467,57 @@ public class OpenVPNThreadv3 extends ClientAPI_OpenVPNClient implements Runnable
     }
 
     private void pollStatus() {
-        ClientAPI_TransportStats t = transport_stats();
-        long in = t.getBytesIn();
-        long out = t.getBytesOut();
-        VpnStatus.updateByteCount(in, out);
+        long[] inout = null;
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU)
+            inout = readStatsPage();
+
+        if (inout != null) {
+            VpnStatus.updateByteCount(inout[0], inout[1]);
+        } else {
+            ClientAPI_TransportStats t = transport_stats();
+            long in = t.getBytesIn();
+            long out = t.getBytesOut();
+            VpnStatus.updateByteCount(in, out);
+        }
+        mHandler.postDelayed(mPollStatus, OpenVPNManagement.mBytecountInterval * 1000);
+    }
+
+    /**
+     * Read the byte counters from the stats page of the core.
+     *
+     * @return bytes in and out, or null if the page is not available yet
+     */
+    @RequiresApi(Build.VERSION_CODES.TIRAMISU)
+    private long[] readStatsPage() {
+        if (mStatsPage == null) {
+            ByteBuffer page = stats_page();
+            if (page == null)
+                return null;
+            page.order(ByteOrder.nativeOrder());
+            if (page.getInt(0) != STATS_PAGE_MAGIC || page.getShort(4) < 1)
+                return null;
+
+            int headerSize = page.getShort(6) & 0xffff;
+            int n = page.getInt(12);
+            for (int i = 0; i < n; i++) {
+                String name = stats_name(i);
+                if (name.equals("BYTES_IN"))
+                    mBytesInOffset = headerSize + i * 8;
+                else if (name.equals("BYTES_OUT"))
+                    mBytesOutOffset = headerSize + i * 8;
+            }
+            mStatsPage = page;
+        }
+
+        /* sequence lock: retry while the core is writing or has written in between */
+        while (true) {
+            int seq = mStatsPage.getInt(8);
+            VarHandle.acquireFence();
+            long in = mStatsPage.getLong(mBytesInOffset);
+            long out = mStatsPage.getLong(mBytesOutOffset);
+            VarHandle.acquireFence();
+            if ((seq & 1) == 0 && mStatsPage.getInt(8) == seq)
+                return new long[]{in, out};
+        }
     }
 }
\ No newline at end of file